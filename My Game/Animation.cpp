@@ -0,0 +1,133 @@
+/// \file Animation.cpp
+/// \brief Code for the animation clips CAnimClips and the animator CAnimator.
+
+#include "Animation.h"
+
+#include <cstdlib>
+
+#include "SimdKernels.h"
+
+void CAnimClips::Clear() {
+  m_vClips.clear();
+  m_vFrames.clear();
+}
+
+/// Append a clip's frames to the frame table. The frame list is numbers and
+/// ranges separated by spaces or commas, where "0-3" is 0 1 2 3 and "3-0"
+/// is 3 2 1 0. A clip with no frames gets frame 0.
+/// \param name Clip name
+/// \param sprite Sprite index
+/// \param frames Frames within the sprite
+/// \param rate Frames per second
+/// \param loop Start again after the last frame
+/// \return Clip index
+
+uint32_t CAnimClips::Add(const char* name, uint32_t sprite,
+                         const char* frames, float rate, bool loop) {
+  SAnimClip clip;
+  clip.strName = name ? name : "";
+  clip.nFirst = (uint32_t)m_vFrames.size();
+  clip.fRate = rate > 0.0f ? rate : 0.0f;
+  clip.bLoop = loop;
+
+  SAnimFrame f;
+  f.nSprite = sprite;
+
+  for (const char* p = frames; p && *p;) {
+    char* end = nullptr;
+    const long a = strtol(p, &end, 10);
+    if (end == p) {  // a separator
+      ++p;
+      continue;
+    }
+
+    long b = a;
+    if (*end == '-') {
+      const char* q = end + 1;
+      b = strtol(q, &end, 10);
+      if (end == q) b = a;
+    }
+
+    for (long k = a;; k += a <= b ? 1 : -1) {
+      f.nFrame = (uint32_t)(k < 0 ? 0 : k);
+      m_vFrames.push_back(f);
+      if (k == b) break;
+    }
+
+    p = end;
+  }
+
+  clip.nCount = (uint32_t)m_vFrames.size() - clip.nFirst;
+  if (clip.nCount == 0) {
+    m_vFrames.push_back(f);
+    clip.nCount = 1;
+  }
+
+  m_vClips.push_back(clip);
+  return (uint32_t)m_vClips.size() - 1;
+}  // Add
+
+/// \param name Clip name
+/// \return Clip index, or -1 if there is no such clip
+
+int CAnimClips::Find(const char* name) const {
+  for (size_t i = 0; i < m_vClips.size(); ++i)
+    if (name && m_vClips[i].strName == name) return (int)i;
+  return -1;
+}
+
+/// Copy a clip's fields into an entity's slots and go to its first frame.
+/// \param i Entity
+/// \param clip Clip index
+
+void CAnimator::Start(size_t i, uint32_t clip) {
+  const SAnimClip& c = m_pClips->GetClip(clip);
+  m_vClip[i] = clip;
+  m_vPhase[i] = 0.0f;
+  m_vRate[i] = c.fRate;
+  m_vLength[i] = (float)c.nCount;
+  m_vLoop[i] = c.bLoop ? 1.0f : 0.0f;
+  m_vStart[i] = (int32_t)c.nFirst;
+  m_vFrame[i] = (int32_t)c.nFirst;
+}
+
+/// Clips may have moved in the frame table, as when gamesettings.xml is
+/// reloaded, so every entity starts its clip again from the new table. An
+/// entity whose clip is gone plays clip 0.
+/// \param pClips Clips
+
+void CAnimator::SetClips(const CAnimClips* pClips) {
+  m_pClips = pClips;
+  for (size_t i = 0; i < m_vClip.size(); ++i)
+    Start(i, m_vClip[i] < pClips->GetClipCount() ? m_vClip[i] : 0);
+}
+
+/// \param n Number of entities
+/// \param clip Clip for new entities
+
+void CAnimator::Resize(size_t n, uint32_t clip) {
+  const size_t old = m_vClip.size();
+  m_vClip.resize(n);
+  m_vPhase.resize(n);
+  m_vRate.resize(n);
+  m_vLength.resize(n);
+  m_vLoop.resize(n);
+  m_vStart.resize(n);
+  m_vFrame.resize(n);
+  for (size_t i = old; i < n; ++i) Start(i, clip);
+}
+
+/// \param i Entity
+/// \param clip Clip index
+
+void CAnimator::Play(size_t i, uint32_t clip) {
+  if (m_vClip[i] != clip) Start(i, clip);
+}
+
+/// \param dt Frame time in seconds
+
+void CAnimator::Update(float dt) {
+  SimdAnimate(m_vPhase.data(), m_vRate.data(), m_vLength.data(),
+              m_vLoop.data(), m_vStart.data(), m_vPhase.size(), dt,
+              m_vFrame.data());
+}
@@ -0,0 +1,118 @@
+/// \file Animation.h
+/// \brief Interface for the animation clips CAnimClips and the animator
+/// CAnimator.
+
+#ifndef __L4RC_GAME_ANIMATION_H__
+#define __L4RC_GAME_ANIMATION_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// \brief One frame of a clip: a sprite and a frame within it.
+struct SAnimFrame {
+  uint32_t nSprite = 0;  ///< Sprite index.
+  uint32_t nFrame = 0;   ///< Frame within the sprite.
+};
+
+/// \brief A clip, a run of entries in the frame table.
+struct SAnimClip {
+  std::string strName;  ///< Name in gamesettings.xml.
+  uint32_t nFirst = 0;  ///< First frame in the frame table.
+  uint32_t nCount = 1;  ///< Number of frames, at least one.
+  float fRate = 1.0f;   ///< Frames per second.
+  bool bLoop = true;    ///< Start again after the last frame.
+};
+
+/// \brief Every animation clip, compiled into one flat frame table.
+///
+/// Clips are read from the animations tag in gamesettings.xml and their
+/// frames are laid end to end in one table, so a clip is no more than where
+/// its frames start, how many there are and how fast they go. An entity's
+/// frame is then an index into the table, found without looking at the clip.
+class CAnimClips {
+ private:
+  std::vector<SAnimClip> m_vClips;    ///< Clips, in the order added.
+  std::vector<SAnimFrame> m_vFrames;  ///< Frames of every clip, by clip.
+
+ public:
+  void Clear(); ///< Remove every clip.
+
+  /// \brief Add a clip whose frames are all from one sprite.
+  /// \param name Clip name
+  /// \param sprite Sprite index
+  /// \param frames Frames within the sprite, such as "0-3 2 1"
+  /// \param rate Frames per second
+  /// \param loop Start again after the last frame
+  /// \return Clip index
+  uint32_t Add(const char* name, uint32_t sprite, const char* frames,
+               float rate, bool loop);
+
+  /// \brief Find a clip by name.
+  /// \param name Clip name
+  /// \return Clip index, or -1 if there is no such clip
+  int Find(const char* name) const;
+
+  size_t GetClipCount() const { return m_vClips.size(); } ///< Clips.
+  size_t GetFrameCount() const { return m_vFrames.size(); } ///< Frames.
+  const SAnimClip& GetClip(uint32_t i) const { return m_vClips[i]; } ///< Clip.
+
+  /// \brief Get a frame from the frame table.
+  const SAnimFrame& GetFrame(int32_t i) const { return m_vFrames[i]; }
+};
+
+/// \brief Animation state for many entities, one array per field.
+///
+/// Each entity plays one clip. Its rate, length, loop flag and first frame
+/// are copied from the clip when it starts, so that `Update()` is a single
+/// pass over flat arrays, with no per-entity timer objects, clip lookups or
+/// branches, done by SimdAnimate(). The phase counts frames rather than
+/// seconds, so that finding the frame is a conversion to int.
+class CAnimator {
+ private:
+  const CAnimClips* m_pClips = nullptr; ///< Clips played.
+  std::vector<uint32_t> m_vClip;   ///< Clip being played.
+  std::vector<float> m_vPhase;     ///< Frames into the clip.
+  std::vector<float> m_vRate;      ///< Frames per second.
+  std::vector<float> m_vLength;    ///< Frames in the clip.
+  std::vector<float> m_vLoop;      ///< 1 for a looping clip, else 0.
+  std::vector<int32_t> m_vStart;   ///< Clip's first frame in the table.
+  std::vector<int32_t> m_vFrame;   ///< Current frame in the table.
+
+  void Start(size_t i, uint32_t clip); ///< Copy a clip's fields.
+
+ public:
+  /// \brief Set the clips played, starting every entity's clip again.
+  /// \param pClips Clips, which must outlive the animator
+  void SetClips(const CAnimClips* pClips);
+
+  /// \brief Set the number of entities, new ones playing a clip.
+  /// \param n Number of entities
+  /// \param clip Clip for new entities
+  void Resize(size_t n, uint32_t clip);
+
+  /// \brief Play a clip, from the start unless it is already playing.
+  /// \param i Entity
+  /// \param clip Clip index
+  void Play(size_t i, uint32_t clip);
+
+  /// \brief Advance every entity.
+  /// \param dt Frame time in seconds
+  void Update(float dt);
+
+  /// \brief Get an entity's current frame.
+  const SAnimFrame& GetFrame(size_t i) const {
+    return m_pClips->GetFrame(m_vFrame[i]);
+  }
+
+  /// \brief Whether an entity's clip has stopped on its last frame.
+  bool IsDone(size_t i) const {
+    return m_vLoop[i] == 0.0f && m_vPhase[i] >= m_vLength[i] - 1.0f;
+  }
+
+  size_t GetCount() const { return m_vClip.size(); } ///< Entities.
+  uint32_t GetClip(size_t i) const { return m_vClip[i]; } ///< Clip playing.
+  const int32_t* GetFrames() const { return m_vFrame.data(); } ///< Frames.
+};
+
+#endif  //__L4RC_GAME_ANIMATION_H__
@@ -0,0 +1,179 @@
+/// \file AssetLoader.cpp
+/// \brief Code for the startup asset pipeline CAssetLoader.
+
+#include "AssetLoader.h"
+
+#include <fstream>
+#include <thread>
+
+/// Constructor.
+/// \param pJobs Job scheduler for the file reads
+/// \param pRenderer Sprite renderer
+/// \param pAudio Audio player
+
+CAssetLoader::CAssetLoader(CJobSystem* pJobs, LSpriteRenderer* pRenderer,
+                           LSound* pAudio)
+    : m_pJobs(pJobs), m_pRenderer(pRenderer), m_pAudio(pAudio) {}
+
+/// The fetch jobs refer to the asset list, so they must all be finished
+/// before it goes.
+
+CAssetLoader::~CAssetLoader() { m_graph.Wait(m_pJobs); }
+
+/// Get milliseconds since construction.
+/// \return Time in ms
+
+float CAssetLoader::Now() const {
+  return std::chrono::duration<float, std::milli>(Clock::now() - m_tStart)
+      .count();
+}
+
+/// Add an asset to the list.
+/// \param kind Kind of asset
+/// \param index Sprite or sound index
+/// \param name Tag name
+/// \param file File name
+/// \param firstFrame True if the first frame needs it
+
+void CAssetLoader::Add(eAssetKind kind, UINT index, const char* name,
+                       const char* file, bool firstFrame) {
+  m_dqAssets.emplace_back();
+  SAsset& asset = m_dqAssets.back();
+  asset.eKind = kind;
+  asset.nIndex = index;
+  asset.strName = name;
+  asset.strFile = file;
+  asset.bFirstFrame = firstFrame;
+
+  if (kind == eAssetKind::Sprite)
+    for (UINT i = (UINT)m_vSprites.size(); i <= index; i++)
+      m_vSprites.push_back(i);
+}
+
+/// Register a sprite.
+/// \param index Sprite index
+/// \param name Sprite tag name
+/// \param file Image file name
+/// \param firstFrame True if the first frame needs it
+
+void CAssetLoader::AddSprite(UINT index, const char* name, const char* file,
+                             bool firstFrame) {
+  Add(eAssetKind::Sprite, index, name, file, firstFrame);
+}
+
+/// Register a sound.
+/// \param index Sound index
+/// \param name Sound tag name
+/// \param file Sound file name
+
+void CAssetLoader::AddSound(UINT index, const char* name, const char* file) {
+  Add(eAssetKind::Sound, index, name, file, false);
+}
+
+/// Read an asset's file from start to end. Whoever moves the asset out of the
+/// queued state does the read, so a file is never read twice.
+/// \param asset The asset
+
+void CAssetLoader::Fetch(SAsset& asset) {
+  eFetch expected = eFetch::Queued;
+  if (!asset.eState.compare_exchange_strong(expected, eFetch::Fetching))
+    return;
+
+  if (!asset.strFile.empty()) {
+    std::ifstream file(asset.strFile, std::ios::binary);
+    std::vector<char> buffer(64 * 1024);
+    while (file.read(buffer.data(), buffer.size())) {}
+  }
+
+  asset.eState = eFetch::Fetched;
+}
+
+/// Hand an asset to the engine, which decodes it. Sprites must be loaded
+/// between `BeginResourceUpload()` and `EndResourceUpload()`.
+/// \param asset The asset
+
+void CAssetLoader::Load(SAsset& asset) {
+  if (asset.eKind == eAssetKind::Sprite) {
+    m_pRenderer->Load(asset.nIndex, asset.strName.c_str());
+    m_vSprites[asset.nIndex] = asset.nIndex;
+  } else {
+    m_pAudio->Load(asset.nIndex, asset.strName.c_str());
+  }
+
+  asset.bLoaded = true;
+  m_nLoaded++;
+}
+
+/// Queue a fetch job per asset, those for the first frame first. They go to
+/// the job system's background queue, which the workers run oldest first
+/// when they have nothing else to do, so the reads work down the list in
+/// priority order and never run inside a frame's task graph. From here on
+/// sprites are drawn as the placeholder until they are loaded.
+
+void CAssetLoader::Start() {
+  for (const SAsset& asset : m_dqAssets)
+    if (asset.eKind == eAssetKind::Sprite && !asset.bLoaded)
+      m_vSprites[asset.nIndex] = m_nPlaceholder;
+
+  m_graph.Clear();
+
+  for (int pass = 0; pass < 2; pass++)
+    for (SAsset& asset : m_dqAssets)
+      if (asset.bFirstFrame == (pass == 0))
+        m_graph.Add([this, &asset]() { Fetch(asset); });
+
+  m_graph.StartBackground(m_pJobs);
+}
+
+/// Load the first-frame assets in one upload. The main thread reads any file
+/// that no worker has started on, and waits for the ones in progress.
+
+void CAssetLoader::LoadFirstFrame() {
+  for (SAsset& asset : m_dqAssets)
+    if (asset.bFirstFrame) {
+      Fetch(asset);
+      while (asset.eState != eFetch::Fetched) std::this_thread::yield();
+    }
+
+  m_pRenderer->BeginResourceUpload();
+  for (SAsset& asset : m_dqAssets)
+    if (asset.bFirstFrame && !asset.bLoaded) Load(asset);
+  m_pRenderer->EndResourceUpload();
+
+  if (IsDone()) m_fTotalLoadTime = Now();
+}
+
+/// Load assets whose files have been read, in priority order, until the time
+/// budget runs out. At least one asset is loaded per call so that loading
+/// always finishes. Call this only while nothing else is using the renderer.
+
+void CAssetLoader::Update() {
+  if (IsDone()) return;
+
+  const float t0 = Now();
+  bool uploading = false;
+
+  for (SAsset& asset : m_dqAssets) {
+    if (asset.bLoaded || asset.eState != eFetch::Fetched) continue;
+
+    if (asset.eKind == eAssetKind::Sprite && !uploading) {
+      m_pRenderer->BeginResourceUpload();
+      uploading = true;
+    }
+
+    Load(asset);
+    if (Now() - t0 > m_fBudget) break;
+  }
+
+  if (uploading) m_pRenderer->EndResourceUpload();
+  if (IsDone()) m_fTotalLoadTime = Now();
+}
+
+/// Record the time to the first frame. Only the first call counts.
+/// \param t Time the first frame was presented
+
+void CAssetLoader::MarkFirstFrame(Clock::time_point t) {
+  if (m_fFirstFrameTime == 0.0f)
+    m_fFirstFrameTime =
+        std::chrono::duration<float, std::milli>(t - m_tStart).count();
+}
@@ -0,0 +1,142 @@
+/// \file AssetLoader.h
+/// \brief Interface for the startup asset pipeline CAssetLoader.
+
+#ifndef __L4RC_GAME_ASSETLOADER_H__
+#define __L4RC_GAME_ASSETLOADER_H__
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "Sound.h"
+#include "SpriteRenderer.h"
+
+/// \brief Kind of asset.
+enum class eAssetKind : UINT {
+  Sprite,  ///< Image, loaded by the sprite renderer.
+  Sound    ///< Sound, loaded by the audio player.
+};
+
+/// \brief The startup asset pipeline.
+///
+/// Assets are registered with a priority. `Start()` hands a job per file to
+/// the job system's background queue, and idle workers read the files into
+/// memory in priority order, so the disk is busy in parallel from the first
+/// moment without the reads ever running in a frame's task graph.
+/// `LoadFirstFrame()` then loads the assets needed for the first frame,
+/// fetching any that no worker has reached yet on the calling thread.
+/// Everything else is loaded by `Update()` a few at a time each frame, as soon
+/// as its file has been read, while the game is already playable. Until then
+/// the sprite table sends draws of that sprite to a placeholder.
+///
+/// The engine decodes and uploads from a file name on the thread that owns
+/// the device, so the decode itself stays on the main thread. What the workers
+/// take off the critical path is the disk: they read each file once, which
+/// leaves it in the OS file cache for the engine's own read. On a cold cache
+/// that is most of the cost.
+class CAssetLoader {
+ public:
+  typedef std::chrono::high_resolution_clock Clock;  ///< Timing clock.
+
+ private:
+  /// \brief Fetch state of an asset, advanced by whoever gets there first.
+  enum class eFetch : int { Queued, Fetching, Fetched };
+
+  /// \brief A registered asset.
+  struct SAsset {
+    eAssetKind eKind = eAssetKind::Sprite;  ///< Kind of asset.
+    UINT nIndex = 0;                ///< Sprite or sound index.
+    std::string strName;            ///< Tag name in gamesettings.xml.
+    std::string strFile;            ///< File, read ahead of the engine.
+    bool bFirstFrame = false;       ///< Needed for the first frame.
+    bool bLoaded = false;           ///< Handed to the engine.
+    std::atomic<eFetch> eState{eFetch::Queued};  ///< Fetch state.
+  };
+
+  CJobSystem* m_pJobs = nullptr;          ///< Job scheduler.
+  LSpriteRenderer* m_pRenderer = nullptr; ///< Sprite renderer.
+  LSound* m_pAudio = nullptr;             ///< Audio player.
+
+  std::deque<SAsset> m_dqAssets;  ///< Assets, a deque so addresses are stable.
+  CTaskGraph m_graph;             ///< One fetch job per asset.
+  std::vector<UINT> m_vSprites;   ///< Sprite to draw for each sprite index.
+  UINT m_nPlaceholder = 0;        ///< Sprite drawn until the real one loads.
+  size_t m_nLoaded = 0;           ///< Number of assets loaded.
+  float m_fBudget = 4.0f;         ///< Load time allowed per frame in ms.
+
+  const Clock::time_point m_tStart = Clock::now();  ///< Time origin.
+  float m_fFirstFrameTime = 0.0f;      ///< First frame presented, ms.
+  float m_fTotalLoadTime = 0.0f;       ///< Every asset loaded, ms.
+
+  /// \brief Add an asset to the list.
+  void Add(eAssetKind kind, UINT index, const char* name, const char* file,
+           bool firstFrame);
+
+  /// \brief Read an asset's file unless someone else already is.
+  void Fetch(SAsset& asset);
+
+  /// \brief Hand an asset to the engine.
+  void Load(SAsset& asset);
+
+  /// \brief Get milliseconds since construction.
+  float Now() const;
+
+ public:
+  /// \brief Constructor.
+  /// \param pJobs Job scheduler for the file reads
+  /// \param pRenderer Sprite renderer
+  /// \param pAudio Audio player
+  CAssetLoader(CJobSystem* pJobs, LSpriteRenderer* pRenderer, LSound* pAudio);
+
+  /// \brief Destructor waits for outstanding file reads.
+  ~CAssetLoader();
+
+  /// \brief Register a sprite.
+  /// \param index Sprite index
+  /// \param name Sprite tag name in gamesettings.xml
+  /// \param file Image file name
+  /// \param firstFrame True if the first frame needs it
+  void AddSprite(UINT index, const char* name, const char* file,
+                 bool firstFrame);
+
+  /// \brief Register a sound. Sounds are never needed for the first frame.
+  /// \param index Sound index
+  /// \param name Sound tag name in gamesettings.xml
+  /// \param file Sound file name
+  void AddSound(UINT index, const char* name, const char* file);
+
+  /// \brief Set the time allowed per frame for loading, in ms.
+  void SetBudget(float ms) { m_fBudget = ms; }
+
+  /// \brief Set the sprite drawn in place of sprites still loading.
+  void SetPlaceholder(UINT index) { m_nPlaceholder = index; }
+
+  /// \brief Start reading files on the worker threads.
+  void Start();
+
+  /// \brief Load the first-frame assets, waiting for them if need be.
+  void LoadFirstFrame();
+
+  /// \brief Load assets whose files have been read, within the time budget.
+  void Update();
+
+  /// \brief Record when the first frame was presented.
+  /// \param t Time the first frame was presented
+  void MarkFirstFrame(Clock::time_point t);
+
+  /// \brief Check whether every asset has been loaded.
+  bool IsDone() const { return m_nLoaded == m_dqAssets.size(); }
+
+  /// \brief Get the sprite to draw for each sprite index.
+  const std::vector<UINT>& GetSpriteTable() const { return m_vSprites; }
+
+  size_t GetLoadedCount() const { return m_nLoaded; }       ///< Assets loaded.
+  size_t GetAssetCount() const { return m_dqAssets.size(); } ///< Assets.
+  float GetFirstFrameTime() const { return m_fFirstFrameTime; } ///< In ms.
+  float GetTotalLoadTime() const { return m_fTotalLoadTime; }   ///< In ms.
+};
+
+#endif  //__L4RC_GAME_ASSETLOADER_H__
@@ -0,0 +1,163 @@
+/// \file AssetPack.cpp
+/// \brief Code for the cooked asset pack CAssetPack.
+
+#include "AssetPack.h"
+
+#include <windows.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+/// Destructor.
+
+CAssetPack::~CAssetPack() { Close(); }
+
+/// Check that an entry's size holds what its parameters say is in it, for
+/// the kinds whose parameters give a size: width times height bytes for a
+/// map and four bytes per pixel for an image.
+/// \param e Entry
+/// \return True if the data is big enough
+
+static bool FitsParams(const SPackEntry& e) {
+  const uint64_t area = (uint64_t)e.nParam[0] * e.nParam[1];
+
+  switch (e.eKind) {
+    case ePackKind::Map: return area <= e.nSize;
+    case ePackKind::Image: return area <= e.nSize / 4;
+    default: return true;
+  }
+}
+
+/// Map the whole file read-only and check that the header, the tables it
+/// points to, every entry's data and every hash slot lie inside it, and that
+/// every map and image is as big as its width and height say. A pack
+/// from another format version is refused, so a stale pack makes the game
+/// fall back to the source files, and a damaged one is refused rather than
+/// read out of bounds.
+/// \param fileName Pack file name
+/// \return True if the pack is open
+
+bool CAssetPack::Open(const char* fileName) {
+  Close();
+
+  HANDLE hFile = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE) return false;
+  m_hFile = hFile;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(hFile, &size) ||
+      size.QuadPart < (LONGLONG)sizeof(SPackHeader)) {
+    Close();
+    return false;
+  }
+  m_nSize = (uint64_t)size.QuadPart;
+
+  m_hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!m_hMapping) {
+    Close();
+    return false;
+  }
+
+  m_pBase = (const char*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+  if (!m_pBase) {
+    Close();
+    return false;
+  }
+
+  m_pHeader = (const SPackHeader*)m_pBase;
+
+  const SPackHeader& h = *m_pHeader;
+  if (memcmp(h.szMagic, "LPAK", 4) || h.nVersion != g_nPackVersion ||
+      h.nEntryOffset > m_nSize ||
+      h.nEntries > (m_nSize - h.nEntryOffset) / sizeof(SPackEntry) ||
+      h.nSlotOffset > m_nSize ||
+      h.nSlots > (m_nSize - h.nSlotOffset) / sizeof(uint32_t) ||
+      h.nSlots == 0 || (h.nSlots & (h.nSlots - 1))) {
+    Close();
+    return false;
+  }
+
+  m_pEntries = (const SPackEntry*)(m_pBase + h.nEntryOffset);
+  m_pSlots = (const uint32_t*)(m_pBase + h.nSlotOffset);
+
+  for (uint32_t i = 0; i < h.nEntries; i++) {
+    const SPackEntry& e = m_pEntries[i];
+    if (e.nOffset > m_nSize || e.nSize > m_nSize - e.nOffset ||
+        !memchr(e.szName, 0, sizeof(e.szName)) || !FitsParams(e)) {
+      Close();
+      return false;
+    }
+  }
+
+  for (uint32_t i = 0; i < h.nSlots; i++)
+    if (m_pSlots[i] > h.nEntries) {
+      Close();
+      return false;
+    }
+
+  return true;
+}
+
+/// Unmap the file and close the handles.
+
+void CAssetPack::Close() {
+  if (m_pBase) UnmapViewOfFile(m_pBase);
+  if (m_hMapping) CloseHandle(m_hMapping);
+  if (m_hFile) CloseHandle(m_hFile);
+
+  m_pBase = nullptr;
+  m_hMapping = nullptr;
+  m_hFile = nullptr;
+  m_nSize = 0;
+  m_pHeader = nullptr;
+  m_pEntries = nullptr;
+  m_pSlots = nullptr;
+}
+
+/// Hash the name and probe linearly from its slot. An empty slot ends the
+/// search, and so does having probed every slot, in case the table is full.
+/// `Open()` has checked that every slot holds a valid entry index.
+/// \param name Entry name
+/// \return Pointer to the entry, or nullptr
+
+const SPackEntry* CAssetPack::Find(const char* name) const {
+  if (!m_pBase) return nullptr;
+
+  const uint64_t key = PackHash(name, strlen(name));
+  const uint32_t mask = m_pHeader->nSlots - 1;
+  uint32_t i = (uint32_t)key & mask;
+
+  for (uint32_t n = 0; n < m_pHeader->nSlots; n++, i = (i + 1) & mask) {
+    const uint32_t slot = m_pSlots[i];
+    if (slot == 0) return nullptr;
+
+    const SPackEntry* pEntry = &m_pEntries[slot - 1];
+    if (pEntry->nKey == key && !strcmp(pEntry->szName, name)) return pEntry;
+  }
+
+  return nullptr;
+}
+
+/// Hash a source file the way the cooker does and compare it with the hash
+/// the entry was cooked from. A file that cannot be read counts as current,
+/// since the pack is then all there is.
+/// \param pEntry Entry
+/// \param fileName Source file name
+/// \return False if the file can be read and has changed since cooking
+
+bool CAssetPack::IsCurrent(const SPackEntry* pEntry,
+                           const char* fileName) const {
+  FILE* pFile = fopen(fileName, "rb");
+  if (!pFile) return true;
+
+  std::vector<char> bytes;
+  char buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+    bytes.insert(bytes.end(), buffer, buffer + n);
+  fclose(pFile);
+
+  return PackHash(bytes.data(), bytes.size()) == pEntry->nSourceHash;
+}
@@ -0,0 +1,126 @@
+/// \file AssetPack.h
+/// \brief Interface for the cooked asset pack CAssetPack.
+
+#ifndef __L4RC_GAME_ASSETPACK_H__
+#define __L4RC_GAME_ASSETPACK_H__
+
+#include <cstddef>
+#include <cstdint>
+
+/// \brief Kind of data in a pack entry.
+enum class ePackKind : uint32_t {
+  Image,     ///< 32-bit BGRA pixels, row major.
+  Sound,     ///< Raw PCM samples.
+  Font,      ///< Sprite font, as written by MakeSpriteFont.
+  Map,       ///< Tile map, one byte per tile, row major, no line breaks.
+};
+
+/// \brief Pack file header, at offset 0.
+struct SPackHeader {
+  char szMagic[4];         ///< Always "LPAK".
+  uint32_t nVersion;       ///< Format version.
+  uint32_t nEntries;       ///< Number of entries.
+  uint32_t nSlots;         ///< Hash slots, a power of two.
+  uint32_t nSources;       ///< Number of source file records.
+  uint32_t nPad;           ///< Unused, keeps what follows 8-byte aligned.
+  uint64_t nEntryOffset;   ///< Offset of the SPackEntry array.
+  uint64_t nSlotOffset;    ///< Offset of the hash slot array.
+  uint64_t nSourceOffset;  ///< Offset of the SPackSource array.
+};
+
+/// \brief A named piece of data in the pack.
+///
+/// The meaning of the three parameters depends on the kind. Images keep
+/// width and height, sounds keep sample rate, channel count and bits per
+/// sample, maps keep width and height in tiles.
+struct SPackEntry {
+  uint64_t nKey;          ///< Hash of the name.
+  uint64_t nHash;         ///< Hash of the data, the content address.
+  uint64_t nSourceHash;   ///< Hash of the source file it was cooked from.
+  uint64_t nOffset;       ///< Offset of the data.
+  uint64_t nSize;         ///< Size of the data in bytes.
+  ePackKind eKind;        ///< Kind of data.
+  uint32_t nParam[3];     ///< Kind-specific parameters.
+  char szName[64];        ///< Name, null terminated.
+};
+
+/// \brief A source file that went into the pack, for up-to-date checks.
+struct SPackSource {
+  uint64_t nTime;      ///< Last write time when cooked.
+  uint64_t nHash;      ///< Hash of the file contents.
+  char szPath[240];    ///< Path relative to the solution directory.
+};
+
+const uint32_t g_nPackVersion = 1;  ///< Current pack format version.
+
+/// \brief 64-bit FNV-1a hash.
+/// \param p Pointer to data
+/// \param n Size of data in bytes
+/// \param h Hash to continue from
+/// \return Hash
+inline uint64_t PackHash(const void* p, size_t n,
+                         uint64_t h = 0xcbf29ce484222325ULL) {
+  const unsigned char* b = (const unsigned char*)p;
+  for (size_t i = 0; i < n; i++) h = (h ^ b[i]) * 0x100000001b3ULL;
+  return h;
+}
+
+/// \brief The cooked asset pack.
+///
+/// A read-only view of a pack file written by the AssetCooker tool. The file
+/// is memory mapped, so opening it costs next to nothing and only the pages
+/// that are actually read become resident. Entries are found through an open
+/// addressing hash table stored in the file, so a lookup hashes the name and
+/// probes a slot or two rather than parsing anything.
+class CAssetPack {
+ private:
+  void* m_hFile = nullptr;     ///< File handle.
+  void* m_hMapping = nullptr;  ///< File mapping handle.
+  const char* m_pBase = nullptr;  ///< Start of the mapped file.
+  uint64_t m_nSize = 0;           ///< Size of the mapped file.
+
+  const SPackHeader* m_pHeader = nullptr;  ///< Header.
+  const SPackEntry* m_pEntries = nullptr;  ///< Entry array.
+  const uint32_t* m_pSlots = nullptr;      ///< Hash slots, entry index + 1.
+
+ public:
+  /// \brief Destructor unmaps the file.
+  ~CAssetPack();
+
+  /// \brief Map a pack file and check its header.
+  /// \param fileName Pack file name
+  /// \return True if the pack is open
+  bool Open(const char* fileName);
+
+  /// \brief Unmap the file.
+  void Close();
+
+  /// \brief Check whether a pack is open.
+  bool IsOpen() const { return m_pBase != nullptr; }
+
+  /// \brief Find an entry by name.
+  /// \param name Entry name
+  /// \return Pointer to the entry, or nullptr
+  const SPackEntry* Find(const char* name) const;
+
+  /// \brief Check whether an entry was cooked from a file as it is now.
+  /// \param pEntry Entry
+  /// \param fileName Source file name
+  /// \return False if the file can be read and has changed since cooking
+  bool IsCurrent(const SPackEntry* pEntry, const char* fileName) const;
+
+  /// \brief Get a pointer to an entry's data.
+  const void* GetData(const SPackEntry* pEntry) const {
+    return m_pBase + pEntry->nOffset;
+  }
+
+  /// \brief Get the number of entries.
+  uint32_t GetEntryCount() const {
+    return m_pHeader ? m_pHeader->nEntries : 0;
+  }
+
+  /// \brief Get the size of the mapped file in bytes.
+  uint64_t GetSize() const { return m_nSize; }
+};
+
+#endif  //__L4RC_GAME_ASSETPACK_H__
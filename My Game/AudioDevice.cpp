@@ -0,0 +1,139 @@
+/// \file AudioDevice.cpp
+/// \brief Code for the audio output devices CNullAudioDevice and
+/// CWaveOutDevice.
+
+#include "AudioDevice.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "Winmm.lib")
+
+/// Convert a sample to 16 bits, clamping anything out of range.
+/// \param x Sample in [-1, 1]
+/// \return 16 bit sample
+
+static inline int16_t ToPcm16(float x) {
+  x = std::max(-1.0f, std::min(1.0f, x));
+  return (int16_t)(x * 32767.0f);
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// CNullAudioDevice
+
+/// \param samples Left and right samples, interleaved
+/// \param frames Number of frames
+
+void CNullAudioDevice::Submit(const float* samples, size_t frames) {
+  for (size_t i = 0; i < 2 * frames; ++i)
+    m_fPeak = std::max(m_fPeak, std::fabs(samples[i]));
+  m_nFrames += frames;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CWaveOutDevice
+
+CWaveOutDevice::~CWaveOutDevice() { Close(); }
+
+/// Open the default device for 16 bit stereo and prepare the ring of
+/// buffers, which are reused for as long as the device is open.
+/// \param rate Frames per second
+/// \param buffers Number of buffers in the ring
+/// \param frames Frames per buffer
+/// \return False if it could not be opened
+
+bool CWaveOutDevice::Open(uint32_t rate, size_t buffers, size_t frames) {
+  Close();
+  m_nRate = rate;
+  m_nFrames = std::max<size_t>(frames, 64);
+
+#ifdef _WIN32
+  WAVEFORMATEX wf = {};
+  wf.wFormatTag = WAVE_FORMAT_PCM;
+  wf.nChannels = 2;
+  wf.nSamplesPerSec = rate;
+  wf.wBitsPerSample = 16;
+  wf.nBlockAlign = 4;
+  wf.nAvgBytesPerSec = rate * 4;
+
+  HWAVEOUT h = nullptr;
+  if (waveOutOpen(&h, WAVE_MAPPER, &wf, 0, 0, CALLBACK_NULL) !=
+      MMSYSERR_NOERROR)
+    return false;
+  m_hWaveOut = h;
+
+  m_vBuffers.resize(std::max<size_t>(buffers, 2));
+  for (std::vector<int16_t>& b : m_vBuffers) {
+    b.assign(2 * m_nFrames, 0);
+
+    WAVEHDR* hdr = new WAVEHDR();
+    hdr->lpData = (LPSTR)b.data();
+    hdr->dwBufferLength = (DWORD)(b.size() * sizeof(int16_t));
+    waveOutPrepareHeader(h, hdr, sizeof(WAVEHDR));
+    m_vHeaders.push_back(hdr);
+  }
+
+  m_nCurrent = m_nFilled = 0;
+  return true;
+#else
+  (void)buffers;
+  return false;
+#endif
+}  // Open
+
+void CWaveOutDevice::Close() {
+#ifdef _WIN32
+  if (m_hWaveOut) {
+    HWAVEOUT h = (HWAVEOUT)m_hWaveOut;
+    waveOutReset(h);  // hands back every queued buffer
+
+    for (void* p : m_vHeaders) {
+      waveOutUnprepareHeader(h, (WAVEHDR*)p, sizeof(WAVEHDR));
+      delete (WAVEHDR*)p;
+    }
+
+    waveOutClose(h);
+  }
+#endif
+
+  m_hWaveOut = nullptr;
+  m_vHeaders.clear();
+  m_vBuffers.clear();
+}  // Close
+
+/// Copy samples into the current buffer, sending it to the card when it is
+/// full. A buffer the card has not finished with is not written to, so when
+/// the ring is full the rest of the samples are dropped.
+/// \param samples Left and right samples, interleaved
+/// \param frames Number of frames
+
+void CWaveOutDevice::Submit(const float* samples, size_t frames) {
+#ifdef _WIN32
+  while (m_hWaveOut && frames > 0) {
+    WAVEHDR* hdr = (WAVEHDR*)m_vHeaders[m_nCurrent];
+    if (hdr->dwFlags & WHDR_INQUEUE) break;  // the card is behind
+
+    const size_t n = std::min(frames, m_nFrames - m_nFilled);
+    int16_t* dst = m_vBuffers[m_nCurrent].data() + 2 * m_nFilled;
+    for (size_t i = 0; i < 2 * n; ++i) dst[i] = ToPcm16(samples[i]);
+
+    samples += 2 * n;
+    frames -= n;
+    m_nFilled += n;
+
+    if (m_nFilled == m_nFrames) {
+      waveOutWrite((HWAVEOUT)m_hWaveOut, hdr, sizeof(WAVEHDR));
+      m_nCurrent = (m_nCurrent + 1) % m_vHeaders.size();
+      m_nFilled = 0;
+    }
+  }
+#else
+  (void)samples;
+#endif
+
+  m_nDropped += frames;
+}  // Submit
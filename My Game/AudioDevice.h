@@ -0,0 +1,91 @@
+/// \file AudioDevice.h
+/// \brief Interface for the audio output devices CAudioDevice,
+/// CNullAudioDevice and CWaveOutDevice.
+
+#ifndef __L4RC_GAME_AUDIODEVICE_H__
+#define __L4RC_GAME_AUDIODEVICE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// \brief Where the mixer's output goes.
+///
+/// The mixer hands over a frame's worth of stereo samples at a time, as
+/// floats in [-1, 1], left and right interleaved. A device must not block,
+/// since it is called from the game loop.
+class CAudioDevice {
+ public:
+  virtual ~CAudioDevice() = default; ///< Close the device.
+
+  virtual uint32_t GetRate() const = 0; ///< Frames per second.
+
+  /// \brief Take samples to play.
+  /// \param samples Left and right samples, interleaved
+  /// \param frames Number of frames, two samples each
+  virtual void Submit(const float* samples, size_t frames) = 0;
+};
+
+/// \brief A device that plays nothing, for servers and benchmarks.
+///
+/// It counts what it is given and keeps the loudest sample, so that a
+/// headless run can check that the mixer kept up and did not clip.
+class CNullAudioDevice : public CAudioDevice {
+ private:
+  uint32_t m_nRate = 44100; ///< Frames per second.
+  uint64_t m_nFrames = 0;   ///< Frames submitted so far.
+  float m_fPeak = 0.0f;     ///< Loudest sample so far.
+
+ public:
+  /// \brief Make a device.
+  /// \param rate Frames per second
+  explicit CNullAudioDevice(uint32_t rate = 44100) : m_nRate(rate) {}
+
+  uint32_t GetRate() const override { return m_nRate; } ///< Frame rate.
+  void Submit(const float* samples, size_t frames) override; ///< Count them.
+
+  uint64_t GetFrames() const { return m_nFrames; } ///< Frames submitted.
+  float GetPeak() const { return m_fPeak; } ///< Loudest sample.
+};
+
+/// \brief The default sound card, through the Windows waveOut API.
+///
+/// Samples are converted to 16 bits and queued in a ring of small buffers.
+/// A buffer goes to the sound card when it is full and is reused once the
+/// card says it is done with it. If every buffer is still queued, the game
+/// is running ahead of the card and the samples are dropped rather than
+/// waited for. Elsewhere than Windows it opens nothing and drops
+/// everything.
+class CWaveOutDevice : public CAudioDevice {
+ private:
+  void* m_hWaveOut = nullptr;              ///< Device handle.
+  std::vector<void*> m_vHeaders;           ///< One WAVEHDR per buffer.
+  std::vector<std::vector<int16_t>> m_vBuffers; ///< Samples per buffer.
+  size_t m_nCurrent = 0;  ///< Buffer being filled.
+  size_t m_nFilled = 0;   ///< Frames in it so far.
+  size_t m_nFrames = 1024; ///< Frames per buffer.
+  uint32_t m_nRate = 44100; ///< Frames per second.
+  uint64_t m_nDropped = 0; ///< Frames dropped because the ring was full.
+
+ public:
+  CWaveOutDevice() = default; ///< Closed device.
+  ~CWaveOutDevice(); ///< Close the device.
+  CWaveOutDevice(const CWaveOutDevice&) = delete; ///< One owner.
+  CWaveOutDevice& operator=(const CWaveOutDevice&) = delete; ///< One owner.
+
+  /// \brief Open the default device.
+  /// \param rate Frames per second
+  /// \param buffers Number of buffers in the ring
+  /// \param frames Frames per buffer
+  /// \return False if it could not be opened
+  bool Open(uint32_t rate, size_t buffers, size_t frames);
+
+  void Close(); ///< Stop and close the device, if open.
+
+  uint32_t GetRate() const override { return m_nRate; } ///< Frame rate.
+  void Submit(const float* samples, size_t frames) override; ///< Queue them.
+
+  uint64_t GetDropped() const { return m_nDropped; } ///< Frames dropped.
+};
+
+#endif  //__L4RC_GAME_AUDIODEVICE_H__
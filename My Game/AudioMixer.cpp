@@ -0,0 +1,613 @@
+/// \file AudioMixer.cpp
+/// \brief Code for the audio scheduler and mixer CAudioMixer.
+
+#include "AudioMixer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+///////////////////////////////////////////////////////////////////////////////
+// Wav files
+
+/// Read a little-endian unsigned integer.
+/// \param p Bytes
+/// \param n Number of bytes, at most 4
+/// \return Value
+
+static uint32_t ReadLE(const unsigned char* p, size_t n) {
+  uint32_t v = 0;
+  for (size_t i = n; i-- > 0;) v = (v << 8) | p[i];
+  return v;
+}
+
+/// Walk the chunks of a RIFF file until the data chunk, checking on the way
+/// that the format chunk says 16 bit PCM with one or two channels. Chunks
+/// the mixer has no use for are skipped.
+/// \param pFile File, left at the first sample
+/// \param info [out] Format and where the samples are
+/// \return False if it is not a 16 bit PCM wav file
+
+bool ReadWavHeader(FILE* pFile, SWavInfo& info) {
+  unsigned char b[16];
+  if (fread(b, 1, 12, pFile) != 12 || std::memcmp(b, "RIFF", 4) != 0 ||
+      std::memcmp(b + 8, "WAVE", 4) != 0)
+    return false;
+
+  bool bFormat = false;
+
+  while (fread(b, 1, 8, pFile) == 8) {
+    const uint32_t size = ReadLE(b + 4, 4);
+    const long skip = (long)size + (long)(size & 1);  // chunks are padded
+
+    if (std::memcmp(b, "fmt ", 4) == 0) {
+      if (size < 16 || fread(b, 1, 16, pFile) != 16) return false;
+      if (ReadLE(b, 2) != 1 || ReadLE(b + 14, 2) != 16) return false;
+
+      info.nChannels = ReadLE(b + 2, 2);
+      info.nRate = ReadLE(b + 4, 4);
+      if (info.nChannels < 1 || info.nChannels > 2 || info.nRate == 0)
+        return false;
+
+      bFormat = true;
+      if (fseek(pFile, skip - 16, SEEK_CUR) != 0) return false;
+    }  // if
+
+    else if (std::memcmp(b, "data", 4) == 0) {
+      if (!bFormat) return false;
+      info.nFrames = size / (2 * info.nChannels);
+      info.nOffset = ftell(pFile);
+      return true;
+    }  // else if
+
+    else if (fseek(pFile, skip, SEEK_CUR) != 0)
+      return false;
+  }  // while
+
+  return false;
+}  // ReadWavHeader
+
+/// \param file File name
+/// \param clip [out] Samples
+/// \return False if it could not be read
+
+bool LoadWav(const char* file, SAudioClip& clip) {
+  FILE* pFile = fopen(file, "rb");
+  if (pFile == nullptr) return false;
+
+  SWavInfo info;
+  bool ok = ReadWavHeader(pFile, info);
+
+  if (ok) {
+    clip.nChannels = info.nChannels;
+    clip.nRate = info.nRate;
+    clip.vSamples.resize((size_t)info.nFrames * info.nChannels);
+    clip.nFrames = (uint32_t)(fread(clip.vSamples.data(),
+                                    2 * info.nChannels, info.nFrames, pFile));
+    clip.vSamples.resize((size_t)clip.nFrames * info.nChannels);
+  }  // if
+
+  fclose(pFile);
+  return ok;
+}  // LoadWav
+
+///////////////////////////////////////////////////////////////////////////////
+// Mixing
+
+/// Bend a sample over the knee smoothly toward full scale, so that a loud
+/// moment is squashed rather than clipped. Below the knee it is unchanged,
+/// and the curve above it starts with the same slope and never reaches 1.
+/// \param x Sample
+/// \return Sample in (-1, 1)
+
+static inline float SoftLimit(float x) {
+  const float knee = 0.75f;
+  const float a = std::fabs(x);
+  if (a <= knee) return x;
+
+  const float u = (a - knee) / (1.0f - knee);
+  const float y = knee + (1.0f - knee) * u / (1.0f + u);
+  return x < 0.0f ? -y : y;
+}
+
+/// Mix a run of source frames into the output, resampling by linear
+/// interpolation, for as long as there are two source frames to
+/// interpolate between.
+/// \param src Source samples, channels interleaved
+/// \param ch Source channels, 1 or 2
+/// \param avail Source frames in src
+/// \param pos [in, out] Play position, relative to src
+/// \param step Source frames per output frame
+/// \param gl Left gain
+/// \param gr Right gain
+/// \param out Output, left and right interleaved
+/// \param frames Most output frames to mix
+/// \return Output frames mixed
+
+static size_t MixRun(const int16_t* src, uint32_t ch, size_t avail,
+                     double& pos, double step, float gl, float gr, float* out,
+                     size_t frames) {
+  const float k = 1.0f / 32768.0f;
+  size_t i = 0;
+
+  for (; i < frames; ++i) {
+    const size_t j = (size_t)pos;
+    if (j + 1 >= avail) break;
+    const float t = (float)(pos - (double)j);
+
+    const int16_t* a = src + j * ch;
+    const int16_t* b = a + ch;
+    const float l = (a[0] + (b[0] - a[0]) * t) * k;
+    const float r = ch == 2 ? (a[1] + (b[1] - a[1]) * t) * k : l;
+
+    out[2 * i] += l * gl;
+    out[2 * i + 1] += r * gr;
+    pos += step;
+  }  // for
+
+  return i;
+}  // MixRun
+
+///////////////////////////////////////////////////////////////////////////////
+// CAudioMixer
+
+CAudioMixer::CAudioMixer() { SetVoices(32); }
+
+CAudioMixer::~CAudioMixer() { Stop(); }
+
+/// \param n Real voices
+
+void CAudioMixer::SetVoices(size_t n) {
+  Stop();
+  m_vSlots.resize(n);
+}
+
+/// \param def Sound
+/// \return Sound index, or -1 if its file could not be read
+
+int CAudioMixer::Add(const SSoundDef& def) {
+  SSound snd;
+  snd.def = def;
+
+  if (def.bStream) {
+    FILE* pFile = fopen(def.strFile.c_str(), "rb");
+    if (pFile == nullptr) return -1;
+    const bool ok = ReadWavHeader(pFile, snd.wav);
+    fclose(pFile);
+    if (!ok) return -1;
+  }  // if
+
+  else if (!LoadWav(def.strFile.c_str(), snd.clip))
+    return -1;
+
+  m_vSounds.push_back(std::move(snd));
+  return (int)m_vSounds.size() - 1;
+}  // Add
+
+/// \param def Sound
+/// \param clip Samples
+/// \return Sound index
+
+int CAudioMixer::Add(const SSoundDef& def, const SAudioClip& clip) {
+  SSound snd;
+  snd.def = def;
+  snd.def.bStream = false;
+  snd.clip = clip;
+  m_vSounds.push_back(std::move(snd));
+  return (int)m_vSounds.size() - 1;
+}  // Add
+
+void CAudioMixer::Clear() {
+  Stop();
+  m_vSounds.clear();
+}
+
+void CAudioMixer::Stop() {
+  for (size_t s = 0; s < m_vSlots.size(); ++s) Release(s);
+  for (SSound& snd : m_vSounds) snd.nVoices = 0;
+
+  m_vRequests.clear();
+  m_vSound.clear();
+  m_vX.clear();
+  m_vY.clear();
+  m_vVolume.clear();
+  m_vPos.clear();
+  m_vScore.clear();
+  m_vSlot.clear();
+  m_vOrder.clear();
+  m_nReal = 0;
+}  // Stop
+
+/// \param name Sound name
+/// \return Sound index, or -1 if there is no such sound
+
+int CAudioMixer::Find(const char* name) const {
+  for (size_t i = 0; i < m_vSounds.size(); ++i)
+    if (name && m_vSounds[i].def.strName == name) return (int)i;
+  return -1;
+}
+
+/// \param sound Sound index
+/// \param x Position x in pixels
+/// \param y Position y in pixels
+/// \param volume Volume, on top of the sound's own
+
+void CAudioMixer::Play(uint32_t sound, float x, float y, float volume) {
+  if (sound >= m_vSounds.size() || volume <= 0.0f) return;
+
+  SRequest r;
+  r.nSound = sound;
+  r.nCellX = (int32_t)std::floor(x / m_fCoalesce);
+  r.nCellY = (int32_t)std::floor(y / m_fCoalesce);
+  r.fX = x;
+  r.fY = y;
+  r.fVolume = volume;
+  m_vRequests.push_back(r);
+}  // Play
+
+/// The volume falls off linearly to nothing at the sound's radius.
+/// \param sound Sound index
+/// \param x Position x in pixels
+/// \param y Position y in pixels
+/// \param volume Volume asked for
+/// \return Score, zero if out of range
+
+float CAudioMixer::Audibility(uint32_t sound, float x, float y,
+                              float volume) const {
+  const SSoundDef& def = m_vSounds[sound].def;
+  const float dx = x - m_fListenerX, dy = y - m_fListenerY;
+  const float d2 = dx * dx + dy * dy;
+  const float r = def.fRadius;
+  if (d2 >= r * r) return 0.0f;
+  return def.fPriority * def.fVolume * volume * (1.0f - std::sqrt(d2) / r);
+}  // Audibility
+
+/// Add a voice for a request, unless the sound already has as many voices
+/// as it may. Then the request takes over the sound's quietest voice if it
+/// is louder, and is dropped if not; either way one of the two is dropped.
+/// \param r Request
+
+void CAudioMixer::Start(const SRequest& r) {
+  SSound& snd = m_vSounds[r.nSound];
+  const float score = Audibility(r.nSound, r.fX, r.fY, r.fVolume);
+
+  if (snd.nVoices >= snd.def.nInstances) {
+    ++m_nDropped;
+
+    int victim = -1;
+    for (size_t v = 0; v < m_vSound.size(); ++v)
+      if (m_vSound[v] == r.nSound &&
+          (victim < 0 || m_vScore[v] < m_vScore[victim]))
+        victim = (int)v;
+
+    if (victim < 0 || m_vScore[victim] >= score) return;
+
+    if (m_vSlot[victim] >= 0) Release((size_t)m_vSlot[victim]);
+    m_vX[victim] = r.fX;
+    m_vY[victim] = r.fY;
+    m_vVolume[victim] = r.fVolume;
+    m_vPos[victim] = 0.0;
+    m_vScore[victim] = score;
+    m_vSlot[victim] = -1;
+    m_vOrder[victim] = m_nStarted++;
+    return;
+  }  // if
+
+  m_vSound.push_back(r.nSound);
+  m_vX.push_back(r.fX);
+  m_vY.push_back(r.fY);
+  m_vVolume.push_back(r.fVolume);
+  m_vPos.push_back(0.0);
+  m_vScore.push_back(score);
+  m_vSlot.push_back(-1);
+  m_vOrder.push_back(m_nStarted++);
+  ++snd.nVoices;
+}  // Start
+
+void CAudioMixer::Score() {
+  for (size_t v = 0; v < m_vSound.size(); ++v)
+    m_vScore[v] = Audibility(m_vSound[v], m_vX[v], m_vY[v], m_vVolume[v]);
+}
+
+/// Pick the highest scoring audible voices, as many as there are slots,
+/// with the older voice winning a tie so that equal sounds do not swap
+/// places from frame to frame. A real voice not picked gives up its slot,
+/// and a picked virtual voice takes a free one.
+
+void CAudioMixer::Schedule() {
+  m_vRank.clear();
+  for (uint32_t v = 0; v < (uint32_t)m_vSound.size(); ++v)
+    if (m_vScore[v] > 0.0f) m_vRank.push_back(v);
+
+  if (m_vRank.size() > m_vSlots.size()) {
+    auto better = [&](uint32_t a, uint32_t b) {
+      return m_vScore[a] > m_vScore[b] ||
+             (m_vScore[a] == m_vScore[b] && m_vOrder[a] < m_vOrder[b]);
+    };
+
+    std::nth_element(m_vRank.begin(), m_vRank.begin() + m_vSlots.size(),
+                     m_vRank.end(), better);
+    m_vRank.resize(m_vSlots.size());
+  }  // if
+
+  m_vDone.assign(m_vSound.size(), 0);  // picked, for now
+  for (uint32_t v : m_vRank) m_vDone[v] = 1;
+
+  for (size_t v = 0; v < m_vSound.size(); ++v)
+    if (m_vSlot[v] >= 0 && !m_vDone[v]) {
+      if (m_vScore[v] > 0.0f) ++m_nSteals;
+      Release((size_t)m_vSlot[v]);
+      m_vSlot[v] = -1;
+    }  // if
+
+  size_t free = 0;
+  for (uint32_t v : m_vRank) {
+    if (m_vSlot[v] >= 0) continue;
+    while (m_vSlots[free].nVoice >= 0) ++free;
+    m_vSlots[free].nVoice = (int32_t)v;
+    m_vSlot[v] = (int32_t)free;
+  }  // for
+
+  m_nReal = m_vRank.size();
+}  // Schedule
+
+/// \param slot Slot index
+
+void CAudioMixer::Release(size_t slot) {
+  SSlot& s = m_vSlots[slot];
+  if (s.pFile) fclose(s.pFile);
+  s.pFile = nullptr;
+  s.nVoice = -1;
+  s.vBuf.clear();
+  s.nBase = s.nNext = 0;
+}  // Release
+
+/// Make sure a stream's buffer holds every frame the voice is about to mix.
+/// Frames already played are dropped from the front, and chunks read onto
+/// the back. Play positions keep counting past the end of a looping
+/// stream, so the buffer is one continuous run and a read wraps to the
+/// start of the samples. The file is opened the first time, so a voice
+/// that was virtual starts reading where it has got to.
+/// \param s Slot playing it
+/// \param snd Sound
+/// \param pos Play position
+/// \param step Source frames per output frame
+/// \param frames Output frames about to be mixed
+/// \return False if the file could not be read
+
+bool CAudioMixer::Fill(SSlot& s, const SSound& snd, double pos, double step,
+                       size_t frames) {
+  const uint32_t ch = snd.wav.nChannels, total = snd.wav.nFrames;
+  if (total == 0) return false;
+
+  if (s.pFile == nullptr) {
+    s.pFile = fopen(snd.def.strFile.c_str(), "rb");
+    if (s.pFile == nullptr) return false;
+    s.vBuf.clear();
+    s.nBase = s.nNext = (uint64_t)pos;
+  }  // if
+
+  const uint64_t first = (uint64_t)pos;
+  if (first > s.nBase) {
+    const uint64_t n = std::min<uint64_t>(first - s.nBase, s.vBuf.size() / ch);
+    s.vBuf.erase(s.vBuf.begin(), s.vBuf.begin() + (size_t)(n * ch));
+    s.nBase += n;
+  }  // if
+
+  const uint64_t need = (uint64_t)(pos + (double)(frames + 1) * step) + 2;
+
+  while (s.nNext < need) {
+    if (!snd.def.bLoop && s.nNext >= total) break;
+
+    const uint64_t at = s.nNext % total;
+    const size_t n = (size_t)std::min<uint64_t>(m_nChunk, total - at);
+    const size_t old = s.vBuf.size();
+    s.vBuf.resize(old + n * ch);
+
+    size_t got = 0;
+    if (fseek(s.pFile, snd.wav.nOffset + (long)(at * ch * 2), SEEK_SET) == 0)
+      got = fread(&s.vBuf[old], 2 * ch, n, s.pFile);
+    s.vBuf.resize(old + got * ch);
+    ++m_nChunks;
+
+    if (got == 0) return false;  // shorter than its header says
+    s.nNext += got;
+  }  // while
+
+  return true;
+}  // Fill
+
+/// Pan by how far the voice is to the left or right within its radius, and
+/// resample to the device's rate. A looping clip is interpolated across the
+/// seam from its last frame to its first.
+/// \param v Voice index
+/// \param frames Output frames
+/// \return True if the voice has finished
+
+bool CAudioMixer::Mix(size_t v, size_t frames) {
+  const SSound& snd = m_vSounds[m_vSound[v]];
+  const SSoundDef& def = snd.def;
+  SSlot& s = m_vSlots[(size_t)m_vSlot[v]];
+  double& pos = m_vPos[v];
+
+  const uint32_t ch = def.bStream ? snd.wav.nChannels : snd.clip.nChannels;
+  const uint32_t rate = def.bStream ? snd.wav.nRate : snd.clip.nRate;
+  const uint32_t total = def.bStream ? snd.wav.nFrames : snd.clip.nFrames;
+  const double step = (double)rate / m_nRate;
+
+  const float g = def.fPriority > 0.0f ? m_vScore[v] / def.fPriority : 0.0f;
+  const float pan =
+      std::max(-1.0f, std::min(1.0f, (m_vX[v] - m_fListenerX) / def.fRadius));
+  const float gl = g * (pan > 0.0f ? 1.0f - pan : 1.0f);
+  const float gr = g * (pan < 0.0f ? 1.0f + pan : 1.0f);
+  float* out = m_vMix.data();
+
+  if (def.bStream) {
+    if (!Fill(s, snd, pos, step, frames)) return true;
+
+    double rel = pos - (double)s.nBase;
+    MixRun(s.vBuf.data(), ch, s.vBuf.size() / ch, rel, step, gl, gr, out,
+           frames);
+    pos = rel + (double)s.nBase;
+    return !def.bLoop && pos + 1.0 >= total;
+  }  // if
+
+  if (total == 0) return true;
+  const int16_t* src = snd.clip.vSamples.data();
+  size_t done = 0;
+
+  while (done < frames) {
+    done += MixRun(src, ch, total, pos, step, gl, gr, out + 2 * done,
+                   frames - done);
+    if (done == frames) break;
+    if (!def.bLoop) return true;
+
+    if (pos >= total) {
+      pos -= total;
+      continue;
+    }  // if
+
+    const int16_t* a = src + (size_t)(total - 1) * ch;
+    const float t = (float)(pos - (total - 1));
+    const float k = 1.0f / 32768.0f;
+    const float l = (a[0] + (src[0] - a[0]) * t) * k;
+    const float r = ch == 2 ? (a[1] + (src[1] - a[1]) * t) * k : l;
+    out[2 * done] += l * gl;
+    out[2 * done + 1] += r * gr;
+    pos += step;
+    ++done;
+  }  // while
+
+  if (def.bLoop && pos >= total) pos -= total;
+  return false;
+}  // Mix
+
+/// Close up the voice arrays over the voices that finished, in order, and
+/// point the slots of the voices that moved at their new places.
+
+void CAudioMixer::Remove() {
+  size_t n = 0;
+
+  for (size_t v = 0; v < m_vSound.size(); ++v) {
+    if (m_vDone[v]) {
+      if (m_vSlot[v] >= 0) {
+        Release((size_t)m_vSlot[v]);
+        --m_nReal;
+      }  // if
+      --m_vSounds[m_vSound[v]].nVoices;
+      continue;
+    }  // if
+
+    if (n != v) {
+      m_vSound[n] = m_vSound[v];
+      m_vX[n] = m_vX[v];
+      m_vY[n] = m_vY[v];
+      m_vVolume[n] = m_vVolume[v];
+      m_vPos[n] = m_vPos[v];
+      m_vScore[n] = m_vScore[v];
+      m_vSlot[n] = m_vSlot[v];
+      m_vOrder[n] = m_vOrder[v];
+      if (m_vSlot[n] >= 0) m_vSlots[(size_t)m_vSlot[n]].nVoice = (int32_t)n;
+    }  // if
+
+    ++n;
+  }  // for
+
+  m_vSound.resize(n);
+  m_vX.resize(n);
+  m_vY.resize(n);
+  m_vVolume.resize(n);
+  m_vPos.resize(n);
+  m_vScore.resize(n);
+  m_vSlot.resize(n);
+  m_vOrder.resize(n);
+}  // Remove
+
+/// Merge this frame's requests, start voices for what is left, score and
+/// schedule every voice, mix the real ones, move the virtual ones on, and
+/// submit the mix, scaled down for the voices in it and soft limited. The
+/// time it all takes is kept for the overlay.
+/// \param x Listener position x in pixels
+/// \param y Listener position y in pixels
+/// \param dt Frame time in seconds
+
+void CAudioMixer::Update(float x, float y, float dt) {
+  const auto t0 = std::chrono::high_resolution_clock::now();
+  m_fListenerX = x;
+  m_fListenerY = y;
+
+  std::sort(m_vRequests.begin(), m_vRequests.end(),
+            [](const SRequest& a, const SRequest& b) {
+              if (a.nSound != b.nSound) return a.nSound < b.nSound;
+              if (a.nCellX != b.nCellX) return a.nCellX < b.nCellX;
+              if (a.nCellY != b.nCellY) return a.nCellY < b.nCellY;
+              if (a.fVolume != b.fVolume) return a.fVolume > b.fVolume;
+              if (a.fX != b.fX) return a.fX < b.fX;
+              return a.fY < b.fY;
+            });
+
+  for (size_t i = 0; i < m_vRequests.size(); ++i) {
+    const SRequest& r = m_vRequests[i];
+    if (i > 0) {
+      const SRequest& q = m_vRequests[i - 1];
+      if (q.nSound == r.nSound && q.nCellX == r.nCellX &&
+          q.nCellY == r.nCellY) {
+        ++m_nCoalesced;
+        continue;
+      }  // if
+    }  // if
+    Start(r);
+  }  // for
+
+  m_vRequests.clear();
+
+  m_nRate = m_pDevice ? m_pDevice->GetRate() : 44100;
+  m_fCarry += (double)dt * m_nRate;
+  const size_t frames = (size_t)m_fCarry;
+  m_fCarry -= (double)frames;
+
+  Score();
+  Schedule();
+  const size_t mixed = m_nReal;
+
+  m_vMix.assign(2 * frames, 0.0f);
+
+  for (size_t v = 0; v < m_vSound.size(); ++v) {
+    if (m_vSlot[v] >= 0) {
+      m_vDone[v] = Mix(v, frames);
+      continue;
+    }  // if
+
+    const SSound& snd = m_vSounds[m_vSound[v]];
+    const bool bStream = snd.def.bStream;
+    const uint32_t rate = bStream ? snd.wav.nRate : snd.clip.nRate;
+    const uint32_t total = bStream ? snd.wav.nFrames : snd.clip.nFrames;
+
+    m_vPos[v] += (double)frames * rate / m_nRate;
+    if (m_vPos[v] + 1.0 < total) continue;
+
+    if (!snd.def.bLoop)
+      m_vDone[v] = 1;
+    else if (!bStream && total > 0)
+      m_vPos[v] = std::fmod(m_vPos[v], (double)total);
+  }  // for
+
+  Remove();
+
+  // voices add up roughly as the square root of how many there are, so
+  // that is the headroom, ramped from last frame's to stop it clicking
+  const float gain =
+      m_fVolume / std::sqrt((float)std::max<size_t>(mixed, 1));
+  for (size_t i = 0; i < frames; ++i) {
+    const float g = m_fGain + (gain - m_fGain) * (i + 1) / frames;
+    m_vMix[2 * i] = SoftLimit(m_vMix[2 * i] * g);
+    m_vMix[2 * i + 1] = SoftLimit(m_vMix[2 * i + 1] * g);
+  }  // for
+  if (frames > 0) m_fGain = gain;
+
+  if (m_pDevice && frames > 0) m_pDevice->Submit(m_vMix.data(), frames);
+
+  const auto t1 = std::chrono::high_resolution_clock::now();
+  m_fMixTime = std::chrono::duration<float, std::milli>(t1 - t0).count();
+}  // Update
@@ -0,0 +1,217 @@
+/// \file AudioMixer.h
+/// \brief Interface for the audio scheduler and mixer CAudioMixer.
+
+#ifndef __L4RC_GAME_AUDIOMIXER_H__
+#define __L4RC_GAME_AUDIOMIXER_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "AudioDevice.h"
+
+/// \brief Sound samples in memory, 16 bits, one or two channels.
+struct SAudioClip {
+  uint32_t nChannels = 1;      ///< 1 for mono, 2 for stereo.
+  uint32_t nRate = 44100;      ///< Frames per second.
+  uint32_t nFrames = 0;        ///< Number of frames.
+  std::vector<int16_t> vSamples; ///< Channels interleaved.
+};
+
+/// \brief Where the samples are in a wav file.
+struct SWavInfo {
+  uint32_t nChannels = 1; ///< 1 for mono, 2 for stereo.
+  uint32_t nRate = 44100; ///< Frames per second.
+  uint32_t nFrames = 0;   ///< Number of frames.
+  long nOffset = 0;       ///< Offset of the first sample in the file.
+};
+
+/// \brief Read the header of a 16 bit PCM wav file.
+/// \param pFile File, left at the first sample
+/// \param info [out] Format and where the samples are
+/// \return False if it is not a 16 bit PCM wav file
+bool ReadWavHeader(FILE* pFile, SWavInfo& info);
+
+/// \brief Load a 16 bit PCM wav file.
+/// \param file File name
+/// \param clip [out] Samples
+/// \return False if it could not be read
+bool LoadWav(const char* file, SAudioClip& clip);
+
+/// \brief A sound the game can play, from gamesettings.xml.
+struct SSoundDef {
+  std::string strName;       ///< Name the game plays it by.
+  std::string strFile;       ///< Wav file.
+  float fVolume = 1.0f;      ///< Volume at the listener.
+  float fPriority = 1.0f;    ///< Weight against other sounds.
+  float fRadius = 1024.0f;   ///< Distance in pixels it fades out over.
+  uint32_t nInstances = 8;   ///< Most voices playing it at once.
+  bool bLoop = false;        ///< Start again at the end.
+  bool bStream = false;      ///< Read from disk while playing.
+};
+
+/// \brief Schedules and mixes the game's sounds.
+///
+/// Every sound played is a voice, kept in parallel arrays, and every frame
+/// each voice is scored by its priority, volume and distance from the
+/// listener. Only the best few, as many as there are real voices, are
+/// mixed. The rest are virtual: their play position moves on, but no
+/// samples are read, so a sound that comes back into range or rises in
+/// the order resumes where it would have been. A real voice that loses its
+/// place to a louder one is counted as stolen. A voice out of range has a
+/// score of zero and is never mixed.
+///
+/// Requests for the same sound in the same frame are merged when they fall
+/// in the same cell of a grid as wide as the coalescing distance. The
+/// loudest request of a cell is the one played, so a hundred bullets
+/// hitting one wall are one sound rather than a hundred. A sound also has a
+/// most voices at once, and a request past that replaces the sound's
+/// quietest voice if it is louder, and is dropped if not.
+///
+/// A streamed sound is not loaded. Each real voice playing one has its own
+/// file handle and reads the samples it is about to mix, a chunk at a
+/// time, so a long piece of music costs a few chunks of memory.
+///
+/// `Update()` mixes as many frames as the frame time is worth, at the
+/// device's rate, and submits them. It does not allocate once the voice
+/// and request arrays have grown to what the game needs. The mix is scaled
+/// by one over the square root of the real voices in it, which keeps a
+/// crowd of sounds near full scale, and the odd peak left over is bent
+/// under full scale by a soft limiter, so the device never clips.
+class CAudioMixer {
+ private:
+  /// \brief A sound and its samples.
+  struct SSound {
+    SSoundDef def;        ///< What it is.
+    SAudioClip clip;      ///< Samples, if not streamed.
+    SWavInfo wav;         ///< Where the samples are, if streamed.
+    uint32_t nVoices = 0; ///< Voices playing it, real or virtual.
+  };
+
+  /// \brief A request to play a sound, this frame.
+  struct SRequest {
+    uint32_t nSound;  ///< Sound index.
+    int32_t nCellX;   ///< Coalescing cell x.
+    int32_t nCellY;   ///< Coalescing cell y.
+    float fX, fY;     ///< Position in pixels.
+    float fVolume;    ///< Volume.
+  };
+
+  /// \brief A real voice: what it plays and, if streamed, its file.
+  struct SSlot {
+    int32_t nVoice = -1;        ///< Voice index, or -1 if free.
+    FILE* pFile = nullptr;      ///< Stream file, if streamed.
+    std::vector<int16_t> vBuf;  ///< Streamed samples.
+    uint64_t nBase = 0;         ///< Play position of vBuf's first frame.
+    uint64_t nNext = 0;         ///< Play position of the next to read.
+  };
+
+  CAudioDevice* m_pDevice = nullptr; ///< Output.
+  std::vector<SSound> m_vSounds;     ///< Sounds, by index.
+  std::vector<SRequest> m_vRequests; ///< Requests this frame.
+
+  std::vector<uint32_t> m_vSound; ///< Sound per voice.
+  std::vector<float> m_vX;        ///< Position x per voice, pixels.
+  std::vector<float> m_vY;        ///< Position y per voice, pixels.
+  std::vector<float> m_vVolume;   ///< Volume asked for, per voice.
+  std::vector<double> m_vPos;     ///< Play position in source frames.
+  std::vector<float> m_vScore;    ///< Audibility this frame.
+  std::vector<int32_t> m_vSlot;   ///< Real voice slot, or -1 if virtual.
+  std::vector<uint32_t> m_vOrder; ///< When started, for ties.
+  std::vector<uint8_t> m_vDone;   ///< Finished this frame.
+
+  std::vector<SSlot> m_vSlots;    ///< Real voices.
+  std::vector<uint32_t> m_vRank;  ///< Voices by score, reused.
+  std::vector<float> m_vMix;      ///< Mixed frames, reused.
+
+  float m_fVolume = 1.0f;         ///< Master volume.
+  float m_fGain = 1.0f;           ///< Master volume over the headroom.
+  float m_fCoalesce = 64.0f;      ///< Coalescing cell size in pixels.
+  float m_fListenerX = 0.0f;      ///< Listener position x.
+  float m_fListenerY = 0.0f;      ///< Listener position y.
+  uint32_t m_nRate = 44100;       ///< Device frames per second.
+  double m_fCarry = 0.0;          ///< Fraction of a frame not mixed yet.
+  uint32_t m_nChunk = 16384;      ///< Frames per stream read.
+  uint32_t m_nStarted = 0;        ///< Voices started so far.
+
+  uint64_t m_nSteals = 0;         ///< Real voices taken by louder ones.
+  uint64_t m_nDropped = 0;        ///< Requests or voices over a limit.
+  uint64_t m_nCoalesced = 0;      ///< Requests merged into another.
+  uint64_t m_nChunks = 0;         ///< Stream chunks read.
+  size_t m_nReal = 0;             ///< Real voices after the last update.
+  float m_fMixTime = 0.0f;        ///< Time taken by the last update, ms.
+
+  /// \brief How loud a sound would be at the listener, times its priority.
+  float Audibility(uint32_t sound, float x, float y, float volume) const;
+
+  void Start(const SRequest& r); ///< Make a voice for a request.
+  void Score(); ///< Score every voice.
+  void Schedule(); ///< Pick the real voices.
+  void Release(size_t slot); ///< Free a real voice, closing its stream.
+  bool Fill(SSlot& s, const SSound& snd, double pos, double step,
+            size_t frames); ///< Read what a stream is about to mix.
+  bool Mix(size_t v, size_t frames); ///< Mix a real voice.
+  void Remove(); ///< Remove the voices that finished.
+
+ public:
+  CAudioMixer(); ///< Default real voices.
+  ~CAudioMixer(); ///< Close any streams.
+  CAudioMixer(const CAudioMixer&) = delete; ///< Owns file handles.
+  CAudioMixer& operator=(const CAudioMixer&) = delete; ///< Owns them.
+
+  /// \brief Set the device mixed frames go to.
+  /// \param pDevice Device, which must outlive the mixer, or nullptr
+  void SetDevice(CAudioDevice* pDevice) { m_pDevice = pDevice; }
+
+  /// \brief Set the number of real voices, stopping every voice.
+  /// \param n Real voices
+  void SetVoices(size_t n);
+
+  void SetVolume(float v) { m_fVolume = v; } ///< Master volume.
+  void SetCoalesce(float d) { m_fCoalesce = d > 1.0f ? d : 1.0f; } ///< Cell.
+  void SetChunk(uint32_t n) { m_nChunk = n > 256 ? n : 256; } ///< Chunk.
+
+  /// \brief Add a sound, loading its file unless it is streamed.
+  /// \param def Sound
+  /// \return Sound index, or -1 if its file could not be read
+  int Add(const SSoundDef& def);
+
+  /// \brief Add a sound whose samples are already in memory.
+  /// \param def Sound
+  /// \param clip Samples
+  /// \return Sound index
+  int Add(const SSoundDef& def, const SAudioClip& clip);
+
+  void Clear(); ///< Stop every voice and remove every sound.
+  void Stop(); ///< Stop every voice.
+
+  /// \brief Find a sound by name.
+  /// \param name Sound name
+  /// \return Sound index, or -1 if there is no such sound
+  int Find(const char* name) const;
+
+  /// \brief Ask for a sound to be played, from the next `Update()`.
+  /// \param sound Sound index
+  /// \param x Position x in pixels
+  /// \param y Position y in pixels
+  /// \param volume Volume, on top of the sound's own
+  void Play(uint32_t sound, float x, float y, float volume = 1.0f);
+
+  /// \brief Start the requested sounds, schedule, mix and submit.
+  /// \param x Listener position x in pixels
+  /// \param y Listener position y in pixels
+  /// \param dt Frame time in seconds
+  void Update(float x, float y, float dt);
+
+  size_t GetVoiceCount() const { return m_vSound.size(); } ///< Voices.
+  size_t GetRealCount() const { return m_nReal; } ///< Real voices mixed.
+  size_t GetSlotCount() const { return m_vSlots.size(); } ///< Most real.
+  uint64_t GetSteals() const { return m_nSteals; } ///< Voices stolen.
+  uint64_t GetDropped() const { return m_nDropped; } ///< Over a limit.
+  uint64_t GetCoalesced() const { return m_nCoalesced; } ///< Merged.
+  uint64_t GetChunks() const { return m_nChunks; } ///< Chunks read.
+  float GetMixTime() const { return m_fMixTime; } ///< Last update, ms.
+};
+
+#endif  //__L4RC_GAME_AUDIOMIXER_H__
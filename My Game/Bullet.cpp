@@ -2,7 +2,8 @@
 #include "GameDefines.h"
 
 
-CBullet::CBullet(b2World* world, const b2Vec2& pos, const b2Vec2& vel) {
+CBullet::CBullet(b2World* world, const b2Vec2& pos, const b2Vec2& vel,
+                 const b2Filter& filter) {
   b2BodyDef def;
   def.type = b2_dynamicBody;
   def.bullet = true;
@@ -16,6 +17,7 @@ CBullet::CBullet(b2World* world, const b2Vec2& pos, const b2Vec2& vel) {
   fd.density = 1.0f;
   fd.friction = 0.0f;
   fd.restitution = 0.0f;
+  fd.filter = filter;  // projectile layer
 
   m_body = world->CreateBody(&def);
   m_body->CreateFixture(&fd);
@@ -24,20 +26,13 @@ CBullet::CBullet(b2World* world, const b2Vec2& pos, const b2Vec2& vel) {
 
 CBullet::~CBullet() {}
 
-void CBullet::Update(float dt) { m_life -= dt; }
-
-void CBullet::Draw(LSpriteRenderer* renderer) {
+void CBullet::GetSpriteDesc(LSpriteDesc2D& desc) const {
   float scale = 32.0f;
-  LSpriteDesc2D desc;
   desc.m_nSpriteIndex = (UINT)eSprite::Bullet;
 
   b2Vec2 p = m_body->GetPosition();
   desc.m_vPos.x = p.x * scale;
   desc.m_vPos.y = p.y * scale;
-
-  renderer->Draw(&desc);
 }
 
-bool CBullet::IsDead() const { return m_life <= 0.0f; }
-
 b2Body* CBullet::GetBody() const { return m_body; }
@@ -5,16 +5,14 @@
 
 class CBullet {
  public:
-  CBullet(b2World* world, const b2Vec2& pos, const b2Vec2& vel);
+  CBullet(b2World* world, const b2Vec2& pos, const b2Vec2& vel,
+          const b2Filter& filter);
   ~CBullet();
 
-  void Update(float dt);
-  void Draw(LSpriteRenderer* renderer);
+  void GetSpriteDesc(LSpriteDesc2D& desc) const;
 
-  bool IsDead() const;
   b2Body* GetBody() const;
 
  private:
   b2Body* m_body = nullptr;
-  float m_life = 2.0f;
 };
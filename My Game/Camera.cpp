@@ -0,0 +1,69 @@
+/// \file Camera.cpp
+/// \brief Code for the camera CCamera.
+
+#include "Camera.h"
+
+#include <cmath>
+
+/// \param margin Added to every side, in pixels
+/// \return Rectangle
+
+SViewRect CCamera::GetRect(float margin) const {
+  const float hw = m_fWidth / 2 + margin;
+  const float hh = m_fHeight / 2 + margin;
+
+  SViewRect r;
+  r.fLeft = m_fX - hw;
+  r.fBottom = m_fY - hh;
+  r.fRight = m_fX + hw;
+  r.fTop = m_fY + hh;
+  return r;
+}  // GetRect
+
+/// \param x Target x in pixels
+/// \param y Target y in pixels
+
+void CCamera::Snap(float x, float y) {
+  m_fX = x + m_settings.fOffsetX;
+  m_fY = y + m_settings.fOffsetY;
+}
+
+/// The point to keep in the dead zone is the target plus the offset. The
+/// camera's goal is the nearest center that has that point inside the dead
+/// zone, which is where it is now if the point has not left it. The camera
+/// then moves the fraction of the way to the goal that the half-life allows
+/// in the frame time, so that two short frames move it as far as one long
+/// one.
+/// \param x Target x in pixels
+/// \param y Target y in pixels
+/// \param dt Frame time in seconds
+
+void CCamera::Follow(float x, float y, float dt) {
+  const float px = x + m_settings.fOffsetX;
+  const float py = y + m_settings.fOffsetY;
+
+  if (std::fabs(px - m_fX) > m_fWidth || std::fabs(py - m_fY) > m_fHeight) {
+    Snap(x, y);  // teleported
+    return;
+  }
+
+  const float hw = m_settings.fDeadWidth / 2;
+  const float hh = m_settings.fDeadHeight / 2;
+  float gx = m_fX, gy = m_fY;
+
+  if (px > m_fX + hw) gx = px - hw;
+  else if (px < m_fX - hw) gx = px + hw;
+  if (py > m_fY + hh) gy = py - hh;
+  else if (py < m_fY - hh) gy = py + hh;
+
+  if (m_settings.fHalfLife <= 0.0f) {
+    m_fX = gx;
+    m_fY = gy;
+    return;
+  }
+
+  const float t = dt > 0.0f ? 1.0f - std::exp2(-dt / m_settings.fHalfLife)
+                            : 0.0f;
+  m_fX += (gx - m_fX) * t;
+  m_fY += (gy - m_fY) * t;
+}  // Follow
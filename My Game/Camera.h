@@ -0,0 +1,109 @@
+/// \file Camera.h
+/// \brief Interface for the camera CCamera and its view rectangle.
+
+#ifndef __L4RC_GAME_CAMERA_H__
+#define __L4RC_GAME_CAMERA_H__
+
+/// \brief A rectangle in world space, in pixels, y up.
+struct SViewRect {
+  float fLeft = 0.0f;    ///< Smallest x.
+  float fBottom = 0.0f;  ///< Smallest y.
+  float fRight = 0.0f;   ///< Largest x.
+  float fTop = 0.0f;     ///< Largest y.
+
+  /// \brief Is a point inside, edges included?
+  /// \param x Position x
+  /// \param y Position y
+  /// \return True if it is inside
+  bool Contains(float x, float y) const {
+    return x >= fLeft && x <= fRight && y >= fBottom && y <= fTop;
+  }
+
+  /// \brief Does a box overlap it, touching included?
+  /// \param left Box's smallest x
+  /// \param bottom Box's smallest y
+  /// \param right Box's largest x
+  /// \param top Box's largest y
+  /// \return True if they overlap
+  bool Overlaps(float left, float bottom, float right, float top) const {
+    return right >= fLeft && left <= fRight && top >= fBottom &&
+           bottom <= fTop;
+  }
+
+  float GetWidth() const { return fRight - fLeft; } ///< Width.
+  float GetHeight() const { return fTop - fBottom; } ///< Height.
+  float GetCenterX() const { return (fLeft + fRight) / 2; } ///< Center x.
+  float GetCenterY() const { return (fBottom + fTop) / 2; } ///< Center y.
+};
+
+/// \brief How a camera follows its target, from gamesettings.xml.
+struct SCameraSettings {
+  float fOffsetX = 0.0f;    ///< Where the target is kept from the center, x.
+  float fOffsetY = 200.0f;  ///< Where the target is kept from the center, y.
+  float fDeadWidth = 0.0f;  ///< Width of the box the target moves freely in.
+  float fDeadHeight = 0.0f; ///< Height of that box.
+  float fHalfLife = 0.0f;   ///< Seconds to close half the gap, 0 to snap.
+  float fPadding = 32.0f;   ///< Added around the view for culling.
+};
+
+/// \brief A camera following a target, and the part of the world it shows.
+///
+/// The view is centered on the camera, the size of the window, which is
+/// what the renderer draws. The cull rectangle is the view padded on every
+/// side, so that anything drawn centered on its position and no bigger than
+/// twice the padding is kept whenever any of it is on screen. Every draw
+/// path culls against the same cull rectangle, so they agree on what is in
+/// view.
+///
+/// The camera does not move while the target stays inside the dead zone, a
+/// box around the offset point. When the target leaves it, the camera heads
+/// for the nearest position that puts the target back on the box's edge,
+/// closing the gap exponentially with the given half-life, which looks the
+/// same at any frame rate. A target more than a view away, after a respawn
+/// or a load, is jumped to.
+class CCamera {
+ private:
+  SCameraSettings m_settings; ///< How it follows.
+  float m_fX = 0.0f;          ///< Center x in pixels.
+  float m_fY = 0.0f;          ///< Center y in pixels.
+  float m_fWidth = 1024.0f;   ///< View width in pixels.
+  float m_fHeight = 768.0f;   ///< View height in pixels.
+
+  /// \brief Get the view grown by a margin on every side.
+  SViewRect GetRect(float margin) const;
+
+ public:
+  /// \brief Set how it follows. It stays where it is.
+  /// \param settings Settings
+  void SetSettings(const SCameraSettings& settings) { m_settings = settings; }
+
+  /// \brief Set the size of the view, the window's.
+  /// \param w Width in pixels
+  /// \param h Height in pixels
+  void SetViewSize(float w, float h) {
+    m_fWidth = w;
+    m_fHeight = h;
+  }
+
+  /// \brief Jump to where it would settle for a target.
+  /// \param x Target x in pixels
+  /// \param y Target y in pixels
+  void Snap(float x, float y);
+
+  /// \brief Follow a target.
+  /// \param x Target x in pixels
+  /// \param y Target y in pixels
+  /// \param dt Frame time in seconds
+  void Follow(float x, float y, float dt);
+
+  float GetX() const { return m_fX; } ///< Center x.
+  float GetY() const { return m_fY; } ///< Center y.
+  const SCameraSettings& GetSettings() const { return m_settings; } ///< How.
+
+  SViewRect GetView() const { return GetRect(0.0f); } ///< What is drawn.
+
+  /// \brief Get the view padded for culling.
+  SViewRect GetCullRect() const { return GetRect(m_settings.fPadding); }
+};
+
+#endif  //__L4RC_GAME_CAMERA_H__
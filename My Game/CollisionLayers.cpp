@@ -0,0 +1,110 @@
+/// \file CollisionLayers.cpp
+/// \brief Code for the collision layer matrix CCollisionMatrix.
+
+#include "CollisionLayers.h"
+
+#include <cstring>
+
+static_assert((uint32_t)eCollisionLayer::Size <= 16,
+              "a Box2D filter has room for 16 layers");
+
+/// Layer names in gamesettings.xml, in `eCollisionLayer` order.
+static const char* g_pLayerNames[] = {"world",      "player", "player-sensor",
+                                      "projectile", "pickup", "enemy"};
+
+static_assert(sizeof(g_pLayerNames) / sizeof(g_pLayerNames[0]) ==
+                  (size_t)eCollisionLayer::Size,
+              "every collision layer has a name");
+
+/// The default matrix. The world stops everything. Players stand on each
+/// other, and their sensors feel the world, other players and enemies but
+/// not bullets or each other. Bullets hit the world and enemies only, so
+/// they pass through the player who fired them. Pickups rest on the world
+/// and are touched by players, and enemies meet players and bullets but
+/// not each other, which the crowd keeps apart.
+
+CCollisionMatrix::CCollisionMatrix() {
+  typedef eCollisionLayer L;
+
+  Set(L::World, L::Player, true);
+  Set(L::World, L::PlayerSensor, true);
+  Set(L::World, L::Projectile, true);
+  Set(L::World, L::Pickup, true);
+  Set(L::World, L::Enemy, true);
+
+  Set(L::Player, L::Player, true);
+  Set(L::Player, L::PlayerSensor, true);
+  Set(L::Player, L::Pickup, true);
+  Set(L::Player, L::Enemy, true);
+
+  Set(L::PlayerSensor, L::Enemy, true);
+  Set(L::Projectile, L::Enemy, true);
+}  // constructor
+
+/// Make every layer collide with nothing, to build a matrix from scratch.
+
+void CCollisionMatrix::Clear() { memset(m_pMasks, 0, sizeof(m_pMasks)); }
+
+/// \param a A layer
+/// \param b Another layer, or the same one
+/// \param collide True if they collide
+
+void CCollisionMatrix::Set(eCollisionLayer a, eCollisionLayer b,
+                           bool collide) {
+  const uint16_t bitA = (uint16_t)(1u << (uint32_t)a);
+  const uint16_t bitB = (uint16_t)(1u << (uint32_t)b);
+
+  if (collide) {
+    m_pMasks[(uint32_t)a] |= bitB;
+    m_pMasks[(uint32_t)b] |= bitA;
+  } else {
+    m_pMasks[(uint32_t)a] &= (uint16_t)~bitB;
+    m_pMasks[(uint32_t)b] &= (uint16_t)~bitA;
+  }
+}  // Set
+
+/// Box2D lets two fixtures collide when each one's category is in the
+/// other's mask, which is what a symmetric matrix gives.
+/// \param layer Layer
+/// \return Filter
+
+b2Filter CCollisionMatrix::GetFilter(eCollisionLayer layer) const {
+  b2Filter filter;
+  filter.categoryBits = (uint16_t)(1u << (uint32_t)layer);
+  filter.maskBits = m_pMasks[(uint32_t)layer];
+  filter.groupIndex = 0;
+  return filter;
+}
+
+/// Each fixture's layer is the lowest bit of its category, so fixtures made
+/// without a filter, whose category is 1, count as world. Box2D flags the
+/// fixtures' contacts to be filtered again at the next step.
+/// \param pWorld World
+
+void CCollisionMatrix::Refilter(b2World* pWorld) const {
+  for (b2Body* b = pWorld->GetBodyList(); b; b = b->GetNext())
+    for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext()) {
+      const uint32_t category = f->GetFilterData().categoryBits;
+      uint32_t layer = 0;
+      while (layer < m_nLayers && !(category >> layer & 1)) layer++;
+      if (layer < m_nLayers)
+        f->SetFilterData(GetFilter((eCollisionLayer)layer));
+    }
+}  // Refilter
+
+/// \param layer Layer
+/// \return Name, or an empty string for `eCollisionLayer::Size`
+
+const char* CCollisionMatrix::GetName(eCollisionLayer layer) {
+  return layer < eCollisionLayer::Size ? g_pLayerNames[(uint32_t)layer] : "";
+}
+
+/// \param name Layer name
+/// \return Layer, or `eCollisionLayer::Size` if there is none
+
+eCollisionLayer CCollisionMatrix::Find(const char* name) {
+  if (name)
+    for (uint32_t i = 0; i < m_nLayers; i++)
+      if (!strcmp(name, g_pLayerNames[i])) return (eCollisionLayer)i;
+  return eCollisionLayer::Size;
+}
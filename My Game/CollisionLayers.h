@@ -0,0 +1,83 @@
+/// \file CollisionLayers.h
+/// \brief Interface for the collision layers and their matrix
+/// CCollisionMatrix.
+
+#ifndef __L4RC_GAME_COLLISIONLAYERS_H__
+#define __L4RC_GAME_COLLISIONLAYERS_H__
+
+#include <cstdint>
+
+#include "box2d/box2d.h"
+
+/// \brief Collision layer enumerated type.
+///
+/// What a fixture is, for deciding what it collides with. Each layer is a
+/// bit of a fixture's filter category. `Size` must be last, and there can
+/// be at most 16 layers, the bits in a Box2D filter.
+
+enum class eCollisionLayer : uint32_t {
+  World,        ///< Tiles and other level geometry.
+  Player,       ///< A player's body.
+  PlayerSensor, ///< A player's foot, head and wall sensors.
+  Projectile,   ///< Bullets.
+  Pickup,       ///< Items lying in the world.
+  Enemy,        ///< Enemies.
+  Size  // MUST BE LAST
+};  // eCollisionLayer
+
+/// \brief Which collision layers collide with which.
+///
+/// A symmetric matrix of layers, kept as a mask per layer. A fixture made
+/// with `GetFilter()` has its layer's bit as its category and its layer's
+/// row as its mask, so Box2D's broadphase drops a pair whose layers do not
+/// meet before it makes a contact, and the contact listener never sees it.
+/// The default matrix leaves out the pairs that only cost time: bullets
+/// with bullets, with the shooter and with every player's sensors, and
+/// sensors with sensors.
+///
+/// The layer is kept in the fixture's category, so `Refilter()` can apply
+/// a changed matrix to every fixture already in a world.
+class CCollisionMatrix {
+ private:
+  static const uint32_t m_nLayers =
+      (uint32_t)eCollisionLayer::Size; ///< Number of layers.
+  uint16_t m_pMasks[m_nLayers] = {}; ///< Layers each layer collides with.
+
+ public:
+  CCollisionMatrix(); ///< Constructor, with the default matrix.
+
+  void Clear(); ///< Make every layer collide with nothing.
+
+  /// \brief Set whether two layers collide, both ways.
+  /// \param a A layer
+  /// \param b Another layer, or the same one
+  /// \param collide True if they collide
+  void Set(eCollisionLayer a, eCollisionLayer b, bool collide);
+
+  /// \brief Check whether two layers collide.
+  /// \param a A layer
+  /// \param b Another layer, or the same one
+  /// \return True if they collide
+  bool Get(eCollisionLayer a, eCollisionLayer b) const {
+    return (m_pMasks[(uint32_t)a] >> (uint32_t)b & 1) != 0;
+  }
+
+  /// \brief Get the filter for a fixture on a layer.
+  /// \param layer Layer
+  /// \return Filter
+  b2Filter GetFilter(eCollisionLayer layer) const;
+
+  /// \brief Give every fixture in a world the filter for its layer.
+  /// \param pWorld World
+  void Refilter(b2World* pWorld) const;
+
+  /// \brief Get a layer's name in gamesettings.xml.
+  static const char* GetName(eCollisionLayer layer);
+
+  /// \brief Find a layer by its name in gamesettings.xml.
+  /// \param name Layer name
+  /// \return Layer, or `eCollisionLayer::Size` if there is none
+  static eCollisionLayer Find(const char* name);
+};
+
+#endif  //__L4RC_GAME_COLLISIONLAYERS_H__
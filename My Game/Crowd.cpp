@@ -0,0 +1,325 @@
+/// \file Crowd.cpp
+/// \brief Code for the enemy crowd CCrowd.
+
+#include "Crowd.h"
+#include "Tiles.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "WorldHash.h"
+
+/// Frames between ticks, by level of detail.
+static const uint32_t g_pLODPeriod[(int)eCrowdLOD::Count] = {1, 4, 16};
+
+/// Ticks between levels of detail being reassigned. This is the longest
+/// period, which every other one divides, so the runs are only permuted
+/// when each has ticked every one of its slices, and every agent has had
+/// exactly its share of ticks.
+static const uint32_t g_nLODInterval = 16;
+
+/// Longest distance in tiles an agent may move in one collision substep, so
+/// that it can never skip over a tile.
+static const float g_fMaxSubstep = 0.45f;
+
+/// Gap kept between an agent and a tile it was pushed out of.
+static const float g_fSkin = 1e-3f;
+
+/// Constructor.
+/// \param params Movement limits
+
+CCrowd::CCrowd(const SCrowdParams& params) : m_params(params) {}
+
+/// Set the tile map to collide with. The array is not copied.
+/// \param tiles One character per tile, row major, '0' is empty
+/// \param w Width in tiles
+/// \param h Height in tiles
+
+void CCrowd::SetMap(const char* tiles, int w, int h) {
+  m_pTiles = tiles;
+  m_nWidth = w;
+  m_nHeight = h;
+}
+
+/// Add an agent at rest. It goes in the far run, which is last, until the
+/// next reassignment of levels.
+/// \param x Position x, map space
+/// \param y Position y of the feet, map space
+/// \return Id
+
+uint32_t CCrowd::Add(float x, float y) {
+  const uint32_t id = (uint32_t)m_vIndex.size();
+  m_vIndex.push_back((uint32_t)m_vX.size());
+  m_vId.push_back(id);
+
+  m_vX.push_back(x);
+  m_vY.push_back(y);
+  m_vVX.push_back(0.0f);
+  m_vVY.push_back(0.0f);
+  m_vGoalX.push_back(x);
+  m_vGoalY.push_back(y);
+  m_vGrounded.push_back(0.0f);
+  m_vBlocked.push_back(0.0f);
+  m_vSpawnX.push_back(x);
+  m_vSpawnY.push_back(y);
+
+  m_pStart[(int)eCrowdLOD::Count] = m_vX.size();
+  return id;
+}
+
+/// Remove every agent.
+
+void CCrowd::Clear() {
+  for (std::vector<float>* v : {&m_vX, &m_vY, &m_vVX, &m_vVY, &m_vGoalX,
+                                &m_vGoalY, &m_vGrounded, &m_vBlocked,
+                                &m_vSpawnX, &m_vSpawnY})
+    v->clear();
+
+  m_vId.clear();
+  m_vIndex.clear();
+  std::fill(m_pStart, m_pStart + (int)eCrowdLOD::Count + 1, 0);
+  m_nFrame = 0;
+  m_nTicked = 0;
+}
+
+/// Hash every field that carries over from frame to frame, in index order,
+/// which the level of detail sort makes the same for the same history.
+/// \param h Hash to continue from
+/// \return Hash
+
+uint64_t CCrowd::Hash(uint64_t h) const {
+  for (const std::vector<float>* v : {&m_vX, &m_vY, &m_vVX, &m_vVY,
+                                      &m_vGoalX, &m_vGoalY, &m_vGrounded,
+                                      &m_vBlocked})
+    h = HashArray(*v, h);
+
+  h = HashArray(m_vId, h);
+  return HashValue(m_nFrame, h);
+}
+
+/// Set the view rectangle. Levels of detail follow it at the next
+/// reassignment.
+/// \param minX Left edge, map space
+/// \param minY Top edge, map space
+/// \param maxX Right edge, map space
+/// \param maxY Bottom edge, map space
+
+void CCrowd::SetView(float minX, float minY, float maxX, float maxY) {
+  m_fViewMinX = minX;
+  m_fViewMinY = minY;
+  m_fViewMaxX = maxX;
+  m_fViewMaxY = maxY;
+}
+
+/// Set every agent's steering target.
+/// \param x Target x, map space
+/// \param y Target y, map space
+
+void CCrowd::SetGoal(float x, float y) {
+  std::fill(m_vGoalX.begin(), m_vGoalX.end(), x);
+  std::fill(m_vGoalY.begin(), m_vGoalY.end(), y);
+}
+
+/// Set one agent's steering target.
+/// \param id Agent id
+/// \param x Target x, map space
+/// \param y Target y, map space
+
+void CCrowd::SetGoal(uint32_t id, float x, float y) {
+  const uint32_t i = m_vIndex[id];
+  m_vGoalX[i] = x;
+  m_vGoalY[i] = y;
+}
+
+/// Whether a tile blocks movement. The sides of the map are walls, and above
+/// and below it is open, so that an agent can fall out and respawn.
+/// \param x Column
+/// \param y Row, 0 at the top
+/// \return True if solid
+
+bool CCrowd::Solid(int x, int y) const {
+  if (x < 0 || x >= m_nWidth) return true;
+  if (y < 0 || y >= m_nHeight) return false;
+  return IsSolidTile(m_pTiles[(size_t)y * m_nWidth + x]);
+}
+
+/// Steer toward the goal, apply gravity and jump when on the ground and
+/// either stopped by a wall or below the goal. Every agent runs the same
+/// arithmetic, with selects in place of branches, over plain float arrays,
+/// so the loop vectorizes.
+/// \param begin First index
+/// \param end One past the last index
+/// \param dt Time step in seconds
+
+void CCrowd::Steer(size_t begin, size_t end, float dt) {
+  float* const x = m_vX.data();
+  float* const y = m_vY.data();
+  float* const vx = m_vVX.data();
+  float* const vy = m_vVY.data();
+  const float* const gx = m_vGoalX.data();
+  const float* const gy = m_vGoalY.data();
+  const float* const grounded = m_vGrounded.data();
+  const float* const blocked = m_vBlocked.data();
+
+  const float run = m_params.fRunSpeed;
+  const float blend = std::min(m_params.fAccel * dt, 1.0f);
+  const float fall = m_params.fGravity * dt;
+  const float jump = -m_params.fJumpSpeed;
+
+  for (size_t i = begin; i < end; ++i) {
+    const float dir = std::max(-1.0f, std::min(1.0f, gx[i] - x[i]));
+    vx[i] += (dir * run - vx[i]) * blend;
+
+    const float below = gy[i] < y[i] - 0.5f ? 1.0f : 0.0f;
+    const float takeoff = grounded[i] * std::max(blocked[i], below);
+    vy[i] = (vy[i] + fall) * (1.0f - takeoff) + jump * takeoff;
+  }
+}
+
+/// Move agents through the tile map, one axis at a time and in substeps
+/// short enough that no tile is skipped, stopping at solid tiles. Agents
+/// that fall out of the bottom of the map go back to where they were added.
+/// \param begin First index
+/// \param end One past the last index
+/// \param dt Time step in seconds
+
+void CCrowd::Move(size_t begin, size_t end, float dt) {
+  const float hw = m_params.fHalfWidth;
+  const float ht = m_params.fHeight;
+
+  for (size_t i = begin; i < end; ++i) {
+    float x = m_vX[i], y = m_vY[i];
+    float vx = m_vVX[i], vy = m_vVY[i];
+    float grounded = 0.0f, blocked = 0.0f;
+
+    const float dist = std::max(std::fabs(vx), std::fabs(vy)) * dt;
+    const int steps = std::max(1, (int)std::ceil(dist / g_fMaxSubstep));
+    const float h = dt / steps;
+
+    for (int s = 0; s < steps; ++s) {
+      if (vx != 0.0f) {  // horizontal, test the leading column
+        const float nx = x + vx * h;
+        const int col = vx > 0.0f ? (int)std::floor(nx + hw)
+                                  : (int)std::floor(nx - hw);
+        const int top = (int)std::floor(y - ht + g_fSkin);
+        const int bottom = (int)std::floor(y - g_fSkin);
+        bool hit = false;
+        for (int r = top; r <= bottom && !hit; ++r) hit = Solid(col, r);
+
+        if (hit) {
+          x = vx > 0.0f ? col - hw - g_fSkin : col + 1 + hw + g_fSkin;
+          vx = 0.0f;
+          blocked = 1.0f;
+        } else x = nx;
+      }
+
+      const float ny = y + vy * h;  // vertical, test the leading row
+      const int row = vy > 0.0f ? (int)std::floor(ny)
+                                : (int)std::floor(ny - ht);
+      const int left = (int)std::floor(x - hw + g_fSkin);
+      const int right = (int)std::floor(x + hw - g_fSkin);
+      bool hit = false;
+      for (int c = left; c <= right && !hit; ++c) hit = Solid(c, row);
+
+      if (hit) {
+        if (vy > 0.0f) {
+          y = (float)row;
+          grounded = 1.0f;
+        } else y = row + 1 + ht;
+        vy = 0.0f;
+      } else y = ny;
+    }
+
+    if (y > m_nHeight + ht) {  // fell out of the map
+      x = m_vSpawnX[i];
+      y = m_vSpawnY[i];
+      vx = vy = 0.0f;
+    }
+
+    m_vX[i] = x;
+    m_vY[i] = y;
+    m_vVX[i] = vx;
+    m_vVY[i] = vy;
+    m_vGrounded[i] = grounded;
+    m_vBlocked[i] = blocked;
+  }
+}
+
+/// Assign each agent a level of detail from its distance to the view, and
+/// if any has changed, permute the arrays with a stable counting sort so that
+/// each level is one contiguous run again.
+
+void CCrowd::AssignLOD() {
+  const size_t n = m_vX.size();
+  const float nearPad = m_params.fNearPad;
+  const float midRange = m_params.fMidRange;
+
+  m_vLOD.resize(n);
+  size_t count[(int)eCrowdLOD::Count] = {};
+  bool changed = false;
+  int run = 0;
+
+  for (size_t i = 0; i < n; ++i) {
+    const float dx = std::max(std::max(m_fViewMinX - m_vX[i], 0.0f),
+                              m_vX[i] - m_fViewMaxX);
+    const float dy = std::max(std::max(m_fViewMinY - m_vY[i], 0.0f),
+                              m_vY[i] - m_fViewMaxY);
+    const float d = std::max(dx, dy);
+    const uint8_t lod = d <= nearPad ? 0 : d <= midRange ? 1 : 2;
+
+    m_vLOD[i] = lod;
+    count[lod]++;
+    while (i >= m_pStart[run + 1]) ++run;
+    changed |= lod != run;
+  }
+
+  if (!changed) return;
+
+  size_t next[(int)eCrowdLOD::Count];
+  m_pStart[0] = 0;
+  for (int k = 0; k < (int)eCrowdLOD::Count; ++k) {
+    next[k] = m_pStart[k];
+    m_pStart[k + 1] = m_pStart[k] + count[k];
+  }
+
+  m_vOrder.resize(n);
+  for (size_t i = 0; i < n; ++i) m_vOrder[next[m_vLOD[i]]++] = (uint32_t)i;
+
+  m_vScratch.resize(n);
+  for (std::vector<float>* v : {&m_vX, &m_vY, &m_vVX, &m_vVY, &m_vGoalX,
+                                &m_vGoalY, &m_vGrounded, &m_vBlocked,
+                                &m_vSpawnX, &m_vSpawnY}) {
+    for (size_t i = 0; i < n; ++i) m_vScratch[i] = (*v)[m_vOrder[i]];
+    v->swap(m_vScratch);
+  }
+
+  for (size_t i = 0; i < n; ++i) m_vOrder[i] = m_vId[m_vOrder[i]];
+  m_vId.swap(m_vOrder);
+  for (size_t i = 0; i < n; ++i) m_vIndex[m_vId[i]] = (uint32_t)i;
+}
+
+/// Advance the agents due to tick this frame. Every run is split into as
+/// many slices as its period in frames, and one slice ticks each frame with
+/// the time step scaled by the period.
+/// \param dt Frame time in seconds
+
+void CCrowd::Update(float dt) {
+  if (m_pTiles == nullptr) return;
+  if (m_nFrame % g_nLODInterval == 0) AssignLOD();
+
+  m_nTicked = 0;
+
+  for (int k = 0; k < (int)eCrowdLOD::Count; ++k) {
+    const uint32_t period = g_pLODPeriod[k];
+    const uint32_t slice = m_nFrame % period;
+    const size_t n = m_pStart[k + 1] - m_pStart[k];
+    const size_t begin = m_pStart[k] + n * slice / period;
+    const size_t end = m_pStart[k] + n * (slice + 1) / period;
+
+    Steer(begin, end, dt * period);
+    Move(begin, end, dt * period);
+    m_nTicked += end - begin;
+  }
+
+  m_nFrame++;
+}
@@ -0,0 +1,149 @@
+/// \file Crowd.h
+/// \brief Interface for the enemy crowd CCrowd.
+
+#ifndef __L4RC_GAME_CROWD_H__
+#define __L4RC_GAME_CROWD_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// \brief Movement limits shared by every agent in a crowd.
+///
+/// Units are tiles and seconds, matching CPlayer at one tile per meter.
+struct SCrowdParams {
+  float fRunSpeed = 4.0f;    ///< Top horizontal speed.
+  float fAccel = 10.0f;      ///< Rate of approach to the desired speed.
+  float fJumpSpeed = 7.0f;   ///< Upward speed at takeoff.
+  float fGravity = 9.8f;     ///< Downward acceleration.
+  float fHalfWidth = 0.4f;   ///< Half the agent's width.
+  float fHeight = 1.4f;      ///< Agent's height.
+  float fNearPad = 4.0f;     ///< Margin around the view that is on screen.
+  float fMidRange = 64.0f;   ///< Margin around the view at mid rate.
+};
+
+/// \brief Level of detail, which sets how often an agent ticks.
+enum class eCrowdLOD : uint8_t {
+  Near,  ///< On screen, ticks every frame.
+  Mid,   ///< Close to the screen, ticks every 4th frame.
+  Far,   ///< Everywhere else, ticks every 16th frame.
+  Count  ///< Number of levels.
+};
+
+/// \brief The enemy crowd.
+///
+/// A lightweight alternative to a Box2D body per enemy. Agents are axis
+/// aligned boxes that collide with the tile grid kinematically, one axis at a
+/// time, and with nothing else. State is stored as a structure of arrays, one
+/// array per field, so the steering pass is a set of straight loops over
+/// floats with no branches or calls that the compiler can vectorize.
+///
+/// Agents are kept sorted by level of detail, so each level is one
+/// contiguous run of the arrays. Near agents tick every frame. Mid and far
+/// agents tick every 4th and 16th frame with a time step to match, a
+/// different slice of their run each frame so that the load is even. Levels
+/// are reassigned every 16 frames, when every slice of every run has ticked,
+/// from the distance to the view, and the arrays permuted to match, so an
+/// agent's index is not stable. Use its id, which is.
+///
+/// Positions are in map space, tiles with row 0 at the top, and are the
+/// middle of the agent's feet. The tile array is not copied and must outlive
+/// the crowd or the next call to `SetMap()`.
+class CCrowd {
+ private:
+  SCrowdParams m_params;             ///< Movement limits.
+  const char* m_pTiles = nullptr;    ///< Tile map, '0' is empty.
+  int m_nWidth = 0;                  ///< Map width in tiles.
+  int m_nHeight = 0;                 ///< Map height in tiles.
+
+  std::vector<float> m_vX;           ///< Position x.
+  std::vector<float> m_vY;           ///< Position y, feet.
+  std::vector<float> m_vVX;          ///< Velocity x.
+  std::vector<float> m_vVY;          ///< Velocity y, positive is down.
+  std::vector<float> m_vGoalX;       ///< Steering target x.
+  std::vector<float> m_vGoalY;       ///< Steering target y.
+  std::vector<float> m_vGrounded;    ///< 1 if standing on a tile, else 0.
+  std::vector<float> m_vBlocked;     ///< 1 if a wall stopped it, else 0.
+  std::vector<float> m_vSpawnX;      ///< Respawn position x.
+  std::vector<float> m_vSpawnY;      ///< Respawn position y.
+  std::vector<uint32_t> m_vId;       ///< Stable id by index.
+  std::vector<uint32_t> m_vIndex;    ///< Index by id.
+
+  std::vector<uint8_t> m_vLOD;       ///< Level by index, while sorting.
+  std::vector<uint32_t> m_vOrder;    ///< Sorted order, while sorting.
+  std::vector<float> m_vScratch;     ///< Permuted field, while sorting.
+
+  size_t m_pStart[(int)eCrowdLOD::Count + 1] = {}; ///< Run start by level.
+  uint32_t m_nFrame = 0;             ///< Frames ticked.
+  size_t m_nTicked = 0;              ///< Agents ticked last frame.
+
+  float m_fViewMinX = 0.0f;          ///< View rectangle, map space.
+  float m_fViewMinY = 0.0f;          ///< View rectangle, map space.
+  float m_fViewMaxX = 0.0f;          ///< View rectangle, map space.
+  float m_fViewMaxY = 0.0f;          ///< View rectangle, map space.
+
+  bool Solid(int x, int y) const;   ///< Tile blocks movement.
+  void Steer(size_t begin, size_t end, float dt); ///< Vectorizable pass.
+  void Move(size_t begin, size_t end, float dt);  ///< Tile collision pass.
+  void AssignLOD(); ///< Sort agents into runs by distance to the view.
+
+ public:
+  /// \brief Constructor.
+  /// \param params Movement limits
+  CCrowd(const SCrowdParams& params = SCrowdParams());
+
+  /// \brief Set the tile map to collide with.
+  /// \param tiles One character per tile, row major, '0' is empty
+  /// \param w Width in tiles
+  /// \param h Height in tiles
+  void SetMap(const char* tiles, int w, int h);
+
+  /// \brief Add an agent.
+  /// \param x Position x, map space
+  /// \param y Position y of the feet, map space
+  /// \return Id
+  uint32_t Add(float x, float y);
+
+  /// \brief Remove every agent.
+  void Clear();
+
+  /// \brief Set the view rectangle that decides levels of detail.
+  void SetView(float minX, float minY, float maxX, float maxY);
+
+  /// \brief Set every agent's steering target.
+  void SetGoal(float x, float y);
+
+  /// \brief Set one agent's steering target.
+  /// \param id Agent id
+  /// \param x Target x, map space
+  /// \param y Target y, map space
+  void SetGoal(uint32_t id, float x, float y);
+
+  /// \brief Advance the agents due to tick this frame.
+  /// \param dt Frame time in seconds
+  void Update(float dt);
+
+  /// \brief Hash the agents' state, for determinism checks.
+  /// \param h Hash to continue from
+  /// \return Hash
+  uint64_t Hash(uint64_t h) const;
+
+  size_t GetCount() const { return m_vX.size(); } ///< Number of agents.
+  size_t GetTicked() const { return m_nTicked; } ///< Ticked last frame.
+
+  /// \brief Get the index range of agents at a level of detail.
+  /// \param lod Level of detail
+  /// \param begin [out] First index
+  /// \param end [out] One past the last index
+  void GetRange(eCrowdLOD lod, size_t& begin, size_t& end) const {
+    begin = m_pStart[(int)lod];
+    end = m_pStart[(int)lod + 1];
+  }
+
+  float GetX(size_t i) const { return m_vX[i]; } ///< Position x by index.
+  float GetY(size_t i) const { return m_vY[i]; } ///< Position y by index.
+  uint32_t GetId(size_t i) const { return m_vId[i]; } ///< Id by index.
+  float GetHeight() const { return m_params.fHeight; } ///< Agent height.
+};
+
+#endif  //__L4RC_GAME_CROWD_H__
@@ -0,0 +1,256 @@
+/// \file DebugDraw.cpp
+/// \brief Code for the physics debug renderer CDebugDraw.
+
+#include "DebugDraw.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// \param center View center in pixels
+/// \param half Half the view size in pixels
+
+void CDebugDraw::Begin(const Vector2& center, const Vector2& half) {
+  m_vVerts.clear();
+  m_vColors.clear();
+  m_vMin = center - half;
+  m_vMax = center + half;
+  m_nShapes = 0;
+  m_nCulled = 0;
+}
+
+/// Check a shape's bounds against the view, counting it either way.
+/// \param lo Bottom left of the shape in pixels
+/// \param hi Top right of the shape in pixels
+/// \return true if it is wholly outside the view
+
+bool CDebugDraw::Cull(const Vector2& lo, const Vector2& hi) {
+  const bool out = hi.x < m_vMin.x || lo.x > m_vMax.x || hi.y < m_vMin.y ||
+                   lo.y > m_vMax.y;
+  ++(out ? m_nCulled : m_nShapes);
+  return out;
+}
+
+/// Ask the broadphase for the fixtures whose boxes touch the view and draw
+/// each once. A chain is in the broadphase once per edge, so it can be
+/// reported more than once.
+/// \param pWorld Physics world
+
+void CDebugDraw::DrawWorld(const b2World* pWorld) {
+  b2AABB view;
+  view.lowerBound = b2Vec2(m_vMin.x / m_fScale, m_vMin.y / m_fScale);
+  view.upperBound = b2Vec2(m_vMax.x / m_fScale, m_vMax.y / m_fScale);
+
+  m_vFixtures.clear();
+  pWorld->QueryAABB(this, view);
+  std::sort(m_vFixtures.begin(), m_vFixtures.end());
+  m_vFixtures.erase(std::unique(m_vFixtures.begin(), m_vFixtures.end()),
+                    m_vFixtures.end());
+
+  for (b2Fixture* f : m_vFixtures) DrawFixture(f);
+}
+
+/// \param pFixture Fixture whose box touches the view
+/// \return true, to keep going
+
+bool CDebugDraw::ReportFixture(b2Fixture* pFixture) {
+  m_vFixtures.push_back(pFixture);
+  return true;
+}
+
+/// Draw a fixture's shape where its body is, colored the way the Box2D
+/// testbed colors them: sensors yellow, sleeping bodies grey, static green,
+/// kinematic blue and dynamic red.
+/// \param pFixture Fixture
+
+void CDebugDraw::DrawFixture(b2Fixture* pFixture) {
+  b2Body* body = pFixture->GetBody();
+  const b2Transform& xf = body->GetTransform();
+
+  b2Color color(0.9f, 0.7f, 0.7f);
+  if (pFixture->IsSensor()) color = b2Color(0.9f, 0.9f, 0.3f);
+  else if (body->GetType() == b2_staticBody) color = b2Color(0.5f, 0.9f, 0.5f);
+  else if (body->GetType() == b2_kinematicBody)
+    color = b2Color(0.5f, 0.5f, 0.9f);
+  else if (!body->IsAwake()) color = b2Color(0.6f, 0.6f, 0.6f);
+
+  switch (pFixture->GetType()) {
+    case b2Shape::e_circle: {
+      const b2CircleShape* s = (const b2CircleShape*)pFixture->GetShape();
+      const b2Vec2 axis = b2Mul(xf.q, b2Vec2(1.0f, 0.0f));
+      DrawSolidCircle(b2Mul(xf, s->m_p), s->m_radius, axis, color);
+    } break;
+
+    case b2Shape::e_polygon: {
+      const b2PolygonShape* s = (const b2PolygonShape*)pFixture->GetShape();
+      b2Vec2 v[b2_maxPolygonVertices];
+      for (int32 i = 0; i < s->m_count; ++i) v[i] = b2Mul(xf, s->m_vertices[i]);
+      DrawSolidPolygon(v, s->m_count, color);
+    } break;
+
+    case b2Shape::e_edge: {
+      const b2EdgeShape* s = (const b2EdgeShape*)pFixture->GetShape();
+      DrawSegment(b2Mul(xf, s->m_vertex1), b2Mul(xf, s->m_vertex2), color);
+    } break;
+
+    case b2Shape::e_chain: {
+      const b2ChainShape* s = (const b2ChainShape*)pFixture->GetShape();
+      for (int32 i = 0; i + 1 < s->m_count; ++i)
+        DrawSegment(b2Mul(xf, s->m_vertices[i]),
+                    b2Mul(xf, s->m_vertices[i + 1]), color);
+    } break;
+
+    default: break;
+  }
+}  // DrawFixture
+
+/// \param a One end
+/// \param b Other end
+/// \param color Color
+
+void CDebugDraw::AddLine(const Vector2& a, const Vector2& b,
+                         const b2Color& color) {
+  m_vVerts.push_back(a);
+  m_vVerts.push_back(b);
+  m_vColors.push_back(DirectX::XMFLOAT4(color.r, color.g, color.b, color.a));
+}
+
+/// \param center Center
+/// \param half Half extents
+/// \param color Color
+
+void CDebugDraw::AddBox(const Vector2& center, const Vector2& half,
+                        const b2Color& color) {
+  const Vector2 lo = center - half, hi = center + half;
+  if (Cull(lo, hi)) return;
+
+  AddLine(lo, Vector2(hi.x, lo.y), color);
+  AddLine(Vector2(hi.x, lo.y), hi, color);
+  AddLine(hi, Vector2(lo.x, hi.y), color);
+  AddLine(Vector2(lo.x, hi.y), lo, color);
+}
+
+/// Each line is a copy of the sprite centered on the line, turned to lie
+/// along it and stretched to its length and the line thickness, tinted with
+/// the line's color. They all go into the packet in one call.
+/// \param pPacket Frame packet, on its debug layer
+/// \param sprite Sprite stretched along each line
+/// \param width Sprite width in pixels
+/// \param height Sprite height in pixels
+
+void CDebugDraw::Flush(CFramePacket* pPacket, UINT sprite, float width,
+                       float height) {
+  if (m_vColors.empty() || width <= 0.0f || height <= 0.0f) return;
+
+  m_vSprites.resize(m_vColors.size());
+  for (size_t i = 0; i < m_vColors.size(); ++i) {
+    const Vector2& a = m_vVerts[2 * i];
+    const Vector2 d = m_vVerts[2 * i + 1] - a;
+
+    LSpriteDesc2D& desc = m_vSprites[i];
+    desc.m_nSpriteIndex = sprite;
+    desc.m_vPos = a + d * 0.5f;
+    desc.m_fRoll = std::atan2(d.y, d.x);
+    desc.m_fXScale = (d.Length() + m_fThickness) / width;
+    desc.m_fYScale = m_fThickness / height;
+    desc.m_f4Tint = m_vColors[i];
+  }
+
+  pPacket->Draw(m_vSprites.data(), m_vSprites.size());
+}  // Flush
+
+/// \param v Vertices in meters
+/// \param n Number of vertices
+/// \param color Color
+
+void CDebugDraw::DrawPolygon(const b2Vec2* v, int32 n, const b2Color& color) {
+  if (n <= 0) return;
+
+  Vector2 lo(v[0].x, v[0].y), hi = lo;
+  for (int32 i = 1; i < n; ++i) {
+    lo = Vector2(std::min(lo.x, v[i].x), std::min(lo.y, v[i].y));
+    hi = Vector2(std::max(hi.x, v[i].x), std::max(hi.y, v[i].y));
+  }
+  if (Cull(lo * m_fScale, hi * m_fScale)) return;
+
+  for (int32 i = 0, j = n - 1; i < n; j = i++)
+    AddLine(Vector2(v[j].x, v[j].y) * m_fScale,
+            Vector2(v[i].x, v[i].y) * m_fScale, color);
+}
+
+/// Drawn as an outline, since everything is lines.
+/// \param v Vertices in meters
+/// \param n Number of vertices
+/// \param color Color
+
+void CDebugDraw::DrawSolidPolygon(const b2Vec2* v, int32 n,
+                                  const b2Color& color) {
+  DrawPolygon(v, n, color);
+}
+
+/// \param c Center in meters
+/// \param r Radius in meters
+/// \param color Color
+
+void CDebugDraw::DrawCircle(const b2Vec2& c, float r, const b2Color& color) {
+  const Vector2 center = Vector2(c.x, c.y) * m_fScale;
+  const float radius = r * m_fScale;
+  if (Cull(center - Vector2(radius), center + Vector2(radius))) return;
+
+  const float step = 6.2831853f / m_nCircleSegments;
+  Vector2 last = center + Vector2(radius, 0.0f);
+  for (int i = 1; i <= m_nCircleSegments; ++i) {
+    const Vector2 p = center + Vector2(std::cos(i * step), std::sin(i * step)) *
+                                   radius;
+    AddLine(last, p, color);
+    last = p;
+  }
+}
+
+/// Drawn as an outline with a radius along the axis, to show the rotation.
+/// \param c Center in meters
+/// \param r Radius in meters
+/// \param axis Unit vector along the body's x axis
+/// \param color Color
+
+void CDebugDraw::DrawSolidCircle(const b2Vec2& c, float r, const b2Vec2& axis,
+                                 const b2Color& color) {
+  const size_t shapes = m_nShapes;
+  DrawCircle(c, r, color);
+  if (m_nShapes == shapes) return;  // culled
+
+  const Vector2 center = Vector2(c.x, c.y) * m_fScale;
+  AddLine(center, center + Vector2(axis.x, axis.y) * (r * m_fScale), color);
+}
+
+/// \param a One end in meters
+/// \param b Other end in meters
+/// \param color Color
+
+void CDebugDraw::DrawSegment(const b2Vec2& a, const b2Vec2& b,
+                             const b2Color& color) {
+  const Vector2 p = Vector2(a.x, a.y) * m_fScale;
+  const Vector2 q = Vector2(b.x, b.y) * m_fScale;
+  const Vector2 lo(std::min(p.x, q.x), std::min(p.y, q.y));
+  const Vector2 hi(std::max(p.x, q.x), std::max(p.y, q.y));
+  if (!Cull(lo, hi)) AddLine(p, q, color);
+}
+
+/// Half a meter of the x axis in red and of the y axis in green.
+/// \param xf Transform
+
+void CDebugDraw::DrawTransform(const b2Transform& xf) {
+  const float k = 0.5f;
+  DrawSegment(xf.p, xf.p + k * b2Mul(xf.q, b2Vec2(1.0f, 0.0f)),
+              b2Color(1.0f, 0.0f, 0.0f));
+  DrawSegment(xf.p, xf.p + k * b2Mul(xf.q, b2Vec2(0.0f, 1.0f)),
+              b2Color(0.0f, 1.0f, 0.0f));
+}
+
+/// A point is a small box.
+/// \param p Position in meters
+/// \param size Size in pixels
+/// \param color Color
+
+void CDebugDraw::DrawPoint(const b2Vec2& p, float size, const b2Color& color) {
+  AddBox(Vector2(p.x, p.y) * m_fScale, Vector2(size / 2.0f), color);
+}
@@ -0,0 +1,96 @@
+/// \file DebugDraw.h
+/// \brief Interface for the physics debug renderer CDebugDraw.
+
+#ifndef __L4RC_GAME_DEBUGDRAW_H__
+#define __L4RC_GAME_DEBUGDRAW_H__
+
+#include <vector>
+
+#include "FramePacket.h"
+#include "SimpleMath.h"
+#include "SpriteDesc.h"
+#include "box2d/box2d.h"
+
+using namespace DirectX::SimpleMath;
+
+/// \brief Box2D debug drawing as one batch of lines.
+///
+/// Every shape, whether from Box2D through the `b2Draw` interface or from the
+/// game through `AddLine()` and `AddBox()`, is broken into line segments that
+/// go into one vertex stream, two vertices and a color per line. Anything
+/// wholly outside the view is dropped before it is broken up. `DrawWorld()`
+/// asks the broadphase for the fixtures in view instead of walking every
+/// body, so the cost follows what is on screen rather than the size of the
+/// map. `Flush()` turns the stream into stretched and tinted copies of one
+/// sprite and puts them in the frame packet in one call, so they go to the
+/// renderer as a single batch.
+class CDebugDraw : public b2Draw, private b2QueryCallback {
+ private:
+  std::vector<Vector2> m_vVerts;  ///< Line ends in pixels, two per line.
+  std::vector<DirectX::XMFLOAT4> m_vColors; ///< Color per line.
+  std::vector<LSpriteDesc2D> m_vSprites;    ///< Lines as sprites, reused.
+  std::vector<b2Fixture*> m_vFixtures;      ///< Fixtures in view, reused.
+
+  Vector2 m_vMin;              ///< Bottom left of the view in pixels.
+  Vector2 m_vMax;              ///< Top right of the view in pixels.
+  float m_fScale = 32.0f;      ///< Pixels per meter.
+  float m_fThickness = 2.0f;   ///< Line thickness in pixels.
+  bool m_bEnabled = false;     ///< Draw the physics world.
+  size_t m_nShapes = 0;        ///< Shapes drawn since Begin().
+  size_t m_nCulled = 0;        ///< Shapes dropped since Begin().
+
+  static const int m_nCircleSegments = 16; ///< Lines per circle.
+
+  bool Cull(const Vector2& lo, const Vector2& hi); ///< Outside the view?
+  bool ReportFixture(b2Fixture* pFixture) override; ///< Fixture in view.
+  void DrawFixture(b2Fixture* pFixture); ///< Draw one fixture's shape.
+
+ public:
+  /// \brief Start a frame, emptying the stream.
+  /// \param center View center in pixels
+  /// \param half Half the view size in pixels
+  void Begin(const Vector2& center, const Vector2& half);
+
+  /// \brief Draw the shapes of the fixtures in view.
+  /// \param pWorld Physics world
+  void DrawWorld(const b2World* pWorld);
+
+  /// \brief Add a line in pixels.
+  /// \param a One end
+  /// \param b Other end
+  /// \param color Color
+  void AddLine(const Vector2& a, const Vector2& b, const b2Color& color);
+
+  /// \brief Add an axis aligned box outline in pixels.
+  /// \param center Center
+  /// \param half Half extents
+  /// \param color Color
+  void AddBox(const Vector2& center, const Vector2& half,
+              const b2Color& color);
+
+  /// \brief Put the lines in the frame packet as one batch.
+  /// \param pPacket Frame packet, on its debug layer
+  /// \param sprite Sprite stretched along each line
+  /// \param width Sprite width in pixels
+  /// \param height Sprite height in pixels
+  void Flush(CFramePacket* pPacket, UINT sprite, float width, float height);
+
+  void DrawPolygon(const b2Vec2* v, int32 n, const b2Color& color) override;
+  void DrawSolidPolygon(const b2Vec2* v, int32 n,
+                        const b2Color& color) override;
+  void DrawCircle(const b2Vec2& c, float r, const b2Color& color) override;
+  void DrawSolidCircle(const b2Vec2& c, float r, const b2Vec2& axis,
+                       const b2Color& color) override;
+  void DrawSegment(const b2Vec2& a, const b2Vec2& b,
+                   const b2Color& color) override;
+  void DrawTransform(const b2Transform& xf) override;
+  void DrawPoint(const b2Vec2& p, float size, const b2Color& color) override;
+
+  void SetEnabled(bool b) { m_bEnabled = b; } ///< Turn on or off.
+  bool IsEnabled() const { return m_bEnabled; } ///< Whether it is on.
+  size_t GetLineCount() const { return m_vColors.size(); } ///< Lines.
+  size_t GetShapeCount() const { return m_nShapes; } ///< Shapes drawn.
+  size_t GetCulledCount() const { return m_nCulled; } ///< Shapes dropped.
+};
+
+#endif  //__L4RC_GAME_DEBUGDRAW_H__
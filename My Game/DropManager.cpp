@@ -0,0 +1,236 @@
+/// \file DropManager.cpp
+/// \brief Code for the world drop manager CDropManager.
+
+#include "DropManager.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "InventoryManager.h"
+#include "Player.h"
+#include "SaveGame.h"
+#include "SimdKernels.h"
+#include "WorldHash.h"
+
+CDropManager::~CDropManager() { Clear(); }
+
+void CDropManager::SetArea(float width, float height) {
+  m_vArea = Vector2(width, height);
+  m_bGridDirty = true;
+}
+
+void CDropManager::Clear() {
+  for (CItem* item : m_vItems) delete item;
+  m_vItems.clear();
+  m_vPos.clear();
+  m_vDelay.clear();
+  m_vTimers.clear();
+  m_vSprites.clear();
+  m_bGridDirty = true;
+}
+
+void CDropManager::Add(CItem* item, const Vector2& pos) {
+  if (!item) return;
+  m_vItems.push_back(item);
+  m_vPos.push_back(pos);
+  m_vDelay.push_back(m_fPickupDelayTime);
+  m_vTimers.push_back(0.0f);
+  m_bGridDirty = true;
+}
+
+/// Add an item record and a drop record for each drop.
+/// \param save [in, out] Save
+
+void CDropManager::Save(SSaveGame& save) const {
+  save.vDrops.reserve(save.vDrops.size() + m_vItems.size());
+  for (size_t i = 0; i < m_vItems.size(); ++i) {
+    if (!m_vItems[i]) continue;
+
+    SSaveDrop r;
+    r.nItem = m_vItems[i]->Save(save);
+    r.fX = m_vPos[i].x;
+    r.fY = m_vPos[i].y;
+    r.fTimer = m_vTimers[i];
+    r.fPickupDelay = m_vDelay[i];
+    save.vDrops.push_back(r);
+  }
+}
+
+/// Delete the drops, then make a new item for each drop in a save. Drops
+/// whose item is not in the save are left out.
+/// \param save Save
+
+void CDropManager::Load(const SSaveGame& save) {
+  Clear();
+
+  for (const SSaveDrop& r : save.vDrops) {
+    CItem* item = CItem::Load(save, r.nItem);
+    if (!item) continue;
+    m_vItems.push_back(item);
+    m_vPos.push_back(Vector2(r.fX, r.fY));
+    m_vDelay.push_back(r.fPickupDelay);
+    m_vTimers.push_back(r.fTimer);
+  }
+}
+
+/// Hash each drop's item, position and pickup delay, and the bob timers.
+/// \param h Hash to continue from
+/// \return Hash
+
+uint64_t CDropManager::Hash(uint64_t h) const {
+  for (size_t i = 0; i < m_vItems.size(); ++i) {
+    const int id = m_vItems[i] ? m_vItems[i]->GetID() : 0;
+    const float state[] = {m_vPos[i].x, m_vPos[i].y, m_vDelay[i]};
+    h = HashValue(id, h);
+    h = HashValue(state, h);
+  }
+
+  return HashArray(m_vTimers, h);
+}
+
+/// Copy each drop's item into the snapshot's items, assigning over the items
+/// left there by the last snapshot, and copy the arrays as they are.
+/// \param s [out] Snapshot, reused
+
+void CDropManager::Snapshot(SDropSnapshot& s) const {
+  s.nItems = 0;
+  s.vPos.clear();
+  s.vDelay.clear();
+  s.vTimers.clear();
+
+  for (size_t i = 0; i < m_vItems.size(); ++i) {
+    if (!m_vItems[i]) continue;
+    if (s.nItems < s.vItems.size()) s.vItems[s.nItems] = *m_vItems[i];
+    else s.vItems.push_back(*m_vItems[i]);
+    ++s.nItems;
+    s.vPos.push_back(m_vPos[i]);
+    s.vDelay.push_back(m_vDelay[i]);
+    s.vTimers.push_back(m_vTimers[i]);
+  }
+}
+
+/// Assign the snapshot's items over the items already here, so that only
+/// drops picked up since cost a new item.
+/// \param s Snapshot
+
+void CDropManager::Restore(const SDropSnapshot& s) {
+  const size_t n = s.vPos.size();
+  for (size_t i = n; i < m_vItems.size(); ++i) delete m_vItems[i];
+  m_vItems.resize(n, nullptr);
+
+  for (size_t i = 0; i < n; ++i) {
+    if (m_vItems[i]) *m_vItems[i] = s.vItems[i];
+    else m_vItems[i] = new CItem(s.vItems[i]);
+  }
+
+  m_vPos.assign(s.vPos.begin(), s.vPos.end());
+  m_vDelay.assign(s.vDelay.begin(), s.vDelay.end());
+  m_vTimers.assign(s.vTimers.begin(), s.vTimers.end());
+  m_bGridDirty = true;
+}
+
+/// \param dt Frame time in seconds
+
+void CDropManager::Update(float dt) {
+  SimdAdd(m_vTimers.data(), m_vTimers.size(), dt);
+  for (float& delay : m_vDelay) delay = std::max(0.0f, delay - dt);
+}
+
+/// Rebuild the pickup grid if the drops changed, then ask it for the drops
+/// in each player's reach. A player's drops are taken in drop order, which
+/// is the order a loop over all of the drops would take them in, so a full
+/// inventory fills up the same way. A drop given to one player is gone for
+/// the players after it. The grid cells are made as wide as the longest
+/// reach, which is the player's radius plus the pickup radius. Where each
+/// drop was taken is kept for GetTaken() until the next call.
+/// \param players Players
+/// \param inventories Inventories, one per player
+/// \param n Number of players
+
+void CDropManager::Collect(CPlayer* const* players,
+                           CInventoryManager* const* inventories, size_t n) {
+  m_vTaken.clear();
+  if (m_vItems.empty()) return;
+
+  float reach = 0.0f;
+  for (size_t p = 0; p < n; ++p)
+    reach = std::max(reach, players[p]->GetRadius() + m_fPickupRadius);
+
+  if (m_bGridDirty || reach > m_grid.GetCellSize()) {
+    const float cell = std::max(reach, m_grid.GetCellSize());
+    m_grid.Reset(cell, (int)std::ceil(m_vArea.x / cell),
+                 (int)std::ceil(m_vArea.y / cell));
+    m_grid.Build(&m_vPos[0].x, m_vPos.size());
+    m_bGridDirty = false;
+  }
+
+  bool taken = false;
+  for (size_t p = 0; p < n; ++p) {
+    const Vector2& pos = players[p]->GetPos();
+    m_vReach.clear();
+    m_grid.Query(pos.x, pos.y, players[p]->GetRadius() + m_fPickupRadius,
+                 m_vReach);
+    if (m_vReach.empty()) continue;
+    std::sort(m_vReach.begin(), m_vReach.end());
+
+    for (uint32_t i : m_vReach) {
+      if (!m_vItems[i] || m_vDelay[i] > 0.0f) continue;
+      if (inventories[p]->AddItem(m_vItems[i])) {
+        m_vItems[i] = nullptr;  // the inventory has it now
+        m_vTaken.push_back(m_vPos[i]);
+        taken = true;
+      }
+    }
+  }
+
+  if (taken) Compact();
+}  // Collect
+
+/// Close the gaps left by drops that were picked up, keeping the order.
+
+void CDropManager::Compact() {
+  size_t live = 0;
+  for (size_t i = 0; i < m_vItems.size(); ++i) {
+    if (!m_vItems[i]) continue;
+    m_vItems[live] = m_vItems[i];
+    m_vPos[live] = m_vPos[i];
+    m_vDelay[live] = m_vDelay[i];
+    m_vTimers[live++] = m_vTimers[i];
+  }
+
+  m_vItems.resize(live);
+  m_vPos.resize(live);
+  m_vDelay.resize(live);
+  m_vTimers.resize(live);
+  m_bGridDirty = true;
+}
+
+/// Build the sprite list for the drops in view, including the bob offsets,
+/// which are computed for all of the drops in one batch first.
+/// \param view Cull rectangle in pixels
+
+void CDropManager::PrepareWorldItems(const SViewRect& view) {
+  m_vSprites.clear();
+  LSpriteDesc2D desc;
+
+  m_vBob.resize(m_vTimers.size());
+  SimdBob(m_vTimers.data(), m_vTimers.size(), m_fBobSpeed, m_fBobAmplitude,
+          m_vBob.data());
+
+  for (size_t i = 0; i < m_vItems.size(); ++i) {
+    if (!m_vItems[i]) continue;
+    desc.m_vPos = m_vPos[i] + Vector2(0.0f, m_vBob[i]);
+    if (!view.Contains(desc.m_vPos.x, desc.m_vPos.y)) continue;
+    desc.m_nSpriteIndex = (UINT)m_vItems[i]->GetSprite();
+    desc.m_fXScale = 1.0f;
+    desc.m_fYScale = 1.0f;
+    m_vSprites.push_back(desc);
+  }
+}
+
+/// Draw the drop sprites built by the last PrepareWorldItems().
+
+void CDropManager::DrawWorldItems(CFramePacket* pPacket) {
+  pPacket->SetLayer(eSpriteLayer::Drops);
+  for (const LSpriteDesc2D& desc : m_vSprites) pPacket->Draw(&desc);
+}
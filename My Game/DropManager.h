@@ -0,0 +1,131 @@
+/// \file DropManager.h
+/// \brief Interface for the world drop manager CDropManager.
+
+#ifndef __L4RC_GAME_DROPMANAGER_H__
+#define __L4RC_GAME_DROPMANAGER_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Camera.h"
+#include "FramePacket.h"
+#include "Item.h"
+#include "PickupGrid.h"
+#include "SimpleMath.h"
+#include "SpriteRenderer.h"
+
+using namespace DirectX::SimpleMath;
+
+class CPlayer;
+class CInventoryManager;
+struct SSaveGame;
+
+/// \brief The world drops by value, for rollback.
+///
+/// Items are kept by value for the same reason as in SInventorySnapshot, and
+/// the arrays are reused the same way.
+struct SDropSnapshot {
+  std::vector<CItem> vItems;  ///< Items, one per drop.
+  size_t nItems = 0;          ///< Items in use, the rest are spare.
+  std::vector<Vector2> vPos;  ///< Positions.
+  std::vector<float> vDelay;  ///< Pickup delays.
+  std::vector<float> vTimers; ///< Bob timers.
+};
+
+/// \brief The items lying in the world, which any player can pick up.
+///
+/// Drops are kept in parallel arrays, one entry per drop, so the bob timers
+/// and pickup delays are counted down in a pass over floats and the
+/// positions go to the pickup grid as they are. Every player's pickups are
+/// done in one `Collect()`, in player order, so two players reaching the
+/// same drop on the same frame always resolve the same way.
+class CDropManager {
+ private:
+  std::vector<CItem*> m_vItems;     ///< Items, nullptr once picked up.
+  std::vector<Vector2> m_vPos;      ///< Positions in pixels.
+  std::vector<float> m_vDelay;      ///< Seconds before it can be picked up.
+  std::vector<float> m_vTimers;     ///< Seconds since each drop, for the bob.
+  std::vector<float> m_vBob;        ///< Bob offsets, PrepareWorldItems() only.
+  std::vector<LSpriteDesc2D> m_vSprites; ///< Built by PrepareWorldItems().
+
+  CPickupGrid m_grid;               ///< Drops by cell.
+  bool m_bGridDirty = true;         ///< Drops added or removed since Build.
+  Vector2 m_vArea = {4096.0f, 4096.0f}; ///< Size of the map in pixels.
+  std::vector<uint32_t> m_vReach;   ///< Query result, reused.
+  std::vector<Vector2> m_vTaken;    ///< Where drops were picked up.
+
+  static constexpr float m_fPickupRadius = 32.0f;
+  static constexpr float m_fPickupDelayTime = 0.25f;
+  static constexpr float m_fBobAmplitude = 6.0f;
+  static constexpr float m_fBobSpeed = 2.5f;
+
+  void Compact(); ///< Remove the drops that were picked up.
+
+ public:
+  CDropManager() = default; ///< No drops.
+  ~CDropManager(); ///< Delete the items.
+  CDropManager(const CDropManager&) = delete; ///< Owns its items.
+  CDropManager& operator=(const CDropManager&) = delete; ///< Owns them.
+
+  /// \brief Set the size of the map, which the pickup grid covers.
+  /// \param width Width in pixels
+  /// \param height Height in pixels
+  void SetArea(float width, float height);
+
+  void Clear(); ///< Delete every drop.
+
+  /// \brief Put an item in the world, to be picked up after a short delay.
+  /// \param item Item, which the drop manager then owns
+  /// \param pos Position in pixels
+  void Add(CItem* item, const Vector2& pos);
+
+  /// \brief Add the drops to a save.
+  /// \param save [in, out] Save
+  void Save(SSaveGame& save) const;
+
+  /// \brief Replace the drops with those in a save.
+  /// \param save Save
+  void Load(const SSaveGame& save);
+
+  /// \brief Hash the drops, for determinism checks.
+  uint64_t Hash(uint64_t h) const;
+
+  /// \brief Copy the drops, for rollback.
+  /// \param s [out] Snapshot, reused
+  void Snapshot(SDropSnapshot& s) const;
+
+  /// \brief Go back to the drops in a snapshot.
+  /// \param s Snapshot
+  void Restore(const SDropSnapshot& s);
+
+  /// \brief Count down the bob timers and pickup delays.
+  /// \param dt Frame time in seconds
+  void Update(float dt);
+
+  /// \brief Give each player the drops in its reach that fit its inventory.
+  /// \param players Players
+  /// \param inventories Inventories, one per player
+  /// \param n Number of players
+  void Collect(CPlayer* const* players, CInventoryManager* const* inventories,
+               size_t n);
+
+  /// \brief Build the sprite list for the drops in view.
+  /// Does not touch the renderer, so it may run on a worker thread.
+  /// \param view Cull rectangle in pixels
+  void PrepareWorldItems(const SViewRect& view);
+
+  /// \brief Draw the drops, as of PrepareWorldItems().
+  void DrawWorldItems(CFramePacket* pPacket);
+
+  /// \brief Get where drops were picked up by the last `Collect()`.
+  const std::vector<Vector2>& GetTaken() const { return m_vTaken; }
+
+  /// \brief Get the number of drops in view, as of PrepareWorldItems().
+  size_t GetSpriteCount() const { return m_vSprites.size(); }
+
+  size_t GetCount() const { return m_vItems.size(); } ///< Drops.
+  const CItem* GetItem(size_t i) const { return m_vItems[i]; } ///< Item.
+  const Vector2& GetPos(size_t i) const { return m_vPos[i]; } ///< Position.
+};
+
+#endif  //__L4RC_GAME_DROPMANAGER_H__
@@ -0,0 +1,115 @@
+/// \file FileWatcher.cpp
+/// \brief Code for the file change monitor CFileWatcher.
+
+#include "FileWatcher.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+/// Close the change handles or the inotify descriptor.
+
+CFileWatcher::~CFileWatcher() {
+#ifdef _WIN32
+  for (void* h : m_vHandles) FindCloseChangeNotification((HANDLE)h);
+#else
+  if (m_nNotify >= 0) close(m_nNotify);
+#endif
+}
+
+/// Get a file's last write time and size.
+/// \param path File name
+/// \param t [out] Last write time
+/// \param size [out] Size in bytes
+/// \return False if the file is missing
+
+bool CFileWatcher::GetStamp(const std::string& path, int64_t& t,
+                            int64_t& size) {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) return false;
+  t = (int64_t)info.st_mtime;
+  size = (int64_t)info.st_size;
+  return true;
+}
+
+/// Record the file's current time stamp and, the first time a directory is
+/// seen, ask the OS to signal changes in it.
+/// \param path File name
+
+void CFileWatcher::Watch(const char* path) {
+  SFile file;
+  file.strPath = path;
+  GetStamp(file.strPath, file.nTime, file.nSize);
+  m_vFiles.push_back(file);
+
+  const size_t slash = file.strPath.find_last_of("/\\");
+  const std::string dir =
+      slash == std::string::npos ? "." : file.strPath.substr(0, slash);
+  if (std::find(m_vDirs.begin(), m_vDirs.end(), dir) != m_vDirs.end()) return;
+  m_vDirs.push_back(dir);
+
+#ifdef _WIN32
+  HANDLE h = FindFirstChangeNotificationA(dir.c_str(), FALSE,
+                                          FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                              FILE_NOTIFY_CHANGE_FILE_NAME);
+  if (h != INVALID_HANDLE_VALUE) m_vHandles.push_back(h);
+#else
+  if (m_nNotify < 0) m_nNotify = inotify_init1(IN_NONBLOCK);
+  if (m_nNotify >= 0)
+    inotify_add_watch(m_nNotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+#endif
+}
+
+/// Check whether the OS has signaled a change in any watched directory, and
+/// rearm or drain the notifications.
+/// \return True if something changed
+
+bool CFileWatcher::Signaled() {
+  bool changed = false;
+
+#ifdef _WIN32
+  for (void* h : m_vHandles)
+    if (WaitForSingleObject((HANDLE)h, 0) == WAIT_OBJECT_0) {
+      FindNextChangeNotification((HANDLE)h);
+      changed = true;
+    }
+#else
+  if (m_nNotify >= 0) {
+    char buffer[4096];
+    while (read(m_nNotify, buffer, sizeof(buffer)) > 0) changed = true;
+  }
+#endif
+
+  return changed;
+}
+
+/// Report the watched files whose time stamps or sizes moved since they were
+/// last reported. A missing file, such as one halfway through being replaced,
+/// is left for a later poll.
+/// \return File names
+
+std::vector<std::string> CFileWatcher::Poll() {
+  std::vector<std::string> changed;
+  if (!Signaled()) return changed;
+
+  for (SFile& file : m_vFiles) {
+    int64_t t = 0, size = 0;
+    if (!GetStamp(file.strPath, t, size)) continue;
+
+    if (t != file.nTime || size != file.nSize) {
+      file.nTime = t;
+      file.nSize = size;
+      changed.push_back(file.strPath);
+    }
+  }
+
+  return changed;
+}
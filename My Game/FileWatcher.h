@@ -0,0 +1,54 @@
+/// \file FileWatcher.h
+/// \brief Interface for the file change monitor CFileWatcher.
+
+#ifndef __L4RC_GAME_FILEWATCHER_H__
+#define __L4RC_GAME_FILEWATCHER_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// \brief The file change monitor.
+///
+/// Watches a handful of files for changes so that they can be reloaded while
+/// the game runs. The operating system is asked to signal changes in each
+/// watched file's directory, a change notification handle on Windows and
+/// inotify on Linux, so that `Poll()` costs one non-blocking check per
+/// frame. Only when something in a directory has changed are the last write
+/// times and sizes of the watched files compared, and a file is reported once
+/// per change in either. Editors that save by writing a new file and
+/// renaming it over the old one are caught the same way.
+class CFileWatcher {
+ private:
+  /// \brief A watched file.
+  struct SFile {
+    std::string strPath;  ///< File name.
+    int64_t nTime = 0;    ///< Last write time seen.
+    int64_t nSize = 0;    ///< Size seen, catches two saves in one second.
+  };
+
+  std::vector<SFile> m_vFiles;        ///< Watched files.
+  std::vector<std::string> m_vDirs;   ///< Their directories, no duplicates.
+  std::vector<void*> m_vHandles;      ///< Change handles, one per directory.
+  int m_nNotify = -1;                 ///< inotify descriptor.
+
+  /// \brief Get a file's last write time and size.
+  static bool GetStamp(const std::string& path, int64_t& t, int64_t& size);
+
+  /// \brief Check with the OS whether anything changed, without blocking.
+  bool Signaled();
+
+ public:
+  /// \brief Destructor releases the OS handles.
+  ~CFileWatcher();
+
+  /// \brief Start watching a file.
+  /// \param path File name
+  void Watch(const char* path);
+
+  /// \brief Get the files that changed since the last poll.
+  /// \return File names, as passed to `Watch()`
+  std::vector<std::string> Poll();
+};
+
+#endif  //__L4RC_GAME_FILEWATCHER_H__
@@ -0,0 +1,130 @@
+/// \file FramePacket.cpp
+/// \brief Code for the render snapshot CFramePacket.
+
+#include "FramePacket.h"
+
+/// Empty the packet. The vectors keep their capacity so that the next frame
+/// can be recorded without allocating.
+
+void CFramePacket::Clear() {
+  for (CSpriteQueue& q : m_queues) q.Clear();
+  m_vBoxes.clear();
+  m_vText.clear();
+  m_eSpace = eRenderSpace::World;
+  m_eLayer = eSpriteLayer::Tiles;
+}
+
+/// Add a sprite to the current coordinate space and layer. If the sprite
+/// table says so, a different sprite is drawn instead, which is how sprites
+/// that are still loading get a placeholder.
+/// \param pDesc Pointer to sprite descriptor, which is copied
+
+void CFramePacket::Draw(const LSpriteDesc2D* pDesc) {
+  const UINT n = pDesc->m_nSpriteIndex;
+
+  if (m_pSprites && n < m_pSprites->size() && (*m_pSprites)[n] != n) {
+    LSpriteDesc2D desc = *pDesc;
+    desc.m_nSpriteIndex = (*m_pSprites)[n];
+    m_queues[(UINT)m_eSpace].Add(desc, m_eLayer);
+  } else {
+    m_queues[(UINT)m_eSpace].Add(*pDesc, m_eLayer);
+  }
+}
+
+/// Add a run of sprites with the same sprite index to the current coordinate
+/// space and layer in one go. If the sprite is substituted they go one at a
+/// time, which only happens while it is loading.
+/// \param pDesc Sprite descriptors, all with the same sprite index
+/// \param n Number of descriptors
+
+void CFramePacket::Draw(const LSpriteDesc2D* pDesc, size_t n) {
+  if (n == 0) return;
+  const UINT k = pDesc[0].m_nSpriteIndex;
+
+  if (m_pSprites && k < m_pSprites->size() && (*m_pSprites)[k] != k)
+    for (size_t i = 0; i < n; ++i) Draw(pDesc + i);
+  else m_queues[(UINT)m_eSpace].Add(pDesc, n, m_eLayer);
+}
+
+/// Add a line of text. Text is always in screen coordinates with y down, the
+/// same as LSpriteRenderer::DrawScreenText.
+/// \param text Null-terminated text, which is copied
+/// \param pos Screen position
+
+void CFramePacket::DrawScreenText(const char* text, const Vector2& pos) {
+  m_vText.push_back({text, pos});
+}
+
+/// Add a bounding box outline in world space.
+/// \param sprite Sprite used to draw the lines
+/// \param box The box
+
+void CFramePacket::DrawBoundingBox(eSprite sprite, const BoundingBox& box) {
+  m_vBoxes.push_back({sprite, box});
+}
+
+/// Stamp the packet once the simulation has finished with it.
+/// \param frame Simulation frame number
+/// \param t Time in seconds
+
+void CFramePacket::Seal(UINT frame, double t) {
+  m_nFrame = frame;
+  m_fSealTime = t;
+}
+
+/// Get the number of sprites over all coordinate spaces.
+/// \return Sprite count
+
+size_t CFramePacket::GetSpriteCount() const {
+  size_t n = 0;
+  for (const CSpriteQueue& q : m_queues) n += q.GetSize();
+  return n;
+}
+
+/// Get the number of batch breaks over all coordinate spaces, as of the last
+/// call to `Submit()`.
+/// \return Batch break count
+
+UINT CFramePacket::GetBatchBreaks() const {
+  UINT n = 0;
+  for (const CSpriteQueue& q : m_queues) n += q.GetBatchBreaks();
+  return n;
+}
+
+/// Get the number of batch breaks there would have been had the sprites been
+/// drawn in the order they were recorded.
+/// \return Batch break count
+
+UINT CFramePacket::GetUnsortedBatchBreaks() const {
+  UINT n = 0;
+  for (const CSpriteQueue& q : m_queues) n += q.GetUnsortedBatchBreaks();
+  return n;
+}
+
+/// Issue the commands: world sprites and boxes under the game camera, then
+/// screen sprites with the camera at the window center, then text. Sprites in
+/// each space are sorted by layer and texture first. This reads nothing but
+/// the packet itself.
+/// \param pRenderer Pointer to renderer
+/// \param vWinCenter Window center
+/// \param pTextures Texture for each sprite index, or nullptr
+
+void CFramePacket::Submit(LSpriteRenderer* pRenderer,
+                          const Vector2& vWinCenter,
+                          const std::vector<UINT>* pTextures) {
+  pRenderer->SetCameraPos(m_vCameraPos);
+
+  m_queues[(UINT)eRenderSpace::World].Flush(pRenderer, pTextures);
+
+  for (const SBox& b : m_vBoxes)
+    pRenderer->DrawBoundingBox(b.eLineSprite, b.box);
+
+  pRenderer->SetCameraPos(Vector3(vWinCenter.x, vWinCenter.y, 0.0f));
+
+  m_queues[(UINT)eRenderSpace::Screen].Flush(pRenderer, pTextures);
+
+  pRenderer->SetCameraPos(m_vCameraPos);
+
+  for (const SText& t : m_vText)
+    pRenderer->DrawScreenText(t.strText.c_str(), t.vPos);
+}
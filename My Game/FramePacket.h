@@ -0,0 +1,111 @@
+/// \file FramePacket.h
+/// \brief Interface for the render snapshot CFramePacket.
+
+#ifndef __L4RC_GAME_FRAMEPACKET_H__
+#define __L4RC_GAME_FRAMEPACKET_H__
+
+#include <string>
+#include <vector>
+
+#include "GameDefines.h"
+#include "SpriteDesc.h"
+#include "SpriteQueue.h"
+#include "SpriteRenderer.h"
+
+/// \brief Coordinate space for draw commands.
+enum class eRenderSpace : UINT {
+  World,   ///< Drawn relative to the game camera.
+  Screen,  ///< Drawn with the camera at the window center, for UI.
+  Size     // MUST BE LAST
+};
+
+/// \brief A snapshot of everything needed to draw one frame.
+///
+/// The simulation fills a packet at the end of each step, using the same
+/// calls it would make on LSpriteRenderer, and the packet is then submitted
+/// to the renderer with `Submit()`. Everything in the packet is a copy, so
+/// submission never reads live game or Box2D state and can run on another
+/// thread while the next frame is simulated. Sprites go through a
+/// CSpriteQueue per space, so they are drawn by layer and grouped by texture
+/// rather than in the order they were recorded. Vectors are cleared rather than
+/// freed, so after the first few frames filling a packet does not allocate.
+class CFramePacket {
+ private:
+  /// \brief A line of screen text.
+  struct SText {
+    std::string strText;  ///< The text.
+    Vector2 vPos;         ///< Screen position, y down.
+  };
+
+  /// \brief A bounding box outline.
+  struct SBox {
+    eSprite eLineSprite;   ///< Sprite used for the lines.
+    BoundingBox box;       ///< The box, in world space.
+  };
+
+  static const UINT m_nSpaces = (UINT)eRenderSpace::Size;  ///< Space count.
+
+  Vector3 m_vCameraPos;                         ///< Camera position.
+  eRenderSpace m_eSpace = eRenderSpace::World;  ///< Space for new commands.
+  eSpriteLayer m_eLayer = eSpriteLayer::Tiles;  ///< Layer for new sprites.
+  CSpriteQueue m_queues[m_nSpaces];             ///< Sprites per space.
+  const std::vector<UINT>* m_pSprites = nullptr; ///< Sprite substitutions.
+  std::vector<SBox> m_vBoxes;  ///< Bounding boxes, world space.
+  std::vector<SText> m_vText;  ///< Screen text.
+
+  UINT m_nFrame = 0;        ///< Simulation frame this packet came from.
+  double m_fSealTime = 0.0; ///< Time the simulation finished the packet.
+
+ public:
+  /// \brief Empty the packet, keeping its capacity.
+  void Clear();
+
+  /// \brief Set the world camera position for this frame.
+  void SetCameraPos(const Vector3& pos) { m_vCameraPos = pos; }
+
+  /// \brief Get the world camera position for this frame.
+  const Vector3& GetCameraPos() const { return m_vCameraPos; }
+
+  /// \brief Set the coordinate space for commands that follow.
+  void SetSpace(eRenderSpace space) { m_eSpace = space; }
+
+  /// \brief Set the sprite layer for sprites that follow.
+  void SetLayer(eSpriteLayer layer) { m_eLayer = layer; }
+
+  /// \brief Set the table giving the sprite to draw for each sprite index.
+  void SetSpriteTable(const std::vector<UINT>* pSprites) {
+    m_pSprites = pSprites;
+  }
+
+  /// \brief Add a sprite to the current layer, copying the descriptor.
+  void Draw(const LSpriteDesc2D* pDesc);
+
+  /// \brief Add copies of one sprite to the current layer as one batch.
+  void Draw(const LSpriteDesc2D* pDesc, size_t n);
+
+  /// \brief Add a line of text in screen coordinates.
+  void DrawScreenText(const char* text, const Vector2& pos);
+
+  /// \brief Add a bounding box outline in world space.
+  void DrawBoundingBox(eSprite sprite, const BoundingBox& box);
+
+  /// \brief Record which frame this is and when it was finished.
+  /// \param frame Simulation frame number
+  /// \param t Time in seconds
+  void Seal(UINT frame, double t);
+
+  UINT GetFrame() const { return m_nFrame; }         ///< Frame number.
+  double GetSealTime() const { return m_fSealTime; } ///< Seal time in seconds.
+  size_t GetSpriteCount() const;                      ///< Total sprite count.
+  UINT GetBatchBreaks() const;         ///< Batch breaks after sorting.
+  UINT GetUnsortedBatchBreaks() const; ///< Batch breaks before sorting.
+
+  /// \brief Sort and issue every command to the renderer.
+  /// \param pRenderer Pointer to renderer
+  /// \param vWinCenter Window center, used as the camera for screen space
+  /// \param pTextures Texture for each sprite index, or nullptr
+  void Submit(LSpriteRenderer* pRenderer, const Vector2& vWinCenter,
+              const std::vector<UINT>* pTextures = nullptr);
+};
+
+#endif  //__L4RC_GAME_FRAMEPACKET_H__
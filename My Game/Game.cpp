@@ -7,155 +7,150 @@
 #include "ComponentIncludes.h"
 #include "GameDefines.h"
 #include "Player.h"
+#include "SimdKernels.h"
 #include "SpriteRenderer.h"
 #include "TileManager.h"
 #include "shellapi.h"
-
-
-
-
+#include <psapi.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+static const char* g_szMapFile = "Media/Maps/testmap.txt";  ///< Level map.
+static const char* g_szSettingsFile = "Media/XML/gamesettings.xml";  ///< XML.
+static const char* g_szSaveFile = "game.sav";  ///< Save game.
+static const float g_fBulletLife = 2.0f;  ///< Seconds a bullet lasts.
+
+/// Find a sprite by its tag name in gamesettings.xml, for the settings that
+/// name a sprite. TableGen has already checked that every such name is a
+/// sprite, so this only fails for a name changed while the game runs.
+/// \param name Sprite tag name
+/// \return Entry in g_pSpriteTable, or nullptr if there is none
+
+static const SSpriteInfo* FindSprite(const char* name) {
+  if (name)
+    for (const SSpriteInfo& sprite : g_pSpriteTable)
+      if (!strcmp(name, sprite.szName)) return &sprite;
+  return nullptr;
+}
 
 /// Delete the sprite descriptor. The renderer needs to be deleted before this
 /// destructor runs so it will be done elsewhere.
 
 CGame::~CGame() {
   delete m_pSpriteDesc;
-  delete m_pInventory;  // cleans inventory
+  for (CInventoryManager* inventory : m_vInventories)
+    delete inventory;  // cleans inventory
 
 }  // destructor
 
+/// Count a player's sensor touching, or no longer touching, a solid fixture.
+/// The sensor's side of the body says whether it is the foot, the head or a
+/// wall. Every sensor belongs to a player, whose fixtures carry a pointer to
+/// them, so any number of players get their own contacts. Another player's
+/// sensors are not solid, so players side by side do not stand on each
+/// other's sensors.
+/// \param sensor Fixture that may be a player's sensor
+/// \param other The fixture it touches
+/// \param n 1 when the contact begins, -1 when it ends
+
+void ContactListener::CountContact(b2Fixture* sensor, b2Fixture* other, int n) {
+  if (!sensor->IsSensor() || other->IsSensor()) return;
+  CPlayer* p = (CPlayer*)sensor->GetUserData().pointer;
+  if (!p) return;
+
+  const b2Vec2 c = sensor->GetAABB(0).GetCenter();
+  const b2Vec2& body = p->GetBody()->GetPosition();
+
+  if (c.y < body.y) p->m_groundContacts += n;
+  else if (c.y > body.y) p->m_headContacts += n;
+  else if (c.x < body.x) p->m_leftWallContacts += n;
+  else p->m_rightWallContacts += n;
+}
+
+/// Record where a bullet hit something solid, for the particles. Bullets
+/// are the only bodies made with the bullet flag. The manifold normal points
+/// from fixture A to fixture B, so it is turned around when the bullet is B
+/// to point away from what it hit.
+/// \param contact Contact that has just begun
+
+void ContactListener::AddImpact(b2Contact* contact) {
+  b2Fixture* a = contact->GetFixtureA();
+  b2Fixture* b = contact->GetFixtureB();
+  if (a->IsSensor() || b->IsSensor()) return;
+
+  const bool bulletA = a->GetBody()->IsBullet();
+  if (bulletA == b->GetBody()->IsBullet()) return;  // neither, or both
+  if (contact->GetManifold()->pointCount == 0) return;
+
+  b2WorldManifold m;
+  contact->GetWorldManifold(&m);
+  m_vImpacts.push_back({m.points[0], bulletA ? -m.normal : m.normal});
+}  // AddImpact
+
 void ContactListener::BeginContact(b2Contact* contact) {
-  b2Fixture* A = contact->GetFixtureA();
-  b2Fixture* B = contact->GetFixtureB();
-
-
-  if (A->IsSensor()) {
-    CPlayer* Ap = (CPlayer*)A->GetUserData().pointer;
-
-    float AsensorY = A->GetAABB(0).GetCenter().y;
-    float AsensorX = A->GetAABB(0).GetCenter().x;
-    float AbodyY = Ap->GetBody()->GetPosition().y;
-    float AbodyX = Ap->GetBody()->GetPosition().x;
-  
-        if (AsensorY < AbodyY)
-      Ap->m_groundContacts = true;
-    else if (AsensorY > AbodyY)
-      Ap->m_headContacts = true;
-    else if (AsensorX < AbodyX)
-      Ap->m_leftWallContacts = true;
-    else
-      Ap->m_rightWallContacts = true;
-  }
-  if (B->IsSensor()) {
-    CPlayer* Bp = (CPlayer*)B->GetUserData().pointer;
-
-    float BsensorY = B->GetAABB(0).GetCenter().y;
-    float BsensorX = B->GetAABB(0).GetCenter().x;
-    float BbodyY = Bp->GetBody()->GetPosition().y;
-    float BbodyX = Bp->GetBody()->GetPosition().x;
-  
-    if (BsensorY < BbodyY)
-      Bp->m_groundContacts = true;
-    else if (BsensorY > BbodyY)
-      Bp->m_headContacts = true;
-    else if (BsensorX < BbodyX)
-      Bp->m_leftWallContacts = true;
-    else
-      Bp->m_rightWallContacts = true;
-  }
+  CountContact(contact->GetFixtureA(), contact->GetFixtureB(), 1);
+  CountContact(contact->GetFixtureB(), contact->GetFixtureA(), 1);
+  AddImpact(contact);
 }
 
 void ContactListener::EndContact(b2Contact* contact) {
-  b2Fixture* A = contact->GetFixtureA();
-  b2Fixture* B = contact->GetFixtureB();
- 
-  
-
-  if (A->IsSensor()) {
-    CPlayer* Ap = (CPlayer*)A->GetUserData().pointer;
-
-    float AsensorY = A->GetAABB(0).GetCenter().y;
-    float AsensorX = A->GetAABB(0).GetCenter().x;
-    float AbodyY = Ap->GetBody()->GetPosition().y;
-    float AbodyX = Ap->GetBody()->GetPosition().x;
-
-   
-    if (AsensorY < AbodyY)
-      Ap->m_groundContacts = false;
-    else if (AsensorY > AbodyY)
-      Ap->m_headContacts = false;
-    else if (AsensorX < AbodyX)
-      Ap->m_leftWallContacts = false;
-    else
-      Ap->m_rightWallContacts = false;
-  }
-  if (B->IsSensor()) {
-    CPlayer* Bp = (CPlayer*)B->GetUserData().pointer;
-
-    float BsensorY = B->GetAABB(0).GetCenter().y;
-    float BsensorX = B->GetAABB(0).GetCenter().x;
-    float BbodyY = Bp->GetBody()->GetPosition().y;
-    float BbodyX = Bp->GetBody()->GetPosition().x;
-   
-    if (BsensorY < BbodyY)
-      Bp->m_groundContacts = false;
-    else if (BsensorY > BbodyY)
-      Bp->m_headContacts = false;
-    else if (BsensorX < BbodyX)
-      Bp->m_leftWallContacts = false;
-    else
-      Bp->m_rightWallContacts = false;
-  }
+  CountContact(contact->GetFixtureA(), contact->GetFixtureB(), -1);
+  CountContact(contact->GetFixtureB(), contact->GetFixtureA(), -1);
 }
 
 
 void CGame::Initialize() {
   float tileSize = 32.0f;
  
+  unsigned threads = 0;  // one per core unless gamesettings.xml says otherwise
+  if (m_pXmlSettings) {
+    tinyxml2::XMLElement* t = m_pXmlSettings->FirstChildElement("jobs");
+    if (t) threads = t->UnsignedAttribute("threads", 0);
+  }
+  m_pJobs = new CJobSystem(threads);
+  m_pPaths = new CPathService(&m_navGraph);
+
   m_pRenderer = new LSpriteRenderer(eSpriteMode::Batched2D);
   m_pRenderer->Initialize(eSprite::Size);
+
+  bool cooked = true;  // use the cooked pack if the cooker has been run
+  if (m_pXmlSettings) {
+    tinyxml2::XMLElement* t = m_pXmlSettings->FirstChildElement("assets");
+    if (t) cooked = t->BoolAttribute("cooked", true);
+  }
+  if (cooked) m_pack.Open("Media/Cooked/assets.pak");
+
+  m_pLoader = new CAssetLoader(m_pJobs, m_pRenderer, m_pAudio);
   LoadImages();  // load images from xml file list
+  LoadSounds();  // load the sounds for this game
+  m_pLoader->Start();           // read files on the workers
+  m_pLoader->LoadFirstFrame();  // just what the first frame needs
+  m_pRenderer->GetSize(eSprite::DebugGreen, m_vDebugLineSize.x,
+                       m_vDebugLineSize.y);  // debug lines are stretched
+
+  m_pRenderThread = new CRenderThread(m_pRenderer, m_vWinCenter);
+  m_pRenderThread->SetSpriteTable(&m_pLoader->GetSpriteTable());
+  ApplySettings(m_pXmlSettings);
+
+  // group sprites by atlas page, if the atlas builder has been run
+  m_atlas.Load();
+  m_pRenderThread->SetTextureTable(&m_atlas.GetTextureTable());
 
   m_pTileManager = new CTileManager(m_pRenderer, tileSize);
-  m_pTileManager->LoadMap("Media/Maps/testmap.txt");
+  const SPackEntry* pMap = m_pack.Find("map");
+  if (pMap && !m_pack.IsCurrent(pMap, g_szMapFile))
+    pMap = nullptr;  // edited since it was cooked
+  if (pMap)
+    m_pTileManager->LoadMap((const char*)m_pack.GetData(pMap),
+                            pMap->nParam[0], pMap->nParam[1]);
+  else m_pTileManager->LoadMap(g_szMapFile);
   mWorld = new b2World(b2Vec2(0.0f, -9.8f));
   m_listener = new ContactListener();
   mWorld->SetContactListener(m_listener);
 
 
-  float scale = 32.0f;
-  float half = m_pTileManager->GetTileSize() * 0.5f / scale;
-  int mapHeight = m_pTileManager->GetMapHeight();
-
-  for (const TileRect& r : m_pTileManager->GetSolidRects()) {
-    float halfW = (r.w * tileSize * 0.5f) / scale;
-    float halfH = (r.h * tileSize * 0.5f) / scale;
-    float cx = (r.x + r.w * 0.5f) * tileSize;
-    float cy = (mapHeight - r.y - r.h * 0.5f) * tileSize;
-
-    b2BodyDef def;
-    def.type = b2_staticBody;
-    def.position.Set(cx / scale, cy / scale);
-
-    b2Body* tileBody = mWorld->CreateBody(&def);
-
-    b2PolygonShape box;
-    box.SetAsBox(halfW, halfH);
-
-
-    b2FixtureDef fd;
-    fd.shape = &box;
-    fd.friction = 2.5f;
-    fd.restitution = 0.0f;
-    fd.density = 0.0f;
-
-    tileBody->CreateFixture(&fd);
-    m_PhysicsTiles.push_back(tileBody);
-    
-    m_debugBodies.push_back(tileBody);
-
-  }
-
   //for (const Vector2& tilePosPixels : m_pTileManager->GetSolidTiles()) 
   //{
   //  float x = tilePosPixels.x / scale;
@@ -184,70 +179,1104 @@ void CGame::Initialize() {
 
 
 
-  m_pPlayer = new CPlayer(m_pRenderer, mWorld, this);
+  AddPlayer(ePlayerInput::Keyboard);  // the one at this machine
+  m_pPlayer = m_vPlayers[0];
+  m_pInventory = m_vInventories[0];
+  SetPlayerCount();  // and the rest
+
+  m_watcher.Watch(g_szMapFile);
+  m_watcher.Watch(g_szSettingsFile);
+
+  m_rollback.SetCallbacks(
+      [this](uint32_t frame) { SaveSnapshot(frame); },
+      [this](uint32_t frame) { LoadSnapshot(frame); },
+      [this](uint32_t, const SPlayerInput* inputs) {
+        SimulateFrame(m_fRollbackStep, inputs);
+      });
+
+  BeginGame();
+  LoadGame();  // carry on from the last session, if it saved
+}  // Initialize
+
+/// Read the settings that can change while the game runs. This is called
+/// with the settings loaded at startup and again whenever gamesettings.xml
+/// is saved. Settings that only take effect at startup, such as the job
+/// thread count and the sprite list, are not read here.
+/// \param pSettings The settings tag
+
+void CGame::ApplySettings(tinyxml2::XMLElement* pSettings) {
+  if (!pSettings) return;
+
+  tinyxml2::XMLElement* t = pSettings->FirstChildElement("render");
+  if (t) m_pRenderThread->SetThreaded(t->BoolAttribute("threaded", false));
+
+  t = pSettings->FirstChildElement("assets");
+  if (t) m_pLoader->SetBudget(t->FloatAttribute("budget", 4.0f));
+
+  t = pSettings->FirstChildElement("crowd");
+  if (t) m_nCrowdSize = t->UnsignedAttribute("count", 0);
+
+  t = pSettings->FirstChildElement("player");
+  if (t) {
+    const char* controller = t->Attribute("controller");
+    m_bGridController = controller && !strcmp(controller, "grid");
+    m_nPlayerCount = std::max(1u, std::min(t->UnsignedAttribute("count", 1),
+                                           (unsigned)g_nMaxPlayers));
+  }
+
+  t = pSettings->FirstChildElement("camera");
+  if (t) {
+    SCameraSettings& c = m_cameraSettings;
+    c.fOffsetX = t->FloatAttribute("offsetx", 0.0f);
+    c.fOffsetY = t->FloatAttribute("offsety", 200.0f);
+    c.fDeadWidth = t->FloatAttribute("deadwidth", 0.0f);
+    c.fDeadHeight = t->FloatAttribute("deadheight", 0.0f);
+    c.fHalfLife = t->FloatAttribute("halflife", 0.0f);
+    c.fPadding = t->FloatAttribute("padding", 32.0f);
+    for (CCamera& camera : m_vCameras) camera.SetSettings(c);
+  }
+
+  t = pSettings->FirstChildElement("debug");
+  if (t) m_debugDraw.SetEnabled(t->BoolAttribute("physics", false));
+
+  t = pSettings->FirstChildElement("collision");
+  if (t) {
+    m_collision.Clear();
+    for (tinyxml2::XMLElement* p = t->FirstChildElement("layer"); p;
+         p = p->NextSiblingElement("layer")) {
+      const eCollisionLayer layer =
+          CCollisionMatrix::Find(p->Attribute("name"));
+      const char* hits = p->Attribute("hits");
+      if (layer == eCollisionLayer::Size || !hits) continue;
+
+      std::string list = hits;
+      for (size_t i = 0; i < list.size();) {
+        const size_t j = std::min(list.find(' ', i), list.size());
+        const eCollisionLayer other =
+            CCollisionMatrix::Find(list.substr(i, j - i).c_str());
+        if (other != eCollisionLayer::Size) m_collision.Set(layer, other, true);
+        i = j + 1;
+      }
+    }  // for
+
+    if (mWorld) m_collision.Refilter(mWorld);  // the world exists
+  }  // if
+
+  t = pSettings->FirstChildElement("parallax");
+  if (t) {
+    m_vParallax.clear();
+    for (tinyxml2::XMLElement* p = t->FirstChildElement("layer"); p;
+         p = p->NextSiblingElement("layer")) {
+      const SSpriteInfo* sprite = FindSprite(p->Attribute("sprite"));
+      if (!sprite) continue;
+
+      const char* depth = p->Attribute("layer");
+      SParallaxLayer layer;
+      layer.nSprite = (uint32_t)sprite->eIndex;
+      layer.nLayer = (uint32_t)(depth && !strcmp(depth, "near")
+                                    ? eSpriteLayer::BackgroundNear
+                                    : eSpriteLayer::BackgroundFar);
+      layer.fWidth = p->FloatAttribute("width", 1024.0f);
+      layer.fXScale = p->FloatAttribute("xscale", 1.0f);
+      layer.fYScale = p->FloatAttribute("yscale", layer.fXScale);
+      layer.fXScroll = p->FloatAttribute("scroll", 0.0f);
+      layer.fYScroll = p->FloatAttribute("yscroll", 0.0f);
+      layer.fXOffset = p->FloatAttribute("x", 0.0f);
+      layer.fYOffset = p->FloatAttribute("y", 0.0f);
+      m_vParallax.push_back(layer);
+    }
+  }
+
+  LoadClips(pSettings);
+  LoadParticles(pSettings);
+
+  t = pSettings->FirstChildElement("determinism");
+  if (t) {
+    const bool hash = t->BoolAttribute("hash", false);
+    if (hash && !m_bHashWorld) m_worldHash.Reset();
+    m_bHashWorld = hash;
+
+    const float rate = t->FloatAttribute("step", 0.0f);
+    m_fHashStep = rate > 0.0f ? 1.0f / rate : 0.0f;
+
+    const char* log = t->Attribute("log");
+    m_strHashLog = log ? log : "";
+    m_worldHash.SetRecording(!m_strHashLog.empty());
+  }
+
+  t = pSettings->FirstChildElement("rollback");
+  if (t) {
+    m_bRollback = t->BoolAttribute("on", false);
+    const float rate = t->FloatAttribute("step", 60.0f);
+    m_fRollbackStep = 1.0f / (rate > 0.0f ? rate : 60.0f);
+
+    m_fPeerDelay = t->FloatAttribute("delay", 100.0f);
+    m_fPeerJitter = t->FloatAttribute("jitter", 30.0f);
+    RestartRollback(t->UnsignedAttribute("depth", 8));
+  }
+
+  StartNet(pSettings->FirstChildElement("net"));
+  if (!m_vPlayers.empty()) SetPlayerCount();  // the world exists
+}  // ApplySettings
+
+/// Bring one chunk's tile fixtures in line with the chunk's outline. Each
+/// chunk has one static body with a one-sided edge fixture per outline edge,
+/// whose ghost corners let a body slide from one edge onto the next, even
+/// across a chunk border, without catching on the seam. Both edge lists are
+/// sorted, so one pass over the two finds the edges that survived an edit.
+/// Their fixtures, and any contacts resting on them, are kept, and only the
+/// edges that went away or appeared touch the broad-phase.
+/// \param chunk Chunk index
+
+void CGame::BuildChunkBodies(int chunk) {
+  const float scale = 32.0f;
+  const float tileSize = m_pTileManager->GetTileSize();
+  const int mapHeight = m_pTileManager->GetMapHeight();
+
+  SChunkBody& cb = m_vChunkBodies[chunk];
+  if (!cb.pBody) {
+    b2BodyDef def;
+    def.type = b2_staticBody;
+    cb.pBody = mWorld->CreateBody(&def);
+  }
+
+  const std::vector<TileEdge>& edges = m_pTileManager->GetChunkEdges(chunk);
+  std::vector<b2Fixture*> fixtures;
+  fixtures.reserve(edges.size());
 
+  auto corner = [&](int x, int y) {  // row 0 is the top of the world
+    return b2Vec2(x * tileSize / scale, (mapHeight - y) * tileSize / scale);
+  };
+
+  auto create = [&](const TileEdge& e) {
+    b2EdgeShape edge;
+    edge.SetOneSided(corner(e.x0, e.y0), corner(e.x1, e.y1),
+                     corner(e.x2, e.y2), corner(e.x3, e.y3));
+
+    b2FixtureDef fd;
+    fd.shape = &edge;
+    fd.friction = 2.5f;
+    fd.restitution = 0.0f;
+    fd.density = 0.0f;
+    fd.filter = m_collision.GetFilter(eCollisionLayer::World);
+
+    return cb.pBody->CreateFixture(&fd);
+  };
+
+  size_t i = 0;  // old edges
+  size_t j = 0;  // new edges
+
+  while (i < cb.vEdges.size() || j < edges.size()) {
+    if (j == edges.size() ||
+        (i < cb.vEdges.size() && cb.vEdges[i] < edges[j]))
+      cb.pBody->DestroyFixture(cb.vFixtures[i++]);  // gone
+
+    else if (i == cb.vEdges.size() || edges[j] < cb.vEdges[i])
+      fixtures.push_back(create(edges[j++]));  // new
+
+    else {  // unchanged
+      fixtures.push_back(cb.vFixtures[i++]);
+      j++;
+    }
+  }
+
+  cb.vEdges = edges;
+  cb.vFixtures.swap(fixtures);
+}  // BuildChunkBodies
+
+/// Destroy every tile body and build them all again from the tile manager.
+/// Needed at the start of a game and when the map changes size.
+
+void CGame::RebuildTileBodies() {
+  for (SChunkBody& cb : m_vChunkBodies)
+    if (cb.pBody) mWorld->DestroyBody(cb.pBody);
+
+  m_vChunkBodies.clear();
+  m_vChunkBodies.resize(m_pTileManager->GetChunkCount());
+
+  for (int i = 0; i < (int)m_vChunkBodies.size(); ++i) BuildChunkBodies(i);
+}  // RebuildTileBodies
+
+/// Rebuild the tiles and fixtures of the chunks edited since the last frame.
+/// This must run outside of the frame graph, since it changes the Box2D
+/// world, and is timed for the F2 overlay.
+
+void CGame::FlushTileEdits() {
+  if (m_nTileEdits == 0) return;
+
+  const auto t0 = std::chrono::high_resolution_clock::now();
+
+  std::vector<int> changed;
+  m_pTileManager->RebuildDirty(changed);
+  for (int i : changed) BuildChunkBodies(i);
+  m_bNavDirty = true;
+
+  const auto t1 = std::chrono::high_resolution_clock::now();
+  m_fEditTime = std::chrono::duration<float, std::milli>(t1 - t0).count();
+  m_nLastEdits = m_nTileEdits;
+  m_nTileEdits = 0;
+}  // FlushTileEdits
+
+/// Clear every solid tile within a circle. The tiles are only marked here,
+/// and the collision shapes catch up in `FlushTileEdits()`.
+/// \param pos Center in world pixels
+/// \param radius Radius in pixels
+
+void CGame::Explode(const Vector2& pos, float radius) {
+  const float tileSize = m_pTileManager->GetTileSize();
+  const int mapHeight = m_pTileManager->GetMapHeight();
+
+  // world y points up and map rows count down from the top
+  const float cx = pos.x / tileSize;
+  const float cy = mapHeight - pos.y / tileSize;
+  const float r = radius / tileSize;
+
+  for (int y = (int)floorf(cy - r); y <= (int)ceilf(cy + r); ++y)
+    for (int x = (int)floorf(cx - r); x <= (int)ceilf(cx + r); ++x) {
+      const float dx = x + 0.5f - cx;
+      const float dy = y + 0.5f - cy;
+      if (dx * dx + dy * dy <= r * r && m_pTileManager->SetTile(x, y, '0'))
+        m_nTileEdits++;
+    }
+
+  m_rollback.Barrier();
+}  // Explode
+
+/// Rebuild the navigation graph from the tile map and forget every cached
+/// path. The graph is small next to the tile bodies, so it is rebuilt whole
+/// rather than by chunk. No path batch may be in flight.
+
+void CGame::BuildNavGraph() {
+  const int w = m_pTileManager->GetMapWidth();
+  const int h = m_pTileManager->GetMapHeight();
+
+  m_strTiles.assign((size_t)w * h, '0');
+  for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x)
+      m_strTiles[(size_t)y * w + x] = m_pTileManager->GetTile(x, y);
+
+  m_navGraph.Build(m_strTiles.data(), w, h);
+  m_pPaths->Invalidate();
+  m_crowd.SetMap(m_strTiles.data(), w, h);
+  for (CPlayer* p : m_vPlayers) p->SetMap(m_strTiles.data(), w, h);
+
+  const float tileSize = m_pTileManager->GetTileSize();
+  m_drops.SetArea(w * tileSize, h * tileSize);
+  m_vCrowdTickets.clear();  // their nodes are from the old graph
+  m_bNavDirty = false;
+  m_worldHash.Invalidate(eHashPart::Tiles);
+}  // BuildNavGraph
+
+/// Find the navigation node an agent at a point stands on, or would land on.
+/// \param pos Point in world pixels
+/// \return Node index, or -1
+
+int CGame::FindNavNode(const Vector2& pos) const {
+  const float tileSize = m_pTileManager->GetTileSize();
+  const int x = (int)floorf(pos.x / tileSize);
+  const int y =
+      m_pTileManager->GetMapHeight() - 1 - (int)floorf(pos.y / tileSize);
+  return m_navGraph.FindNode(x, y);
+}  // FindNavNode
+
+/// Replace the crowd with as many agents as gamesettings.xml asks for, each
+/// standing on a random node of the navigation graph. The seed is fixed so
+/// that every restart looks the same.
+
+void CGame::SpawnCrowd() {
+  m_crowd.Clear();
+  m_vCrowdTickets.clear();
+
+  const int nodes = m_navGraph.GetNodeCount();
+  if (nodes == 0) return;
+
+  std::mt19937 rng(1);
+  for (size_t i = 0; i < m_nCrowdSize; ++i) {
+    const int n = rng() % nodes;
+    m_crowd.Add(m_navGraph.GetNodeX(n) + 0.5f, m_navGraph.GetNodeY(n) + 1.0f);
+  }
+}  // SpawnCrowd
+
+/// Point the crowd at the player. Agents on screen follow the paths asked for
+/// last frame one node at a time, and ask again from wherever they are now,
+/// which the path cache mostly answers since they share a goal. The rest
+/// walk straight at the player, which is fine where nobody can see them.
+/// Call this between collecting and dispatching path batches.
+
+void CGame::SteerCrowd() {
+  const float tileSize = m_pTileManager->GetTileSize();
+  const float h = (float)m_pTileManager->GetMapHeight();
+  const Vector2 player = m_pPlayer->GetPos();
+  const SViewRect view = m_vCameras[0].GetView();
+
+  m_crowd.SetView(view.fLeft / tileSize, h - view.fTop / tileSize,
+                  view.fRight / tileSize, h - view.fBottom / tileSize);
+  m_crowd.SetGoal(player.x / tileSize, h - player.y / tileSize);
+
+  for (const std::pair<uint32_t, int>& t : m_vCrowdTickets) {
+    const SPathResult& result = m_pPaths->GetResult(t.second);
+    if (!result.bFound || result.vSteps.size() < 2) continue;
+    const int n = result.vSteps[1].nNode;
+    m_crowd.SetGoal(t.first, m_navGraph.GetNodeX(n) + 0.5f,
+                    m_navGraph.GetNodeY(n) + 1.0f);
+  }
+
+  m_vCrowdTickets.clear();
+
+  const int goal = FindNavNode(player);
+  if (goal < 0) return;
+
+  size_t begin, end;
+  m_crowd.GetRange(eCrowdLOD::Near, begin, end);
+  end = std::min(end, begin + 256);  // a screenful is never more than this
+
+  for (size_t i = begin; i < end; ++i) {
+    const int start = m_navGraph.FindNode((int)floorf(m_crowd.GetX(i)),
+                                          (int)floorf(m_crowd.GetY(i) - 0.5f));
+    if (start >= 0)
+      m_vCrowdTickets.push_back(
+          {m_crowd.GetId(i), m_pPaths->Request(start, goal)});
+  }
+}  // SteerCrowd
+
+/// Reload the map or settings if they were saved since the last frame. A map
+/// reload rebuilds the tiles and bodies of only the chunks that changed, and
+/// leaves the player, bullets and inventory as they are. This must run
+/// outside of the frame graph, since it changes the Box2D world.
+
+void CGame::CheckHotReload() {
+  for (const std::string& file : m_watcher.Poll()) {
+    if (file == g_szMapFile) {
+      const auto t0 = std::chrono::high_resolution_clock::now();
+      const size_t chunks = m_pTileManager->GetChunkCount();
+
+      std::vector<int> changed;
+      if (!m_pTileManager->ReloadMap(g_szMapFile, changed)) continue;
+
+      if (m_pTileManager->GetChunkCount() != chunks) RebuildTileBodies();
+      else for (int i : changed) BuildChunkBodies(i);
+      m_bNavDirty = true;
+      m_rollback.Barrier();  // frames before this ran on the old tiles
+
+      const auto t1 = std::chrono::high_resolution_clock::now();
+      m_fReloadTime = std::chrono::duration<float, std::milli>(t1 - t0).count();
+      m_nReloadChunks = changed.size();
+    }
+
+    else if (file == g_szSettingsFile) {
+      tinyxml2::XMLDocument doc;
+      if (doc.LoadFile(g_szSettingsFile) == tinyxml2::XML_SUCCESS)
+        ApplySettings(doc.FirstChildElement("settings"));
+    }
+  }
+}  // CheckHotReload
+
+/// Copy the local player, their inventory, the world drops and the bullets
+/// into a snapshot and hand it to the save writer, which writes it on its
+/// own thread. Only the copy is done on the main thread. The other players
+/// are not saved, since they belong to the script or to a client. This must
+/// run outside the frame graph, while nothing else reads or moves the bodies.
+/// \return True if the save was started, false if one is still being written
+
+bool CGame::SaveGame() {
+  if (m_saveWriter.IsBusy()) return false;
+  const auto t0 = std::chrono::high_resolution_clock::now();
+
+  SSaveGame save;
+  m_pPlayer->Save(save.player);
+  m_pInventory->Save(save);
+  m_drops.Save(save);
+
+  save.vBullets.resize(m_bullets.size());
+  for (size_t i = 0; i < m_bullets.size(); ++i) {
+    const b2Vec2 p = m_bullets[i]->GetBody()->GetPosition();
+    const b2Vec2 v = m_bullets[i]->GetBody()->GetLinearVelocity();
+    save.vBullets[i] = {p.x, p.y, v.x, v.y, m_vBulletLife[i]};
+  }
+
+  const bool started = m_saveWriter.Start(g_szSaveFile, std::move(save));
+
+  const auto t1 = std::chrono::high_resolution_clock::now();
+  m_fSnapshotTime = std::chrono::duration<float, std::milli>(t1 - t0).count();
+  return started;
+}  // SaveGame
+
+/// Read the save file and put the local player, their inventory, the world
+/// drops and the bullets back as they were. The tile map and the crowd are left as they are. A save
+/// still being written is waited for first, so the load sees it. Nothing
+/// changes if the file is missing, from another version or damaged.
+/// \return True if the game was loaded
+
+bool CGame::LoadGame() {
+  m_saveWriter.Wait();
+  const auto t0 = std::chrono::high_resolution_clock::now();
+
+  SSaveGame save;
+  if (!ReadSaveGame(g_szSaveFile, save)) return false;
+
+  for (CBullet* b : m_bullets) {
+    mWorld->DestroyBody(b->GetBody());
+    delete b;
+  }
+  m_bullets.clear();
+  m_vBulletLife.clear();
+  m_vBulletDead.clear();
+
+  for (const SSaveBullet& b : save.vBullets) {
+    m_bullets.push_back(
+        new CBullet(mWorld, b2Vec2(b.fX, b.fY), b2Vec2(b.fVX, b.fVY),
+                    m_collision.GetFilter(eCollisionLayer::Projectile)));
+    m_vBulletLife.push_back(b.fLife);
+  }
+
+  m_pPlayer->Load(save.player);
+  m_pInventory->Load(save);
+  m_drops.Load(save);
+  m_rollback.Barrier();
+
+  const auto t1 = std::chrono::high_resolution_clock::now();
+  m_fLoadTime = std::chrono::duration<float, std::milli>(t1 - t0).count();
+  return true;
+}  // LoadGame
+
+/// Hash each part of the simulation and add the frame to the world hash.
+/// Only bodies that can move are hashed. Tile bodies follow from the tile
+/// map, which is hashed again only after it changes. Two runs give the same
+/// hashes only if they have the same input on the same frames and the same
+/// frame times, which is what the fixed step in gamesettings.xml is for.
+/// This must run after the frame graph, while nothing else is running.
+
+void CGame::HashWorld() {
+  const auto t0 = std::chrono::high_resolution_clock::now();
+
+  uint64_t h = g_nHashSeed;
+  for (b2Body* b = mWorld->GetBodyList(); b; b = b->GetNext()) {
+    if (b->GetType() == b2_staticBody) continue;
+    const b2Vec2& p = b->GetPosition();
+    const b2Vec2& v = b->GetLinearVelocity();
+    const float state[] = {p.x, p.y, b->GetAngle(), v.x, v.y,
+                           b->GetAngularVelocity(), b->IsAwake() ? 1.0f : 0.0f};
+    h = HashValue(state, h);
+  }
+  m_worldHash.Set(eHashPart::Bodies, h);
+
+  h = g_nHashSeed;
+  for (const CPlayer* p : m_vPlayers) h = p->Hash(h);
+  m_worldHash.Set(eHashPart::Player, h);
+  m_worldHash.Set(eHashPart::Bullets, HashArray(m_vBulletLife));
+
+  h = g_nHashSeed;
+  for (const CInventoryManager* inventory : m_vInventories)
+    h = inventory->HashSlots(h);
+  m_worldHash.Set(eHashPart::Inventory, h);
+  m_worldHash.Set(eHashPart::Drops, m_drops.Hash(g_nHashSeed));
+  m_worldHash.Set(eHashPart::Crowd, m_crowd.Hash(g_nHashSeed));
+
+  if (m_worldHash.IsStale(eHashPart::Tiles))
+    m_worldHash.Set(eHashPart::Tiles, HashWords(m_strTiles.data(),
+                                                m_strTiles.size()));
+
+  m_worldHash.EndFrame();
+
+  const auto t1 = std::chrono::high_resolution_clock::now();
+  m_fHashTime = std::chrono::duration<float, std::milli>(t1 - t0).count();
+}  // HashWorld
+
+/// Destroy the bullets that expired last frame. Bodies can only be destroyed
+/// outside of Step, and the lifetimes are compacted along with the bullets
+/// to stay parallel.
+
+void CGame::CompactBullets() {
+  size_t nLive = 0;
+  for (size_t i = 0; i < m_bullets.size(); ++i) {
+    if (i < m_vBulletDead.size() && m_vBulletDead[i]) {
+      mWorld->DestroyBody(m_bullets[i]->GetBody());
+      delete m_bullets[i];
+    } else {
+      m_bullets[nLive] = m_bullets[i];
+      m_vBulletLife[nLive++] = m_vBulletLife[i];
+    }
+  }
+  m_bullets.resize(nLive);
+  m_vBulletLife.resize(nLive);
+  m_vBulletDead.clear();
+}  // CompactBullets
+
+/// Count down the bullet lifetimes and flag the ones that run out, to be
+/// destroyed by CompactBullets() at the start of the next frame.
+/// \param dt Frame time in seconds
+
+void CGame::AgeBullets(float dt) {
+  const size_t n = m_vBulletLife.size();
+  m_vBulletDead.resize(n);
+  SimdAdd(m_vBulletLife.data(), n, -dt);
+  SimdExpired(m_vBulletLife.data(), n, m_vBulletDead.data());
+}  // AgeBullets
+
+/// Fire the shots the players asked for last frame, then move each player by
+/// their input for this frame, unless a menu has their keyboard. Players go
+/// in order, so bullets are made in the same order every time.
+/// \param dt Frame time in seconds
+/// \param inputs Buttons, one per player
+
+void CGame::StepPlayers(float dt, const SPlayerInput* inputs) {
+  const eController controller =
+      m_bGridController ? eController::Grid : eController::Box2D;
+
+  for (size_t i = 0; i < m_vPlayers.size(); ++i) {
+    CPlayer* p = m_vPlayers[i];
+    if (p->WantsToShoot()) {
+      SpawnBulletFromPlayer(p);
+      p->ClearShootRequest();
+    }
+
+    p->SetController(controller);
+    if (!inputs[i].Has(eInput::Menu)) p->Update(dt, inputs[i], m_pTileManager);
+  }
+}  // StepPlayers
+
+/// Run the part of a frame that rollback saves and loads, serially and with
+/// nothing drawn: the players, the physics step, the bullets and the drops,
+/// in the order that ProcessFrame() and the frame graph run them.
+/// \param dt Frame time in seconds
+/// \param inputs Buttons, one per player
+
+void CGame::SimulateFrame(float dt, const SPlayerInput* inputs) {
+  StepPlayers(dt, inputs);
+  mWorld->Step(dt, 8, 3);
+  AgeBullets(dt);
+  m_drops.Update(dt);
+  m_drops.Collect(m_vPlayers.data(), m_vInventories.data(), m_vPlayers.size());
+  CompactBullets();
+}  // SimulateFrame
+
+/// Save the state before a frame into its snapshot in the ring, reusing the
+/// snapshot's arrays.
+/// \param frame Frame number
+
+void CGame::SaveSnapshot(uint32_t frame) {
+  SGameSnapshot& s = m_vSnapshots[frame % m_vSnapshots.size()];
+  s.nFrame = frame;
+  s.vPlayers.resize(m_vPlayers.size());
+  for (size_t i = 0; i < m_vPlayers.size(); ++i)
+    m_vPlayers[i]->Snapshot(s.vPlayers[i]);
+
+  s.vBullets.resize(m_bullets.size());
+  for (size_t i = 0; i < m_bullets.size(); ++i) {
+    const b2Body* b = m_bullets[i]->GetBody();
+    s.vBullets[i].vPos = b->GetPosition();
+    s.vBullets[i].vVel = b->GetLinearVelocity();
+    s.vBullets[i].fLife = m_vBulletLife[i];
+  }
+
+  s.vInventories.resize(m_vInventories.size());
+  for (size_t i = 0; i < m_vInventories.size(); ++i)
+    m_vInventories[i]->Snapshot(s.vInventories[i]);
+  m_drops.Snapshot(s.drops);
+}  // SaveSnapshot
+
+/// Load the state before a frame from its snapshot in the ring. Bullets that
+/// are still here are moved back rather than made again, so only those fired
+/// or expired since cost a body. The players are the same as when it was
+/// saved, since adding one starts rollback again.
+/// \param frame Frame number
+
+void CGame::LoadSnapshot(uint32_t frame) {
+  const SGameSnapshot& s = m_vSnapshots[frame % m_vSnapshots.size()];
+  for (size_t i = 0; i < m_vPlayers.size() && i < s.vPlayers.size(); ++i)
+    m_vPlayers[i]->Restore(s.vPlayers[i]);
+
+  const size_t n = s.vBullets.size();
+  for (size_t i = n; i < m_bullets.size(); ++i) {
+    mWorld->DestroyBody(m_bullets[i]->GetBody());
+    delete m_bullets[i];
+  }
+  if (m_bullets.size() > n) m_bullets.resize(n);
+
+  for (size_t i = 0; i < n; ++i) {
+    const SBulletState& b = s.vBullets[i];
+    if (i < m_bullets.size()) {
+      b2Body* body = m_bullets[i]->GetBody();
+      body->SetTransform(b.vPos, 0.0f);
+      body->SetLinearVelocity(b.vVel);
+      body->SetAwake(true);
+    } else {
+      const b2Filter filter =
+          m_collision.GetFilter(eCollisionLayer::Projectile);
+      m_bullets.push_back(new CBullet(mWorld, b.vPos, b.vVel, filter));
+    }
+  }
+
+  m_vBulletLife.resize(n);
+  for (size_t i = 0; i < n; ++i) m_vBulletLife[i] = s.vBullets[i].fLife;
+  m_vBulletDead.clear();
+
+  for (size_t i = 0; i < m_vInventories.size() && i < s.vInventories.size();
+       ++i)
+    m_vInventories[i]->Restore(s.vInventories[i]);
+  m_drops.Restore(s.drops);
+}  // LoadSnapshot
+
+/// Start rollback again from frame 0, with a slot in the driver for each
+/// player. This is done whenever a player comes or goes, since the driver
+/// and the snapshots keep their inputs and state by player.
+/// \param depth Most frames to roll back
+
+void CGame::RestartRollback(uint32_t depth) {
+  m_rollback.Reset(std::max<size_t>(m_vPlayers.size(), 1), depth);
+  m_vSnapshots.resize(m_rollback.GetDepth() + 1);
+  m_peer.Reset(m_fPeerDelay, m_fPeerJitter);
+  m_bRollbackHeld = false;
+  m_nRollbackHeld = 0;
+}  // RestartRollback
+
+/// Send the local player's input through the loopback peer and hand the
+/// inputs that have come back to the rollback driver, which rolls back and
+/// runs frames again if they are not what it predicted. The local player is
+/// their own remote peer, so what is on screen is predicted and corrected
+/// exactly as another player's would be, with the delay and jitter set in
+/// gamesettings.xml. The other players' inputs are known as soon as they
+/// are read, so they go to the driver directly. Time is counted in fixed
+/// frames, run or held, so a rollback is repeatable. If running this frame
+/// would take a player further past their last confirmed input than the
+/// driver can roll back, the frame is held instead. It is tried again next
+/// time, and its input is not sent twice. m_vInputs is replaced by the
+/// inputs to run this frame with.
+/// \return True if the frame can run, false if it is held
+
+bool CGame::Rollback() {
+  const uint32_t frame = m_rollback.GetFrame();
+  const double now = (frame + m_nRollbackHeld) * m_fRollbackStep * 1000.0;
+
+  if (!m_bRollbackHeld) {  // sent when the frame was first held
+    SInputPacket packet;
+    packet.nFrame = frame;
+    packet.input = m_vInputs[0];
+    m_peer.Send(packet, now);
+  }
+
+  m_vPackets.clear();
+  m_peer.Receive(now, m_vPackets);
+  for (const SInputPacket& p : m_vPackets)
+    m_rollback.AddInput(p.nPlayer, p.nFrame, p.input);
+
+  for (size_t i = 1; i < m_vInputs.size(); ++i)
+    m_rollback.AddInput(i, frame, m_vInputs[i]);
+
+  m_bRollbackHeld = !m_rollback.CanAdvance();
+  if (m_bRollbackHeld) {
+    ++m_nRollbackHeld;
+    return false;
+  }
+
+  const SPlayerInput* inputs = m_rollback.BeginFrame();
+  std::copy(inputs, inputs + m_vInputs.size(), m_vInputs.begin());
+  return true;
+}  // Rollback
+
+/// Make a player with an empty inventory and a camera, standing at a spawn
+/// point of their own. Spawn points are set out in rows above the first
+/// player's, so that a crowd of players does not start inside each other.
+/// \param source Where their input comes from
+
+void CGame::AddPlayer(ePlayerInput source) {
+  const size_t i = m_vPlayers.size();
+  CPlayer* p = new CPlayer(m_pRenderer, mWorld, this);
+  if (i > 0)
+    p->SetSpawn(m_vPlayers[0]->GetSpawn() +
+                Vector2(48.0f * (i % 32), 64.0f * (i / 32)));
+  if (!m_strTiles.empty())
+    p->SetMap(m_strTiles.data(), m_pTileManager->GetMapWidth(),
+              m_pTileManager->GetMapHeight());
+  p->Reset();
 
   // Initialize inventory with screen dimensions
-  m_pInventory = new CInventoryManager(m_pRenderer);
-  m_pInventory->SetScreenSize((float)m_nWinWidth, (float)m_nWinHeight);
-  m_pInventory->SetPlayer(m_pPlayer);
+  CInventoryManager* inventory = new CInventoryManager(m_pRenderer);
+  inventory->SetScreenSize((float)m_nWinWidth, (float)m_nWinHeight);
+  inventory->SetPlayer(p);
+  inventory->SetDrops(&m_drops);
+
+  m_vPlayers.push_back(p);
+  m_vInventories.push_back(inventory);
+  CCamera camera;
+  camera.SetSettings(m_cameraSettings);
+  camera.SetViewSize((float)m_nWinWidth, (float)m_nWinHeight);
+  camera.Snap(p->GetPos().x, p->GetPos().y);
+  m_vCameras.push_back(camera);
+  m_vInputSources.push_back(source);
+  m_vInputSlots.push_back(-1);
+  m_vInputs.push_back(SPlayerInput());
+}  // AddPlayer
+
+/// Add scripted players, or remove them from the end, until there are as
+/// many players as gamesettings.xml asks for. Players that someone is
+/// playing are never removed, so there may be more. Removing a player
+/// destroys their body, and their inventory goes with them.
+
+void CGame::SetPlayerCount() {
+  const size_t n = m_vPlayers.size();
+
+  while (m_vPlayers.size() < m_nPlayerCount) AddPlayer(ePlayerInput::Script);
+
+  while (m_vPlayers.size() > std::max<size_t>(m_nPlayerCount, 1) &&
+         m_vInputSources.back() == ePlayerInput::Script) {
+    b2Body* body = m_vPlayers.back()->GetBody();
+    m_debugBodies.erase(
+        std::remove(m_debugBodies.begin(), m_debugBodies.end(), body),
+        m_debugBodies.end());
+    mWorld->DestroyBody(body);
+    delete m_vPlayers.back();
+    delete m_vInventories.back();
+
+    m_vPlayers.pop_back();
+    m_vInventories.pop_back();
+    m_vCameras.pop_back();
+    m_vInputSources.pop_back();
+    m_vInputSlots.pop_back();
+    m_vInputs.pop_back();
+  }
 
+  if (m_vPlayers.size() != n) RestartRollback(m_rollback.GetDepth());
+}  // SetPlayerCount
 
+/// Get this frame's input for every player: the keyboard for the local
+/// player, the clients for the players they play, and the script for the
+/// rest. A headless server's local player is left standing, since nobody is
+/// at the keyboard.
+/// \param keyboard Buttons read from the keyboard this frame
 
-  LoadSounds();  // load the sounds for this game
+void CGame::ReadInputs(const SPlayerInput& keyboard) {
+  const bool headless = m_eNetMode == eNetMode::Server && m_bHeadless;
+  if (m_eNetMode == eNetMode::Server) ServeInput();
 
-  BeginGame();
-}  // Initialize
+  for (size_t i = 0; i < m_vPlayers.size(); ++i)
+    switch (m_vInputSources[i]) {
+      case ePlayerInput::Keyboard:
+        m_vInputs[i] = headless ? SPlayerInput() : keyboard;
+        break;
+
+      case ePlayerInput::Net:
+        m_vInputs[i] = m_netServer.TakeInput(m_vInputSlots[i]);
+        break;
+
+      default:
+        m_vInputs[i] = CPlayer::ScriptInput((uint32_t)i, m_nFrame);
+        break;
+    }
+
+  ++m_nFrame;
+}  // ReadInputs
+
+/// Take the role set in gamesettings.xml. The sockets are opened again only
+/// when the role or address changes, so that saving the settings for some
+/// other reason does not drop the clients. A server opens its port to any
+/// address. A client opens any free port and asks the server to join.
+/// \param pNet The net tag, or nullptr for no network
+
+void CGame::StartNet(tinyxml2::XMLElement* pNet) {
+  const char* mode = pNet ? pNet->Attribute("mode") : nullptr;
+  const char* host = pNet ? pNet->Attribute("host") : nullptr;
+  const unsigned port = pNet ? pNet->UnsignedAttribute("port", 27015) : 0;
+
+  eNetMode role = eNetMode::Off;
+  if (mode && !strcmp(mode, "server")) role = eNetMode::Server;
+  else if (mode && !strcmp(mode, "client")) role = eNetMode::Client;
+
+  if (pNet) {
+    m_bHeadless = pNet->BoolAttribute("headless", false);
+    m_nNetSend = std::max(1u, pNet->UnsignedAttribute("send", 3));
+    m_nNetRadius = std::max(0, pNet->IntAttribute("radius", 1));
+  }
+
+  const std::string config = std::to_string((int)role) + " " +
+                             (host ? host : "127.0.0.1") + ":" +
+                             std::to_string(port);
+  if (config == m_strNetConfig) return;
+  m_strNetConfig = config;
+
+  m_netServer.Close();
+  m_netClient.Close();
+  m_eNetMode = eNetMode::Off;
+  for (size_t i = 0; i < m_vPlayers.size(); ++i)  // clients are gone
+    if (m_vInputSources[i] == ePlayerInput::Net) {
+      m_vInputSources[i] = ePlayerInput::Script;
+      m_vInputSlots[i] = -1;
+    }
+
+  if (role == eNetMode::Server) {
+    if (m_netServer.Open((uint16_t)port, pNet->UnsignedAttribute("clients", 64)))
+      m_eNetMode = role;
+  }
+
+  else if (role == eNetMode::Client) {
+    SNetAddress server;
+    if (server.Set(host ? host : "127.0.0.1", (uint16_t)port) &&
+        m_netClient.Connect(server, m_pTimer->GetTime() * 1000.0))
+      m_eNetMode = role;
+  }
+}  // StartNet
+
+/// Read the clients' packets and give each client that joined a player of
+/// their own: the first scripted player, or a new one when every player is
+/// taken. A client that leaves hands their player back to the script. The
+/// player's net id is their index + 1, which is what the client is told to
+/// watch. Past the most players there can be, a client watches the local
+/// player.
+
+void CGame::ServeInput() {
+  m_netServer.Poll(m_pTimer->GetTime() * 1000.0);
+
+  for (size_t slot : m_netServer.GetLeft())
+    for (size_t i = 0; i < m_vPlayers.size(); ++i)
+      if (m_vInputSources[i] == ePlayerInput::Net &&
+          m_vInputSlots[i] == (int)slot) {
+        m_vInputSources[i] = ePlayerInput::Script;
+        m_vInputSlots[i] = -1;
+      }
+
+  for (size_t slot : m_netServer.GetJoined()) {
+    size_t i = 1;
+    while (i < m_vPlayers.size() && m_vInputSources[i] != ePlayerInput::Script)
+      ++i;
+
+    if (i == m_vPlayers.size()) {
+      if (i >= g_nMaxPlayers) {
+        m_netServer.SetPlayer(slot, 1);
+        continue;
+      }
+
+      AddPlayer(ePlayerInput::Script);
+      RestartRollback(m_rollback.GetDepth());
+    }
+
+    m_vInputSources[i] = ePlayerInput::Net;
+    m_vInputSlots[i] = (int)slot;
+    m_netServer.SetPlayer(slot, (uint32_t)i + 1);
+  }
+}  // ServeInput
+
+/// Every few frames, gather the players, bullets and drops as network
+/// entities, in pixels, and send each client a snapshot of those in the
+/// chunks around their player. The interest grid is set from the tile map
+/// each time, since a reload can change its size.
+
+void CGame::Replicate() {
+  if (++m_nNetTick % m_nNetSend != 0) return;
+  const auto t0 = std::chrono::high_resolution_clock::now();
+
+  const float tileSize = m_pTileManager->GetTileSize();
+  const int chunk = m_pTileManager->GetChunkSize();
+  m_netServer.SetInterest(chunk * tileSize,
+                          (m_pTileManager->GetMapWidth() + chunk - 1) / chunk,
+                          (m_pTileManager->GetMapHeight() + chunk - 1) / chunk,
+                          m_nNetRadius);
+
+  m_vNetWorld.clear();
+  SNetEntity e;
+
+  for (size_t i = 0; i < m_vPlayers.size(); ++i) {
+    const CPlayer* p = m_vPlayers[i];
+    e = SNetEntity();
+    e.nId = (uint32_t)i + 1;
+    e.nType = (uint8_t)eNetEntity::Player;
+    if (p->GetFacing() < 0) e.nFlags |= (uint8_t)eNetFlag::FacingLeft;
+    if (p->IsAttacking()) e.nFlags |= (uint8_t)eNetFlag::Attacking;
+    e.nData = (uint16_t)p->GetHealth();
+    e.SetPos(p->GetPos().x, p->GetPos().y);
+    const b2Vec2 v = p->GetBody()->GetLinearVelocity();
+    e.SetVel(v.x * 32.0f, v.y * 32.0f);
+    m_vNetWorld.push_back(e);
+  }
+
+  for (const CBullet* b : m_bullets) {
+    e = SNetEntity();
+    e.nId = m_netIds.Get(b, eNetEntity::Bullet);
+    e.nType = (uint8_t)eNetEntity::Bullet;
+    const b2Vec2 p = b->GetBody()->GetPosition();
+    const b2Vec2 u = b->GetBody()->GetLinearVelocity();
+    e.SetPos(p.x * 32.0f, p.y * 32.0f);
+    e.SetVel(u.x * 32.0f, u.y * 32.0f);
+    m_vNetWorld.push_back(e);
+  }
+
+  for (size_t i = 0; i < m_drops.GetCount(); ++i) {
+    const CItem* item = m_drops.GetItem(i);
+    e = SNetEntity();
+    e.nId = m_netIds.Get(item, eNetEntity::Drop);
+    e.nType = (uint8_t)eNetEntity::Drop;
+    e.nData = (uint16_t)item->GetSprite();
+    e.SetPos(m_drops.GetPos(i).x, m_drops.GetPos(i).y);
+    m_vNetWorld.push_back(e);
+  }
+
+  m_netIds.Sweep();
+  m_netServer.Replicate(m_nNetTick, m_vNetWorld);
+
+  const auto t1 = std::chrono::high_resolution_clock::now();
+  m_fNetTime = std::chrono::duration<float, std::milli>(t1 - t0).count();
+}  // Replicate
+
+/// A client does not simulate. It sends the keyboard to the server, takes
+/// the latest snapshot's entities as sprites, and centers the camera on the
+/// player the server says it watches.
+
+void CGame::ClientFrame() {
+  m_netClient.Poll(m_pTimer->GetTime() * 1000.0);
+
+  SPlayerInput input;  // the player is left alone while the inventory is open
+  if (m_pInventory->IsOpen()) input.Set(eInput::Menu);
+  else input = CPlayer::ReadInput(m_pKeyboard);
+  m_netClient.SendInput(++m_nNetFrame, input);
+
+  m_vNetSprites.clear();
+  LSpriteDesc2D d;
+
+  for (const SNetEntity& e : m_netClient.GetView()) {
+    d.m_vPos = Vector2(e.GetX(), e.GetY());
+    eSpriteLayer layer = eSpriteLayer::Actors;
+
+    switch ((eNetEntity)e.nType) {
+      case eNetEntity::Player:
+        d.m_nSpriteIndex = (UINT)(e.nFlags & (uint8_t)eNetFlag::Attacking
+                                      ? eSprite::Jab
+                                      : eSprite::Step);
+        if (e.nId == m_netClient.GetPlayerId())
+          m_vCameras[0].Follow(d.m_vPos.x, d.m_vPos.y,
+                               m_pTimer->GetFrameTime());
+        break;
+
+      case eNetEntity::Bullet:
+        d.m_nSpriteIndex = (UINT)eSprite::Bullet;
+        layer = eSpriteLayer::Projectiles;
+        break;
+
+      default:
+        if (e.nData >= (UINT)eSprite::Size) continue;
+        d.m_nSpriteIndex = e.nData;
+        layer = eSpriteLayer::Drops;
+        break;
+    }
+
+    m_vNetSprites.push_back({layer, d});
+  }
 
-/// Load the specific images needed for this game. This is where `eSprite`
-/// values from `GameDefines.h` get tied to the names of sprite tags in
-/// `gamesettings.xml`. Those sprite tags contain the name of the corresponding
-/// image file. If the image tag or the image file are missing, then the game
-/// should abort from deeper in the Engine code leaving you with an error
-/// message in a dialog box.
+  const CCamera& camera = m_vCameras[0];
+  m_vCameraPos = Vector3(camera.GetX(), camera.GetY(), 0.0f);
+  m_cullRect = camera.GetCullRect();
+  m_pTileManager->Cull(m_cullRect);
+}  // ClientFrame
+
+/// Register every sprite with the asset loader. The sprite table and `eSprite`
+/// are generated from the sprite tags in `gamesettings.xml` by TableGen before
+/// the game is built, so they always agree, and a sprite tag or image file
+/// that is missing stops the build rather than the game. Sprites marked
+/// `first` in the XML are needed for the first frame. The rest stream in
+/// while the game runs, drawn as the placeholder `DebugSquare` until they
+/// arrive.
 
 void CGame::LoadImages() {
-  m_pRenderer->BeginResourceUpload();
-
-  m_pRenderer->Load(eSprite::Background, "background");
-  // m_pRenderer->Load(eSprite::TextWheel,  "textwheel");
-  m_pRenderer->Load(eSprite::Chapel, "chapel");
-  m_pRenderer->Load(eSprite::Sky, "sky");
-  m_pRenderer->Load(eSprite::Pig, "pig");
-  m_pRenderer->Load(eSprite::Dirt, "dirt");
-  m_pRenderer->Load(eSprite::Step, "step");
-  m_pRenderer->Load(eSprite::Jab, "jab");
-  m_pRenderer->Load(eSprite::DebugRed, "debugBox");
-  m_pRenderer->Load(eSprite::DebugSquare, "debugSquareWOutline");
-  m_pRenderer->Load(eSprite::DebugGreen, "contactSquare");
-  m_pRenderer->Load(eSprite::Bullet, "bullet");
-  
-  m_pRenderer->Load(eSprite::InventorySlot, "inventory_slot");
-  m_pRenderer->Load(eSprite::InventoryPanel, "inventory_panel");
-  m_pRenderer->Load(eSprite::InventorySlotSelected, "inventory_slot_selected");
-
-  // Load item sprites
-  m_pRenderer->Load(eSprite::ItemPotion, "item_potion");
-  m_pRenderer->Load(eSprite::ItemKey, "item_key");
-  m_pRenderer->Load(eSprite::ItemCoin, "item_coin");
-  m_pRenderer->Load(eSprite::ItemApple, "item_apple");
-  m_pRenderer->Load(eSprite::ItemShield, "item_shield");
-  m_pRenderer->EndResourceUpload();
+  m_pLoader->SetPlaceholder((UINT)eSprite::DebugSquare);
+
+  for (const SSpriteInfo& sprite : g_pSpriteTable)
+    m_pLoader->AddSprite((UINT)sprite.eIndex, sprite.szName, sprite.szFile,
+                         sprite.bFirstFrame);
 }  // LoadImages
 
-/// Initialize the audio player and load game sounds.
+/// Initialize the audio player, open the audio device and load the sounds
+/// into the mixer. The audio player plays a whole sound or nothing, so the
+/// game mixes its own voices and sends the mix to the sound card. The audio
+/// tag sets the real voices and the device, and `device="null"` mixes
+/// without playing, as a server would. The sounds and their settings come
+/// from the sound table that TableGen generates from `gamesettings.xml`, in
+/// `eSound` order. A sound whose file cannot be read is left out, and asking
+/// for it does nothing.
 
 void CGame::LoadSounds() {
   m_pAudio->Initialize(eSound::Size);
-  //  m_pAudio->Load(eSound::Grunt, "grunt");
-  // m_pAudio->Load(eSound::Clang, "clang");
-  // m_pAudio->Load(eSound::Oink, "oink");
+
+  tinyxml2::XMLElement* t =
+      m_pXmlSettings ? m_pXmlSettings->FirstChildElement("audio") : nullptr;
+  const uint32_t rate = t ? t->UnsignedAttribute("rate", 44100) : 44100;
+  const char* device = t ? t->Attribute("device") : nullptr;
+
+  if (t) {
+    m_audio.SetVoices(t->UnsignedAttribute("voices", 32));
+    m_audio.SetVolume(t->FloatAttribute("volume", 1.0f));
+    m_audio.SetCoalesce(t->FloatAttribute("coalesce", 64.0f));
+    m_audio.SetChunk(t->UnsignedAttribute("chunk", 16384));
+  }
+
+  if (!device || strcmp(device, "null")) {
+    CWaveOutDevice* pWaveOut = new CWaveOutDevice;
+    if (pWaveOut->Open(rate, t ? t->UnsignedAttribute("buffers", 4) : 4,
+                       t ? t->UnsignedAttribute("frames", 1024) : 1024))
+      m_pAudioDevice = pWaveOut;
+    else delete pWaveOut;
+  }
+
+  if (!m_pAudioDevice) m_pAudioDevice = new CNullAudioDevice(rate);
+  m_audio.SetDevice(m_pAudioDevice);
+
+  for (const SSoundInfo& sound : g_pSoundTable) {
+    SSoundDef def;
+    def.strName = sound.szName;
+    def.strFile = sound.szFile;
+    def.fVolume = sound.fVolume;
+    def.fPriority = sound.fPriority;
+    def.fRadius = sound.fRadius;
+    def.nInstances = sound.nInstances;
+    def.bLoop = sound.bLoop;
+    def.bStream = sound.bStream;
+    m_pSoundIds[(UINT)sound.eIndex] = m_audio.Add(def);
+  }
 }  // LoadSounds
 
+/// Ask the mixer for a clang where a bullet hit something, an oink for each
+/// item picked up and a grunt for each attack started this frame. Each hit
+/// is asked for, since the mixer merges hits close together.
+
+void CGame::PlaySounds() {
+  const int clang = m_pSoundIds[(UINT)eSound::Clang];
+  const int grunt = m_pSoundIds[(UINT)eSound::Grunt];
+  const int oink = m_pSoundIds[(UINT)eSound::Oink];
+
+  if (clang >= 0)
+    for (const SImpact& hit : m_listener->GetImpacts())
+      m_audio.Play((uint32_t)clang, hit.vPos.x * 32.0f, hit.vPos.y * 32.0f);
+
+  if (oink >= 0)
+    for (const Vector2& pos : m_drops.GetTaken())
+      m_audio.Play((uint32_t)oink, pos.x, pos.y);
+
+  if (grunt >= 0)
+    for (const CPlayer* p : m_vPlayers)
+      if (p->AttackStarted())
+        m_audio.Play((uint32_t)grunt, p->GetPos().x, p->GetPos().y);
+}  // PlaySounds
+
 
 void CGame::Release() {
+  SaveGame();  // so the next session carries on from here
+  m_saveWriter.Wait();
+  if (!m_strHashLog.empty()) m_worldHash.Write(m_strHashLog.c_str());
+  m_netServer.Close();  // tell the other end
+  m_netClient.Close();
+  m_audio.Stop();  // closes streams
+  m_audio.SetDevice(nullptr);
+  delete m_pAudioDevice;
+  m_pAudioDevice = nullptr;
+
+  delete m_pRenderThread;  // must stop before the renderer goes
+  m_pRenderThread = nullptr;
+  delete m_pLoader;  // waits for its file reads, so before the jobs
+  m_pLoader = nullptr;
+  m_pPaths->Collect(m_pJobs);  // likewise for path searches
+  delete m_pPaths;
+  m_pPaths = nullptr;
+  delete m_pJobs;
+  m_pJobs = nullptr;
   delete m_pRenderer;
-  delete m_pPlayer;
+  for (CPlayer* p : m_vPlayers) delete p;
   m_pRenderer = nullptr;  // for safety
 }  // Release
 
@@ -257,10 +1286,30 @@ void CGame::Release() {
 
 void CGame::BeginGame() {
   delete m_pSpriteDesc;
-  bool DebugDraw = true;
-  m_pSpriteDesc = new LSpriteDesc2D((UINT)eSprite::TextWheel, m_vWinCenter);
   m_pSpriteDesc = new LSpriteDesc2D((UINT)eSprite::Pig, m_vWinCenter / 4);
 
+  // clear out the last game, if there was one
+  for (CBullet* b : m_bullets) {
+    mWorld->DestroyBody(b->GetBody());
+    delete b;
+  }
+  m_bullets.clear();
+  m_vBulletSprites.clear();
+  m_vBulletLife.clear();
+  m_vBulletDead.clear();
+
+  RebuildTileBodies();
+  m_bNavDirty = true;
+  m_crowd.Clear();  // respawned once the graph is built
+  for (CPlayer* p : m_vPlayers) p->Reset();
+  for (size_t i = 0; i < m_vPlayers.size(); ++i)  // no panning to the spawn
+    m_vCameras[i].Snap(m_vPlayers[i]->GetPos().x, m_vPlayers[i]->GetPos().y);
+  FollowCamera(0.0f);
+  for (CInventoryManager* inventory : m_vInventories) inventory->Clear();
+  m_drops.Clear();
+  m_worldHash.Reset();  // frame 0 is the first frame of this game
+  m_rollback.Barrier();
+
   // Add some test items to inventory
   CItem* potion = new CItem(1, "Health Potion", "Restores 50 HP",
                             eSprite::ItemPotion, eItemType::Consumable);
@@ -294,6 +1343,9 @@ void CGame::KeyboardHandler() {
   if (m_pKeyboard->TriggerDown(VK_F2))  // toggle frame rate
     m_bDrawFrameRate = !m_bDrawFrameRate;
 
+  if (m_pKeyboard->TriggerDown(VK_F3))  // toggle render thread
+    m_pRenderThread->SetThreaded(!m_pRenderThread->IsThreaded());
+
   // Always handle hotbar input (number keys 1-6)
   m_pInventory->HandleHotbarInput(m_pKeyboard);
 
@@ -307,19 +1359,50 @@ void CGame::KeyboardHandler() {
   if (!m_pInventory->IsOpen() && m_pKeyboard->TriggerDown('Q'))
     m_pInventory->UseHotbarItem();
 
+  if (m_pKeyboard->TriggerDown(VK_F4)) {  // blast the terrain ahead
+    const b2Vec2 p = m_pPlayer->GetBody()->GetPosition();
+    Explode(Vector2(p.x * 32.0f + 160.0f, p.y * 32.0f - 64.0f), 192.0f);
+  }
+
+  if (m_pKeyboard->TriggerDown(VK_F5)) {  // toggle the debug path
+    m_bDrawPath = !m_bDrawPath;
+    m_vDebugPath.clear();
+  }
+
+  if (m_pKeyboard->TriggerDown(VK_F6)) {  // toggle the player controller
+    m_bGridController = !m_bGridController;
+    m_rollback.Barrier();
+  }
+
+  if (m_pKeyboard->TriggerDown(VK_F7))  // save in the background
+    SaveGame();
+
+  if (m_pKeyboard->TriggerDown(VK_F8))  // load the last save
+    LoadGame();
+
+  if (m_pKeyboard->TriggerDown(VK_F9)) {  // toggle the world hash
+    m_bHashWorld = !m_bHashWorld;
+    m_worldHash.Reset();
+  }
+
+  if (m_pKeyboard->TriggerDown(VK_F11))  // toggle the physics outlines
+    m_debugDraw.SetEnabled(!m_debugDraw.IsEnabled());
+
   if (m_pKeyboard->TriggerDown(VK_BACK))  // restart game
     BeginGame();                          // restart game
 
 }  // KeyboardHandler
 
-void CGame::SpawnBulletFromPlayer() {
-  b2Vec2 pos = m_pPlayer->GetBody()->GetPosition();
+void CGame::SpawnBulletFromPlayer(const CPlayer* player) {
+  b2Vec2 pos = player->GetBody()->GetPosition();
 
   b2Vec2 dir = b2Vec2(1.0f, 0.0f);
 
   b2Vec2 vel = b2Vec2(15.0f, 0.0f);
 
-  m_bullets.push_back(new CBullet(mWorld, pos, vel));
+  m_bullets.push_back(new CBullet(
+      mWorld, pos, vel, m_collision.GetFilter(eCollisionLayer::Projectile)));
+  m_vBulletLife.push_back(g_fBulletLife);
 }
 
 /// Draw the current frame rate to a hard-coded position in the window.
@@ -328,189 +1411,643 @@ void CGame::SpawnBulletFromPlayer() {
 
 void CGame::RegisterDebugBody(b2Body* b) { m_debugBodies.push_back(b); }
 
-void CGame::DrawFrameRateText() {
+/// Get the resident memory of this process.
+/// \return Working set size in bytes
+
+static size_t GetResidentMemory() {
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+  return pmc.WorkingSetSize;
+}
+
+void CGame::DrawFrameRateText(CFramePacket* pPacket) {
   const std::string s =
       std::to_string(m_pTimer->GetFPS()) + " fps";  // frame rate
   const Vector2 pos(m_nWinWidth - 128.0f, 30.0f);   // hard-coded position
-  m_pRenderer->DrawScreenText(s.c_str(), pos);      // draw to screen
+  pPacket->DrawScreenText(s.c_str(), pos);          // draw to screen
+
+  // time spent in the frame graph and how many threads shared it
+  const std::string jobs =
+      std::to_string((int)(m_frameGraph.GetLastRunTime() * 1000.0f)) +
+      " us x" + std::to_string(m_pJobs->GetThreadCount());
+  pPacket->DrawScreenText(jobs.c_str(), pos + Vector2(-64.0f, 30.0f));
+
+  // render pipeline mode, packet-to-screen latency and rendered frame rate
+  const std::string pipe =
+      std::string(m_pRenderThread->IsThreaded() ? "mt " : "st ") +
+      std::to_string((int)m_pRenderThread->GetLatency()) + " ms " +
+      std::to_string((int)m_pRenderThread->GetThroughput()) + " fps";
+  pPacket->DrawScreenText(pipe.c_str(), pos + Vector2(-64.0f, 60.0f));
+
+  // sprite batches as drawn, and as they would have been without sorting
+  const std::string batches =
+      std::to_string(m_pRenderThread->GetBatchBreaks()) + "/" +
+      std::to_string(m_pRenderThread->GetUnsortedBatchBreaks()) + " batches";
+  pPacket->DrawScreenText(batches.c_str(), pos + Vector2(-64.0f, 90.0f));
+
+  // textures after atlas grouping, atlas pages and packing efficiency
+  const std::string atlas =
+      std::to_string(m_atlas.GetTextureCount()) + " tex " +
+      std::to_string(m_atlas.GetPageCount()) + " pg " +
+      std::to_string((int)(m_atlas.GetEfficiency() * 100.0f)) + "%";
+  pPacket->DrawScreenText(atlas.c_str(), pos + Vector2(-64.0f, 120.0f));
+
+  // assets loaded, time to first frame and time to load everything
+  const std::string assets =
+      std::to_string(m_pLoader->GetLoadedCount()) + "/" +
+      std::to_string(m_pLoader->GetAssetCount()) + " " +
+      std::to_string((int)m_pLoader->GetFirstFrameTime()) + "/" +
+      std::to_string((int)m_pLoader->GetTotalLoadTime()) + " ms";
+  pPacket->DrawScreenText(assets.c_str(), pos + Vector2(-64.0f, 150.0f));
+
+  // whether assets came from the cooked pack, and resident memory
+  const std::string memory =
+      std::string(m_pack.IsOpen() ? "cooked " : "raw ") +
+      std::to_string(GetResidentMemory() >> 20) + " MB";
+  pPacket->DrawScreenText(memory.c_str(), pos + Vector2(-64.0f, 180.0f));
+
+  // chunks rebuilt by the last hot reload and how long it took
+  const std::string reload =
+      std::to_string(m_nReloadChunks) + " ch " +
+      std::to_string((int)(m_fReloadTime * 1000.0f)) + " us reload";
+  pPacket->DrawScreenText(reload.c_str(), pos + Vector2(-64.0f, 210.0f));
+
+  // tiles changed in the last edited frame, and edits per ms of rebuilding
+  const std::string edits =
+      std::to_string(m_nLastEdits) + " ed " +
+      std::to_string((int)(m_nLastEdits / std::max(m_fEditTime, 0.001f))) +
+      "/ms";
+  pPacket->DrawScreenText(edits.c_str(), pos + Vector2(-64.0f, 240.0f));
+
+  // path requests so far, share answered from the cache, last batch time
+  const uint64_t queries = m_pPaths->GetQueryCount();
+  const std::string paths =
+      std::to_string(queries) + " paths " +
+      std::to_string(queries ? 100 * m_pPaths->GetCacheHits() / queries : 0) +
+      "% " + std::to_string((int)(m_pPaths->GetSearchTime() * 1000.0f)) +
+      " us";
+  pPacket->DrawScreenText(paths.c_str(), pos + Vector2(-64.0f, 270.0f));
+
+  // crowd size, agents ticked this frame and agents on screen
+  size_t begin, end;
+  m_crowd.GetRange(eCrowdLOD::Near, begin, end);
+  const std::string crowd =
+      std::to_string(m_crowd.GetCount()) + " crowd " +
+      std::to_string(m_crowd.GetTicked()) + " tick " +
+      std::to_string(end - begin) + " near";
+  pPacket->DrawScreenText(crowd.c_str(), pos + Vector2(-64.0f, 300.0f));
+
+  // what moves the player, and what it is touching
+  const std::string player =
+      std::string(m_bGridController ? "grid" : "box2d") + " " +
+      (m_pPlayer->IsGrounded() ? "G" : "-") +
+      (m_pPlayer->IsHeadBlocked() ? "H" : "-") +
+      (m_pPlayer->TouchingLeftWall() ? "L" : "-") +
+      (m_pPlayer->TouchingRightWall() ? "R" : "-");
+  pPacket->DrawScreenText(player.c_str(), pos + Vector2(-64.0f, 330.0f));
+
+  // last save's main thread and writer thread times, and last load's time
+  const std::string save =
+      "save " + std::to_string((int)(m_fSnapshotTime * 1000.0f)) + " us + " +
+      (m_saveWriter.IsBusy()
+           ? std::string("...")
+           : std::to_string((int)m_saveWriter.GetLastTime()) + " ms") +
+      " load " + std::to_string((int)m_fLoadTime) + " ms";
+  pPacket->DrawScreenText(save.c_str(), pos + Vector2(-64.0f, 360.0f));
+
+  // frame number and world hash, when hashing
+  if (m_bHashWorld) {
+    char hash[64];
+    const SFrameHash& f = m_worldHash.GetLast();
+    snprintf(hash, sizeof(hash), "hash %u %08x %d us", f.nFrame,
+             (uint32_t)f.nWorld, (int)(m_fHashTime * 1000.0f));
+    pPacket->DrawScreenText(hash, pos + Vector2(-64.0f, 390.0f));
+  }
+
+  // depth and time of the last rollback, inputs that came too late and
+  // frames held waiting for the peer
+  if (m_bRollback) {
+    char rollback[80];
+    snprintf(rollback, sizeof(rollback),
+             "rollback %u frames %d us %u late %u held",
+             m_rollback.GetLastDepth(),
+             (int)(m_rollback.GetLastTime() * 1000.0),
+             m_rollback.GetLate(), m_nRollbackHeld);
+    pPacket->DrawScreenText(rollback, pos + Vector2(-64.0f, 420.0f));
+  }
+
+  // clients and replication time as a server, traffic as a client
+  if (m_eNetMode != eNetMode::Off) {
+    char net[64];
+    if (m_eNetMode == eNetMode::Server)
+      snprintf(net, sizeof(net), "server %zu clients %zu ents %d us",
+               m_netServer.GetClientCount(), m_vNetWorld.size(),
+               (int)(m_fNetTime * 1000.0f));
+    else
+      snprintf(net, sizeof(net), "client tick %u %zu ents %u kB",
+               m_netClient.GetTick(), m_netClient.GetView().size(),
+               (unsigned)(m_netClient.GetBytes() / 1024));
+    pPacket->DrawScreenText(net, pos + Vector2(-64.0f, 450.0f));
+  }
+
+  // players, and how many of them clients are playing
+  if (m_vPlayers.size() > 1) {
+    const size_t net = std::count(m_vInputSources.begin(),
+                                  m_vInputSources.end(), ePlayerInput::Net);
+    char players[64];
+    snprintf(players, sizeof(players), "%zu players %zu net %zu drops",
+             m_vPlayers.size(), net, m_drops.GetCount());
+    pPacket->DrawScreenText(players, pos + Vector2(-64.0f, 480.0f));
+  }
+
+  // debug lines drawn and shapes left out of view
+  if (m_debugDraw.IsEnabled()) {
+    char debug[64];
+    snprintf(debug, sizeof(debug), "%zu lines %zu shapes %zu culled",
+             m_debugDraw.GetLineCount(), m_debugDraw.GetShapeCount(),
+             m_debugDraw.GetCulledCount());
+    pPacket->DrawScreenText(debug, pos + Vector2(-64.0f, 510.0f));
+  }
+
+  // live particles, the size of the pool, and how many are in view
+  if (m_particles.GetCapacity() > 0) {
+    char particles[64];
+    snprintf(particles, sizeof(particles), "%zu/%zu particles %zu drawn",
+             m_particles.GetCount(), m_particles.GetCapacity(),
+             m_vParticleSprites.size());
+    pPacket->DrawScreenText(particles, pos + Vector2(-64.0f, 540.0f));
+  }
+
+  // view padding, and tiles, drops and bullets inside the cull rectangle
+  char view[64];
+  snprintf(view, sizeof(view), "+%d px %zu tiles %zu drops %zu bullets",
+           (int)m_cameraSettings.fPadding, m_pTileManager->GetVisibleCount(),
+           m_drops.GetSpriteCount(), m_vBulletSprites.size());
+  pPacket->DrawScreenText(view, pos + Vector2(-64.0f, 600.0f));
+
+  // voices mixed and playing, voices stolen, and the mixer's time
+  char audio[64];
+  snprintf(audio, sizeof(audio), "%zu/%zu voices %u stolen %d us",
+           m_audio.GetRealCount(), m_audio.GetVoiceCount(),
+           (unsigned)m_audio.GetSteals(),
+           (int)(m_audio.GetMixTime() * 1000.0f));
+  pPacket->DrawScreenText(audio, pos + Vector2(-64.0f, 570.0f));
+
+  // contacts in the world after the collision matrix, and the last step
+  char physics[64];
+  snprintf(physics, sizeof(physics), "%d contacts %d us step",
+           mWorld->GetContactCount(),
+           (int)(mWorld->GetProfile().step * 1000.0f));
+  pPacket->DrawScreenText(physics, pos + Vector2(-64.0f, 630.0f));
 }  // DrawFrameRateText
 
-/// Draw the game objects. The renderer is notified of the start and end of the
-/// frame so that it can let Direct3D do its pipelining jiggery-pokery.
+/// Compile the clips in the animations tag into the frame table. Any player
+/// clip that is missing gets the player's old sprite, so the player is still
+/// drawn with no animations tag at all. The animator is then pointed at the
+/// new table.
+/// \param pSettings The settings tag
+
+void CGame::LoadClips(tinyxml2::XMLElement* pSettings) {
+  m_clips.Clear();
+
+  tinyxml2::XMLElement* t = pSettings->FirstChildElement("animations");
+  for (tinyxml2::XMLElement* c = t ? t->FirstChildElement("clip") : nullptr;
+       c; c = c->NextSiblingElement("clip")) {
+    const SSpriteInfo* sprite = FindSprite(c->Attribute("sprite"));
+    if (sprite)
+      m_clips.Add(c->Attribute("name"), (uint32_t)sprite->eIndex,
+                  c->Attribute("frames"), c->FloatAttribute("fps", 8.0f),
+                  c->BoolAttribute("loop", true));
+  }
 
-void CGame::RenderFrame() {
-  m_pRenderer->BeginFrame();  // required before rendering
-  float scale = 32.0f;
-  // =========================
-  //   BACKGROUND DRAWING
-  // =========================
+  static const char* names[] = {"player_idle", "player_walk", "player_jump",
+                                "player_attack"};
+  for (UINT i = 0; i < (UINT)ePlayerAnim::Size; ++i) {
+    const int clip = m_clips.Find(names[i]);
+    const eSprite sprite =
+        i == (UINT)ePlayerAnim::Attack ? eSprite::Jab : eSprite::Step;
+    m_pPlayerClips[i] = clip >= 0 ? (uint32_t)clip
+                                  : m_clips.Add(names[i], (uint32_t)sprite,
+                                                "0", 1.0f, true);
+  }
 
-  {
-    const Vector2 cam = m_pRenderer->GetCameraPos();
-    const float winW = (float)m_nWinWidth;
-    const float winH = (float)m_nWinHeight;
+  m_animator.SetClips(&m_clips);
+}  // LoadClips
+
+/// Pick each player's clip from what it is doing, then advance all of them
+/// in one pass. Animation is not part of the simulation, so it is neither
+/// hashed nor rolled back.
+/// \param dt Frame time in seconds
+
+void CGame::AnimatePlayers(float dt) {
+  m_animator.Resize(m_vPlayers.size(),
+                    m_pPlayerClips[(UINT)ePlayerAnim::Idle]);
 
-    // Real PNG dimensions:
-    const float bgW = 1024.0f;
-    const float bgH = 576.0f;
+  for (size_t i = 0; i < m_vPlayers.size(); ++i) {
+    const CPlayer* p = m_vPlayers[i];
+    const SPlayerInput& in = m_vInputs[i];
 
-    // Scale the background to fill the vertical window (768 tall)
-    const float sc = 1.39f;  // ? 1.333  winH / bgH
+    ePlayerAnim anim = ePlayerAnim::Idle;
+    if (p->IsAttacking()) anim = ePlayerAnim::Attack;
+    else if (!p->IsGrounded()) anim = ePlayerAnim::Jump;
+    else if (in.Has(eInput::Left) != in.Has(eInput::Right))
+      anim = ePlayerAnim::Walk;
 
-    const float drawW = bgW * sc;  // scaled width
+    m_animator.Play(i, m_pPlayerClips[(UINT)anim]);
+  }
+
+  m_animator.Update(dt);
+}  // AnimatePlayers
+
+/// Read the particle emitters and allocate the pool, which empties it.
+/// Angles are in degrees in gamesettings.xml. The emitters named impact and
+/// pickup are the ones the game uses, and either may be left out.
+/// \param pSettings Settings tag
+
+void CGame::LoadParticles(tinyxml2::XMLElement* pSettings) {
+  const float rad = 3.14159265f / 180.0f;
+  std::vector<SParticleEmitter> emitters;
+
+  tinyxml2::XMLElement* t = pSettings->FirstChildElement("particles");
+  for (tinyxml2::XMLElement* p = t ? t->FirstChildElement("emitter") : nullptr;
+       p; p = p->NextSiblingElement("emitter")) {
+    const SSpriteInfo* sprite = FindSprite(p->Attribute("sprite"));
+    const char* name = p->Attribute("name");
+    if (!sprite || !name) continue;
+
+    SParticleEmitter e;
+    e.strName = name;
+    e.nSprite = (uint32_t)sprite->eIndex;
+    e.nMax = p->UnsignedAttribute("max", 1024);
+    e.nCount = p->UnsignedAttribute("count", 8);
+    e.fAngle = p->FloatAttribute("angle", 90.0f) * rad;
+    e.fSpread = p->FloatAttribute("spread", 360.0f) * rad;
+    e.fSpeedMin = p->FloatAttribute("speedmin", 50.0f);
+    e.fSpeedMax = p->FloatAttribute("speedmax", e.fSpeedMin);
+    e.fLifeMin = p->FloatAttribute("lifemin", 0.5f);
+    e.fLifeMax = p->FloatAttribute("lifemax", e.fLifeMin);
+    e.fGravity = p->FloatAttribute("gravity", 0.0f);
+    e.fSize = p->FloatAttribute("size", 1.0f);
+    e.fEndSize = p->FloatAttribute("endsize", e.fSize);
+    e.fRed = p->FloatAttribute("r", 1.0f);
+    e.fGreen = p->FloatAttribute("g", 1.0f);
+    e.fBlue = p->FloatAttribute("b", 1.0f);
+    emitters.push_back(e);
+  }
+
+  m_particles.SetEmitters(emitters);
+  m_nImpactEmitter = m_particles.Find("impact");
+  m_nPickupEmitter = m_particles.Find("pickup");
+  m_vParticleSprites.clear();
+  m_vParticleRuns.clear();
+}  // LoadParticles
+
+/// Emit a burst for each bullet hit and each item picked up this frame,
+/// move every particle, then build sprites for the ones in view, grouped by
+/// emitter so each emitter's sprites go to the frame packet as one run.
+/// Particles shrink and fade out over their lives. They are not part of the
+/// simulation, so they are neither hashed nor rolled back.
+/// \param dt Frame time in seconds
+/// \param view Cull rectangle in pixels
+
+void CGame::UpdateParticles(float dt, const SViewRect& view) {
+  if (m_nImpactEmitter >= 0) {
+    const uint32_t e = (uint32_t)m_nImpactEmitter;
+    const uint32_t n = m_particles.GetEmitter(e).nCount;
+    for (const SImpact& hit : m_listener->GetImpacts())
+      m_particles.Emit(e, hit.vPos.x * 32.0f, hit.vPos.y * 32.0f,
+                       std::atan2(hit.vNormal.y, hit.vNormal.x), n);
+  }
 
-    float bgYOffset = 100.0f;  // shift downward
+  if (m_nPickupEmitter >= 0)
+    for (const Vector2& pos : m_drops.GetTaken())
+      m_particles.Emit((uint32_t)m_nPickupEmitter, pos.x, pos.y);
 
+  m_particles.Update(dt);
 
-    // Start drawing slightly offscreen for no gaps
-    float startX = cam.x - winW / 2.0f - drawW;
+  m_vParticleSprites.clear();
+  m_vParticleRuns.clear();
 
-    
-    // ---- Draw CHAPEL next (mid layer) ----
-    for (float x = startX; x < cam.x + winW / 2.0f + drawW; x += drawW) {
-      LSpriteDesc2D C;
-      C.m_nSpriteIndex = (UINT)eSprite::Chapel;
-      C.m_vPos = Vector2(x + (drawW / 2.0f) + -210.0f, cam.y + bgYOffset); // vertical center
-      C.m_fXScale = sc;
-      C.m_fYScale = sc + 1.0f;
-      m_pRenderer->Draw(&C);
+  const float* x = m_particles.GetX();
+  const float* y = m_particles.GetY();
+  const float* life = m_particles.GetLife();
+  const float* inv = m_particles.GetInvLife();
+
+  for (uint32_t e = 0; e < (uint32_t)m_particles.GetEmitterCount(); ++e) {
+    const SParticleEmitter& em = m_particles.GetEmitter(e);
+    const uint32_t first = m_particles.GetBase(e);
+    const uint32_t end = first + m_particles.GetCount(e);
+
+    LSpriteDesc2D d;
+    d.m_nSpriteIndex = em.nSprite;
+    d.m_f4Tint = DirectX::XMFLOAT4(em.fRed, em.fGreen, em.fBlue, 1.0f);
+
+    for (uint32_t i = first; i < end; ++i) {
+      if (!view.Contains(x[i], y[i])) continue;
+      const float t = life[i] * inv[i];  // 1 at birth, 0 at death
+      d.m_vPos = Vector2(x[i], y[i]);
+      d.m_fXScale = d.m_fYScale = em.fEndSize + (em.fSize - em.fEndSize) * t;
+      d.m_fAlpha = t;
+      m_vParticleSprites.push_back(d);
     }
 
-    // ---- Draw SKY first (furthest) ----
-    for (float x = startX; x < cam.x + winW / 2.0f + drawW; x += drawW) {
-      LSpriteDesc2D S;
-      S.m_nSpriteIndex = (UINT)eSprite::Sky;
-      S.m_vPos = Vector2(x + (drawW / 2.0f) + -210.0f, cam.y + bgYOffset); // vertical center
-      S.m_fXScale = sc;
-      S.m_fYScale = sc + 1.0f;
-      m_pRenderer->Draw(&S);
+    m_vParticleRuns.push_back(m_vParticleSprites.size());
+  }
+}  // UpdateParticles
+
+/// Draw each background layer as one batch of copies of its image. The
+/// copies across the cull rectangle are worked out from the camera, so none
+/// are built off screen, and they go into the packet in one call.
+/// \param pPacket Frame packet
+
+void CGame::DrawParallax(CFramePacket* pPacket) {
+  const float halfView = m_cullRect.GetWidth() / 2;
+  LSpriteDesc2D desc;
+
+  for (const SParallaxLayer& layer : m_vParallax) {
+    const SParallaxSpan span =
+        GetParallaxSpan(layer, m_cullRect.GetCenterX(), halfView);
+
+    desc.m_nSpriteIndex = layer.nSprite;
+    desc.m_vPos.y = GetParallaxY(layer, m_vCameraPos.y);
+    desc.m_fXScale = layer.fXScale;
+    desc.m_fYScale = layer.fYScale;
+
+    m_vParallaxSprites.clear();
+    for (int k = span.nFirst; k < span.nFirst + span.nCount; ++k) {
+      desc.m_vPos.x = span.GetX(k);
+      m_vParallaxSprites.push_back(desc);
     }
 
+    pPacket->SetLayer((eSpriteLayer)layer.nLayer);
+    pPacket->Draw(m_vParallaxSprites.data(), m_vParallaxSprites.size());
   }
+}  // DrawParallax
+
+/// Record the game objects into a frame packet and hand it to the render
+/// pipeline. Everything the renderer needs is copied into the packet here, so
+/// this is the last point in the frame that reads live game state.
+
+void CGame::RenderFrame() {
+  CFramePacket* pPacket = m_pRenderThread->BeginPacket();
+  pPacket->SetCameraPos(m_vCameraPos);
+
+  if (m_eNetMode == eNetMode::Server && m_bHeadless) {  // the overlay only
+    DrawFrameRateText(pPacket);
+    m_pRenderThread->EndPacket();
+    MarkFirstFrame();
+    return;
+  }
+
+  DrawParallax(pPacket);
 
- 
   //GroundDrawing
-  m_pTileManager->Draw();
-
-  //Player Draw
-  if (m_pPlayer) m_pPlayer->Draw();
-
-  for (CBullet* b : m_bullets) b->Draw(m_pRenderer);
-
-  //Inv Draw
-  if (m_pInventory) {
-    m_pInventory->DrawWorldItems();
-  }
-  bool DebugDraw = false;
-  //Debug Draw
-if (DebugDraw) {
-  
-  for (b2Body* body : m_debugBodies) {
-    for (b2Fixture* f = body->GetFixtureList(); f; f = f->GetNext()) {
-      b2AABB aabb = f->GetAABB(0);
-
-      // Convert AABB corners from meters → pixels
-      float left = aabb.lowerBound.x * scale;
-      float right = aabb.upperBound.x * scale;
-      float bottom = aabb.lowerBound.y * scale;
-      float top = aabb.upperBound.y * scale;
-
-      // Center + half extents for drawing
-      Vector2 center((left + right) * 0.5f, (top + bottom) * 0.5f);
-      float halfW = (right - left) * 0.5f;
-      float halfH = (top - bottom) * 0.5f;
-
-      // Draw box
-      LSpriteDesc2D d;
-      d.m_nSpriteIndex = (UINT)eSprite::DebugSquare;
-      d.m_vPos = center;
-      d.m_fXScale = halfW / 8.0f;  // adjust if your debug sprite is 16×16 or 32×32
-      d.m_fYScale = halfH / 8.0f;
-      m_pRenderer->Draw(&d);
+  m_pTileManager->Draw(pPacket);
+
+  if (m_eNetMode == eNetMode::Client) {  // what the server sent
+    for (const auto& s : m_vNetSprites) {
+      pPacket->SetLayer(s.first);
+      pPacket->Draw(&s.second);
     }
   }
-}
 
+  else {
+    //Player Draw
+    for (size_t i = 0; i < m_vPlayers.size(); ++i)
+      if (i < m_animator.GetCount())
+        m_vPlayers[i]->Draw(pPacket, m_animator.GetFrame(i));
+
+    pPacket->SetLayer(eSpriteLayer::Projectiles);
+    for (const LSpriteDesc2D& d : m_vBulletSprites) pPacket->Draw(&d);
+
+    pPacket->SetLayer(eSpriteLayer::Particles);  // one run per emitter
+    for (size_t e = 0, first = 0; e < m_vParticleRuns.size(); ++e) {
+      const size_t end = m_vParticleRuns[e];
+      pPacket->Draw(m_vParticleSprites.data() + first, end - first);
+      first = end;
+    }
+
+    //Inv Draw
+    m_drops.DrawWorldItems(pPacket);
+    pPacket->SetLayer(eSpriteLayer::Actors);
+    for (const LSpriteDesc2D& d : m_vCrowdSprites) pPacket->Draw(&d);
+  }
+
+  if (m_debugDraw.IsEnabled() || m_bDrawPath) {  // all in one batch
+    const SViewRect view = m_vCameras[0].GetView();  // lines need no padding
+    m_debugDraw.Begin(Vector2(view.GetCenterX(), view.GetCenterY()),
+                      Vector2(view.GetWidth() / 2, view.GetHeight() / 2));
+
+    if (m_debugDraw.IsEnabled() && m_eNetMode != eNetMode::Client) {
+      m_debugDraw.DrawWorld(mWorld);
+      for (const CPlayer* p : m_vPlayers) p->DebugDraw(&m_debugDraw);
+    }
+
+    if (m_bDrawPath)  // path from the spawn point to the player
+      for (size_t i = 1; i < m_vDebugPath.size(); ++i)
+        m_debugDraw.AddLine(m_vDebugPath[i - 1], m_vDebugPath[i],
+                            b2Color(0.3f, 0.9f, 0.3f));
+
+    pPacket->SetLayer(eSpriteLayer::Debug);
+    m_debugDraw.Flush(pPacket, (UINT)eSprite::DebugGreen, m_vDebugLineSize.x,
+                      m_vDebugLineSize.y);
+  }
 
   // Draw UI elements in screen space (not affected by camera)
+  // The packet puts the camera at the window center for these, which makes
+  // screen coordinates work as expected: (0,0) to (width,height)
   {
-    // Save current camera position
-    Vector3 savedCameraPos = m_pRenderer->GetCameraPos();
-
-    // Set camera to window center for UI rendering
-    // This makes screen coordinates work as expected: (0,0) to (width,height)
-    m_pRenderer->SetCameraPos(
-        Vector3(m_nWinWidth / 2.0f, m_nWinHeight / 2.0f, 0.0f));
+    pPacket->SetSpace(eRenderSpace::Screen);
 
     // Always draw hotbar at bottom of screen
     if (m_pInventory) {
-      m_pInventory->DrawHotbarOnly();
+      m_pInventory->DrawHotbarOnly(pPacket);
     }
 
     // Draw full inventory when open
     if (m_pInventory && m_pInventory->IsOpen()) {
-      m_pInventory->Draw();
+      m_pInventory->Draw(pPacket);
     }
 
-    // Restore camera position
-    m_pRenderer->SetCameraPos(savedCameraPos);
+    pPacket->SetSpace(eRenderSpace::World);
   }
 
-  if (m_bDrawFrameRate) DrawFrameRateText();
+  if (m_bDrawFrameRate) DrawFrameRateText(pPacket);
 
-  m_pRenderer->EndFrame();  // required after rendering
+  m_pRenderThread->EndPacket();  // render now or on the render thread
+  MarkFirstFrame();
 }  // RenderFrame
 
-void CGame::FollowCamera() {
-  if (m_pPlayer == nullptr) return;
+/// Hand the loader the time the first frame reached the screen, once the
+/// renderer has presented it, which on the render thread may be a frame
+/// after the packet was sealed.
+
+void CGame::MarkFirstFrame() {
+  CAssetLoader::Clock::time_point t;
+  if (m_pRenderThread->GetFirstPresentTime(t)) m_pLoader->MarkFirstFrame(t);
+}
+
+/// Move each player's camera after them. The local player's is the one
+/// drawn here, and its cull rectangle is the one every draw path culls
+/// against this frame.
+/// \param dt Frame time in seconds
+
+void CGame::FollowCamera(float dt) {
+  if (m_vPlayers.empty()) return;
+
+  for (size_t i = 0; i < m_vPlayers.size(); ++i) {
+    const Vector2& pos = m_vPlayers[i]->GetPos();
+    m_vCameras[i].Follow(pos.x, pos.y, dt);
+  }
+
+  const CCamera& camera = m_vCameras[0];
+  m_vCameraPos = Vector3(camera.GetX(), camera.GetY(), 0.0f);  // to renderer
+  m_cullRect = camera.GetCullRect();
+}  // FollowCamera
 
-  Vector3 vCameraPos(m_pPlayer->GetPos());
+/// Build and run this frame's task graph. The physics step runs alongside
+/// the bullet lifetimes, the world drops and tile culling, none of which touch
+/// Box2D. Sprite lists that read body positions wait for the step. Anything
+/// that creates or destroys bodies, or talks to the renderer, stays on the
+/// main thread outside the graph. Every sprite list is culled against the
+/// local camera's cull rectangle.
+/// \param dt Frame time in seconds
 
-     
-  const float verticalOffset = 200.0f;  
-  vCameraPos.y += verticalOffset;
-  
-  m_pRenderer->SetCameraPos(vCameraPos); 
-}  
+void CGame::RunFrameGraph(float dt) {
+  const SViewRect view = m_cullRect;
+
+  m_frameGraph.Clear();
+
+  const JobHandle step = m_frameGraph.Add([&]() {
+    m_listener->ClearImpacts();  // not those of frames run again
+    mWorld->Step(dt, 8, 3);
+  });
+
+  const JobHandle bullets = m_frameGraph.Add([&]() { AgeBullets(dt); });
+
+  const JobHandle drops = m_frameGraph.Add([&]() {  // pickups by any player
+    m_drops.Update(dt);
+    m_drops.Collect(m_vPlayers.data(), m_vInventories.data(),
+                    m_vPlayers.size());
+  });
+
+  m_frameGraph.Add([&]() { m_pTileManager->Cull(view); });
+
+  m_frameGraph.Add([&]() {
+    m_vBulletSprites.clear();
+    LSpriteDesc2D d;
+    for (size_t i = 0; i < m_bullets.size(); ++i) {
+      if (m_vBulletDead[i]) continue;
+      m_bullets[i]->GetSpriteDesc(d);
+      if (view.Contains(d.m_vPos.x, d.m_vPos.y)) m_vBulletSprites.push_back(d);
+    }
+  }, {step, bullets});
+
+  const JobHandle crowd = m_frameGraph.Add([&]() { m_crowd.Update(dt); });
+
+  m_frameGraph.Add([&]() { m_drops.PrepareWorldItems(view); }, {drops});
+
+  m_frameGraph.Add([&]() { AnimatePlayers(dt); }, {step});  // contacts
+
+  m_frameGraph.Add([&]() {  // hits and pickups
+    UpdateParticles(dt, view);
+  }, {step, drops});
+
+  m_frameGraph.Add([&]() {  // agents on screen only
+    const float tileSize = m_pTileManager->GetTileSize();
+    const float h = (float)m_pTileManager->GetMapHeight();
+    size_t begin, end;
+    m_crowd.GetRange(eCrowdLOD::Near, begin, end);
+    m_vCrowdSprites.clear();
+    LSpriteDesc2D d;
+    d.m_nSpriteIndex = (UINT)eSprite::Pig;
+    for (size_t i = begin; i < end; ++i) {
+      d.m_vPos = Vector2(m_crowd.GetX(i) * tileSize,
+                         (h - m_crowd.GetY(i) + m_crowd.GetHeight() / 2) *
+                             tileSize);
+      m_vCrowdSprites.push_back(d);
+    }
+  }, {crowd});
+
+  m_frameGraph.Run(m_pJobs);
+}  // RunFrameGraph
 
 void CGame::ProcessFrame() {
+  auto items = [&]() {  // slots and drops, which menus change between frames
+    return m_pInventory->HashSlots(m_drops.Hash(g_nHashSeed));
+  };
+  const uint64_t nItems = m_bRollback ? items() : 0;
+
   KeyboardHandler();       // handle keyboard input
+  if (m_bRollback && items() != nItems) m_rollback.Barrier();
   m_pAudio->BeginFrame();  // notify audio player that frame has begun
 
   float dt = m_pTimer->GetFrameTime();
+  if (m_bHashWorld && m_fHashStep > 0.0f) dt = m_fHashStep;  // repeatable
+  if (m_bRollback) dt = m_fRollbackStep;  // frames run again must match
 
-  for (auto it = m_bullets.begin(); it != m_bullets.end();) {
-    (*it)->Update(dt);
+  m_pPaths->Collect(m_pJobs);  // paths asked for last frame
+  if (m_nPathTicket >= 0) {
+    const float tileSize = m_pTileManager->GetTileSize();
+    const int mapHeight = m_pTileManager->GetMapHeight();
+    m_vDebugPath.clear();
 
-    if ((*it)->IsDead()) {
-      mWorld->DestroyBody((*it)->GetBody());
-      delete *it;
-      it = m_bullets.erase(it);
-    } else {
-      ++it;
-    }
+    for (const SNavStep& step : m_pPaths->GetResult(m_nPathTicket).vSteps)
+      m_vDebugPath.push_back(Vector2(
+          (m_navGraph.GetNodeX(step.nNode) + 0.5f) * tileSize,
+          (mapHeight - m_navGraph.GetNodeY(step.nNode) - 0.5f) * tileSize));
+
+    m_nPathTicket = -1;
   }
-  if (m_pPlayer->WantsToShoot()) {
-    SpawnBulletFromPlayer();
-    m_pPlayer->ClearShootRequest();
+
+  CheckHotReload();  // map and settings edits take effect here
+
+  if (m_eNetMode == eNetMode::Client) {  // the server runs the game
+    ClientFrame();
+    m_audio.Update(m_vCameraPos.x, m_vCameraPos.y, m_pTimer->GetFrameTime());
+    RenderFrame();
+    return;
   }
 
-  if (m_pInventory) {
-    m_pInventory->Update(dt);
+  FlushTileEdits();  // so do tiles destroyed since the last frame
+  if (m_bNavDirty) BuildNavGraph();
+  if (m_crowd.GetCount() != m_nCrowdSize) SpawnCrowd();
+
+  CompactBullets();
+
+  SPlayerInput input;  // the player is left alone while the inventory is open
+  if (m_pInventory->IsOpen()) input.Set(eInput::Menu);
+  else input = CPlayer::ReadInput(m_pKeyboard);
+  ReadInputs(input);
+  if (m_bRollback && !Rollback()) {  // too far ahead of the peer's input
+    m_audio.Update(m_vCameraPos.x, m_vCameraPos.y, m_pTimer->GetFrameTime());
+    RenderFrame();
+    return;
+  }
+  StepPlayers(dt, m_vInputs.data());
+
+  if (!m_pLoader->IsDone()) {  // stream in assets while the renderer is free
+    m_pRenderThread->WaitIdle();
+    m_pLoader->Update();
   }
 
-  if (!m_pInventory->IsOpen())
-    m_pPlayer->Update(dt, m_pKeyboard, m_pTileManager);
+  if (m_bDrawPath)  // searched on the workers while the frame runs
+    m_nPathTicket = m_pPaths->Request(FindNavNode(m_pPlayer->GetSpawn()),
+                                      FindNavNode(m_pPlayer->GetPos()));
+  SteerCrowd();
+  m_pPaths->Dispatch(m_pJobs);
 
   m_pTimer->Tick([&]() {  // all time-dependent function calls should go here
-    const float t = m_pTimer->GetFrameTime();
-    mWorld->Step(dt, 8, 3);
-    FollowCamera();
-   
+    FollowCamera(dt);
+    RunFrameGraph(dt);
+    PlaySounds();
+    if (m_bHashWorld) HashWorld();
   });
+  if (m_bRollback) m_rollback.EndFrame();
+  if (m_eNetMode == eNetMode::Server) Replicate();
+  m_audio.Update(m_vCameraPos.x, m_vCameraPos.y,
+                 m_pTimer->GetFrameTime());  // wall clock, not dt
 
 
   RenderFrame();
-}
-
-
+}
\ No newline at end of file
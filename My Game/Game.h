@@ -11,6 +11,27 @@
 #include "TileManager.h"
 #include "InventoryManager.h"
 #include "Bullet.h"
+#include "Animation.h"
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "AudioMixer.h"
+#include "Camera.h"
+#include "CollisionLayers.h"
+#include "Crowd.h"
+#include "DebugDraw.h"
+#include "DropManager.h"
+#include "FileWatcher.h"
+#include "JobSystem.h"
+#include "Parallax.h"
+#include "Particles.h"
+#include "PathService.h"
+#include "RenderThread.h"
+#include "Replication.h"
+#include "Rollback.h"
+#include "SaveGame.h"
+#include "Snapshot.h"
+#include "TextureAtlas.h"
+#include "WorldHash.h"
 #include "box2d/box2d.h"
 
 
@@ -28,12 +49,42 @@ class CPlayer;
 class CTileManager;
 class ContactListener;
 
+const size_t g_nMaxPlayers = 1024; ///< Most players, and net ids kept for them.
+
+/// \brief Where a player's input comes from.
+enum class ePlayerInput {
+  Keyboard, ///< This machine's keyboard.
+  Net,      ///< A client, as a server.
+  Script    ///< Made up from the frame number, when nobody plays them.
+};
+
+/// \brief The game's part in a network game.
+enum class eNetMode {
+  Off,    ///< No network.
+  Server, ///< Simulate, and replicate to clients.
+  Client  ///< Send input, and draw what the server replicates.
+};
+
+/// \brief Where a bullet hit something.
+struct SImpact {
+  b2Vec2 vPos;    ///< Contact point in meters.
+  b2Vec2 vNormal; ///< Unit normal, pointing away from what was hit.
+};
+
 class ContactListener : public b2ContactListener {
  private:
-  
+  std::vector<SImpact> m_vImpacts; ///< Bullet hits since ClearImpacts().
+
+  static void CountContact(b2Fixture *sensor, b2Fixture *other, int n);
+  void AddImpact(b2Contact *contact); ///< Record a bullet hit.
+
  public:
   void BeginContact(b2Contact *contact) override;
   void EndContact(b2Contact *contact) override;
+
+  void ClearImpacts() { m_vImpacts.clear(); } ///< Forget the hits so far.
+  /// \brief Get the bullet hits since ClearImpacts().
+  const std::vector<SImpact> &GetImpacts() const { return m_vImpacts; }
 };
 
 class CGame : public LComponent, public LSettings {
@@ -43,31 +94,170 @@ private:
   LSpriteDesc2D *m_pSpriteDesc = nullptr; ///< Sprite descriptor.
   LSpriteRenderer *m_pRenderer = nullptr; ///< Pointer to renderer.
   CTileManager *m_pTileManager = nullptr;
-  CPlayer *m_pPlayer = nullptr;
-  b2World *mWorld;  // Box2D physics world
+  CPlayer *m_pPlayer = nullptr; ///< Local player, the first in m_vPlayers.
+  b2World *mWorld = nullptr;  // Box2D physics world
   ContactListener *m_listener = nullptr;
   std::vector<b2Body *> m_debugBodies;
+  CDebugDraw m_debugDraw;        ///< Physics outlines, F11 toggles.
+  CCollisionMatrix m_collision;  ///< Which collision layers meet.
+  Vector2 m_vDebugLineSize;      ///< Size of the sprite lines are drawn with.
   std::vector<CBullet *> m_bullets;
+  std::vector<LSpriteDesc2D> m_vBulletSprites; ///< Built by the frame graph.
+  std::vector<float> m_vBulletLife;   ///< Seconds left, one per bullet.
+  std::vector<uint8_t> m_vBulletDead; ///< 1 per expired bullet, per frame.
+
+  CJobSystem *m_pJobs = nullptr; ///< Worker pool.
+  CAssetLoader *m_pLoader = nullptr; ///< Startup asset pipeline.
+  CAssetPack m_pack;             ///< Cooked assets, if there are any.
+  CTaskGraph m_frameGraph;       ///< Jobs for the current frame.
+
+  CRenderThread *m_pRenderThread = nullptr; ///< Render pipeline.
+  Vector3 m_vCameraPos;          ///< Camera position for this frame.
+  SViewRect m_cullRect;          ///< Local camera's cull rectangle.
+  CTextureAtlas m_atlas;         ///< Sprite to atlas page mapping.
+  std::vector<SParallaxLayer> m_vParallax; ///< Background layers, far first.
+  std::vector<LSpriteDesc2D> m_vParallaxSprites; ///< One layer's copies.
+
+  /// \brief The static body holding one chunk's tile fixtures.
+  struct SChunkBody {
+    b2Body *pBody = nullptr;            ///< Static body, at the origin.
+    std::vector<TileEdge> vEdges;       ///< Edges it was built from.
+    std::vector<b2Fixture *> vFixtures; ///< One fixture per edge.
+  };
+
+  std::vector<SChunkBody> m_vChunkBodies; ///< Tile bodies by chunk.
+  CFileWatcher m_watcher;        ///< Watches the map and settings.
+  size_t m_nReloadChunks = 0;    ///< Chunks rebuilt by the last reload.
+  float m_fReloadTime = 0.0f;    ///< Time taken by the last reload in ms.
+  size_t m_nTileEdits = 0;       ///< Tiles changed since the last flush.
+  size_t m_nLastEdits = 0;       ///< Tiles changed in the last flushed frame.
+  float m_fEditTime = 0.0f;      ///< Time taken by the last flush in ms.
 
+  CNavGraph m_navGraph;          ///< Navigation graph of the tile map.
+  CPathService *m_pPaths = nullptr; ///< Path finder for AI.
+  bool m_bNavDirty = true;       ///< Tiles changed since the graph was built.
+  int m_nPathTicket = -1;        ///< Debug path request in flight.
+  bool m_bDrawPath = false;      ///< Draw the debug path.
+  std::vector<Vector2> m_vDebugPath; ///< Spawn to player, in pixels.
+  std::string m_strTiles;        ///< Tile map the graph and crowd were given.
 
+  CCrowd m_crowd;                ///< Enemy crowd.
+  size_t m_nCrowdSize = 0;       ///< Agents wanted, from gamesettings.xml.
+  std::vector<std::pair<uint32_t, int>> m_vCrowdTickets; ///< Agent, ticket.
+  std::vector<LSpriteDesc2D> m_vCrowdSprites; ///< Built by the frame graph.
+  bool m_bGridController = false; ///< Move the player without Box2D.
+  CSaveWriter m_saveWriter;      ///< Writes saves in the background.
+  float m_fSnapshotTime = 0.0f;  ///< Main thread time of the last save, ms.
+  float m_fLoadTime = 0.0f;      ///< Time taken by the last load in ms.
+  CWorldHash m_worldHash;        ///< Per-frame simulation checksum.
+  bool m_bHashWorld = false;     ///< Compute m_worldHash every frame.
+  float m_fHashStep = 0.0f;      ///< Fixed frame time while hashing, or 0.
+  std::string m_strHashLog;      ///< File for the hashes on exit, if any.
+  float m_fHashTime = 0.0f;      ///< Time taken by the last hash in ms.
+  CRollback m_rollback;          ///< Runs frames again after late inputs.
+  CLoopbackPeer m_peer;          ///< Sends the player's input back late.
+  std::vector<SGameSnapshot> m_vSnapshots; ///< Ring by frame, reused.
+  std::vector<SInputPacket> m_vPackets; ///< Packets received this frame.
+  bool m_bRollback = false;      ///< Play through m_peer with rollback.
+  float m_fRollbackStep = 1.0f / 60.0f; ///< Fixed frame time with rollback.
+  bool m_bRollbackHeld = false;  ///< Last frame waited on m_peer.
+  uint32_t m_nRollbackHeld = 0;  ///< Frames held since the restart.
+  eNetMode m_eNetMode = eNetMode::Off; ///< Network role.
+  bool m_bHeadless = false;      ///< Server draws only the overlay.
+  CNetServer m_netServer;        ///< Replicates to clients, as a server.
+  CNetClient m_netClient;        ///< Replicated to, as a client.
+  CNetIdMap m_netIds{g_nMaxPlayers + 1}; ///< Bullets and drops, after players.
+  std::vector<SNetEntity> m_vNetWorld; ///< Every entity, as replicated.
+  std::vector<std::pair<eSpriteLayer, LSpriteDesc2D>>
+      m_vNetSprites;             ///< Client's entity sprites, by layer.
+  std::string m_strNetConfig;    ///< Role and address the sockets are for.
+  uint32_t m_nNetTick = 0;       ///< Server ticks so far.
+  uint32_t m_nNetSend = 3;       ///< Ticks per snapshot.
+  int m_nNetRadius = 1;          ///< Chunks around a player to replicate.
+  uint32_t m_nNetFrame = 0;      ///< Client inputs sent.
+  float m_fNetTime = 0.0f;       ///< Time of the last replication in ms.
+  float m_fPeerDelay = 100.0f;   ///< Loopback peer delay in ms.
+  float m_fPeerJitter = 30.0f;   ///< Loopback peer jitter in ms.
 
-  void FollowCamera();       ///< Make camera follow player character.
+  std::vector<CPlayer *> m_vPlayers; ///< Players, the local one first.
+  std::vector<CInventoryManager *> m_vInventories; ///< One per player.
+  std::vector<CCamera> m_vCameras;   ///< Camera per player.
+  SCameraSettings m_cameraSettings;  ///< How cameras follow, from XML.
+  std::vector<ePlayerInput> m_vInputSources; ///< Input source per player.
+  std::vector<int> m_vInputSlots;    ///< Client slot per Net player, or -1.
+  std::vector<SPlayerInput> m_vInputs; ///< This frame's input per player.
+  size_t m_nPlayerCount = 1;     ///< Players wanted, from gamesettings.xml.
+  uint32_t m_nFrame = 0;         ///< Frames simulated, for scripted input.
+  CDropManager m_drops;          ///< World drops, shared by the players.
+  CAnimClips m_clips;            ///< Animation clips, from gamesettings.xml.
+  CAnimator m_animator;          ///< Animation state, one per player.
+  uint32_t m_pPlayerClips[(UINT)ePlayerAnim::Size] = {}; ///< Clip indices.
+  CParticles m_particles;        ///< Particle pool, emitters from XML.
+  int m_nImpactEmitter = -1;     ///< Emitter for bullet hits, or -1.
+  int m_nPickupEmitter = -1;     ///< Emitter for items picked up, or -1.
+  std::vector<LSpriteDesc2D> m_vParticleSprites; ///< Built by the frame graph.
+  std::vector<size_t> m_vParticleRuns; ///< End of each emitter's sprites.
+  CAudioMixer m_audio;           ///< Voices, mixed by the game.
+  CAudioDevice* m_pAudioDevice = nullptr; ///< Where the mix goes.
+  int m_pSoundIds[(UINT)eSound::Size] = {}; ///< Mixer sound, or -1.
 
-	CInventoryManager* m_pInventory = nullptr; ///< Pointer to inventory manager.
+
+
+  void FollowCamera(float dt); ///< Make cameras follow player characters.
+
+	CInventoryManager* m_pInventory = nullptr; ///< Local player's inventory.
 
     void LoadImages(); ///< Load images.
     void LoadSounds(); ///< Load sounds.
+    void PlaySounds(); ///< Ask the mixer for this frame's sounds.
     void BeginGame(); ///< Begin playing the game.
     void CreateObjects(){}///< Create game objects.
     void KeyboardHandler(); ///< The keyboard handler.
     void RenderFrame(); ///< Render an animation frame.
-    void DrawFrameRateText(); ///< Draw frame rate text to screen.
+    void MarkFirstFrame(); ///< Tell the loader the first frame is up.
+    void RunFrameGraph(float dt); ///< Run simulation and render prep jobs.
+    void DrawFrameRateText(CFramePacket *pPacket); ///< Draw frame rate text.
+    void DrawParallax(CFramePacket *pPacket); ///< Draw the background layers.
+    void LoadClips(tinyxml2::XMLElement *pSettings); ///< Compile the clips.
+    void AnimatePlayers(float dt); ///< Pick and advance players' clips.
+    void LoadParticles(tinyxml2::XMLElement *pSettings); ///< Emitters.
+    void UpdateParticles(float dt, const SViewRect &view); ///< Emit, cull.
+    void BuildChunkBodies(int chunk); ///< Patch one chunk's tile fixtures.
+    void FlushTileEdits(); ///< Rebuild the chunks edited this frame.
+    void Explode(const Vector2 &pos, float radius); ///< Carve out tiles.
+    void BuildNavGraph(); ///< Rebuild the navigation graph from the tiles.
+    int FindNavNode(const Vector2 &pos) const; ///< Node under a point.
+    void SpawnCrowd(); ///< Scatter the crowd over the navigation graph.
+    void SteerCrowd(); ///< Set crowd goals and ask for their paths.
+    void RebuildTileBodies(); ///< Recreate every tile body.
+    void CheckHotReload(); ///< Reload files that changed on disk.
+    void ApplySettings(tinyxml2::XMLElement *pSettings); ///< Live settings.
+    bool SaveGame(); ///< Snapshot the game and write it in the background.
+    bool LoadGame(); ///< Replace the game with the last save.
+    void HashWorld(); ///< Add this frame to m_worldHash.
+    void CompactBullets(); ///< Destroy the bullets that expired.
+    void AgeBullets(float dt); ///< Count down bullet lifetimes.
+    void StepPlayers(float dt, const SPlayerInput *inputs); ///< Shoot, move.
+    void SimulateFrame(float dt, const SPlayerInput *inputs); ///< Rollback.
+    void SaveSnapshot(uint32_t frame); ///< Save the state before a frame.
+    void LoadSnapshot(uint32_t frame); ///< Load the state before a frame.
+    void RestartRollback(uint32_t depth); ///< Start again from frame 0.
+    bool Rollback(); ///< Inputs through m_peer and the rollback driver.
+    void AddPlayer(ePlayerInput source); ///< Add a player at a spawn point.
+    void SetPlayerCount(); ///< Add or remove scripted players.
+    void ReadInputs(const SPlayerInput &keyboard); ///< Fill m_vInputs.
+    void StartNet(tinyxml2::XMLElement *pNet); ///< Open or close sockets.
+    void ServeInput(); ///< Give clients players and take their input.
+    void Replicate(); ///< Send this frame to the clients.
+    void ClientFrame(); ///< Send input and draw what the server sent.
  public:
-    std::vector<b2Body *> m_PhysicsTiles;
   void RegisterDebugBody(b2Body *b);
 
+  /// \brief Get which collision layers meet, for making fixtures.
+  const CCollisionMatrix &GetCollision() const { return m_collision; }
+
   ~CGame(); ///< Destructor.
-  void SpawnBulletFromPlayer();
+  void SpawnBulletFromPlayer(const CPlayer *player);
   void Initialize();   ///< Initialize the game.
   void ProcessFrame(); ///< Process an animation frame.
   void Release();      ///< Release the renderer.
@@ -5,51 +5,21 @@
 #define __L4RC_GAME_GAMEDEFINES_H__
 
 #include "Defines.h"
+#include "GameTables.h"  // eSprite and eSound, from gamesettings.xml
 #include "Sound.h"
 
-/// \brief Sprite enumerated type.
+/// \brief Player animation enumerated type.
 ///
-/// An enumerated type for the sprites, which will be cast to an unsigned
-/// integer and used for the index of the corresponding texture in graphics
-/// memory. `Size` must be last.
-
-enum class eSprite: UINT{
-  Background, TextWheel, Pig, Dirt, Sky, Chapel, 
-
-  // add inventory sprites
-  InventorySlot, // empty slot
-  InventorySlotSelected, // hovered inventory slot
-  InventoryPanel, // inventory background panel
-
-  // test item sprites
-  ItemPotion,	// health pot
-  ItemKey,		// key
-  ItemCoin,		// coin
-  ItemSword,	//sword
-  ItemShield,	//shield
-  ItemApple,	//apple
-  Step,
-  Jab,
-  DebugRed,
-  DebugSquare,
-  DebugGreen,
-  Bullet,
-  
-  Size  //MUST BE LAST
-}; //eSprite
-
-
-/// \brief Sound enumerated type.
-///
-/// An enumerated type for the sounds, which will be cast to an unsigned
-/// integer and used for the index of the corresponding sample. `Size` must
-/// be last.
-
-enum class eSound : UINT {
-  Clang,
-  Grunt,
-  Oink,
+/// The clips a player plays, named `player_idle`, `player_walk`,
+/// `player_jump` and `player_attack` in gamesettings.xml. `Size` must be
+/// last.
+
+enum class ePlayerAnim : UINT {
+  Idle,
+  Walk,
+  Jump,
+  Attack,
   Size  // MUST BE LAST
-};  // eSound
+};  // ePlayerAnim
 
 #endif  //__L4RC_GAME_GAMEDEFINES_H__
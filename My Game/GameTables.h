@@ -0,0 +1,191 @@
+/// \file GameTables.h
+/// \brief Sprite and sound tables, generated from gamesettings.xml.
+///
+/// Written by TableGen before every build of the game. Do not edit it, edit
+/// the sprite and sound lists in gamesettings.xml instead.
+
+#ifndef __L4RC_GAME_GAMETABLES_H__
+#define __L4RC_GAME_GAMETABLES_H__
+
+#include <cstddef>
+
+#include "Defines.h"
+
+/// \brief Sprite enumerated type.
+///
+/// An enumerated type for the sprites, which will be cast to an unsigned
+/// integer and used for the index of the corresponding texture in graphics
+/// memory. `Size` must be last.
+
+enum class eSprite : UINT {
+  Background,  ///< background
+  TextWheel,  ///< textwheel
+  Pig,  ///< pig
+  Dirt,  ///< dirt
+  Sky,  ///< sky
+  Chapel,  ///< chapel
+  InventorySlot,  ///< inventory_slot
+  InventorySlotSelected,  ///< inventory_slot_selected
+  InventoryPanel,  ///< inventory_panel
+  ItemPotion,  ///< item_potion
+  ItemKey,  ///< item_key
+  ItemCoin,  ///< item_coin
+  ItemSword,  ///< item_sword
+  ItemShield,  ///< item_shield
+  ItemApple,  ///< item_apple
+  Step,  ///< step
+  Jab,  ///< jab
+  DebugRed,  ///< debugBox
+  DebugSquare,  ///< debugSquareWOutline
+  DebugGreen,  ///< contactSquare
+  Bullet,  ///< bullet
+  Size  // MUST BE LAST
+};  // eSprite
+
+/// \brief Sound enumerated type.
+///
+/// An enumerated type for the sounds, which will be cast to an unsigned
+/// integer and used for the index of the corresponding sample. `Size` must
+/// be last.
+
+enum class eSound : UINT {
+  Clang,  ///< clang
+  Grunt,  ///< grunt
+  Oink,  ///< oink
+  Size  // MUST BE LAST
+};  // eSound
+
+/// \brief A sprite tag in gamesettings.xml and what is known about its image.
+struct SSpriteInfo {
+  eSprite eIndex;      ///< Sprite index.
+  const char* szName;  ///< Tag name in gamesettings.xml.
+  const char* szFile;  ///< Image file.
+  bool bFirstFrame;    ///< Loaded before the first frame.
+  UINT nWidth;         ///< Width in pixels, 0 if unknown.
+  UINT nHeight;        ///< Height in pixels, 0 if unknown.
+  int nPage;           ///< Atlas page, or -1 if standalone.
+  float fU0;           ///< Left texture coordinate on the page.
+  float fV0;           ///< Top texture coordinate on the page.
+  float fU1;           ///< Right texture coordinate on the page.
+  float fV1;           ///< Bottom texture coordinate on the page.
+};
+
+/// \brief A sound tag in gamesettings.xml.
+struct SSoundInfo {
+  eSound eIndex;       ///< Sound index.
+  const char* szName;  ///< Tag name in gamesettings.xml.
+  const char* szFile;  ///< Sound file.
+  float fVolume;       ///< Volume, 0 to 1.
+  float fPriority;     ///< Rank against other sounds.
+  float fRadius;       ///< Fades out over this many pixels.
+  UINT nInstances;     ///< Most voices of it at once.
+  bool bLoop;          ///< Repeats.
+  bool bStream;        ///< Read from disk while it plays.
+};
+
+/// Every sprite, in `eSprite` order.
+static constexpr SSpriteInfo g_pSpriteTable[] = {
+    {eSprite::Background, "background",
+     "Media\\Images\\background.png",
+     false, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::TextWheel, "textwheel",
+     "Media\\Images\\textwheel.png",
+     false, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::Pig, "pig",
+     "Media\\Images\\pig.png",
+     false, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::Dirt, "dirt",
+     "Media\\Images\\Dirt32.png",
+     true, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::Sky, "sky",
+     "Media\\Images\\Background_1.png",
+     false, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::Chapel, "chapel",
+     "Media\\Images\\Background_0.png",
+     false, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::InventorySlot, "inventory_slot",
+     "Media\\Images\\inventory_slot.png",
+     true, 64, 64, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::InventorySlotSelected, "inventory_slot_selected",
+     "Media\\Images\\inventory_slot_selected.png",
+     true, 64, 64, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::InventoryPanel, "inventory_panel",
+     "Media\\Images\\inventory_panel.png",
+     false, 64, 64, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::ItemPotion, "item_potion",
+     "Media\\Images\\item_potion.png",
+     true, 32, 48, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::ItemKey, "item_key",
+     "Media\\Images\\item_key.png",
+     true, 48, 32, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::ItemCoin, "item_coin",
+     "Media\\Images\\item_coin.png",
+     true, 64, 64, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::ItemSword, "item_sword",
+     "Media\\Images\\item_sword.png",
+     true, 64, 64, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::ItemShield, "item_shield",
+     "Media\\Images\\item_shield.png",
+     true, 32, 48, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::ItemApple, "item_apple",
+     "Media\\Images\\item_apple.png",
+     true, 32, 32, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::Step, "step",
+     "Media\\Images\\sprite-step.png",
+     true, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::Jab, "jab",
+     "Media\\Images\\sprite-jab.png",
+     true, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::DebugRed, "debugBox",
+     "Media\\Images\\DebugBox.png",
+     false, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::DebugSquare, "debugSquareWOutline",
+     "Media\\Images\\DebugSquareWOutline.png",
+     true, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::DebugGreen, "contactSquare",
+     "Media\\Images\\ContactSquare.png",
+     true, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+    {eSprite::Bullet, "bullet",
+     "Media\\Images\\Bullet.png",
+     false, 0, 0, -1, 0.0f, 0.0f, 0.0f, 0.0f},
+};
+
+/// Every sound, in `eSound` order.
+static constexpr SSoundInfo g_pSoundTable[] = {
+    {eSound::Clang, "clang",
+     "Media\\Sounds\\clang.wav",
+     0.6f, 1.0f, 1024.0f, 8, false, false},
+    {eSound::Grunt, "grunt",
+     "Media\\Sounds\\umph.wav",
+     1.0f, 2.0f, 1024.0f, 8, false, false},
+    {eSound::Oink, "oink",
+     "Media\\Sounds\\oink.wav",
+     0.8f, 1.5f, 1024.0f, 8, false, false},
+};
+
+static constexpr UINT g_nAtlasPages = 0;  ///< Atlas page count.
+static constexpr float g_fAtlasEfficiency = 0.0f;  ///< Packing.
+
+/// \brief Check that a table lists its enum in order, so that it can be
+/// indexed by it.
+/// \param table Table
+/// \return True if row `i` is for enum value `i`
+template <class T, size_t n>
+constexpr bool IsTableInOrder(const T (&table)[n]) {
+  for (size_t i = 0; i < n; ++i)
+    if ((size_t)table[i].eIndex != i) return false;
+  return true;
+}
+
+static_assert(sizeof(g_pSpriteTable) / sizeof(g_pSpriteTable[0]) ==
+                  (size_t)eSprite::Size,
+              "the sprite table has a row per sprite");
+static_assert(IsTableInOrder(g_pSpriteTable),
+              "the sprite table is in eSprite order");
+static_assert(sizeof(g_pSoundTable) / sizeof(g_pSoundTable[0]) ==
+                  (size_t)eSound::Size,
+              "the sound table has a row per sound");
+static_assert(IsTableInOrder(g_pSoundTable),
+              "the sound table is in eSound order");
+
+#endif  //__L4RC_GAME_GAMETABLES_H__
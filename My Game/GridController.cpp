@@ -0,0 +1,190 @@
+/// \file GridController.cpp
+/// \brief Code for the kinematic character controller CGridController.
+
+#include "GridController.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// Longest distance in tiles a box may move in one substep, so that it can
+/// never skip over a tile.
+static const float g_fMaxSubstep = 0.45f;
+
+/// Gap kept between a box and a tile it was pushed out of, and how far
+/// beyond its sides contacts are looked for.
+static const float g_fSkin = 1e-3f;
+
+/// Constructor.
+/// \param halfWidth Half the box's width in tiles
+/// \param height Box height in tiles
+
+CGridController::CGridController(float halfWidth, float height)
+    : m_fHalfWidth(halfWidth), m_fHeight(height) {}
+
+/// Set the tile map to collide with. The array is not copied.
+/// \param tiles One character per tile, row major
+/// \param w Width in tiles
+/// \param h Height in tiles
+
+void CGridController::SetMap(const char* tiles, int w, int h) {
+  m_pTiles = tiles;
+  m_nWidth = w;
+  m_nHeight = h;
+}
+
+/// Get a tile. The sides of the map are walls, and above and below it is
+/// open.
+/// \param x Column
+/// \param y Row, 0 at the top
+/// \return Tile
+
+char CGridController::Tile(int x, int y) const {
+  if (x < 0 || x >= m_nWidth) return '1';
+  if (y < 0 || y >= m_nHeight || m_pTiles == nullptr) return '0';
+  return m_pTiles[(size_t)y * m_nWidth + x];
+}
+
+/// Find the highest floor under the box with its top in a range of heights.
+/// Solid tiles and one-way platforms hold up the whole width of the box, and
+/// slopes hold up the middle of its feet. Where the middle is over a slope,
+/// the rest of that row is ignored, so that a solid tile at the top of the
+/// slope does not lift the box early. A one-way platform only counts if the
+/// feet were on or above it before the move.
+/// \param yMin Highest floor to accept
+/// \param yMax Lowest floor to accept
+/// \param yFeet Feet before the move
+/// \param drop Ignore one-way platforms
+/// \param ground [out] Floor height
+/// \return True if there is a floor in range
+
+bool CGridController::FindGround(float yMin, float yMax, float yFeet,
+                                 bool drop, float& ground) const {
+  const int left = (int)std::floor(m_fX - m_fHalfWidth + g_fSkin);
+  const int right = (int)std::floor(m_fX + m_fHalfWidth - g_fSkin);
+  const int mid = (int)std::floor(m_fX);
+  const float frac = m_fX - mid;
+
+  for (int r = (int)std::floor(yMin); r <= (int)std::floor(yMax); ++r) {
+    float best = r + 2.0f;  // below anything in this row
+    const char t = Tile(mid, r);
+
+    if (t == '3' || t == '4') {  // on a slope, it is the only floor
+      const float top = t == '3' ? r + 1.0f - frac : r + frac;
+      if (top >= yMin - g_fSkin && top <= yMax + g_fSkin) best = top;
+    }
+
+    else if (r >= yMin - g_fSkin && r <= yMax + g_fSkin) {
+      const bool platform = !drop && yFeet <= r + g_fSkin;
+      for (int c = left; c <= right; ++c) {
+        const char u = Tile(c, r);
+        if (u == '1' || (u == '2' && platform)) best = (float)r;
+      }
+    }
+
+    if (best <= r + 1.0f) {
+      ground = best;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/// Move by the current velocity. Along x only solid tiles block, and then
+/// only above the step height when on the ground. Along y a rising box stops
+/// at solid tiles above its head, and a falling box lands on the highest
+/// floor it reaches. A box that was on the ground and is not rising looks
+/// for a floor down to the step depth, so that it follows slopes down. The
+/// contacts are found last, at the final position.
+/// \param dt Time step in seconds
+/// \param drop Fall through one-way platforms
+
+void CGridController::Move(float dt, bool drop) {
+  const float hw = m_fHalfWidth;
+  const float ht = m_fHeight;
+
+  const float dist = std::max(std::fabs(m_fVX), std::fabs(m_fVY)) * dt;
+  const int steps = std::max(1, (int)std::ceil(dist / g_fMaxSubstep));
+  const float h = dt / steps;
+
+  bool grounded = m_contacts.bGround;
+  bool head = false, wallLeft = false, wallRight = false;
+
+  for (int s = 0; s < steps; ++s) {
+    const float climb = grounded ? m_fStepUp : 0.0f;
+
+    if (m_fVX != 0.0f) {  // horizontal, test the leading column
+      const float nx = m_fX + m_fVX * h;
+      const int col = m_fVX > 0.0f ? (int)std::floor(nx + hw)
+                                   : (int)std::floor(nx - hw);
+      const int top = (int)std::floor(m_fY - ht + g_fSkin);
+      const int bottom = (int)std::floor(m_fY - g_fSkin);
+      bool hit = false;
+
+      for (int r = top; r <= bottom && !hit; ++r)
+        hit = Blocks(col, r) && r < m_fY - climb;  // too high to step up
+
+      if (hit) {
+        m_fX = m_fVX > 0.0f ? col - hw - g_fSkin : col + 1 + hw + g_fSkin;
+        (m_fVX > 0.0f ? wallRight : wallLeft) = true;
+        m_fVX = 0.0f;
+      } else m_fX = nx;
+    }
+
+    const float ny = m_fY + m_fVY * h;
+
+    if (m_fVY < 0.0f) {  // rising, test the row above the head
+      const int row = (int)std::floor(ny - ht);
+      const int left = (int)std::floor(m_fX - hw + g_fSkin);
+      const int right = (int)std::floor(m_fX + hw - g_fSkin);
+      bool hit = false;
+      for (int c = left; c <= right && !hit; ++c) hit = Blocks(c, row);
+
+      if (hit) {
+        m_fY = row + 1 + ht;
+        m_fVY = 0.0f;
+        head = true;
+      } else m_fY = ny;
+
+      grounded = false;
+    }
+
+    else {  // falling or walking, land on the highest floor reached
+      const float reach = grounded ? m_fStepDown : 0.0f;
+      float ground;
+
+      if (FindGround(m_fY - climb, ny + reach, m_fY, drop, ground)) {
+        m_fY = ground;
+        m_fVY = 0.0f;
+        grounded = true;
+      } else {
+        m_fY = ny;
+        grounded = false;
+      }
+    }
+  }
+
+  // contacts at the final position
+  float ground;
+  m_contacts.bGround = grounded ||
+      (m_fVY >= 0.0f && FindGround(m_fY, m_fY + g_fSkin, m_fY, drop, ground));
+
+  const int top = (int)std::floor(m_fY - ht + g_fSkin);
+  const int bottom = (int)std::floor(m_fY - m_fStepUp - g_fSkin);
+  const int left = (int)std::floor(m_fX - hw - 2 * g_fSkin);
+  const int right = (int)std::floor(m_fX + hw + 2 * g_fSkin);
+
+  for (int r = top; r <= bottom; ++r) {
+    wallLeft = wallLeft || Blocks(left, r);
+    wallRight = wallRight || Blocks(right, r);
+  }
+
+  const int above = (int)std::floor(m_fY - ht - 2 * g_fSkin);
+  for (int c = (int)std::floor(m_fX - hw + g_fSkin);
+       c <= (int)std::floor(m_fX + hw - g_fSkin); ++c)
+    head = head || Blocks(c, above);
+
+  m_contacts.bHead = head;
+  m_contacts.bWallLeft = wallLeft;
+  m_contacts.bWallRight = wallRight;
+}
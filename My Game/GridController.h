@@ -0,0 +1,90 @@
+/// \file GridController.h
+/// \brief Interface for the kinematic character controller CGridController.
+
+#ifndef __L4RC_GAME_GRIDCONTROLLER_H__
+#define __L4RC_GAME_GRIDCONTROLLER_H__
+
+/// \brief What a character touched in its last move.
+struct SGridContacts {
+  bool bGround = false;     ///< Standing on a floor, platform or slope.
+  bool bHead = false;       ///< Head against a ceiling.
+  bool bWallLeft = false;   ///< Left side against a wall.
+  bool bWallRight = false;  ///< Right side against a wall.
+};
+
+/// \brief The kinematic character controller.
+///
+/// Moves an axis aligned box through a tile map directly, with no physics
+/// engine. Each move is split into substeps short enough that no tile can
+/// be skipped, and each substep moves along x and then along y, stopping at
+/// the tiles in the way. The ground, head and wall contacts come out of the
+/// same pass, so they describe the position the move ended at, not the one
+/// a frame earlier.
+///
+/// Tiles are '1' for solid, '2' for a one-way platform that holds up a
+/// character falling onto it from above and nothing else, and '3' and '4'
+/// for 45 degree slopes rising to the right and to the left. Slopes and
+/// solid tiles no more than a step high are walked up rather than blocking,
+/// and a character on the ground sticks to it walking down a slope.
+///
+/// Units are tiles and seconds, with y down and row 0 at the top, the same
+/// as the navigation graph and the crowd. The position is the middle of the
+/// character's feet. The tile array is not copied and must outlive the
+/// controller or the next call to `SetMap()`.
+class CGridController {
+ private:
+  const char* m_pTiles = nullptr;  ///< Tile map.
+  int m_nWidth = 0;                ///< Map width in tiles.
+  int m_nHeight = 0;               ///< Map height in tiles.
+
+  float m_fHalfWidth = 0.4f;  ///< Half the box's width.
+  float m_fHeight = 1.4f;     ///< Box height.
+  float m_fStepUp = 0.5f;     ///< Highest ledge walked up without a jump.
+  float m_fStepDown = 0.3f;   ///< Deepest drop followed without falling.
+
+  float m_fX = 0.0f;   ///< Position x.
+  float m_fY = 0.0f;   ///< Position y, feet.
+  float m_fVX = 0.0f;  ///< Velocity x.
+  float m_fVY = 0.0f;  ///< Velocity y, positive is down.
+  SGridContacts m_contacts; ///< Contacts after the last move.
+
+  char Tile(int x, int y) const; ///< Tile, solid off the sides of the map.
+  bool Blocks(int x, int y) const { return Tile(x, y) == '1'; } ///< Wall.
+  bool FindGround(float yMin, float yMax, float yFeet, bool drop,
+                  float& ground) const; ///< Highest floor in a range.
+
+ public:
+  /// \brief Constructor.
+  /// \param halfWidth Half the box's width in tiles
+  /// \param height Box height in tiles
+  CGridController(float halfWidth, float height);
+
+  /// \brief Set the tile map to collide with.
+  /// \param tiles One character per tile, row major
+  /// \param w Width in tiles
+  /// \param h Height in tiles
+  void SetMap(const char* tiles, int w, int h);
+
+  /// \brief Move by the current velocity, stopping at tiles.
+  /// \param dt Time step in seconds
+  /// \param drop Fall through one-way platforms
+  void Move(float dt, bool drop = false);
+
+  /// \brief Put the feet somewhere, keeping the velocity.
+  void SetPos(float x, float y) { m_fX = x; m_fY = y; }
+
+  /// \brief Set the velocity in tiles per second, y down.
+  void SetVel(float vx, float vy) { m_fVX = vx; m_fVY = vy; }
+
+  /// \brief Set what the box touches, as when going back to a saved state.
+  void SetContacts(const SGridContacts& c) { m_contacts = c; }
+
+  float GetX() const { return m_fX; } ///< Feet x.
+  float GetY() const { return m_fY; } ///< Feet y.
+  float GetVelX() const { return m_fVX; } ///< Velocity x.
+  float GetVelY() const { return m_fVY; } ///< Velocity y, positive is down.
+  float GetHeight() const { return m_fHeight; } ///< Box height.
+  const SGridContacts& GetContacts() const { return m_contacts; } ///< Touch.
+};
+
+#endif  //__L4RC_GAME_GRIDCONTROLLER_H__
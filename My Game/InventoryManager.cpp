@@ -5,7 +5,10 @@
 #include <cstring>
 #include <sstream>
 
+#include "DropManager.h"
 #include "Player.h"
+#include "SaveGame.h"
+#include "WorldHash.h"
 #include "SpriteDesc.h"
 
 /// Constructor initializes the inventory with empty slots.
@@ -19,16 +22,104 @@ CInventoryManager::CInventoryManager(LSpriteRenderer* renderer)
 
 /// Destructor cleans up all items in inventory.
 
-CInventoryManager::~CInventoryManager() {
-  for (CItem* item : m_vItems) {
+CInventoryManager::~CInventoryManager() { Clear(); }
+
+/// Delete every item in the slots, and put the selection and UI back as they
+/// were at the start. The slots themselves stay, all empty. Items dropped
+/// into the world belong to the drop manager and are left alone.
+
+void CInventoryManager::Clear() {
+  for (CItem*& item : m_vItems) {
     delete item;
+    item = nullptr;
   }
-  m_vItems.clear();
 
-  for (SDroppedItem& drop : m_vDroppedItems) {
-    delete drop.pItem;
+  m_nSelectedSlot = 0;
+  m_nHotbarSelection = 0;
+  m_bIsOpen = false;
+}
+
+/// Add an item record for each filled slot, which refers to it by index.
+/// \param save [in, out] Snapshot
+
+void CInventoryManager::Save(SSaveGame& save) const {
+  save.inventory.nSelected = m_nSelectedSlot;
+  save.inventory.nHotbar = m_nHotbarSelection;
+
+  save.vSlots.assign(m_vItems.size(), 0);
+  for (size_t i = 0; i < m_vItems.size(); ++i)
+    if (m_vItems[i]) save.vSlots[i] = m_vItems[i]->Save(save) + 1;
+}
+
+/// Hash each slot's item id and quantity, 0 and 0 for an empty slot, and the
+/// selection.
+/// \param h Hash to continue from
+/// \return Hash
+
+uint64_t CInventoryManager::HashSlots(uint64_t h) const {
+  for (const CItem* item : m_vItems) {
+    const int slot[] = {item ? item->GetID() : 0,
+                        item ? item->GetQuantity() : 0};
+    h = HashValue(slot, h);
   }
-  m_vDroppedItems.clear();
+
+  const int selection[] = {m_nSelectedSlot, m_nHotbarSelection};
+  return HashValue(selection, h);
+}
+
+/// Copy each filled slot's item into the snapshot's items, assigning over
+/// the items left there by the last snapshot.
+/// \param s [out] Snapshot, reused
+
+void CInventoryManager::Snapshot(SInventorySnapshot& s) const {
+  s.nItems = 0;
+  auto put = [&](const CItem* item) {
+    if (s.nItems < s.vItems.size()) s.vItems[s.nItems] = *item;
+    else s.vItems.push_back(*item);
+    return (int)++s.nItems;
+  };
+
+  s.vSlots.resize(m_vItems.size());
+  for (size_t i = 0; i < m_vItems.size(); ++i)
+    s.vSlots[i] = m_vItems[i] ? put(m_vItems[i]) : 0;
+}
+
+/// Assign the snapshot's items over the items already in the slots, so that
+/// going back a few frames makes new items only for those used up since.
+/// \param s Snapshot
+
+void CInventoryManager::Restore(const SInventorySnapshot& s) {
+  auto get = [](CItem* item, const CItem& value) {
+    if (!item) return new CItem(value);
+    *item = value;
+    return item;
+  };
+
+  for (size_t i = 0; i < m_vItems.size(); ++i)
+    if (i < s.vSlots.size() && s.vSlots[i] > 0)
+      m_vItems[i] = get(m_vItems[i], s.vItems[s.vSlots[i] - 1]);
+    else {
+      delete m_vItems[i];
+      m_vItems[i] = nullptr;
+    }
+}
+
+/// Empty the slots, then make a new item for each filled slot in a save.
+/// References to items that are not in the save are ignored, and so are
+/// slots past the last one.
+/// \param save Snapshot
+
+void CInventoryManager::Load(const SSaveGame& save) {
+  Clear();
+
+  const size_t slots = std::min(save.vSlots.size(), m_vItems.size());
+  for (size_t i = 0; i < slots; ++i)
+    if (save.vSlots[i]) m_vItems[i] = CItem::Load(save, save.vSlots[i] - 1);
+
+  if (save.inventory.nSelected >= 0 && save.inventory.nSelected < m_nMaxSlots)
+    m_nSelectedSlot = save.inventory.nSelected;
+  if (save.inventory.nHotbar >= 0 && save.inventory.nHotbar < m_nHotbarSlots)
+    m_nHotbarSelection = save.inventory.nHotbar;
 }
 
 /// Set screen dimensions and recalculate layout.
@@ -43,45 +134,7 @@ void CInventoryManager::SetScreenSize(float width, float height) {
 
 void CInventoryManager::SetPlayer(CPlayer* player) { m_pPlayer = player; }
 
-void CInventoryManager::Update(float dt) {
-  if (m_vDroppedItems.empty()) return;
-
-  Vector2 playerPos = Vector2::Zero;
-  float playerRadius = 0.0f;
-  bool hasPlayer = (m_pPlayer != nullptr);
-  if (hasPlayer) {
-    playerPos = m_pPlayer->GetPos();
-    playerRadius = m_pPlayer->GetRadius();
-  }
-
-  for (size_t i = 0; i < m_vDroppedItems.size();) {
-    SDroppedItem& drop = m_vDroppedItems[i];
-    if (!drop.pItem) {
-      m_vDroppedItems.erase(m_vDroppedItems.begin() + i);
-      continue;
-    }
-
-    drop.fTimer += dt;
-    if (drop.fPickupDelay > 0.0f) {
-      drop.fPickupDelay = std::max(0.0f, drop.fPickupDelay - dt);
-    }
-
-    bool removed = false;
-    if (hasPlayer && drop.fPickupDelay <= 0.0f) {
-      float combinedRadius = playerRadius + m_fPickupRadius;
-      Vector2 diff = drop.vPos - playerPos;
-      if (diff.LengthSquared() <= combinedRadius * combinedRadius) {
-        if (AddItem(drop.pItem)) {
-          drop.pItem = nullptr;
-          m_vDroppedItems.erase(m_vDroppedItems.begin() + i);
-          removed = true;
-        }
-      }
-    }
-
-    if (!removed) ++i;
-  }
-}
+void CInventoryManager::SetDrops(CDropManager* drops) { m_pDrops = drops; }
 
 /// Update all layout positions based on current screen size.
 /// Coordinate system: (0,0) at bottom-left, Y increases upward for sprites
@@ -319,10 +372,10 @@ void CInventoryManager::UseSelectedItem() {
   }
 }
 
-/// Drop the currently selected item.
+/// Drop the currently selected item into the world, in front of the player.
 
 void CInventoryManager::DropSelectedItem() {
-  if (m_nSelectedSlot < 0 || !m_vItems[m_nSelectedSlot]) return;
+  if (m_nSelectedSlot < 0 || !m_vItems[m_nSelectedSlot] || !m_pDrops) return;
 
   CItem* item = m_vItems[m_nSelectedSlot];
 
@@ -333,12 +386,7 @@ void CInventoryManager::DropSelectedItem() {
                                   -m_pPlayer->GetRadius() * 0.25f);
   }
 
-  SDroppedItem drop;
-  drop.pItem = item;
-  drop.vPos = dropPos;
-  drop.fTimer = 0.0f;
-  drop.fPickupDelay = m_fPickupDelayTime;
-  m_vDroppedItems.push_back(drop);
+  m_pDrops->Add(item, dropPos);
   m_vItems[m_nSelectedSlot] = nullptr;
 
   if (m_nSelectedSlot < m_nHotbarSlots) {
@@ -379,7 +427,7 @@ float CInventoryManager::SpriteYToTextY(float spriteY) const {
 
 /// Draw the background panel for the inventory.
 
-void CInventoryManager::DrawPanel() {
+void CInventoryManager::DrawPanel(CFramePacket* pPacket) {
   LSpriteDesc2D desc;
   desc.m_nSpriteIndex = (UINT)eSprite::InventoryPanel;
 
@@ -392,16 +440,18 @@ void CInventoryManager::DrawPanel() {
   desc.m_fXScale = m_vPanelSize.x / 64.0f;
   desc.m_fYScale = m_vPanelSize.y / 64.0f;
 
-  m_pRenderer->Draw(&desc);
+  pPacket->SetLayer(eSpriteLayer::Panel);
+  pPacket->Draw(&desc);
 }
 
 /// Draw a single inventory slot.
+/// \param pPacket Frame packet to record into
 /// \param slotIndex Index of slot to draw
 /// \param pos Position to draw at (bottom-left corner in sprite coords)
 /// \param isHotbar Whether this is a hotbar slot
 
-void CInventoryManager::DrawSlot(int slotIndex, const Vector2& pos,
-                                 bool isHotbar) {
+void CInventoryManager::DrawSlot(CFramePacket* pPacket, int slotIndex,
+                                 const Vector2& pos, bool isHotbar) {
   LSpriteDesc2D desc;
 
   // Determine if this slot is selected
@@ -422,14 +472,16 @@ void CInventoryManager::DrawSlot(int slotIndex, const Vector2& pos,
   // Sprites draw from center, pos is bottom-left so add half size
   Vector2 slotCenter = pos + Vector2(m_fSlotSize / 2.0f, m_fSlotSize / 2.0f);
   desc.m_vPos = slotCenter;
-  m_pRenderer->Draw(&desc);
+  pPacket->SetLayer(eSpriteLayer::Slots);
+  pPacket->Draw(&desc);
 
   // Draw item if slot has one
   CItem* item = m_vItems[slotIndex];
   if (item) {
     desc.m_nSpriteIndex = (UINT)item->GetSprite();
     desc.m_vPos = slotCenter;
-    m_pRenderer->Draw(&desc);
+    pPacket->SetLayer(eSpriteLayer::Icons);
+    pPacket->Draw(&desc);
 
     // Draw quantity if stackable and > 1
     if (item->IsStackable() && item->GetQuantity() > 1) {
@@ -437,14 +489,14 @@ void CInventoryManager::DrawSlot(int slotIndex, const Vector2& pos,
       // Position at bottom-right of slot, convert to text coords
       float textX = pos.x + m_fSlotSize - 18.0f;
       float textY = SpriteYToTextY(pos.y + 20.0f);
-      m_pRenderer->DrawScreenText(qtyStr.c_str(), Vector2(textX, textY));
+      pPacket->DrawScreenText(qtyStr.c_str(), Vector2(textX, textY));
     }
   }
 }
 
 /// Draw item info for the selected item.
 
-void CInventoryManager::DrawItemInfo() {
+void CInventoryManager::DrawItemInfo(CFramePacket* pPacket) {
   if (m_nSelectedSlot < 0 || !m_vItems[m_nSelectedSlot]) return;
 
   CItem* item = m_vItems[m_nSelectedSlot];
@@ -514,52 +566,39 @@ void CInventoryManager::DrawItemInfo() {
 
   float textY = SpriteYToTextY(infoTopSpriteY);
   for (int i = 0; i < static_cast<int>(lines.size()) && i < maxLines; ++i) {
-    m_pRenderer->DrawScreenText(lines[i].c_str(), Vector2(textX, textY));
+    pPacket->DrawScreenText(lines[i].c_str(), Vector2(textX, textY));
     textY += lineHeight;
   }
 }
 
 /// Draw the hotbar at the bottom of the screen.
 
-void CInventoryManager::DrawHotbar() {
+void CInventoryManager::DrawHotbar(CFramePacket* pPacket) {
   for (int i = 0; i < m_nHotbarSlots; i++) {
     Vector2 slotPos = GetHotbarSlotPosition(i);
-    DrawSlot(i, slotPos, true);
+    DrawSlot(pPacket, i, slotPos, true);
   }
 }
 
 /// Draw just the hotbar (always visible at bottom of screen).
 
-void CInventoryManager::DrawHotbarOnly() { DrawHotbar(); }
-
-void CInventoryManager::DrawWorldItems() {
-  LSpriteDesc2D desc;
-
-  for (const SDroppedItem& drop : m_vDroppedItems) {
-    if (!drop.pItem) continue;
-
-    desc.m_nSpriteIndex = (UINT)drop.pItem->GetSprite();
-    float bobOffset = std::sin(drop.fTimer * m_fBobSpeed) * m_fBobAmplitude;
-    desc.m_vPos = drop.vPos + Vector2(0.0f, bobOffset);
-    desc.m_fXScale = 1.0f;
-    desc.m_fYScale = 1.0f;
-    m_pRenderer->Draw(&desc);
-  }
+void CInventoryManager::DrawHotbarOnly(CFramePacket* pPacket) {
+  DrawHotbar(pPacket);
 }
 
 /// Draw the entire inventory UI.
 
-void CInventoryManager::Draw() {
+void CInventoryManager::Draw(CFramePacket* pPacket) {
   if (!m_bIsOpen) return;
 
   // Draw semi-transparent background panel
-  DrawPanel();
+  DrawPanel(pPacket);
 
   // Draw title at top of panel
   float titleX = m_vPanelPos.x + m_fPanelPadding;
   float titleY =
       SpriteYToTextY(m_vPanelPos.y + m_vPanelSize.y - m_fPanelPadding - 5.0f);
-  m_pRenderer->DrawScreenText("INVENTORY", Vector2(titleX, titleY));
+  pPacket->DrawScreenText("INVENTORY", Vector2(titleX, titleY));
 
   // Draw controls hint at top right, keep inside panel bounds
   const char* controlsText = "[I] Close";
@@ -569,16 +608,16 @@ void CInventoryManager::Draw() {
   float controlsX =
       m_vPanelPos.x + m_vPanelSize.x - m_fPanelPadding - controlsWidth;
   controlsX = std::max(controlsX, m_vPanelPos.x + m_fPanelPadding);
-  m_pRenderer->DrawScreenText(controlsText, Vector2(controlsX, titleY));
+  pPacket->DrawScreenText(controlsText, Vector2(controlsX, titleY));
 
   // Draw all inventory slots
   for (int i = 0; i < m_nMaxSlots; i++) {
     Vector2 slotPos = GetSlotPosition(i);
-    DrawSlot(i, slotPos, false);
+    DrawSlot(pPacket, i, slotPos, false);
   }
 
   // Draw selected item info
-  DrawItemInfo();
+  DrawItemInfo(pPacket);
 }
 
 /// Check if inventory has room for an item.
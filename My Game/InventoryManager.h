@@ -6,10 +6,26 @@
 #include "Keyboard.h"
 #include "SimpleMath.h"
 #include "SpriteRenderer.h"
+#include "FramePacket.h"
 
 using namespace DirectX::SimpleMath;
 
 class CPlayer;
+class CDropManager;
+struct SSaveGame;
+
+/// \brief The slots by value, for rollback.
+///
+/// Items are kept by value rather than by pointer, since picking up a drop
+/// can merge it into a stack and delete it. The arrays keep their capacity,
+/// so taking a snapshot into the same one again does not allocate once it
+/// has grown. The selection is not kept, as it is changed by menus and not
+/// by frames.
+struct SInventorySnapshot {
+  std::vector<CItem> vItems;      ///< Items in the slots.
+  size_t nItems = 0;              ///< Items in use, the rest are spare.
+  std::vector<int> vSlots;        ///< Item index + 1 per slot, 0 if empty.
+};
 
 /// \brief The inventory manager class.
 /// Manages item storage, UI display, hotbar, and user interaction.
@@ -40,22 +56,8 @@ class CInventoryManager {
   Vector2 m_vPanelPos;      ///< Position of background panel
   Vector2 m_vPanelSize;     ///< Size of background panel
 
-  struct SDroppedItem {
-    CItem* pItem = nullptr;
-    Vector2 vPos = Vector2::Zero;
-    float fTimer = 0.0f;
-    float fPickupDelay = 0.0f;
-  };
-
-  std::vector<SDroppedItem>
-      m_vDroppedItems;  ///< World items spawned from drops
-
   CPlayer* m_pPlayer = nullptr;  ///< Player pointer for world drop placement
-
-  static constexpr float m_fPickupRadius = 32.0f;
-  static constexpr float m_fPickupDelayTime = 0.25f;
-  static constexpr float m_fBobAmplitude = 6.0f;
-  static constexpr float m_fBobSpeed = 2.5f;
+  CDropManager* m_pDrops = nullptr;  ///< Where dropped items go.
 
   /// \brief Update layout positions based on screen size.
   void UpdateLayout();
@@ -70,19 +72,21 @@ class CInventoryManager {
   int GetSlotAtPosition(const Vector2& pos) const;
 
   /// \brief Draw a single inventory slot.
+  /// \param pPacket Frame packet to record into
   /// \param slotIndex Index of slot to draw
   /// \param pos Position to draw at
   /// \param isHotbar Whether this is a hotbar slot
-  void DrawSlot(int slotIndex, const Vector2& pos, bool isHotbar = false);
+  void DrawSlot(CFramePacket* pPacket, int slotIndex, const Vector2& pos,
+                bool isHotbar = false);
 
   /// \brief Draw the background panel.
-  void DrawPanel();
+  void DrawPanel(CFramePacket* pPacket);
 
   /// \brief Draw the hotbar at the bottom of the screen.
-  void DrawHotbar();
+  void DrawHotbar(CFramePacket* pPacket);
 
   /// \brief Draw item tooltip/info for selected item.
-  void DrawItemInfo();
+  void DrawItemInfo(CFramePacket* pPacket);
 
   /// \brief Convert sprite Y coordinate to text Y coordinate.
   /// Sprites use Y-up (0 at bottom), text uses Y-down (0 at top).
@@ -104,8 +108,30 @@ class CInventoryManager {
   /// \brief Provide player reference for drop placement.
   void SetPlayer(CPlayer* player);
 
-  /// \brief Update world drop state (bobbing, pickup detection).
-  void Update(float dt);
+  /// \brief Provide the world drops that dropped items go to.
+  void SetDrops(CDropManager* drops);
+
+  /// \brief Delete every item in the slots.
+  void Clear();
+
+  /// \brief Add the slots and selection to a save.
+  /// \param save [in, out] Snapshot
+  void Save(SSaveGame& save) const;
+
+  /// \brief Replace everything with the contents of a save.
+  /// \param save Snapshot
+  void Load(const SSaveGame& save);
+
+  /// \brief Hash the slots and selection, for determinism checks.
+  uint64_t HashSlots(uint64_t h) const;
+
+  /// \brief Copy the slots, for rollback.
+  /// \param s [out] Snapshot, reused
+  void Snapshot(SInventorySnapshot& s) const;
+
+  /// \brief Go back to the slots in a snapshot.
+  /// \param s Snapshot
+  void Restore(const SInventorySnapshot& s);
 
   /// \brief Add an item to the inventory.
   /// \param item Pointer to item to add
@@ -146,13 +172,10 @@ class CInventoryManager {
   void HandleHotbarInput(LKeyboard* pKeyboard);
 
   /// \brief Draw the full inventory UI (when open).
-  void Draw();
+  void Draw(CFramePacket* pPacket);
 
   /// \brief Draw just the hotbar (always visible).
-  void DrawHotbarOnly();
-
-  /// \brief Draw items dropped into the world.
-  void DrawWorldItems();
+  void DrawHotbarOnly(CFramePacket* pPacket);
 
   /// \brief Check if inventory has room for an item.
   /// \param item Item to check
@@ -1,5 +1,7 @@
 #include "Item.h"
 
+#include "SaveGame.h"
+
 /// Constructor initializes all item properties.
 /// \param id Unique item ID
 /// \param name Display name
@@ -29,4 +31,42 @@ CItem::CItem(int id, const std::string& name, const std::string& desc,
 bool CItem::CanAddToStack(int amount) const {
     if (!m_bStackable) return false;
     return (m_nQuantity + amount) <= m_nMaxStack;
-}
\ No newline at end of file
+}
+/// Add a record with this item's fields, and its name and description in
+/// the save's string table. Slots and drops refer to items by the index.
+/// \param save [in, out] Save
+/// \return Index of the record
+
+uint32_t CItem::Save(SSaveGame& save) const {
+    SSaveItem r;
+    r.nID = m_nItemID;
+    r.nSprite = (uint32_t)m_eSpriteType;
+    r.nType = (uint32_t)m_eItemType;
+    r.nQuantity = m_nQuantity;
+    r.nMaxStack = m_nMaxStack;
+    r.bStackable = m_bStackable ? 1 : 0;
+    r.nName = save.AddString(m_sName);
+    r.nDesc = save.AddString(m_sDescription);
+    save.vItems.push_back(r);
+    return (uint32_t)save.vItems.size() - 1;
+}
+
+/// Make a new item from a record, as Save() wrote it. A record whose sprite
+/// or type is not one this build has, from a corrupt save or one written
+/// with a longer sprite table, is rejected rather than drawn out of range.
+/// \param save Save
+/// \param index Index of the record
+/// \return New item, or nullptr if the index or the record is out of range
+
+CItem* CItem::Load(const SSaveGame& save, uint32_t index) {
+    if (index >= save.vItems.size()) return nullptr;
+    const SSaveItem& r = save.vItems[index];
+    if (r.nSprite >= (uint32_t)eSprite::Size ||
+        r.nType > (uint32_t)eItemType::Misc)
+        return nullptr;
+    CItem* item = new CItem(r.nID, save.GetString(r.nName),
+        save.GetString(r.nDesc), (eSprite)r.nSprite, (eItemType)r.nType,
+        r.bStackable != 0, r.nMaxStack);
+    item->SetQuantity(r.nQuantity);
+    return item;
+}
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include "GameDefines.h"
 
+struct SSaveGame;
+
 /// \brief Item types enumeration.
 /// Defines different categories of items in the game.
 enum class eItemType {
@@ -58,6 +61,17 @@ public:
     /// \return True if can add this amount to stack
     bool CanAddToStack(int amount) const;
 
+    /// \brief Add an item record to a save.
+    /// \param save [in, out] Save
+    /// \return Index of the record
+    uint32_t Save(SSaveGame& save) const;
+
+    /// \brief Make an item from a record in a save.
+    /// \param save Save
+    /// \param index Index of the record
+    /// \return New item, or nullptr if there is no such record
+    static CItem* Load(const SSaveGame& save, uint32_t index);
+
     /// \brief Check if item is empty (quantity <= 0).
     /// \return True if no items remain
     bool IsEmpty() const { return m_nQuantity <= 0; }
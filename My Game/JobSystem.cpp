@@ -0,0 +1,236 @@
+/// \file JobSystem.cpp
+/// \brief Code for the job scheduler CJobSystem and task graph CTaskGraph.
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+
+/// Index of the calling thread's deque. The main thread, and any other thread
+/// that is not one of our workers, uses slot 0.
+static thread_local int t_nWorkerIndex = 0;
+
+/// Constructor creates one deque per thread and starts the workers.
+/// \param threads Number of threads including the main thread
+
+CJobSystem::CJobSystem(unsigned threads) {
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (unsigned i = 0; i < threads; i++)
+    m_vQueues.push_back(std::make_unique<SQueue>());
+
+  for (unsigned i = 1; i < threads; i++)
+    m_vThreads.emplace_back(&CJobSystem::WorkerLoop, this, (int)i);
+}
+
+/// Destructor tells the workers to quit and waits for them. Only destroy the
+/// scheduler between frames, never while a task graph is running.
+
+CJobSystem::~CJobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutexWake);
+    m_bQuit = true;
+  }
+  m_cvWake.notify_all();
+
+  for (std::thread& t : m_vThreads) t.join();
+}
+
+/// Workers run jobs until told to quit, sleeping when every queue is empty.
+/// A background job is only taken when no deque has a job in it.
+/// \param index Index of this worker's deque
+
+void CJobSystem::WorkerLoop(int index) {
+  t_nWorkerIndex = index;
+
+  while (!m_bQuit) {
+    SJob* pJob = Pop(index);
+    if (!pJob) pJob = PopBackground();
+
+    if (pJob) {
+      Execute(pJob);
+    } else {
+      std::unique_lock<std::mutex> lock(m_mutexWake);
+      m_cvWake.wait(lock, [&]() {
+        return m_bQuit || m_nQueued > 0 || m_nBackground > 0;
+      });
+    }
+  }
+}
+
+/// Take the newest job from our own deque (it is most likely still in cache),
+/// or failing that the oldest job from the next non-empty deque.
+/// \param index Index of the calling thread's deque
+/// \return Pointer to a job or nullptr if there are none
+
+SJob* CJobSystem::Pop(int index) {
+  if (m_nQueued <= 0) return nullptr;
+
+  const int n = (int)m_vQueues.size();
+
+  for (int i = 0; i < n; i++) {
+    SQueue& q = *m_vQueues[(index + i) % n];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.dqJobs.empty()) continue;
+
+    SJob* pJob = nullptr;
+    if (i == 0) {
+      pJob = q.dqJobs.back();
+      q.dqJobs.pop_back();
+    } else {
+      pJob = q.dqJobs.front();
+      q.dqJobs.pop_front();
+    }
+
+    m_nQueued--;
+    return pJob;
+  }
+
+  return nullptr;
+}
+
+/// Take the oldest job from the background queue, so that background jobs
+/// run in the order they were submitted.
+/// \return Pointer to a job or nullptr if there are none
+
+SJob* CJobSystem::PopBackground() {
+  if (m_nBackground <= 0) return nullptr;
+
+  std::lock_guard<std::mutex> lock(m_mutexBackground);
+  if (m_dqBackground.empty()) return nullptr;
+
+  SJob* pJob = m_dqBackground.front();
+  m_dqBackground.pop_front();
+  m_nBackground--;
+  return pJob;
+}
+
+/// Run a job, then submit any dependents that were only waiting on it.
+/// \param pJob Pointer to the job
+
+void CJobSystem::Execute(SJob* pJob) {
+  if (pJob->fnTask) pJob->fnTask();
+
+  for (SJob* pNext : pJob->vDependents)
+    if (--pNext->nPending == 0) Submit(pNext);
+
+  pJob->pGraph->m_nRemaining--;
+}
+
+/// Push a job onto the calling thread's deque, or onto the back of the
+/// background queue if its graph was started in the background, and wake a
+/// sleeping worker.
+/// \param pJob Pointer to a job whose dependencies have all finished
+
+void CJobSystem::Submit(SJob* pJob) {
+  const bool background = pJob->pGraph->m_bBackground;
+
+  if (background) {
+    std::lock_guard<std::mutex> lock(m_mutexBackground);
+    m_dqBackground.push_back(pJob);
+  } else {
+    SQueue& q = *m_vQueues[t_nWorkerIndex];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.dqJobs.push_back(pJob);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutexWake);
+    if (background) m_nBackground++;
+    else m_nQueued++;
+  }
+  m_cvWake.notify_one();
+}
+
+/// Run a single queued job on the calling thread. This is how the main thread
+/// helps out while waiting on a task graph.
+/// \return True if a job was run
+
+bool CJobSystem::RunOne() {
+  SJob* pJob = Pop(t_nWorkerIndex);
+  if (pJob) Execute(pJob);
+  return pJob != nullptr;
+}
+
+/// Run the oldest background job on the calling thread. This is how a thread
+/// waiting on a background graph helps out, and how the graph finishes when
+/// there are no workers.
+/// \return True if a job was run
+
+bool CJobSystem::RunOneBackground() {
+  SJob* pJob = PopBackground();
+  if (pJob) Execute(pJob);
+  return pJob != nullptr;
+}
+
+/// Add a job to the graph. Dependencies must already be in the graph, so
+/// the graph cannot contain cycles.
+/// \param task The work to do
+/// \param deps Handles of jobs that must finish first
+/// \return Handle of the new job
+
+JobHandle CTaskGraph::Add(const std::function<void()>& task,
+                          std::initializer_list<JobHandle> deps) {
+  m_dqJobs.emplace_back();
+  SJob& job = m_dqJobs.back();
+  job.fnTask = task;
+  job.pGraph = this;
+
+  for (JobHandle h : deps) {
+    m_dqJobs[h].vDependents.push_back(&job);
+    job.nDependencies++;
+  }
+
+  return (JobHandle)m_dqJobs.size() - 1;
+}
+
+/// Submit the jobs that have no dependencies, then run jobs on the calling
+/// thread until the whole graph has finished.
+/// \param pJobs Pointer to the job scheduler
+
+void CTaskGraph::Run(CJobSystem* pJobs) {
+  const auto t0 = std::chrono::high_resolution_clock::now();
+
+  Start(pJobs);
+  Wait(pJobs);
+
+  const auto t1 = std::chrono::high_resolution_clock::now();
+  m_fLastRunTime = std::chrono::duration<float, std::milli>(t1 - t0).count();
+}
+
+/// Submit the jobs that have no dependencies. The rest are submitted by the
+/// scheduler as their dependencies finish.
+/// \param pJobs Pointer to the job scheduler
+/// \param background True to use the background queue
+
+void CTaskGraph::Submit(CJobSystem* pJobs, bool background) {
+  m_bBackground = background;
+  m_nRemaining = (int)m_dqJobs.size();
+
+  for (SJob& job : m_dqJobs) job.nPending = job.nDependencies;
+
+  for (SJob& job : m_dqJobs)
+    if (job.nDependencies == 0) pJobs->Submit(&job);
+}
+
+/// Submit the jobs to the workers' deques.
+/// \param pJobs Pointer to the job scheduler
+
+void CTaskGraph::Start(CJobSystem* pJobs) { Submit(pJobs, false); }
+
+/// Submit the jobs to the background queue. Those with no dependencies start
+/// in the order they were added.
+/// \param pJobs Pointer to the job scheduler
+
+void CTaskGraph::StartBackground(CJobSystem* pJobs) { Submit(pJobs, true); }
+
+/// Run jobs on the calling thread until the graph has finished. Waiting on a
+/// background graph runs background jobs only, and waiting on any other
+/// graph runs no background jobs.
+/// \param pJobs Pointer to the job scheduler
+
+void CTaskGraph::Wait(CJobSystem* pJobs) {
+  while (m_nRemaining > 0)
+    if (!(m_bBackground ? pJobs->RunOneBackground() : pJobs->RunOne()))
+      std::this_thread::yield();
+}
@@ -0,0 +1,157 @@
+/// \file JobSystem.h
+/// \brief Interface for the job scheduler CJobSystem and task graph CTaskGraph.
+
+#ifndef __L4RC_GAME_JOBSYSTEM_H__
+#define __L4RC_GAME_JOBSYSTEM_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CTaskGraph;
+
+typedef int JobHandle;  ///< Index of a job within its task graph.
+
+/// \brief A unit of work.
+///
+/// A job is a function plus the bookkeeping needed to run it after the jobs
+/// it depends on. Jobs are owned by a CTaskGraph, the scheduler only ever sees
+/// pointers to them.
+struct SJob {
+  std::function<void()> fnTask;      ///< The work to do.
+  std::atomic<int> nPending{0};      ///< Unfinished dependencies this run.
+  int nDependencies = 0;             ///< Total number of dependencies.
+  std::vector<SJob*> vDependents;    ///< Jobs waiting on this one.
+  CTaskGraph* pGraph = nullptr;      ///< Graph that owns this job.
+};
+
+/// \brief The job scheduler.
+///
+/// A fixed pool of worker threads, each with its own job deque. A worker pops
+/// from the back of its own deque and, when that is empty, steals from the
+/// front of another one. Slot 0 belongs to the main thread, which does not
+/// sleep in the pool but helps out while it waits on a task graph.
+///
+/// Jobs from a graph started with `CTaskGraph::StartBackground()`, such as
+/// file reads, go to a separate queue that is run oldest first, and only by
+/// workers that find no other job. So they never hold up a frame's graph on
+/// the main thread, which only runs them while waiting on their own graph.
+class CJobSystem {
+ private:
+  /// \brief A worker's job deque.
+  struct SQueue {
+    std::mutex mutex;          ///< Guards the deque.
+    std::deque<SJob*> dqJobs;  ///< Jobs ready to run.
+  };
+
+  std::vector<std::thread> m_vThreads;             ///< Worker threads.
+  std::vector<std::unique_ptr<SQueue>> m_vQueues;  ///< One deque per thread.
+
+  std::mutex m_mutexBackground;          ///< Guards the background queue.
+  std::deque<SJob*> m_dqBackground;      ///< Background jobs, oldest first.
+
+  std::mutex m_mutexWake;             ///< Guards sleeping workers.
+  std::condition_variable m_cvWake;   ///< Wakes sleeping workers.
+  std::atomic<int> m_nQueued{0};      ///< Number of jobs sitting in deques.
+  std::atomic<int> m_nBackground{0};  ///< Number of background jobs queued.
+  std::atomic<bool> m_bQuit{false};   ///< Tells workers to exit.
+
+  /// \brief Body of a worker thread.
+  /// \param index Index of this worker's deque
+  void WorkerLoop(int index);
+
+  /// \brief Pop our own newest job or steal someone else's oldest.
+  /// \param index Index of the calling thread's deque
+  /// \return Pointer to a job or nullptr if every deque is empty
+  SJob* Pop(int index);
+
+  /// \brief Pop the oldest background job.
+  /// \return Pointer to a job or nullptr if there are none
+  SJob* PopBackground();
+
+  /// \brief Run a job and submit dependents that became ready.
+  void Execute(SJob* pJob);
+
+ public:
+  /// \brief Constructor starts the worker threads.
+  /// \param threads Thread count including main, 0 for one per core
+  CJobSystem(unsigned threads = 0);
+
+  /// \brief Destructor stops and joins the worker threads.
+  ~CJobSystem();
+
+  /// \brief Queue a job whose dependencies have all finished.
+  void Submit(SJob* pJob);
+
+  /// \brief Run one queued job, not a background one, on the calling thread.
+  /// \return True if a job was run
+  bool RunOne();
+
+  /// \brief Run the oldest background job on the calling thread.
+  /// \return True if a job was run
+  bool RunOneBackground();
+
+  /// \brief Get the number of threads, including the main thread.
+  unsigned GetThreadCount() const { return (unsigned)m_vQueues.size(); }
+};
+
+/// \brief A per-frame task graph.
+///
+/// Jobs are added along with the handles of the jobs they depend on, then the
+/// whole graph is handed to the scheduler with `Run()`, which returns once
+/// every job has finished. Clear the graph and rebuild it each frame. A graph
+/// that should run over several frames is started with `Start()` instead and
+/// polled with `IsDone()`, or with `StartBackground()` if its jobs block, such
+/// as on the disk, and must stay out of the way of the frame's jobs.
+class CTaskGraph {
+  friend class CJobSystem;
+
+ private:
+  std::deque<SJob> m_dqJobs;         ///< Jobs, a deque so addresses are stable.
+  std::atomic<int> m_nRemaining{0};  ///< Jobs not yet finished.
+  bool m_bBackground = false;        ///< Jobs go to the background queue.
+  float m_fLastRunTime = 0.0f;       ///< Wall time of last run in ms.
+
+  /// \brief Submit the jobs that have no dependencies.
+  void Submit(CJobSystem* pJobs, bool background);
+
+ public:
+  /// \brief Add a job to the graph.
+  /// \param task The work to do
+  /// \param deps Handles of jobs that must finish first
+  /// \return Handle of the new job
+  JobHandle Add(const std::function<void()>& task,
+                std::initializer_list<JobHandle> deps = {});
+
+  /// \brief Run every job and wait, helping out on the calling thread.
+  void Run(CJobSystem* pJobs);
+
+  /// \brief Submit the jobs and return without waiting.
+  void Start(CJobSystem* pJobs);
+
+  /// \brief Submit the jobs to the background queue and return.
+  void StartBackground(CJobSystem* pJobs);
+
+  /// \brief Wait for a started graph, helping out on the calling thread.
+  void Wait(CJobSystem* pJobs);
+
+  /// \brief Check whether every job of the last start has finished.
+  bool IsDone() const { return m_nRemaining == 0; }
+
+  /// \brief Remove all jobs.
+  void Clear() { m_dqJobs.clear(); }
+
+  /// \brief Get the number of jobs in the graph.
+  size_t GetSize() const { return m_dqJobs.size(); }
+
+  /// \brief Get the wall time of the last run in milliseconds.
+  float GetLastRunTime() const { return m_fLastRunTime; }
+};
+
+#endif  //__L4RC_GAME_JOBSYSTEM_H__
@@ -0,0 +1,298 @@
+/// \file NavGraph.cpp
+/// \brief Code for the platformer navigation graph CNavGraph.
+
+#include "NavGraph.h"
+#include "Tiles.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// Check whether a tile blocks movement. The map's sides count as walls and
+/// anything above or below the map is open.
+/// \param tiles Tile array
+/// \param x Column
+/// \param y Row
+/// \return True if solid
+
+bool CNavGraph::Solid(const char* tiles, int x, int y) const {
+  if (x < 0 || x >= m_nWidth) return true;
+  if (y < 0 || y >= m_nHeight) return false;
+  return IsSolidTile(tiles[y * m_nWidth + x]);
+}
+
+/// Check whether an agent fits with its feet in a tile.
+/// \param tiles Tile array
+/// \param x Column
+/// \param y Row of the lowest tile the agent occupies
+/// \return True if every tile the agent occupies is empty
+
+bool CNavGraph::Clear(const char* tiles, int x, int y) const {
+  for (int k = 0; k < m_params.nHeight; ++k)
+    if (Solid(tiles, x, y - k)) return false;
+  return true;
+}
+
+/// Trace the arcs of jumps at a quarter, half, three quarters and all of the
+/// run speed, in both directions, from the middle of a tile. Each arc is kept
+/// as the list of tiles the agent's feet pass through, so that linking a
+/// node only has to look those tiles up instead of integrating again. When
+/// the feet cross into a new row and a new column in the same step, the tile
+/// beside the old one is listed too so that an arc cannot slip diagonally
+/// between two solid tiles.
+
+void CNavGraph::BuildArcs() {
+  m_vArcs.clear();
+
+  const float dt = 1.0f / 240.0f;
+  const float eps = 1e-4f;
+
+  for (int dir = -1; dir <= 1; dir += 2)
+    for (int k = 1; k <= 4; ++k) {
+      const float vx = dir * m_params.fRunSpeed * k / 4.0f;
+      std::vector<SArcCell> arc;
+
+      float px = 0.5f, py = 1.0f;  // feet, in tiles, y down
+      float vy = -m_params.fJumpSpeed;
+      float length = 0.0f;
+      int cx = 0, cy = 0;
+
+      while (cy <= m_params.nMaxFall) {
+        const float nx = px + vx * dt;
+        const float ny = py + vy * dt;
+        length += std::sqrt((nx - px) * (nx - px) + (ny - py) * (ny - py));
+        px = nx;
+        py = ny;
+        vy += m_params.fGravity * dt;
+
+        const int tx = (int)std::floor(px);
+        const int ty = (int)std::floor(py - eps);
+        if (tx == cx && ty == cy) continue;
+
+        const bool falling = vy > 0.0f;
+        if (tx != cx && ty != cy)
+          arc.push_back({tx, cy, falling, length});
+
+        arc.push_back({tx, ty, falling, length});
+        cx = tx;
+        cy = ty;
+      }
+
+      m_vArcs.push_back(arc);
+    }
+}
+
+/// Link every node to its walk neighbors, the floors it can drop onto and the
+/// floors its jump arcs land on. Where several links reach the same node only
+/// the cheapest is kept.
+/// \param tiles Tile array
+
+void CNavGraph::BuildEdges(const char* tiles) {
+  const int nodes = GetNodeCount();
+  m_vFirst.assign(nodes + 1, 0);
+  m_vEdges.clear();
+
+  std::vector<SNavEdge> out;
+
+  auto link = [&](int to, float cost, eNavLink type) {
+    for (SNavEdge& e : out)
+      if (e.nTo == to) {
+        if (cost < e.fCost) e = {to, cost, type};
+        return;
+      }
+    out.push_back({to, cost, type});
+  };
+
+  for (int n = 0; n < nodes; ++n) {
+    const int x = m_vNodeX[n];
+    const int y = m_vNodeY[n];
+    out.clear();
+
+    for (int dir = -1; dir <= 1; dir += 2) {
+      const int nx = x + dir;
+      if (!Clear(tiles, nx, y)) continue;
+
+      if (m_vNodeAt[y * m_nWidth + nx] >= 0) {  // floor continues
+        link(m_vNodeAt[y * m_nWidth + nx], 1.0f, eNavLink::Walk);
+        continue;
+      }
+
+      int fy = y + 1;  // off the edge, fall until there is floor
+      while (fy < m_nHeight && fy - y <= m_params.nMaxFall &&
+             !Solid(tiles, nx, fy + 1))
+        fy++;
+
+      if (fy < m_nHeight && fy - y <= m_params.nMaxFall &&
+          m_vNodeAt[fy * m_nWidth + nx] >= 0)
+        link(m_vNodeAt[fy * m_nWidth + nx], 1.0f + (fy - y), eNavLink::Drop);
+    }
+
+    for (const std::vector<SArcCell>& arc : m_vArcs)
+      for (const SArcCell& c : arc) {
+        const int ax = x + c.nX;
+        const int ay = y + c.nY;
+        if (ay >= m_nHeight || !Clear(tiles, ax, ay)) break;
+
+        if (c.bFalling && ay >= 0 && Solid(tiles, ax, ay + 1)) {
+          const int to = m_vNodeAt[ay * m_nWidth + ax];
+          if (to >= 0 && to != n && (c.nY != 0 || std::abs(c.nX) > 1))
+            link(to, c.fLength + 1.0f, eNavLink::Jump);
+          break;
+        }
+      }
+
+    m_vEdges.insert(m_vEdges.end(), out.begin(), out.end());
+    m_vFirst[n + 1] = (int)m_vEdges.size();
+  }
+}
+
+/// Group the nodes of each chunk into regions, the strongly connected
+/// components of the links that stay inside the chunk, and link the regions
+/// wherever a node link crosses between them. Any node of a region can reach
+/// any other without leaving it, so a path between two regions in the region
+/// graph is always a path between any of their nodes, and a goal whose region
+/// is unreachable is unreachable. Components are found with Tarjan's
+/// algorithm, run with an explicit stack since a region can hold hundreds of
+/// nodes. Region links cost the distance between region centroids.
+
+void CNavGraph::BuildRegions() {
+  const int nodes = GetNodeCount();
+
+  auto chunk = [&](int n) {
+    return (m_vNodeY[n] / m_nChunkSize) * m_nChunksW +
+           m_vNodeX[n] / m_nChunkSize;
+  };
+
+  std::vector<int> index(nodes, -1);   // visit order
+  std::vector<int> low(nodes, 0);      // lowest visit order reachable
+  std::vector<int> id(nodes, -1);      // component, once finished
+  std::vector<int> stack;              // nodes of unfinished components
+  std::vector<std::pair<int, int>> call;  // node, next edge to try
+  int order = 0, components = 0;
+
+  for (int root = 0; root < nodes; ++root) {
+    if (index[root] >= 0) continue;
+    call.push_back({root, m_vFirst[root]});
+    index[root] = low[root] = order++;
+    stack.push_back(root);
+
+    while (!call.empty()) {
+      const int n = call.back().first;
+      int& e = call.back().second;
+
+      if (e < m_vFirst[n + 1]) {
+        const int to = m_vEdges[e++].nTo;
+        if (chunk(to) != chunk(n)) continue;
+
+        if (index[to] < 0) {  // descend
+          index[to] = low[to] = order++;
+          stack.push_back(to);
+          call.push_back({to, m_vFirst[to]});
+        }
+        else if (id[to] < 0) low[n] = std::min(low[n], index[to]);
+        continue;
+      }
+
+      if (low[n] == index[n]) {  // n is the root of a component
+        int m;
+        do {
+          m = stack.back();
+          stack.pop_back();
+          id[m] = components;
+        } while (m != n);
+        components++;
+      }
+
+      call.pop_back();
+      if (!call.empty())
+        low[call.back().first] = std::min(low[call.back().first], low[n]);
+    }
+  }
+
+  m_vRegion.swap(id);
+  m_vRegionX.assign(components, 0.0f);
+  m_vRegionY.assign(components, 0.0f);
+  std::vector<int> count(components, 0);
+
+  for (int n = 0; n < nodes; ++n) {
+    const int r = m_vRegion[n];
+    m_vRegionX[r] += (float)m_vNodeX[n];
+    m_vRegionY[r] += (float)m_vNodeY[n];
+    count[r]++;
+  }
+
+  const int regions = GetRegionCount();
+  for (int r = 0; r < regions; ++r) {
+    m_vRegionX[r] /= count[r];
+    m_vRegionY[r] /= count[r];
+  }
+
+  std::vector<std::pair<int, int>> pairs;
+  for (int n = 0; n < nodes; ++n)
+    for (const SNavEdge* e = EdgesBegin(n); e != EdgesEnd(n); ++e)
+      if (m_vRegion[n] != m_vRegion[e->nTo])
+        pairs.push_back({m_vRegion[n], m_vRegion[e->nTo]});
+
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+  m_vRegionFirst.assign(regions + 1, 0);
+  m_vRegionEdges.clear();
+
+  for (const std::pair<int, int>& p : pairs) {
+    const float dx = m_vRegionX[p.second] - m_vRegionX[p.first];
+    const float dy = m_vRegionY[p.second] - m_vRegionY[p.first];
+    m_vRegionEdges.push_back(
+        {p.second, std::sqrt(dx * dx + dy * dy), eNavLink::Walk});
+    m_vRegionFirst[p.first + 1]++;
+  }
+
+  for (int r = 0; r < regions; ++r) m_vRegionFirst[r + 1] += m_vRegionFirst[r];
+}
+
+/// Find the nodes, then link them, then group them into regions.
+/// \param tiles One character per tile, row major, '0' is empty
+/// \param w Width in tiles
+/// \param h Height in tiles
+/// \param params Movement limits
+
+void CNavGraph::Build(const char* tiles, int w, int h,
+                      const SNavParams& params) {
+  m_params = params;
+  m_nWidth = w;
+  m_nHeight = h;
+  m_nChunksW = (w + m_nChunkSize - 1) / m_nChunkSize;
+
+  m_vNodeAt.assign((size_t)w * h, -1);
+  m_vNodeX.clear();
+  m_vNodeY.clear();
+
+  for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x)
+      if (Solid(tiles, x, y + 1) && Clear(tiles, x, y)) {
+        m_vNodeAt[y * w + x] = (int)m_vNodeX.size();
+        m_vNodeX.push_back(x);
+        m_vNodeY.push_back(y);
+      }
+
+  BuildArcs();
+  BuildEdges(tiles);
+  BuildRegions();
+}
+
+/// Find the floor under a tile. An agent in the air is given the node it
+/// will land on if it falls straight down.
+/// \param x Column
+/// \param y Row, 0 at the top
+/// \return Node index, or -1 if there is no floor within the fall limit
+
+int CNavGraph::FindNode(int x, int y) const {
+  if (x < 0 || x >= m_nWidth || m_vNodeAt.empty()) return -1;
+  y = std::max(y, 0);
+
+  for (int i = 0; i <= m_params.nMaxFall && y + i < m_nHeight; ++i) {
+    const int n = m_vNodeAt[(y + i) * m_nWidth + x];
+    if (n >= 0) return n;
+  }
+
+  return -1;
+}
@@ -0,0 +1,145 @@
+/// \file NavGraph.h
+/// \brief Interface for the platformer navigation graph CNavGraph.
+
+#ifndef __L4RC_GAME_NAVGRAPH_H__
+#define __L4RC_GAME_NAVGRAPH_H__
+
+#include <cstdint>
+#include <vector>
+
+/// \brief How an agent gets from one node to the next.
+enum class eNavLink : uint8_t {
+  Walk,  ///< Step to the next tile along a floor.
+  Drop,  ///< Walk off a ledge and fall.
+  Jump,  ///< Jump along a precomputed arc.
+};
+
+/// \brief Movement limits that decide which links an agent can use.
+///
+/// Units are tiles and seconds. The defaults match CPlayer, whose jump speed
+/// is 7 m/s, run speed 5 m/s and gravity 9.8 m/s^2, at one tile per meter.
+struct SNavParams {
+  float fJumpSpeed = 7.0f;  ///< Upward speed at takeoff.
+  float fRunSpeed = 5.0f;   ///< Top horizontal speed.
+  float fGravity = 9.8f;    ///< Downward acceleration.
+  int nHeight = 2;          ///< Clearance needed above the floor, in tiles.
+  int nMaxFall = 24;        ///< Longest drop or jump descent, in tiles.
+};
+
+/// \brief A directed link between two nodes.
+struct SNavEdge {
+  int nTo;          ///< Target node.
+  float fCost;      ///< Path length in tiles, never below the straight line.
+  eNavLink eLink;   ///< How to traverse it.
+};
+
+/// \brief A step along a path.
+struct SNavStep {
+  int nNode;        ///< Node reached.
+  eNavLink eLink;   ///< Link taken to reach it.
+};
+
+/// \brief The platformer navigation graph.
+///
+/// A node is an empty tile with a solid tile under it and enough empty tiles
+/// above it for an agent to stand. Nodes are joined by walk links to their
+/// neighbors on the same floor, drop links off the ends of floors and jump
+/// links found by tracing the arcs an agent can jump at a few horizontal
+/// speeds. Edges are stored compactly, each node's outgoing edges in one run
+/// of an array, so a search touches contiguous memory.
+///
+/// Nodes are also grouped into regions, the nodes of one 16x16 tile chunk
+/// that can reach each other without leaving it, and regions are joined by
+/// the links that cross between them. Searching this much smaller graph
+/// first gives a corridor of regions that bounds the search on the full
+/// graph, and proves a goal unreachable without touching the full graph.
+///
+/// Map coordinates match CTileManager, row 0 at the top. The graph only
+/// reads a tile array, so it does not depend on the renderer.
+class CNavGraph {
+ public:
+  static const int m_nChunkSize = 16;  ///< Region chunk size in tiles.
+
+ private:
+  /// \brief A cell visited by a jump arc, relative to the takeoff node.
+  struct SArcCell {
+    int nX;             ///< Column offset.
+    int nY;             ///< Row offset, positive is down.
+    bool bFalling;      ///< The arc is on its way down here.
+    float fLength;      ///< Arc length from takeoff in tiles.
+  };
+
+  SNavParams m_params;    ///< Movement limits.
+  int m_nWidth = 0;       ///< Map width in tiles.
+  int m_nHeight = 0;      ///< Map height in tiles.
+  int m_nChunksW = 0;     ///< Chunks across.
+
+  std::vector<int> m_vNodeAt;      ///< Node index by tile, or -1.
+  std::vector<int> m_vNodeX;       ///< Node column.
+  std::vector<int> m_vNodeY;       ///< Node row.
+  std::vector<int> m_vFirst;       ///< Edge run start by node, plus an end.
+  std::vector<SNavEdge> m_vEdges;  ///< Edges grouped by source node.
+
+  std::vector<int> m_vRegion;           ///< Region by node.
+  std::vector<float> m_vRegionX;        ///< Region centroid column.
+  std::vector<float> m_vRegionY;        ///< Region centroid row.
+  std::vector<int> m_vRegionFirst;      ///< Region edge run start, plus end.
+  std::vector<SNavEdge> m_vRegionEdges; ///< Region edges grouped by source.
+
+  std::vector<std::vector<SArcCell>> m_vArcs;  ///< Jump arc templates.
+
+  bool Solid(const char* tiles, int x, int y) const; ///< Solid or off-map side.
+  bool Clear(const char* tiles, int x, int y) const; ///< Room to stand.
+  void BuildArcs(); ///< Trace the jump arc templates.
+  void BuildEdges(const char* tiles); ///< Link the nodes.
+  void BuildRegions(); ///< Group nodes into regions.
+
+ public:
+  /// \brief Build the graph from a tile map.
+  /// \param tiles One character per tile, row major, '0' is empty
+  /// \param w Width in tiles
+  /// \param h Height in tiles
+  /// \param params Movement limits
+  void Build(const char* tiles, int w, int h,
+             const SNavParams& params = SNavParams());
+
+  /// \brief Find the node an agent standing at a tile would use.
+  /// \param x Column
+  /// \param y Row, 0 at the top
+  /// \return Node index, or -1 if there is no floor within the fall limit
+  int FindNode(int x, int y) const;
+
+  int GetNodeCount() const { return (int)m_vNodeX.size(); } ///< Node count.
+  int GetEdgeCount() const { return (int)m_vEdges.size(); } ///< Edge count.
+  int GetRegionCount() const { return (int)m_vRegionX.size(); } ///< Regions.
+  int GetWidth() const { return m_nWidth; } ///< Map width in tiles.
+  int GetHeight() const { return m_nHeight; } ///< Map height in tiles.
+
+  int GetNodeX(int n) const { return m_vNodeX[n]; } ///< Node column.
+  int GetNodeY(int n) const { return m_vNodeY[n]; } ///< Node row.
+  int GetRegion(int n) const { return m_vRegion[n]; } ///< Node's region.
+  float GetRegionX(int r) const { return m_vRegionX[r]; } ///< Centroid x.
+  float GetRegionY(int r) const { return m_vRegionY[r]; } ///< Centroid y.
+
+  /// \brief Get a node's outgoing edges.
+  const SNavEdge* EdgesBegin(int n) const {
+    return m_vEdges.data() + m_vFirst[n];
+  }
+
+  /// \brief Get the end of a node's outgoing edges.
+  const SNavEdge* EdgesEnd(int n) const {
+    return m_vEdges.data() + m_vFirst[n + 1];
+  }
+
+  /// \brief Get a region's outgoing edges.
+  const SNavEdge* RegionEdgesBegin(int r) const {
+    return m_vRegionEdges.data() + m_vRegionFirst[r];
+  }
+
+  /// \brief Get the end of a region's outgoing edges.
+  const SNavEdge* RegionEdgesEnd(int r) const {
+    return m_vRegionEdges.data() + m_vRegionFirst[r + 1];
+  }
+};
+
+#endif  //__L4RC_GAME_NAVGRAPH_H__
@@ -0,0 +1,165 @@
+/// \file NetSocket.cpp
+/// \brief Code for the UDP socket CUdpSocket.
+
+#include "NetSocket.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef int socklen_t;
+typedef SOCKET sock_t;
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int sock_t;
+#endif
+
+#ifdef _WIN32
+static int g_nSockets = 0; ///< Open sockets, Winsock runs while nonzero.
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// SNetAddress
+
+bool SNetAddress::Set(const char* host, uint16_t port) {
+  unsigned a, b, c, d;
+  char tail;
+  if (!host || sscanf(host, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 ||
+      a > 255 || b > 255 || c > 255 || d > 255)
+    return false;
+
+  nIp = a << 24 | b << 16 | c << 8 | d;
+  nPort = port;
+  return true;
+}
+
+std::string SNetAddress::ToString() const {
+  char s[32];
+  snprintf(s, sizeof(s), "%u.%u.%u.%u:%u", nIp >> 24, nIp >> 16 & 255,
+           nIp >> 8 & 255, nIp & 255, nPort);
+  return s;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CUdpSocket
+
+CUdpSocket::~CUdpSocket() { Close(); }
+
+/// Open a non-blocking UDP socket and bind it. The receive buffer is made
+/// large enough to hold a burst of packets from hundreds of clients between
+/// two frames, since a packet that does not fit is dropped.
+/// \param port Port, 0 for any free port
+/// \param loopback Accept packets from this machine only
+/// \return False if the socket could not be opened or bound
+
+bool CUdpSocket::Open(uint16_t port, bool loopback) {
+  Close();
+
+#ifdef _WIN32
+  if (g_nSockets == 0) {
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+  }
+  ++g_nSockets;
+  m_bStarted = true;
+  const SOCKET h = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  m_nSocket = h == INVALID_SOCKET ? -1 : (intptr_t)h;
+#else
+  m_nSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#endif
+
+  if (m_nSocket == -1) {
+    Close();
+    return false;
+  }
+
+  const sock_t s = (sock_t)m_nSocket;
+  const int buffer = 4 << 20;
+  setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&buffer,
+             sizeof(buffer));
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+
+  bool ok = bind(s, (const sockaddr*)&addr, sizeof(addr)) == 0;
+
+  socklen_t len = sizeof(addr);
+  ok = ok && getsockname(s, (sockaddr*)&addr, &len) == 0;
+  m_nPort = ntohs(addr.sin_port);
+
+#ifdef _WIN32
+  u_long nonblocking = 1;
+  ok = ok && ioctlsocket(s, FIONBIO, &nonblocking) == 0;
+#else
+  ok = ok && fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK) == 0;
+#endif
+
+  if (!ok) Close();
+  return ok;
+}
+
+void CUdpSocket::Close() {
+#ifdef _WIN32
+  if (m_nSocket != -1) closesocket((sock_t)m_nSocket);
+  if (m_bStarted && --g_nSockets == 0) WSACleanup();
+  m_bStarted = false;
+#else
+  if (m_nSocket != -1) close((sock_t)m_nSocket);
+#endif
+
+  m_nSocket = -1;
+  m_nPort = 0;
+}
+
+bool CUdpSocket::Send(const SNetAddress& to, const void* data, size_t size) {
+  if (m_nSocket == -1) return false;
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(to.nPort);
+  addr.sin_addr.s_addr = htonl(to.nIp);
+
+  return sendto((sock_t)m_nSocket, (const char*)data, (int)size, 0,
+                (const sockaddr*)&addr, sizeof(addr)) == (int)size;
+}
+
+/// Read one packet without blocking. Errors are treated as no packet, which
+/// includes the connection reset that Windows reports on a UDP socket when
+/// an earlier packet could not be delivered.
+/// \param data [out] Buffer
+/// \param size Buffer size in bytes
+/// \param from [out] Sender
+/// \return Packet size in bytes, 0 if there is none
+
+size_t CUdpSocket::Receive(void* data, size_t size, SNetAddress& from) {
+  if (m_nSocket == -1) return 0;
+
+  for (int tries = 0; tries < 8; ++tries) {  // skip errors, not packets
+    sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+    const int n = (int)recvfrom((sock_t)m_nSocket, (char*)data, (int)size, 0,
+                                (sockaddr*)&addr, &len);
+    if (n > 0) {
+      from.nIp = ntohl(addr.sin_addr.s_addr);
+      from.nPort = ntohs(addr.sin_port);
+      return (size_t)n;
+    }
+
+#ifdef _WIN32
+    if (n == 0 || WSAGetLastError() == WSAEWOULDBLOCK) return 0;
+#else
+    if (n == 0 || errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+#endif
+  }
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+/// \file NetSocket.h
+/// \brief Interface for the UDP socket CUdpSocket.
+
+#ifndef __L4RC_GAME_NETSOCKET_H__
+#define __L4RC_GAME_NETSOCKET_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// \brief An IPv4 address and port, both in host byte order.
+struct SNetAddress {
+  uint32_t nIp = 0;   ///< Address, 127.0.0.1 is 0x7f000001.
+  uint16_t nPort = 0; ///< Port.
+
+  bool operator==(const SNetAddress& x) const {
+    return nIp == x.nIp && nPort == x.nPort;
+  } ///< Same address and port.
+  bool operator!=(const SNetAddress& x) const { return !(*this == x); }
+
+  /// \brief Parse a dotted address such as "127.0.0.1".
+  /// \param host Address
+  /// \param port Port
+  /// \return False if it is not a dotted IPv4 address
+  bool Set(const char* host, uint16_t port);
+
+  std::string ToString() const; ///< As "127.0.0.1:27015".
+};
+
+/// \brief A non-blocking UDP socket.
+///
+/// The game sends a packet per client per tick and reads whatever has
+/// arrived once per frame, so the socket never blocks: `Receive()` returns
+/// at once when there is nothing to read. Winsock is started with the first
+/// socket and stopped with the last on Windows. Elsewhere these are BSD
+/// sockets, so the benchmarks run on any platform.
+class CUdpSocket {
+ private:
+  intptr_t m_nSocket = -1; ///< Socket handle, -1 if closed.
+  uint16_t m_nPort = 0;    ///< Port it is bound to.
+  bool m_bStarted = false; ///< Counted as a Winsock user, Windows only.
+
+ public:
+  CUdpSocket() = default; ///< Closed socket.
+  ~CUdpSocket(); ///< Close the socket.
+  CUdpSocket(const CUdpSocket&) = delete; ///< One owner per handle.
+  CUdpSocket& operator=(const CUdpSocket&) = delete; ///< One owner.
+
+  /// \brief Open the socket and bind it to a port.
+  /// \param port Port, 0 for any free port
+  /// \param loopback Accept packets from this machine only
+  /// \return False if the socket could not be opened or bound
+  bool Open(uint16_t port, bool loopback = false);
+
+  void Close(); ///< Close the socket, if open.
+  bool IsOpen() const { return m_nSocket != -1; } ///< Open check.
+  uint16_t GetPort() const { return m_nPort; } ///< Port bound to.
+
+  /// \brief Send a packet.
+  /// \param to Address to send to
+  /// \param data Packet
+  /// \param size Packet size in bytes
+  /// \return False if it was not sent
+  bool Send(const SNetAddress& to, const void* data, size_t size);
+
+  /// \brief Read the next packet that has arrived, if any.
+  /// \param data [out] Buffer
+  /// \param size Buffer size in bytes
+  /// \param from [out] Sender
+  /// \return Packet size in bytes, 0 if there is none
+  size_t Receive(void* data, size_t size, SNetAddress& from);
+};
+
+#endif  //__L4RC_GAME_NETSOCKET_H__
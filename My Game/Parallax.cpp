@@ -0,0 +1,39 @@
+/// \file Parallax.cpp
+/// \brief Code for the parallax background layers.
+
+#include "Parallax.h"
+
+#include <cmath>
+
+/// Copy `k` covers `origin + (k - 1/2) width` to `origin + (k + 1/2) width`,
+/// so the copy under any point is found by one division. The span runs from
+/// the copy under the left edge of the view to the copy under the right
+/// edge. Every center is worked out from its index rather than by adding the
+/// width to the last one, so neighbors meet exactly however far the camera
+/// has gone.
+/// \param layer Layer
+/// \param camX Camera x in pixels
+/// \param halfView Half the view width in pixels
+/// \return Span
+
+SParallaxSpan GetParallaxSpan(const SParallaxLayer& layer, float camX,
+                              float halfView) {
+  SParallaxSpan span;
+  span.fStep = layer.fWidth * layer.fXScale;
+  span.fOrigin = camX * (1.0f - layer.fXScroll) + layer.fXOffset;
+  if (span.fStep <= 0.0f || halfView < 0.0f) return span;
+
+  const float left = (camX - halfView - span.fOrigin) / span.fStep;
+  const float right = (camX + halfView - span.fOrigin) / span.fStep;
+  span.nFirst = (int)std::floor(left + 0.5f);
+  span.nCount = (int)std::floor(right + 0.5f) - span.nFirst + 1;
+  return span;
+}
+
+/// \param layer Layer
+/// \param camY Camera y in pixels
+/// \return Center y
+
+float GetParallaxY(const SParallaxLayer& layer, float camY) {
+  return camY * (1.0f - layer.fYScroll) + layer.fYOffset;
+}
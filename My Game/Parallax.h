@@ -0,0 +1,56 @@
+/// \file Parallax.h
+/// \brief Interface for the parallax background layers.
+
+#ifndef __L4RC_GAME_PARALLAX_H__
+#define __L4RC_GAME_PARALLAX_H__
+
+#include <cstdint>
+
+/// \brief A background image repeated across the view, scrolling slower than
+/// the world.
+///
+/// Copy `k` of a layer is centered at `x = origin + k * width`, where the
+/// origin follows the camera by `1 - scroll`. A scroll of 0 keeps the layer
+/// fixed to the screen and 1 fixes it in the world, with the far layers
+/// somewhere in between. Vertically the layer is a single row, placed the
+/// same way. Layers are read from the parallax tag in gamesettings.xml.
+struct SParallaxLayer {
+  uint32_t nSprite = 0;   ///< Sprite index.
+  uint32_t nLayer = 0;    ///< Sprite layer index.
+  float fWidth = 1.0f;    ///< Image width in pixels, unscaled.
+  float fXScale = 1.0f;   ///< Horizontal scale.
+  float fYScale = 1.0f;   ///< Vertical scale.
+  float fXScroll = 0.0f;  ///< Horizontal scroll factor.
+  float fYScroll = 0.0f;  ///< Vertical scroll factor.
+  float fXOffset = 0.0f;  ///< Horizontal offset of copy 0 in pixels.
+  float fYOffset = 0.0f;  ///< Vertical offset in pixels.
+};
+
+/// \brief The copies of a layer that overlap the view.
+struct SParallaxSpan {
+  int nFirst = 0;        ///< Index of the leftmost copy.
+  int nCount = 0;        ///< Number of copies.
+  float fOrigin = 0.0f;  ///< Center of copy 0.
+  float fStep = 0.0f;    ///< Distance between copy centers.
+
+  /// \brief Get the center of a copy.
+  /// \param k Copy index
+  /// \return Center x
+  float GetX(int k) const { return fOrigin + (float)k * fStep; }
+};
+
+/// \brief Get the copies of a layer in view, without stepping across it.
+/// \param layer Layer
+/// \param camX Camera x in pixels
+/// \param halfView Half the view width in pixels
+/// \return Span
+SParallaxSpan GetParallaxSpan(const SParallaxLayer& layer, float camX,
+                              float halfView);
+
+/// \brief Get the center y of a layer.
+/// \param layer Layer
+/// \param camY Camera y in pixels
+/// \return Center y
+float GetParallaxY(const SParallaxLayer& layer, float camY);
+
+#endif  //__L4RC_GAME_PARALLAX_H__
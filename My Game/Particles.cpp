@@ -0,0 +1,149 @@
+/// \file Particles.cpp
+/// \brief Code for the particle pool CParticles.
+
+#include "Particles.h"
+
+#include <cmath>
+
+#include "SimdKernels.h"
+
+/// One step of a 32 bit xorshift, made into a float from its top 24 bits.
+/// Particles are only for show, so they have a generator of their own and
+/// never touch the simulation's.
+/// \return Uniform in [0, 1)
+
+float CParticles::Random() {
+  m_nRandom ^= m_nRandom << 13;
+  m_nRandom ^= m_nRandom >> 17;
+  m_nRandom ^= m_nRandom << 5;
+  return (m_nRandom >> 8) * (1.0f / 16777216.0f);
+}
+
+/// \param emitters Emitters
+
+void CParticles::SetEmitters(const std::vector<SParticleEmitter>& emitters) {
+  m_vEmitters = emitters;
+  m_vBase.resize(emitters.size());
+  m_vCount.assign(emitters.size(), 0);
+
+  uint32_t total = 0;
+  for (size_t e = 0; e < emitters.size(); ++e) {
+    m_vBase[e] = total;
+    total += emitters[e].nMax;
+  }
+
+  m_vX.assign(total, 0.0f);
+  m_vY.assign(total, 0.0f);
+  m_vVX.assign(total, 0.0f);
+  m_vVY.assign(total, 0.0f);
+  m_vLife.assign(total, 0.0f);
+  m_vInvLife.assign(total, 0.0f);
+}  // SetEmitters
+
+void CParticles::Clear() {
+  m_vCount.assign(m_vCount.size(), 0);
+}
+
+/// \param name Emitter name
+/// \return Emitter index, or -1 if there is no such emitter
+
+int CParticles::Find(const char* name) const {
+  for (size_t e = 0; e < m_vEmitters.size(); ++e)
+    if (name && m_vEmitters[e].strName == name) return (int)e;
+  return -1;
+}
+
+/// \param e Emitter index
+/// \param x Position x in pixels
+/// \param y Position y in pixels
+/// \return Number of particles emitted
+
+uint32_t CParticles::Emit(uint32_t e, float x, float y) {
+  const SParticleEmitter& em = m_vEmitters[e];
+  return Emit(e, x, y, em.fAngle, em.nCount);
+}
+
+/// Add particles to the end of the emitter's slab, each heading somewhere
+/// in the cone around the direction at a speed and for a life picked at
+/// random from the emitter's ranges.
+/// \param e Emitter index
+/// \param x Position x in pixels
+/// \param y Position y in pixels
+/// \param angle Direction in radians, 0 along x, y up
+/// \param count Particles in the burst
+/// \return Number of particles emitted, fewer if the slab filled up
+
+uint32_t CParticles::Emit(uint32_t e, float x, float y, float angle,
+                          uint32_t count) {
+  const SParticleEmitter& em = m_vEmitters[e];
+  const uint32_t room = em.nMax - m_vCount[e];
+  if (count > room) count = room;
+
+  uint32_t i = m_vBase[e] + m_vCount[e];
+  for (uint32_t k = 0; k < count; ++k, ++i) {
+    const float a = angle + (Random() - 0.5f) * em.fSpread;
+    const float speed =
+        em.fSpeedMin + Random() * (em.fSpeedMax - em.fSpeedMin);
+    const float life = em.fLifeMin + Random() * (em.fLifeMax - em.fLifeMin);
+
+    m_vX[i] = x;
+    m_vY[i] = y;
+    m_vVX[i] = std::cos(a) * speed;
+    m_vVY[i] = std::sin(a) * speed;
+    m_vLife[i] = life > 0.0f ? life : 1e-3f;
+    m_vInvLife[i] = 1.0f / m_vLife[i];
+  }
+
+  m_vCount[e] += count;
+  return count;
+}  // Emit
+
+/// Fill each expired slot with the slab's last particle, which may itself
+/// have expired, so the slot is looked at again.
+/// \param e Emitter index
+
+void CParticles::Compact(uint32_t e) {
+  const uint32_t base = m_vBase[e];
+  uint32_t n = m_vCount[e];
+
+  for (uint32_t k = 0; k < n;) {
+    const uint32_t i = base + k;
+    if (m_vLife[i] > 0.0f) {
+      ++k;
+      continue;
+    }
+
+    const uint32_t j = base + --n;
+    m_vX[i] = m_vX[j];
+    m_vY[i] = m_vY[j];
+    m_vVX[i] = m_vVX[j];
+    m_vVY[i] = m_vVY[j];
+    m_vLife[i] = m_vLife[j];
+    m_vInvLife[i] = m_vInvLife[j];
+  }
+
+  m_vCount[e] = n;
+}  // Compact
+
+/// Each slab has one gravity, so it is one kernel pass over its live
+/// particles, and a compaction only if any of them died.
+/// \param dt Frame time in seconds
+
+void CParticles::Update(float dt) {
+  for (uint32_t e = 0; e < (uint32_t)m_vEmitters.size(); ++e) {
+    const uint32_t b = m_vBase[e], n = m_vCount[e];
+    if (n == 0) continue;
+
+    if (SimdIntegrateAge(&m_vX[b], &m_vY[b], &m_vVX[b], &m_vVY[b],
+                         &m_vLife[b], n, m_vEmitters[e].fGravity, dt) > 0)
+      Compact(e);
+  }
+}  // Update
+
+/// \return Live particles in every slab
+
+size_t CParticles::GetCount() const {
+  size_t n = 0;
+  for (uint32_t c : m_vCount) n += c;
+  return n;
+}
@@ -0,0 +1,109 @@
+/// \file Particles.h
+/// \brief Interface for the particle pool CParticles.
+
+#ifndef __L4RC_GAME_PARTICLES_H__
+#define __L4RC_GAME_PARTICLES_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// \brief How an emitter's particles start out and behave.
+struct SParticleEmitter {
+  std::string strName;      ///< Name in gamesettings.xml.
+  uint32_t nSprite = 0;     ///< Sprite index.
+  uint32_t nMax = 1024;     ///< Particles alive at once, its part of the pool.
+  uint32_t nCount = 8;      ///< Particles per burst.
+  float fAngle = 1.5708f;   ///< Direction in radians, 0 along x, y up.
+  float fSpread = 6.2832f;  ///< Width of the cone around it in radians.
+  float fSpeedMin = 50.0f;  ///< Slowest start, pixels per second.
+  float fSpeedMax = 150.0f; ///< Fastest start, pixels per second.
+  float fLifeMin = 0.3f;    ///< Shortest life in seconds.
+  float fLifeMax = 0.6f;    ///< Longest life in seconds.
+  float fGravity = -400.0f; ///< Acceleration along y, pixels per second^2.
+  float fSize = 1.0f;       ///< Scale at birth.
+  float fEndSize = 0.0f;    ///< Scale at death.
+  float fRed = 1.0f;        ///< Tint red.
+  float fGreen = 1.0f;      ///< Tint green.
+  float fBlue = 1.0f;       ///< Tint blue.
+};
+
+/// \brief A fixed pool of particles, one array per field.
+///
+/// The pool is allocated once, when the emitters are set, and split into
+/// one contiguous slab per emitter, sized by the emitter's maximum. A slab's
+/// live particles are packed at its start, so `Update()` moves them under
+/// the emitter's gravity and counts down their lives in one pass with
+/// SimdIntegrateAge(), which also says how many died. Only then are the
+/// lives looked at one by one, and a dead particle is replaced by the
+/// slab's last live one. Emitting into a full slab drops the rest of the
+/// burst, so nothing is allocated once the game is running. Since every
+/// particle in a slab has the same sprite, a slab is drawn as one run.
+class CParticles {
+ private:
+  std::vector<SParticleEmitter> m_vEmitters; ///< Emitters, in the order set.
+  std::vector<uint32_t> m_vBase;   ///< First slot of each emitter's slab.
+  std::vector<uint32_t> m_vCount;  ///< Live particles in each slab.
+
+  std::vector<float> m_vX;         ///< Positions x in pixels.
+  std::vector<float> m_vY;         ///< Positions y in pixels.
+  std::vector<float> m_vVX;        ///< Velocities x.
+  std::vector<float> m_vVY;        ///< Velocities y.
+  std::vector<float> m_vLife;      ///< Seconds left.
+  std::vector<float> m_vInvLife;   ///< 1 over the life it was born with.
+
+  uint32_t m_nRandom = 0x9E3779B9; ///< Xorshift state.
+
+  float Random(); ///< Uniform in [0, 1).
+  void Compact(uint32_t e); ///< Remove a slab's expired particles.
+
+ public:
+  /// \brief Set the emitters, allocating the pool and emptying it.
+  /// \param emitters Emitters
+  void SetEmitters(const std::vector<SParticleEmitter>& emitters);
+
+  void Clear(); ///< Kill every particle.
+
+  /// \brief Find an emitter by name.
+  /// \param name Emitter name
+  /// \return Emitter index, or -1 if there is no such emitter
+  int Find(const char* name) const;
+
+  /// \brief Emit a burst in the emitter's own direction.
+  /// \param e Emitter index
+  /// \param x Position x in pixels
+  /// \param y Position y in pixels
+  /// \return Number of particles emitted
+  uint32_t Emit(uint32_t e, float x, float y);
+
+  /// \brief Emit a burst in a given direction.
+  /// \param e Emitter index
+  /// \param x Position x in pixels
+  /// \param y Position y in pixels
+  /// \param angle Direction in radians, 0 along x, y up
+  /// \param count Particles in the burst
+  /// \return Number of particles emitted
+  uint32_t Emit(uint32_t e, float x, float y, float angle, uint32_t count);
+
+  /// \brief Move every particle and remove the ones that died.
+  /// \param dt Frame time in seconds
+  void Update(float dt);
+
+  size_t GetEmitterCount() const { return m_vEmitters.size(); } ///< Emitters.
+  size_t GetCapacity() const { return m_vX.size(); } ///< Pool size.
+  size_t GetCount() const; ///< Live particles.
+
+  /// \brief Get an emitter.
+  const SParticleEmitter& GetEmitter(uint32_t e) const {
+    return m_vEmitters[e];
+  }
+
+  uint32_t GetBase(uint32_t e) const { return m_vBase[e]; } ///< Slab start.
+  uint32_t GetCount(uint32_t e) const { return m_vCount[e]; } ///< Live.
+  const float* GetX() const { return m_vX.data(); } ///< Positions x.
+  const float* GetY() const { return m_vY.data(); } ///< Positions y.
+  const float* GetLife() const { return m_vLife.data(); } ///< Seconds left.
+  const float* GetInvLife() const { return m_vInvLife.data(); } ///< 1/life.
+};
+
+#endif  //__L4RC_GAME_PARTICLES_H__
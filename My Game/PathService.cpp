@@ -0,0 +1,330 @@
+/// \file PathService.cpp
+/// \brief Code for the batched path finder CPathService.
+
+#include "PathService.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+/// Constructor.
+/// \param pGraph Graph to search
+
+CPathService::CPathService(const CNavGraph* pGraph) : m_pGraph(pGraph) {}
+
+/// Queue a request. Nothing is searched until `Dispatch()`.
+/// \param start Start node
+/// \param goal Goal node
+/// \return Ticket
+
+int CPathService::Request(int start, int goal) {
+  m_vPending.push_back({start, goal});
+  return (int)m_vPending.size() - 1;
+}
+
+/// Answer what can be answered at once, from the cache or from another
+/// request in the same batch, and hand the rest to as many jobs as there are
+/// threads. Each job takes the next unanswered request until none are left,
+/// so long searches do not hold up a whole slice of the batch.
+/// \param pJobs Job system
+
+void CPathService::Dispatch(CJobSystem* pJobs) {
+  if (m_bBusy) return;
+
+  m_vBatch.swap(m_vPending);
+  m_vPending.clear();
+
+  const int n = (int)m_vBatch.size();
+  m_vWorking.resize(n);
+  m_vSameAs.assign(n, -1);
+  m_vSearchList.clear();
+  m_mapBatch.clear();
+
+  for (int i = 0; i < n; ++i) {
+    const SQuery& q = m_vBatch[i];
+    const uint64_t key = Key(q.nStart, q.nGoal);
+    SPathResult& result = m_vWorking[i];
+    m_nQueries++;
+
+    const auto hit = m_mapCache.find(key);
+    if (hit != m_mapCache.end()) {
+      const SCacheRef& ref = hit->second;
+      result.bFound = ref.nPath >= 0;
+      result.vSteps.clear();
+      if (result.bFound) {
+        const std::vector<SNavStep>& path = m_vCachePaths[ref.nPath];
+        result.vSteps.assign(path.begin() + ref.nOffset, path.end());
+        result.vSteps[0].eLink = eNavLink::Walk;
+      }
+      m_nCacheHits++;
+      continue;
+    }
+
+    const auto first = m_mapBatch.insert({key, i});
+    if (!first.second) m_vSameAs[i] = first.first->second;
+    else m_vSearchList.push_back(i);
+  }
+
+  const int jobs =
+      std::min((int)pJobs->GetThreadCount(), (int)m_vSearchList.size());
+  if (jobs == 0) {
+    m_bBusy = true;  // nothing to search, but Collect() still publishes
+    return;
+  }
+
+  if ((int)m_vSearch.size() < jobs) m_vSearch.resize(jobs);
+
+  const int nodes = m_pGraph->GetNodeCount();
+  const int regions = m_pGraph->GetRegionCount();
+
+  for (SSearch& s : m_vSearch) {
+    if ((int)s.vCost.size() != nodes) {
+      s.vCost.assign(nodes, 0.0f);
+      s.vParent.assign(nodes, -1);
+      s.vLink.assign(nodes, eNavLink::Walk);
+      s.vStamp.assign(nodes, 0);
+      s.nStamp = 0;
+    }
+
+    if ((int)s.vRegionCost.size() != regions) {
+      s.vRegionCost.assign(regions, 0.0f);
+      s.vRegionParent.assign(regions, -1);
+      s.vRegionStamp.assign(regions, 0);
+      s.vCorridor.assign(regions, 0);
+      s.nRegionStamp = 0;
+    }
+  }
+
+  m_nNext = 0;
+  m_jobs.Clear();
+
+  for (int j = 0; j < jobs; ++j)
+    m_jobs.Add([this, j]() {
+      const auto t0 = std::chrono::high_resolution_clock::now();
+      SSearch& s = m_vSearch[j];
+
+      for (int k = m_nNext++; k < (int)m_vSearchList.size(); k = m_nNext++) {
+        const int ticket = m_vSearchList[k];
+        Solve(s, m_vBatch[ticket], m_vWorking[ticket]);
+      }
+
+      const auto t1 = std::chrono::high_resolution_clock::now();
+      s.fTime = std::chrono::duration<float, std::milli>(t1 - t0).count();
+    });
+
+  m_jobs.Start(pJobs);
+  m_bBusy = true;
+}
+
+/// Wait for the jobs, copy results to the duplicate requests, enter the new
+/// paths in the cache and make the results visible to `GetResult()`.
+/// \param pJobs Job system
+
+void CPathService::Collect(CJobSystem* pJobs) {
+  if (!m_bBusy) return;
+
+  m_jobs.Wait(pJobs);
+  m_bBusy = false;
+
+  m_fSearchTime = 0.0f;
+  for (SSearch& s : m_vSearch) {
+    m_fSearchTime += s.fTime;
+    m_nExpanded += s.nExpanded;
+    s.fTime = 0.0f;
+    s.nExpanded = 0;
+  }
+
+  m_nSearches += m_vSearchList.size();
+
+  for (int i = 0; i < (int)m_vSameAs.size(); ++i)
+    if (m_vSameAs[i] >= 0) m_vWorking[i] = m_vWorking[m_vSameAs[i]];
+
+  for (int ticket : m_vSearchList)
+    CacheInsert(m_vBatch[ticket], m_vWorking[ticket]);
+
+  m_vResults.swap(m_vWorking);
+}
+
+/// Forget every cached path.
+
+void CPathService::Invalidate() {
+  m_mapCache.clear();
+  m_vCachePaths.clear();
+}
+
+/// Enter a search result in the cache. A path is entered once for every node
+/// along it, and an unreachable goal is entered for the start node only.
+/// \param q Query
+/// \param result Its result
+
+void CPathService::CacheInsert(const SQuery& q, const SPathResult& result) {
+  if (m_mapCache.size() + result.vSteps.size() > m_nCacheLimit) Invalidate();
+
+  if (!result.bFound) {
+    m_mapCache[Key(q.nStart, q.nGoal)] = {-1, 0};
+    return;
+  }
+
+  const int path = (int)m_vCachePaths.size();
+  m_vCachePaths.push_back(result.vSteps);
+
+  for (int i = 0; i < (int)result.vSteps.size(); ++i)
+    m_mapCache.insert({Key(result.vSteps[i].nNode, q.nGoal), {path, i}});
+}
+
+/// A* over the region graph. On success the regions along the path, and the
+/// regions they link to, are stamped as the corridor for `SearchNodes()`.
+/// Region links cost the distance between centroids, so the straight line
+/// distance is a consistent heuristic.
+/// \param s Search memory
+/// \param start Start node
+/// \param goal Goal node
+/// \return False if the goal's region cannot be reached
+
+bool CPathService::SearchRegions(SSearch& s, int start, int goal) {
+  const CNavGraph& g = *m_pGraph;
+  const int from = g.GetRegion(start);
+  const int to = g.GetRegion(goal);
+  const uint32_t stamp = ++s.nRegionStamp;
+  const float gx = g.GetRegionX(to), gy = g.GetRegionY(to);
+
+  auto h = [&](int r) {
+    const float dx = g.GetRegionX(r) - gx, dy = g.GetRegionY(r) - gy;
+    return std::sqrt(dx * dx + dy * dy);
+  };
+
+  std::vector<std::pair<float, int>>& heap = s.vHeap;
+  const std::greater<std::pair<float, int>> later;
+  heap.clear();
+
+  s.vRegionCost[from] = 0.0f;
+  s.vRegionParent[from] = -1;
+  s.vRegionStamp[from] = stamp;
+  heap.push_back({h(from), from});
+
+  bool found = false;
+
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), later);
+    const std::pair<float, int> top = heap.back();
+    heap.pop_back();
+
+    const int r = top.second;
+    if (top.first - h(r) > s.vRegionCost[r] + 1e-3f) continue;  // stale
+    if (r == to) {
+      found = true;
+      break;
+    }
+
+    for (const SNavEdge* e = g.RegionEdgesBegin(r); e != g.RegionEdgesEnd(r);
+         ++e) {
+      const float cost = s.vRegionCost[r] + e->fCost;
+      if (s.vRegionStamp[e->nTo] != stamp || cost < s.vRegionCost[e->nTo]) {
+        s.vRegionStamp[e->nTo] = stamp;
+        s.vRegionCost[e->nTo] = cost;
+        s.vRegionParent[e->nTo] = r;
+        heap.push_back({cost + h(e->nTo), e->nTo});
+        std::push_heap(heap.begin(), heap.end(), later);
+      }
+    }
+  }
+
+  if (!found) return false;
+
+  for (int r = to; r >= 0; r = s.vRegionParent[r]) {
+    s.vCorridor[r] = stamp;
+    for (const SNavEdge* e = g.RegionEdgesBegin(r); e != g.RegionEdgesEnd(r);
+         ++e)
+      s.vCorridor[e->nTo] = stamp;
+  }
+
+  return true;
+}
+
+/// A* over the nodes, with the straight line distance as the heuristic. Link
+/// costs are never below the straight line between their ends, so it never
+/// overestimates.
+/// \param s Search memory
+/// \param start Start node
+/// \param goal Goal node
+/// \param corridor Only visit nodes in the corridor of the last region search
+/// \return True if the goal was reached
+
+bool CPathService::SearchNodes(SSearch& s, int start, int goal,
+                               bool corridor) {
+  const CNavGraph& g = *m_pGraph;
+  const uint32_t stamp = ++s.nStamp;
+  const float gx = (float)g.GetNodeX(goal), gy = (float)g.GetNodeY(goal);
+
+  auto h = [&](int n) {
+    const float dx = g.GetNodeX(n) - gx, dy = g.GetNodeY(n) - gy;
+    return std::sqrt(dx * dx + dy * dy);
+  };
+
+  std::vector<std::pair<float, int>>& heap = s.vHeap;
+  const std::greater<std::pair<float, int>> later;
+  heap.clear();
+
+  s.vCost[start] = 0.0f;
+  s.vParent[start] = -1;
+  s.vLink[start] = eNavLink::Walk;
+  s.vStamp[start] = stamp;
+  heap.push_back({h(start), start});
+
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), later);
+    const std::pair<float, int> top = heap.back();
+    heap.pop_back();
+
+    const int n = top.second;
+    if (top.first - h(n) > s.vCost[n] + 1e-3f) continue;  // stale
+    if (n == goal) return true;
+    s.nExpanded++;
+
+    for (const SNavEdge* e = g.EdgesBegin(n); e != g.EdgesEnd(n); ++e) {
+      if (corridor && s.vCorridor[g.GetRegion(e->nTo)] != s.nRegionStamp)
+        continue;
+
+      const float cost = s.vCost[n] + e->fCost;
+      if (s.vStamp[e->nTo] != stamp || cost < s.vCost[e->nTo]) {
+        s.vStamp[e->nTo] = stamp;
+        s.vCost[e->nTo] = cost;
+        s.vParent[e->nTo] = n;
+        s.vLink[e->nTo] = e->eLink;
+        heap.push_back({cost + h(e->nTo), e->nTo});
+        std::push_heap(heap.begin(), heap.end(), later);
+      }
+    }
+  }
+
+  return false;
+}
+
+/// Answer one query, searching the corridor first and the whole graph only
+/// if the corridor has no path.
+/// \param s Search memory
+/// \param q Query
+/// \param result [out] Path
+
+void CPathService::Solve(SSearch& s, const SQuery& q, SPathResult& result) {
+  result.bFound = false;
+  result.vSteps.clear();
+
+  const int nodes = m_pGraph->GetNodeCount();
+  if (q.nStart < 0 || q.nGoal < 0 || q.nStart >= nodes || q.nGoal >= nodes)
+    return;
+
+  if (q.nStart != q.nGoal) {
+    if (!SearchRegions(s, q.nStart, q.nGoal)) return;
+    if (!SearchNodes(s, q.nStart, q.nGoal, true) &&
+        !SearchNodes(s, q.nStart, q.nGoal, false))
+      return;  // the corridor always has a path, this is a safety net
+
+    for (int n = q.nGoal; n != q.nStart; n = s.vParent[n])
+      result.vSteps.push_back({n, s.vLink[n]});
+  }
+
+  result.vSteps.push_back({q.nStart, eNavLink::Walk});
+  std::reverse(result.vSteps.begin(), result.vSteps.end());
+  result.bFound = true;
+}
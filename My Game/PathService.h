@@ -0,0 +1,145 @@
+/// \file PathService.h
+/// \brief Interface for the batched path finder CPathService.
+
+#ifndef __L4RC_GAME_PATHSERVICE_H__
+#define __L4RC_GAME_PATHSERVICE_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "JobSystem.h"
+#include "NavGraph.h"
+
+/// \brief The answer to a path request.
+struct SPathResult {
+  bool bFound = false;            ///< Whether the goal can be reached.
+  std::vector<SNavStep> vSteps;   ///< Nodes from start to goal, inclusive.
+};
+
+/// \brief The batched path finder.
+///
+/// Path requests are queued during a frame with `Request()`, which returns a
+/// ticket. `Dispatch()` hands the queued requests to the job system as one
+/// batch and returns at once, and `Collect()` waits for the batch, usually
+/// finished by then, after which `GetResult()` gives the path for each
+/// ticket. Requests made while a batch is in flight go in the next one.
+///
+/// Each search is A* over the region graph first, which either proves the
+/// goal unreachable or gives a corridor of regions, and then A* over the
+/// nodes of that corridor and the regions next to it. Only if that fails
+/// does the node search run unrestricted. Requests in a batch with the same
+/// start and goal are searched once.
+///
+/// Every path found is cached by goal, and each node along it is entered as
+/// a start, with the rest of the path as its answer. A search kept to a
+/// corridor finds the shortest path inside it, which is not always the
+/// shortest on the whole graph, so a cached answer is a good path to the
+/// goal but not always the shortest. A crowd of agents chasing one target
+/// mostly stand on or near paths that were already found, so most of their
+/// requests are answered by a lookup.
+/// The cache is flushed when the graph changes or it grows too large.
+class CPathService {
+ private:
+  /// \brief A queued request.
+  struct SQuery {
+    int nStart;  ///< Start node.
+    int nGoal;   ///< Goal node.
+  };
+
+  /// \brief Where a cached path starts for a given node and goal.
+  struct SCacheRef {
+    int nPath;    ///< Index into m_vCachePaths, -1 for no path.
+    int nOffset;  ///< Step within that path.
+  };
+
+  /// \brief Per-job search memory, reused from query to query.
+  ///
+  /// Stamps mark which entries belong to the current search, so nothing has
+  /// to be cleared between searches.
+  struct SSearch {
+    std::vector<float> vCost;         ///< Best cost so far, by node.
+    std::vector<int> vParent;         ///< Node it was reached from.
+    std::vector<eNavLink> vLink;      ///< Link it was reached by.
+    std::vector<uint32_t> vStamp;     ///< Search that set the above.
+    std::vector<uint32_t> vCorridor;  ///< Search whose corridor has a region.
+    std::vector<float> vRegionCost;   ///< Best cost so far, by region.
+    std::vector<int> vRegionParent;   ///< Region it was reached from.
+    std::vector<uint32_t> vRegionStamp; ///< Search that set the above.
+    std::vector<std::pair<float, int>> vHeap; ///< Open list.
+    uint32_t nStamp = 0;              ///< Current node search.
+    uint32_t nRegionStamp = 0;        ///< Current region search.
+    uint64_t nExpanded = 0;           ///< Nodes expanded, for statistics.
+    float fTime = 0.0f;               ///< Time spent this batch in ms.
+  };
+
+  const CNavGraph* m_pGraph = nullptr;  ///< Graph to search.
+
+  std::vector<SQuery> m_vPending;       ///< Queued for the next batch.
+  std::vector<SQuery> m_vBatch;         ///< Batch in flight.
+  std::vector<int> m_vSearchList;       ///< Batch tickets that need a search.
+  std::vector<int> m_vSameAs;           ///< Earlier ticket with same query.
+  std::unordered_map<uint64_t, int> m_mapBatch; ///< First ticket by query.
+  std::vector<SPathResult> m_vWorking;  ///< Results being filled in.
+  std::vector<SPathResult> m_vResults;  ///< Results of the last batch.
+  std::vector<SSearch> m_vSearch;       ///< One per job.
+  std::atomic<int> m_nNext{0};          ///< Next entry of m_vSearchList.
+  CTaskGraph m_jobs;                    ///< Jobs of the batch in flight.
+  bool m_bBusy = false;                 ///< A batch is in flight.
+
+  std::unordered_map<uint64_t, SCacheRef> m_mapCache; ///< Path by start, goal.
+  std::vector<std::vector<SNavStep>> m_vCachePaths;   ///< Cached paths.
+  size_t m_nCacheLimit = 1 << 20;       ///< Entries before a flush.
+
+  uint64_t m_nQueries = 0;    ///< Requests answered.
+  uint64_t m_nCacheHits = 0;  ///< Requests answered from the cache.
+  uint64_t m_nSearches = 0;   ///< Searches run.
+  uint64_t m_nExpanded = 0;   ///< Nodes expanded by all searches.
+  float m_fSearchTime = 0.0f; ///< Thread time of the last batch in ms.
+
+  bool SearchRegions(SSearch& s, int start, int goal); ///< Find a corridor.
+  bool SearchNodes(SSearch& s, int start, int goal, bool corridor); ///< A*.
+  void Solve(SSearch& s, const SQuery& q, SPathResult& result); ///< One query.
+  void CacheInsert(const SQuery& q, const SPathResult& result); ///< Remember.
+  static uint64_t Key(int node, int goal) {
+    return (uint64_t)(uint32_t)node << 32 | (uint32_t)goal;
+  } ///< Cache key.
+
+ public:
+  /// \brief Constructor.
+  /// \param pGraph Graph to search, which must outlive this
+  CPathService(const CNavGraph* pGraph);
+
+  /// \brief Queue a path request for the next batch.
+  /// \param start Start node
+  /// \param goal Goal node
+  /// \return Ticket for `GetResult()` once the batch is collected
+  int Request(int start, int goal);
+
+  /// \brief Start searching the queued requests on the job system.
+  /// \param pJobs Job system
+  void Dispatch(CJobSystem* pJobs);
+
+  /// \brief Wait for the batch in flight and publish its results.
+  /// \param pJobs Job system, which the calling thread helps out
+  void Collect(CJobSystem* pJobs);
+
+  /// \brief Get a result of the last collected batch.
+  /// \param ticket Ticket returned by `Request()`
+  const SPathResult& GetResult(int ticket) const { return m_vResults[ticket]; }
+
+  /// \brief Forget every cached path, for when the graph has changed.
+  /// Collect any batch in flight before changing the graph.
+  void Invalidate();
+
+  bool IsBusy() const { return m_bBusy; } ///< A batch is in flight.
+  uint64_t GetQueryCount() const { return m_nQueries; } ///< Requests.
+  uint64_t GetCacheHits() const { return m_nCacheHits; } ///< Cache hits.
+  uint64_t GetSearchCount() const { return m_nSearches; } ///< Searches.
+  uint64_t GetExpandedCount() const { return m_nExpanded; } ///< Expansions.
+  float GetSearchTime() const { return m_fSearchTime; } ///< Last batch, ms.
+};
+
+#endif  //__L4RC_GAME_PATHSERVICE_H__
@@ -0,0 +1,82 @@
+/// \file PickupGrid.cpp
+/// \brief Code for the pickup grid CPickupGrid.
+
+#include "PickupGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+int CPickupGrid::CellX(float x) const {
+  return std::max(0, std::min(m_nW - 1, (int)std::floor(x / m_fCell)));
+}
+
+int CPickupGrid::CellY(float y) const {
+  return std::max(0, std::min(m_nH - 1, (int)std::floor(y / m_fCell)));
+}
+
+void CPickupGrid::Reset(float cell, int w, int h) {
+  m_fCell = std::max(cell, 1.0f);
+  m_nW = std::max(w, 1);
+  m_nH = std::max(h, 1);
+  m_vStart.clear();
+  m_vIndex.clear();
+  m_vXY.clear();
+}
+
+/// Counting sort of the points by cell: count each cell, turn the counts
+/// into start indices, and place each point at its cell's next index.
+/// \param xy Point x and y, interleaved
+/// \param n Number of points
+
+void CPickupGrid::Build(const float* xy, size_t n) {
+  const size_t cells = (size_t)m_nW * m_nH;
+  m_vStart.assign(cells + 1, 0);
+  m_vCell.resize(n);
+  m_vIndex.resize(n);
+  m_vXY.resize(2 * n);
+
+  for (size_t i = 0; i < n; ++i) {
+    const uint32_t c = CellY(xy[2 * i + 1]) * m_nW + CellX(xy[2 * i]);
+    m_vCell[i] = c;
+    m_vStart[c + 1]++;
+  }
+
+  for (size_t c = 1; c <= cells; ++c) m_vStart[c] += m_vStart[c - 1];
+
+  for (size_t i = 0; i < n; ++i) {
+    const uint32_t k = m_vStart[m_vCell[i]]++;
+    m_vIndex[k] = (uint32_t)i;
+    m_vXY[2 * k] = xy[2 * i];
+    m_vXY[2 * k + 1] = xy[2 * i + 1];
+  }
+
+  for (size_t c = cells; c > 0; --c) m_vStart[c] = m_vStart[c - 1];
+  m_vStart[0] = 0;
+}  // Build
+
+/// Look in the cell under the point and the eight around it. Since the
+/// reach is no more than a cell, nothing further away can be in reach.
+/// Clamping keeps neighbors neighbors, so this holds off the grid too.
+/// \param x Point x
+/// \param y Point y
+/// \param reach Distance, no more than the cell size
+/// \param out [out] Input indices, appended
+
+void CPickupGrid::Query(float x, float y, float reach,
+                        std::vector<uint32_t>& out) const {
+  if (m_vIndex.empty()) return;
+
+  const int cx = CellX(x), cy = CellY(y);
+  const int x0 = std::max(0, cx - 1), x1 = std::min(m_nW - 1, cx + 1);
+  const int y0 = std::max(0, cy - 1), y1 = std::min(m_nH - 1, cy + 1);
+  const float r2 = reach * reach;
+
+  for (int j = y0; j <= y1; ++j) {
+    const size_t row = (size_t)j * m_nW;
+    for (uint32_t k = m_vStart[row + x0]; k < m_vStart[row + x1 + 1]; ++k) {
+      const float dx = m_vXY[2 * k] - x;
+      const float dy = m_vXY[2 * k + 1] - y;
+      if (dx * dx + dy * dy <= r2) out.push_back(m_vIndex[k]);
+    }
+  }
+}  // Query
@@ -0,0 +1,58 @@
+/// \file PickupGrid.h
+/// \brief Interface for the pickup grid CPickupGrid.
+
+#ifndef __L4RC_GAME_PICKUPGRID_H__
+#define __L4RC_GAME_PICKUPGRID_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// \brief Points bucketed into a uniform grid, for finding the ones in reach.
+///
+/// Every player asks each frame which world drops it can reach. Looping over
+/// all of the drops for each player costs players times drops, which is
+/// millions of distance checks for a few hundred players on a busy map. The
+/// drops are instead sorted into cells as wide as the longest reach, once per
+/// frame, and each player looks only at the three by three cells around it.
+/// The points are copied in cell order, so a query reads them in a run.
+///
+/// Points outside the grid go in the edge cells, so a point just off the map
+/// is still found from just inside it.
+class CPickupGrid {
+ private:
+  float m_fCell = 64.0f;          ///< Cell width and height.
+  int m_nW = 1;                   ///< Cells wide.
+  int m_nH = 1;                   ///< Cells high.
+  std::vector<uint32_t> m_vStart; ///< First point of each cell, and an end.
+  std::vector<uint32_t> m_vCell;  ///< Cell of each point, in input order.
+  std::vector<uint32_t> m_vIndex; ///< Input index of each point, by cell.
+  std::vector<float> m_vXY;       ///< Point x and y, by cell.
+
+  int CellX(float x) const; ///< Column of a point, clamped.
+  int CellY(float y) const; ///< Row of a point, clamped.
+
+ public:
+  /// \brief Set the grid size.
+  /// \param cell Cell size, no less than any query's reach
+  /// \param w Cells wide
+  /// \param h Cells high
+  void Reset(float cell, int w, int h);
+
+  /// \brief Bucket the points.
+  /// \param xy Point x and y, interleaved, as in an array of Vector2
+  /// \param n Number of points
+  void Build(const float* xy, size_t n);
+
+  /// \brief Get the points within reach of a point.
+  /// \param x Point x
+  /// \param y Point y
+  /// \param reach Distance, no more than the cell size
+  /// \param out [out] Input indices, appended, in no particular order
+  void Query(float x, float y, float reach, std::vector<uint32_t>& out) const;
+
+  size_t GetCount() const { return m_vIndex.size(); } ///< Points.
+  float GetCellSize() const { return m_fCell; } ///< Cell size.
+};
+
+#endif  //__L4RC_GAME_PICKUPGRID_H__
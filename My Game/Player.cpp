@@ -1,15 +1,77 @@
 #include "Player.h"
 
 
+#include <algorithm>
+
 #include "GameDefines.h"
+#include "SaveGame.h"
+#include "WorldHash.h"
 #include "Keyboard.h"
 #include "SpriteRenderer.h"
 #include "TileManager.h"
 
 
+/// Read the buttons that move the player: A and D to run, S to drop through
+/// platforms, and the frame Space, J or F goes down to jump, attack or shoot.
+/// \param pKeyboard Keyboard, with this frame's state
+/// \return Buttons
+
+SPlayerInput CPlayer::ReadInput(LKeyboard *pKeyboard) {
+  SPlayerInput input;
+  if (pKeyboard->Down('A')) input.Set(eInput::Left);
+  if (pKeyboard->Down('D')) input.Set(eInput::Right);
+  if (pKeyboard->Down('S')) input.Set(eInput::Down);
+  if (pKeyboard->TriggerDown(VK_SPACE)) input.Set(eInput::Jump);
+  if (pKeyboard->TriggerDown('J')) input.Set(eInput::Attack);
+  if (pKeyboard->TriggerDown('F')) input.Set(eInput::Shoot);
+  return input;
+}
+
+/// Make up the buttons of a player nobody is playing, from the frame number
+/// alone, so that a frame run again gets the same ones. The player runs one
+/// way for two to four seconds at 60 fps and then the other, and jumps and
+/// shoots now and then, each player on their own schedule.
+/// \param seed Different for each player
+/// \param frame Frame number
+/// \return Buttons
+
+SPlayerInput CPlayer::ScriptInput(uint32_t seed, uint32_t frame) {
+  const uint32_t h = (seed + 1) * 2654435761u;
+  const uint32_t period = 120 + h % 120;  // frames between turns
+  const uint32_t t = frame + (h >> 8) % period;
+
+  SPlayerInput input;
+  input.Set(t / period % 2 ? eInput::Left : eInput::Right);
+  if (t % 45 == (h >> 16) % 45) input.Set(eInput::Jump);
+  if (t % 90 == (h >> 20) % 90) input.Set(eInput::Shoot);
+  return input;
+}
+
+/// Count down the attack timer, end the attack once its active time has
+/// run, and start a new one if the button is down and the cooldown is over.
+/// Starting one is flagged for this frame only, for its sound.
+/// \param dt Frame time in seconds
+/// \param input Buttons
+
+void CPlayer::UpdateAttack(float dt, const SPlayerInput &input) {
+  m_bAttackStarted = false;
+  m_fAttackTimer = std::max(m_fAttackTimer - dt, 0.0f);
+  if (m_fAttackTimer <= m_fAttackCooldown - m_fAttackActive)
+    m_bIsAttacking = false;  // the swing is over
+
+  if (input.Has(eInput::Attack) && m_fAttackTimer == 0.0f) {
+    m_bIsAttacking = true;
+    m_bAttackStarted = true;
+    m_fAttackTimer = m_fAttackCooldown;
+  }
+}
 
+void CPlayer::Update(float dt, const SPlayerInput &input, CTileManager *pTiles) {
+  if (m_eController == eController::Grid) {
+    UpdateGrid(dt, input);
+    return;
+  }
 
-void CPlayer::Update(float dt, LKeyboard *pKeyboard, CTileManager *pTiles) {
   float scale = 32.0f;
 
   b2Vec2 pos = mBody->GetPosition();
@@ -23,8 +85,8 @@ void CPlayer::Update(float dt, LKeyboard *pKeyboard, CTileManager *pTiles) {
   b2Vec2 vel = mBody->GetLinearVelocity();
   float target = 0.0f;
 
-  if (pKeyboard->Down('A')) target = -m_fSpeed;
-  if (pKeyboard->Down('D')) target = m_fSpeed;
+  if (input.Has(eInput::Left)) target = -m_fSpeed;
+  if (input.Has(eInput::Right)) target = m_fSpeed;
 
   // smooth acceleration toward target
   float accel = 15.0f;
@@ -34,19 +96,10 @@ void CPlayer::Update(float dt, LKeyboard *pKeyboard, CTileManager *pTiles) {
 
 
 
-  m_fAttackTimer -= dt;
-  if (m_fAttackTimer < 0) m_fAttackTimer = 0;
-
-
-
- 
   // --- Attack Input ---
-  if (pKeyboard->TriggerDown('J') && m_fAttackTimer == 0.0f) {
-    m_bIsAttacking = true;
-    m_fAttackTimer = m_fAttackCooldown;
-  }
+  UpdateAttack(dt, input);
 
-  if (pKeyboard->TriggerDown('F')) {
+  if (input.Has(eInput::Shoot)) {
     RequestShoot();
   }
 
@@ -87,7 +140,7 @@ void CPlayer::Update(float dt, LKeyboard *pKeyboard, CTileManager *pTiles) {
   else
     m_coyoteTimer -= dt;
 
-if (m_coyoteTimer > 0.0f && pKeyboard->TriggerDown(VK_SPACE)) {
+if (m_coyoteTimer > 0.0f && input.Has(eInput::Jump)) {
     m_coyoteTimer = 0.0f;
 
     b2Vec2 v = mBody->GetLinearVelocity();
@@ -98,47 +151,262 @@ if (m_coyoteTimer > 0.0f && pKeyboard->TriggerDown(VK_SPACE)) {
   mBody->SetLinearVelocity(b2Vec2(vel.x, mBody->GetLinearVelocity().y));
 }
 
-void CPlayer::Draw() {
-  LSpriteDesc2D desc;
-  desc.m_nSpriteIndex =
-      m_bIsAttacking
-          ? static_cast<UINT>(eSprite::Jab)
-          : static_cast<UINT>(eSprite::Step);  // temporary player sprite
-  desc.m_vPos = m_vPos;
-  m_pRenderer->Draw(&desc);
-
-  desc.m_vPos.x = m_vPos.x;
-  desc.m_vPos.y = m_vPos.y;
-
-  m_pRenderer->Draw(&desc);
-  bool debug = false;
-  if (debug) {
-    if (IsGrounded()) {
-      LSpriteDesc2D d;
-      d.m_nSpriteIndex = (UINT)eSprite::DebugGreen;
-      d.m_vPos = Vector2(m_vPos.x - 4, m_vPos.y - 40);
-      m_pRenderer->Draw(&d);
-    }
+/// Update with the grid controller. Input is read the same way as with the
+/// Box2D body, but the move happens here and now, and the contacts it
+/// reports are for where the player ends up, so a landing can be jumped
+/// from on the very next update. Holding S drops through one-way platforms.
+/// \param dt Frame time in seconds
+/// \param input Buttons
+
+void CPlayer::UpdateGrid(float dt, const SPlayerInput &input) {
+  float target = 0.0f;
+  if (input.Has(eInput::Left)) target = -m_fSpeed;
+  if (input.Has(eInput::Right)) target = m_fSpeed;
+
+  float vx = m_grid.GetVelX();
+  float vy = m_grid.GetVelY();
+  vx += (target - vx) * 15.0f * dt;  // same acceleration as the body
+
+  UpdateAttack(dt, input);
+  if (input.Has(eInput::Shoot)) RequestShoot();
+
+  if (IsGrounded()) m_coyoteTimer = m_coyoteTimeMax;
+  else m_coyoteTimer -= dt;
+
+  if (m_coyoteTimer > 0.0f && input.Has(eInput::Jump)) {
+    m_coyoteTimer = 0.0f;
+    vy = -7.0f;  // tiles per second, up is negative
   }
 
+  vy += 9.8f * dt;  // gravity, as in the Box2D world
+  m_grid.SetVel(vx, vy);
+  m_grid.Move(dt, input.Has(eInput::Down));
+  SyncFromGrid();
+}
+
+/// Copy the grid controller's position to the pixel position and to the
+/// body, which is kinematic while the grid controller is in charge and only
+/// follows along for anything that asks it where the player is.
 
+void CPlayer::SyncFromGrid() {
+  const float x = m_grid.GetX();
+  const float y = m_nMapHeight - m_grid.GetY() + m_fHeight * 0.5f;  // center
+
+  m_vPos = Vector2(x * 32.0f, y * 32.0f);
+  mBody->SetTransform(b2Vec2(x, y), 0.0f);
+}
+
+/// Switch between the Box2D body and the grid controller, carrying over the
+/// position and velocity. The body becomes kinematic under the grid
+/// controller, so Box2D stops moving it and drops its sensor contacts. The
+/// map must have been set with `SetMap()` before switching to the grid.
+/// \param controller Controller to use from now on
+
+void CPlayer::SetController(eController controller) {
+  if (controller == m_eController) return;
+
+  const b2Vec2 p = mBody->GetPosition();
+  const b2Vec2 v = mBody->GetLinearVelocity();
+
+  if (controller == eController::Grid) {
+    m_grid.SetPos(p.x, m_nMapHeight - (p.y - m_fHeight * 0.5f));
+    m_grid.SetVel(v.x, -v.y);
+    mBody->SetType(b2_kinematicBody);
+    mBody->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
+  } else {
+    mBody->SetType(b2_dynamicBody);
+    mBody->SetLinearVelocity(b2Vec2(m_grid.GetVelX(), -m_grid.GetVelY()));
+    mBody->SetAwake(true);
+  }
+
+  m_eController = controller;
+}
+
+/// Give the grid controller the tiles to collide with. The array is not
+/// copied and must stay valid until the next call.
+/// \param tiles One character per tile, row major
+/// \param w Width in tiles
+/// \param h Height in tiles
+
+void CPlayer::SetMap(const char *tiles, int w, int h) {
+  m_grid.SetMap(tiles, w, h);
+  m_nMapHeight = h;
+}
+
+/// Draw the player with the frame its animation clip is on.
+/// \param pPacket Frame packet
+/// \param frame Animation frame
+
+void CPlayer::Draw(CFramePacket *pPacket, const SAnimFrame &frame) {
+  LSpriteDesc2D desc;
+  desc.m_nSpriteIndex = frame.nSprite;
+  desc.m_nCurrentFrame = frame.nFrame;
+  desc.m_vPos = m_vPos;
+  pPacket->SetLayer(eSpriteLayer::Actors);
+  pPacket->Draw(&desc);
 
   Vector2 healthEndpointOne;
   Vector2 healthEndpointTwo;
 
   // m_pRenderer->DrawLine(eSprite::Dirt, &healthEndpointOne,
   // &healthEndpointTwo);
+}
+
+/// Outline the foot sensor while the player is on the ground and the attack
+/// hitbox while an attack is under way.
+/// \param pDraw Debug renderer
+
+void CPlayer::DebugDraw(CDebugDraw *pDraw) const {
+  if (IsGrounded())
+    pDraw->AddBox(m_debugFootPos, Vector2(4.0f), b2Color(0.3f, 0.9f, 0.3f));
 
-  // --- Debug draw for attack hitbox ---
   if (m_bIsAttacking) {
-    Vector2 attackCenter = m_vPos + Vector2(m_fAttackRange * m_iFacingDir, 0);
-    BoundingBox box;
-    box.Center = Vector3(attackCenter.x, attackCenter.y, 0);
-    box.Extents = Vector3(m_fAttackRadius, m_fAttackRadius, 0);
-    m_pRenderer->DrawBoundingBox(eSprite::Dirt, box);
+    const Vector2 center = m_vPos + Vector2(m_fAttackRange * m_iFacingDir, 0);
+    pDraw->AddBox(center, Vector2(m_fAttackRadius), b2Color(0.9f, 0.3f, 0.3f));
   }
 }
 
+/// Put the player back at the start position, at rest, with full health and
+/// no attack or shot pending. The body is moved rather than recreated, so
+/// anything holding a pointer to it stays valid.
+
+void CPlayer::Reset() {
+  float scale = 32.0f;
+
+  m_vPos = m_vSpawn;
+  mBody->SetTransform(b2Vec2(m_vPos.x / scale, m_vPos.y / scale), 0.0f);
+  mBody->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
+  mBody->SetAwake(true);
+
+  m_grid.SetPos(m_vPos.x / scale,
+                m_nMapHeight - (m_vPos.y / scale - m_fHeight * 0.5f));
+  m_grid.SetVel(0.0f, 0.0f);
+
+  m_uHealth = m_uMaxHealth;
+  m_coyoteTimer = 0.0f;
+  m_bIsAttacking = false;
+  m_bAttackStarted = false;
+  m_fAttackTimer = 0.0f;
+  m_wantsToShoot = false;
+}
+
+/// Record the body's position and velocity, which under the grid controller
+/// are the grid's, with y flipped back to point up.
+/// \param save [out] Player record
+
+void CPlayer::Save(SSavePlayer &save) const {
+  const b2Vec2 p = mBody->GetPosition();
+  const b2Vec2 v = m_eController == eController::Grid
+                       ? b2Vec2(m_grid.GetVelX(), -m_grid.GetVelY())
+                       : mBody->GetLinearVelocity();
+
+  save.fX = p.x;
+  save.fY = p.y;
+  save.fVX = v.x;
+  save.fVY = v.y;
+  save.nHealth = m_uHealth;
+  save.nFacing = m_iFacingDir;
+}
+
+/// Put the body and the grid controller where a save says, as `Reset()` puts
+/// them at the spawn point, and clear anything in progress.
+/// \param save Player record
+
+void CPlayer::Load(const SSavePlayer &save) {
+  m_vPos = Vector2(save.fX * 32.0f, save.fY * 32.0f);
+  mBody->SetTransform(b2Vec2(save.fX, save.fY), 0.0f);
+  mBody->SetAwake(true);
+
+  m_grid.SetPos(save.fX, m_nMapHeight - (save.fY - m_fHeight * 0.5f));
+  if (m_eController == eController::Grid) {
+    m_grid.SetVel(save.fVX, -save.fVY);
+    mBody->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
+  } else {
+    m_grid.SetVel(0.0f, 0.0f);
+    mBody->SetLinearVelocity(b2Vec2(save.fVX, save.fVY));
+  }
+
+  m_uHealth = std::min(save.nHealth, m_uMaxHealth);
+  m_iFacingDir = save.nFacing < 0 ? -1 : 1;
+  m_coyoteTimer = 0.0f;
+  m_bIsAttacking = false;
+  m_bAttackStarted = false;
+  m_fAttackTimer = 0.0f;
+  m_wantsToShoot = false;
+}
+
+/// Hash the state that carries over between frames: the contact counts the
+/// listener keeps, timers, health and the grid controller. The body itself
+/// is hashed with the other bodies.
+/// \param h Hash to continue from
+/// \return Hash
+
+uint64_t CPlayer::Hash(uint64_t h) const {
+  h = HashValue(m_groundContacts, h);
+  h = HashValue(m_headContacts, h);
+  h = HashValue(m_leftWallContacts, h);
+  h = HashValue(m_rightWallContacts, h);
+  h = HashValue(m_vPos.x, h);
+  h = HashValue(m_vPos.y, h);
+  h = HashValue(m_coyoteTimer, h);
+  h = HashValue(m_bIsAttacking, h);
+  h = HashValue(m_fAttackTimer, h);
+  h = HashValue(m_wantsToShoot, h);
+  h = HashValue(m_uHealth, h);
+  h = HashValue(m_iFacingDir, h);
+  h = HashValue(m_eController, h);
+
+  const SGridContacts& c = m_grid.GetContacts();
+  const float grid[] = {m_grid.GetX(), m_grid.GetY(), m_grid.GetVelX(),
+                        m_grid.GetVelY()};
+  const bool contacts[] = {c.bGround, c.bHead, c.bWallLeft, c.bWallRight};
+  h = HashValue(grid, h);
+  return HashValue(contacts, h);
+}
+
+/// Copy out the body's motion and everything Update() carries over from one
+/// frame to the next.
+/// \param state [out] State
+
+void CPlayer::Snapshot(SPlayerState &state) const {
+  state.vBodyPos = mBody->GetPosition();
+  state.vBodyVel = mBody->GetLinearVelocity();
+  state.bAwake = mBody->IsAwake();
+  state.vPos = m_vPos;
+  state.fCoyote = m_coyoteTimer;
+  state.fAttackTimer = m_fAttackTimer;
+  state.bAttacking = m_bIsAttacking;
+  state.bWantsToShoot = m_wantsToShoot;
+  state.nHealth = m_uHealth;
+  state.nFacing = m_iFacingDir;
+  state.fGridX = m_grid.GetX();
+  state.fGridY = m_grid.GetY();
+  state.fGridVX = m_grid.GetVelX();
+  state.fGridVY = m_grid.GetVelY();
+  state.contacts = m_grid.GetContacts();
+}
+
+/// Put everything back as it was in a Snapshot(). The body is moved with
+/// SetTransform(), which Box2D allows outside of a step.
+/// \param state State
+
+void CPlayer::Restore(const SPlayerState &state) {
+  mBody->SetTransform(state.vBodyPos, 0.0f);
+  mBody->SetLinearVelocity(state.vBodyVel);
+  mBody->SetAwake(state.bAwake);
+  m_vPos = state.vPos;
+  m_coyoteTimer = state.fCoyote;
+  m_fAttackTimer = state.fAttackTimer;
+  m_bIsAttacking = state.bAttacking;
+  m_bAttackStarted = false;
+  m_wantsToShoot = state.bWantsToShoot;
+  m_uHealth = state.nHealth;
+  m_iFacingDir = state.nFacing;
+  m_grid.SetPos(state.fGridX, state.fGridY);
+  m_grid.SetVel(state.fGridVX, state.fGridVY);
+  m_grid.SetContacts(state.contacts);
+}
+
 void CPlayer::TakeDamage(UINT damage) {
   if (m_uHealth - damage >= 0) {
     m_uHealth -= damage;
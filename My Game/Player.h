@@ -3,12 +3,23 @@
 #include "SimpleMath.h"
 #include "SpriteRenderer.h"
 #include "Game.h"
+#include "FramePacket.h"
+#include "GridController.h"
+#include "Rollback.h"
+#include "Snapshot.h"
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
 
 class CTileManager;
 class CGame;         
+struct SSavePlayer;
+
+/// \brief What moves the player.
+enum class eController {
+  Box2D,  ///< Dynamic body, contacts from sensor fixtures.
+  Grid    ///< CGridController against the tile map, body follows it.
+};
 
 
 class CPlayer {
@@ -24,7 +35,8 @@ class CPlayer {
   float m_halfSpriteH = 16.0f;
 
 
-  Vector2 m_vPos = {100.0f, 1000.0f}; //1M = 16 Pixels
+  Vector2 m_vSpawn = {100.0f, 1000.0f}; ///< Start position in pixels.
+  Vector2 m_vPos = m_vSpawn; //1M = 16 Pixels
   Vector2 m_vVel = {0.0f, 0.0f};
   float m_fSpeed = 5.0f;
   float m_fRadius = 16.0f;
@@ -33,7 +45,7 @@ class CPlayer {
   UINT m_uHealth = 100;
   const UINT m_uMaxHealth = 100;
 
-  bool m_groundContacts = false;
+  int m_groundContacts = 0;
   int m_headContacts = 0;
   int m_leftWallContacts = 0;
   int m_rightWallContacts = 0;
@@ -50,7 +62,9 @@ class CPlayer {
   bool m_wantsToShoot = false;
 
   bool m_bIsAttacking = false;
+  bool m_bAttackStarted = false;   // an attack started this update
   float m_fAttackCooldown = 0.5f;  // seconds between attacks
+  float m_fAttackActive = 0.25f;   // seconds an attack lasts
   float m_fAttackTimer = 0.0f;
   float m_fAttackRange = 40.0f;   // pixels in front of player
   float m_fAttackRadius = 16.0f;  // size of attack hitbox
@@ -58,6 +72,14 @@ class CPlayer {
   //-- Test for visual hitbox
   int m_iFacingDir = 1;  // 1 = right, -1 = left
 
+  eController m_eController = eController::Box2D; ///< What moves the player.
+  CGridController m_grid{m_fWidth * 0.5f, m_fHeight}; ///< Kinematic mover.
+  int m_nMapHeight = 0; ///< Map height in tiles, to flip y for m_grid.
+
+  void UpdateGrid(float dt, const SPlayerInput &input); ///< Move with m_grid.
+  void UpdateAttack(float dt, const SPlayerInput &input); ///< Start and end.
+  void SyncFromGrid(); ///< Body and pixel position from m_grid.
+
  public:
   friend class ContactListener;
   CPlayer(LSpriteRenderer *renderer, b2World *world, CGame *game)
@@ -86,6 +108,7 @@ class CPlayer {
     fix.shape = &box;
     fix.density = 1.0f;
     fix.friction = 0.0f;
+    fix.filter = m_pGame->GetCollision().GetFilter(eCollisionLayer::Player);
 
 
     mBody->CreateFixture(&fix);
@@ -109,6 +132,8 @@ class CPlayer {
     b2FixtureDef sensorFix;
     sensorFix.shape = &footShape;
     sensorFix.isSensor = true;
+    sensorFix.filter =
+        m_pGame->GetCollision().GetFilter(eCollisionLayer::PlayerSensor);
     sensorFix.userData.pointer = (uintptr_t)this;
 
     mBody->CreateFixture(&sensorFix);
@@ -125,6 +150,7 @@ class CPlayer {
     b2FixtureDef headFix;
     headFix.shape = &headShape;
     headFix.isSensor = true;
+    headFix.filter = sensorFix.filter;
     headFix.userData.pointer = (uintptr_t)this;
 
     mBody->CreateFixture(&headFix);
@@ -141,6 +167,7 @@ class CPlayer {
     b2FixtureDef leftFix;
     leftFix.shape = &leftShape;
     leftFix.isSensor = true;
+    leftFix.filter = sensorFix.filter;
     leftFix.userData.pointer = (uintptr_t)this;
 
     mBody->CreateFixture(&leftFix);
@@ -155,6 +182,7 @@ class CPlayer {
     b2FixtureDef rightFix;
     rightFix.shape = &rightShape;
     rightFix.isSensor = true;
+    rightFix.filter = sensorFix.filter;
     rightFix.userData.pointer = (uintptr_t)this;
 
     mBody->CreateFixture(&rightFix);
@@ -162,21 +190,53 @@ class CPlayer {
 
   }
   b2Body *GetBody() const { return mBody; }
-  bool IsGrounded() const { return m_groundContacts; }
-  bool IsHeadBlocked() const { return m_headContacts > 0; }
-  bool TouchingLeftWall() const { return m_leftWallContacts > 0; }
-  bool TouchingRightWall() const { return m_rightWallContacts > 0; }
+  bool IsGrounded() const {
+    return m_eController == eController::Grid ? m_grid.GetContacts().bGround
+                                              : m_groundContacts > 0;
+  }
+  bool IsHeadBlocked() const {
+    return m_eController == eController::Grid ? m_grid.GetContacts().bHead
+                                              : m_headContacts > 0;
+  }
+  bool TouchingLeftWall() const {
+    return m_eController == eController::Grid ? m_grid.GetContacts().bWallLeft
+                                              : m_leftWallContacts > 0;
+  }
+  bool TouchingRightWall() const {
+    return m_eController == eController::Grid
+               ? m_grid.GetContacts().bWallRight
+               : m_rightWallContacts > 0;
+  }
+
+  void SetController(eController controller); ///< Switch movers in place.
+  eController GetController() const { return m_eController; } ///< Mover.
+  void SetMap(const char *tiles, int w, int h); ///< Tiles for the grid.
 
   void RequestShoot();
   bool WantsToShoot() const { return m_wantsToShoot; }
   void ClearShootRequest() { m_wantsToShoot = false; }
 
 
-  void Update(float dt, LKeyboard *pKeyboard, CTileManager *pTiles);
-  void Draw();
+  static SPlayerInput ReadInput(LKeyboard *pKeyboard); ///< Buttons held.
+  static SPlayerInput ScriptInput(uint32_t seed, uint32_t frame); ///< Bot.
+  void Update(float dt, const SPlayerInput &input, CTileManager *pTiles);
+  void Draw(CFramePacket *pPacket, const SAnimFrame &frame); ///< Sprite.
+  void DebugDraw(CDebugDraw *pDraw) const; ///< Sensor and attack outlines.
+  void Reset(); ///< Back to the start position with full health.
+  void Save(SSavePlayer &save) const; ///< Position, velocity and health.
+  void Load(const SSavePlayer &save); ///< Restore what Save() wrote.
+  uint64_t Hash(uint64_t h) const; ///< State and contacts, for checksums.
+  void Snapshot(SPlayerState &state) const; ///< State for rollback.
+  void Restore(const SPlayerState &state); ///< Go back to a Snapshot().
   void TakeDamage(UINT damage);
   void HealDamage(UINT heal);
   const Vector2 &GetPos() const { return m_vPos; }
+  const Vector2 &GetSpawn() const { return m_vSpawn; } ///< Start position.
+  void SetSpawn(const Vector2 &pos) { m_vSpawn = pos; } ///< For Reset().
+  bool IsAttacking() const { return m_bIsAttacking; } ///< Attack under way.
+  bool AttackStarted() const { return m_bAttackStarted; } ///< This update.
+  int GetFacing() const { return m_iFacingDir; } ///< 1 right, -1 left.
+  UINT GetHealth() const { return m_uHealth; } ///< Health.
   float GetRadius() const { return m_fRadius; }
 
 };
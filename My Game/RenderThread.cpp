@@ -0,0 +1,158 @@
+/// \file RenderThread.cpp
+/// \brief Code for the render pipeline CRenderThread.
+
+#include "RenderThread.h"
+
+/// Weight given to the newest sample when smoothing the timing statistics.
+static const float g_fSmoothing = 0.05f;
+
+/// Constructor. Rendering starts out synchronous.
+/// \param pRenderer Pointer to renderer
+/// \param vWinCenter Window center
+
+CRenderThread::CRenderThread(LSpriteRenderer* pRenderer,
+                             const Vector2& vWinCenter)
+    : m_pRenderer(pRenderer), m_vWinCenter(vWinCenter) {
+  m_tLastFrame = Clock::now();
+}
+
+/// Destructor makes sure the render thread is no longer touching the renderer.
+
+CRenderThread::~CRenderThread() { Stop(); }
+
+/// Seconds since the pipeline was created.
+/// \return Time in seconds
+
+double CRenderThread::Now() const {
+  return std::chrono::duration<double>(Clock::now() - m_tStart).count();
+}
+
+/// Switch modes. Any packet in flight is rendered before the switch.
+/// \param threaded True to render on a separate thread
+
+void CRenderThread::SetThreaded(bool threaded) {
+  if (threaded == m_bThreaded) return;
+  if (threaded)
+    Start();
+  else
+    Stop();
+}
+
+/// Start the render thread.
+
+void CRenderThread::Start() {
+  m_bQuit = false;
+  m_bThreaded = true;
+  m_thread = std::thread(&CRenderThread::ThreadLoop, this);
+}
+
+/// Let the render thread finish the packet it has, if any, then join it.
+
+void CRenderThread::Stop() {
+  if (!m_bThreaded) return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bQuit = true;
+  }
+  m_cvReady.notify_one();
+  m_thread.join();
+  m_bThreaded = false;
+}
+
+/// Render a packet and update the latency, throughput and batch statistics.
+/// \param packet The packet
+
+void CRenderThread::Render(CFramePacket& packet) {
+  m_pRenderer->BeginFrame();
+  packet.Submit(m_pRenderer, m_vWinCenter, m_pTextures);
+  m_pRenderer->EndFrame();
+
+  m_nBatchBreaks = packet.GetBatchBreaks();
+  m_nUnsortedBreaks = packet.GetUnsortedBatchBreaks();
+
+  const Clock::time_point t = Clock::now();
+  if (!m_bPresented) {
+    m_tFirstPresent = t;
+    m_bPresented = true;  // after the time, which it publishes
+  }
+
+  const float latency = (float)((Now() - packet.GetSealTime()) * 1000.0);
+  const float period = std::chrono::duration<float>(t - m_tLastFrame).count();
+  m_tLastFrame = t;
+
+  const float oldLatency = m_fLatency;
+  m_fLatency = oldLatency + (latency - oldLatency) * g_fSmoothing;
+
+  if (period > 0.0f) {
+    const float oldThroughput = m_fThroughput;
+    m_fThroughput =
+        oldThroughput + (1.0f / period - oldThroughput) * g_fSmoothing;
+  }
+}
+
+/// The render thread waits for a packet, renders it, and tells the simulation
+/// that the packet is free again.
+
+void CRenderThread::ThreadLoop() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true) {
+    m_cvReady.wait(lock, [&]() { return m_bQuit || m_nReady >= 0; });
+    if (m_nReady < 0) break;  // quitting with nothing left to render
+
+    const int index = m_nReady;
+    m_nReady = -1;
+    m_bRendering = true;
+
+    lock.unlock();
+    Render(m_packets[index]);
+    lock.lock();
+
+    m_bRendering = false;
+    m_cvDone.notify_one();
+  }
+}
+
+/// Wait for the render thread to finish the packet it has, if any. The
+/// renderer is then free for other uses, such as loading textures, until the
+/// next `EndPacket()`.
+
+void CRenderThread::WaitIdle() {
+  if (!m_bThreaded) return;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cvDone.wait(lock, [&]() { return m_nReady < 0 && !m_bRendering; });
+}
+
+/// Get the packet the simulation should record into. It is the one not in use
+/// by the render thread, so recording never has to wait.
+/// \return Pointer to an empty packet
+
+CFramePacket* CRenderThread::BeginPacket() {
+  CFramePacket* pPacket = &m_packets[m_nRecording];
+  pPacket->Clear();
+  return pPacket;
+}
+
+/// Seal the packet that was being recorded. In synchronous mode render it
+/// now. In threaded mode wait until the render thread has finished the
+/// previous packet, hand this one over and flip to the other buffer.
+
+void CRenderThread::EndPacket() {
+  m_packets[m_nRecording].Seal(m_nFrame++, Now());
+
+  if (!m_bThreaded) {
+    Render(m_packets[m_nRecording]);
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cvDone.wait(lock, [&]() { return m_nReady < 0 && !m_bRendering; });
+    m_nReady = m_nRecording;
+  }
+  m_cvReady.notify_one();
+
+  m_nRecording ^= 1;
+}
@@ -0,0 +1,130 @@
+/// \file RenderThread.h
+/// \brief Interface for the render pipeline CRenderThread.
+
+#ifndef __L4RC_GAME_RENDERTHREAD_H__
+#define __L4RC_GAME_RENDERTHREAD_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "FramePacket.h"
+
+/// \brief The render pipeline.
+///
+/// Owns two frame packets. The simulation records into one with
+/// `BeginPacket()` and `EndPacket()`. In synchronous mode `EndPacket()`
+/// submits the packet straight away on the calling thread, which is how the
+/// game has always worked. In threaded mode it hands the packet to a render
+/// thread and returns, so that frame N is rendered while frame N+1 is
+/// simulated. The simulation only waits if it finishes a packet before the
+/// render thread has finished the previous one.
+///
+/// Latency is measured from `EndPacket()` to the end of `EndFrame()` on the
+/// renderer, and throughput is rendered frames per second. Both are smoothed
+/// so that they can be read off the frame rate display.
+class CRenderThread {
+ private:
+  typedef std::chrono::high_resolution_clock Clock;  ///< Timing clock.
+
+  LSpriteRenderer* m_pRenderer = nullptr;  ///< Pointer to renderer.
+  Vector2 m_vWinCenter;                    ///< Window center.
+  const std::vector<UINT>* m_pTextures = nullptr;  ///< Sprite texture table.
+
+  CFramePacket m_packets[2];  ///< Double-buffered packets.
+  int m_nRecording = 0;       ///< Index of packet the simulation is filling.
+  int m_nReady = -1;          ///< Index of packet waiting to render, or -1.
+  bool m_bRendering = false;  ///< Render thread is busy with a packet.
+  UINT m_nFrame = 0;          ///< Simulation frame counter.
+
+  bool m_bThreaded = false;          ///< Whether the render thread runs.
+  bool m_bQuit = false;              ///< Tells render thread to exit.
+  std::thread m_thread;              ///< The render thread.
+  std::mutex m_mutex;                ///< Guards the packet hand-off.
+  std::condition_variable m_cvReady; ///< Signals a packet is ready.
+  std::condition_variable m_cvDone;  ///< Signals a packet is finished.
+
+  const Clock::time_point m_tStart = Clock::now();  ///< Time origin.
+  Clock::time_point m_tLastFrame;  ///< End time of last rendered frame.
+  std::atomic<float> m_fLatency{0.0f};     ///< Smoothed latency in ms.
+  std::atomic<float> m_fThroughput{0.0f};  ///< Smoothed frames per second.
+  std::atomic<UINT> m_nBatchBreaks{0};     ///< Last frame, sorted.
+  std::atomic<UINT> m_nUnsortedBreaks{0};  ///< Last frame, submission order.
+  Clock::time_point m_tFirstPresent;        ///< End of the first EndFrame().
+  std::atomic<bool> m_bPresented{false};    ///< A frame has been presented.
+
+  /// \brief Body of the render thread.
+  void ThreadLoop();
+
+  /// \brief Render a packet and update the timing statistics.
+  void Render(CFramePacket& packet);
+
+  /// \brief Get seconds since construction.
+  double Now() const;
+
+  /// \brief Start the render thread.
+  void Start();
+
+  /// \brief Wait for the render thread to drain and stop it.
+  void Stop();
+
+ public:
+  /// \brief Constructor.
+  /// \param pRenderer Pointer to renderer
+  /// \param vWinCenter Window center, for screen space commands
+  CRenderThread(LSpriteRenderer* pRenderer, const Vector2& vWinCenter);
+
+  /// \brief Destructor stops the render thread.
+  ~CRenderThread();
+
+  /// \brief Switch between threaded and synchronous rendering.
+  void SetThreaded(bool threaded);
+
+  /// \brief Set the sprite texture table used for sorting and batching.
+  void SetTextureTable(const std::vector<UINT>* pTextures) {
+    m_pTextures = pTextures;
+  }
+
+  /// \brief Set the sprite substitution table for both packets.
+  void SetSpriteTable(const std::vector<UINT>* pSprites) {
+    for (CFramePacket& packet : m_packets) packet.SetSpriteTable(pSprites);
+  }
+
+  /// \brief Wait until the render thread is not using the renderer.
+  void WaitIdle();
+
+  /// \brief Check whether rendering is threaded.
+  bool IsThreaded() const { return m_bThreaded; }
+
+  /// \brief Get an empty packet for the simulation to record into.
+  CFramePacket* BeginPacket();
+
+  /// \brief Seal the packet and render it, or hand it to the render thread.
+  void EndPacket();
+
+  /// \brief Get smoothed packet-to-screen latency in milliseconds.
+  float GetLatency() const { return m_fLatency; }
+
+  /// \brief Get smoothed rendered frames per second.
+  float GetThroughput() const { return m_fThroughput; }
+
+  /// \brief Get the last frame's sprite batch breaks after sorting.
+  UINT GetBatchBreaks() const { return m_nBatchBreaks; }
+
+  /// \brief Get the last frame's sprite batch breaks in submission order.
+  UINT GetUnsortedBatchBreaks() const { return m_nUnsortedBreaks; }
+
+  /// \brief Get the time the first frame was presented.
+  /// \param t [out] Time the first `EndFrame()` returned
+  /// \return False if no frame has been presented yet
+  bool GetFirstPresentTime(std::chrono::high_resolution_clock::time_point& t)
+      const {
+    if (!m_bPresented) return false;
+    t = m_tFirstPresent;
+    return true;
+  }
+};
+
+#endif  //__L4RC_GAME_RENDERTHREAD_H__
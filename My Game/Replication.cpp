@@ -0,0 +1,616 @@
+/// \file Replication.cpp
+/// \brief Code for state replication, CNetServer and CNetClient.
+
+#include "Replication.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+static const size_t g_nUdpHeader = 28; ///< IPv4 and UDP header bytes.
+
+/// \brief An entry's operation in a snapshot, 2 bits.
+enum class eNetOp : uint32_t {
+  Delta,  ///< Changed fields of an entity in the baseline.
+  New,    ///< Type and fields of an entity not in the baseline.
+  Remove, ///< Entity in the baseline that the client no longer gets.
+  End     ///< No more entries.
+};
+
+/// \brief A bit in an entity delta's field mask.
+enum eNetField : uint32_t {
+  FIELD_X = 1, FIELD_Y = 2, FIELD_VX = 4, FIELD_VY = 8, FIELD_FLAGS = 16,
+  FIELD_DATA = 32
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CBitWriter and CBitReader
+
+void CBitWriter::Write(uint32_t value, uint32_t bits) {
+  for (uint32_t i = 0; i < bits;) {
+    const size_t byte = m_nBits >> 3;
+    const uint32_t bit = m_nBits & 7;
+    const uint32_t n = std::min(8 - bit, bits - i);
+    if (byte == m_vBytes.size()) m_vBytes.push_back(0);
+    m_vBytes[byte] |= (uint8_t)((value >> i & ((1u << n) - 1)) << bit);
+    i += n;
+    m_nBits += n;
+  }
+}
+
+void CBitWriter::WriteVar(uint32_t value) {
+  if (value < 16) Write(0, 2), Write(value, 4);
+  else if (value < 256) Write(1, 2), Write(value, 8);
+  else if (value < 65536) Write(2, 2), Write(value, 16);
+  else Write(3, 2), Write(value, 32);
+}
+
+void CBitWriter::Truncate(size_t bits) {
+  if (bits >= m_nBits) return;
+  m_nBits = bits;
+  m_vBytes.resize(GetBytes());
+  if (bits & 7) m_vBytes.back() &= (uint8_t)((1u << (bits & 7)) - 1);
+}
+
+uint32_t CBitReader::Read(uint32_t bits) {
+  if (m_nBits + bits > m_nSize) {
+    m_bError = true;
+    m_nBits = m_nSize;
+    return 0;
+  }
+
+  uint32_t value = 0;
+  for (uint32_t i = 0; i < bits;) {
+    const size_t byte = m_nBits >> 3;
+    const uint32_t bit = m_nBits & 7;
+    const uint32_t n = std::min(8 - bit, bits - i);
+    value |= (uint32_t)(m_pBytes[byte] >> bit & ((1u << n) - 1)) << i;
+    i += n;
+    m_nBits += n;
+  }
+
+  return value;
+}
+
+uint32_t CBitReader::ReadVar() {
+  static const uint32_t bits[4] = {4, 8, 16, 32};
+  return Read(bits[Read(2)]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Entity deltas
+
+/// Write a 6 bit mask of the fields that differ from the baseline, then
+/// each of those fields. Positions and velocities are written as the
+/// difference of the quantized values, which is a few bits for anything
+/// that moves smoothly. The subtraction wraps, so it cannot overflow.
+/// \param w Writer
+/// \param base Baseline, a zero entity for a new one
+/// \param x Entity
+
+void WriteEntityDelta(CBitWriter& w, const SNetEntity& base,
+                      const SNetEntity& x) {
+  uint32_t mask = 0;
+  if (x.nX != base.nX) mask |= FIELD_X;
+  if (x.nY != base.nY) mask |= FIELD_Y;
+  if (x.nVX != base.nVX) mask |= FIELD_VX;
+  if (x.nVY != base.nVY) mask |= FIELD_VY;
+  if (x.nFlags != base.nFlags) mask |= FIELD_FLAGS;
+  if (x.nData != base.nData) mask |= FIELD_DATA;
+
+  auto delta = [](int32_t a, int32_t b) {
+    return (int32_t)((uint32_t)a - (uint32_t)b);
+  };
+
+  w.Write(mask, 6);
+  if (mask & FIELD_X) w.WriteSigned(delta(x.nX, base.nX));
+  if (mask & FIELD_Y) w.WriteSigned(delta(x.nY, base.nY));
+  if (mask & FIELD_VX) w.WriteSigned(delta(x.nVX, base.nVX));
+  if (mask & FIELD_VY) w.WriteSigned(delta(x.nVY, base.nVY));
+  if (mask & FIELD_FLAGS) w.Write(x.nFlags, 8);
+  if (mask & FIELD_DATA) w.WriteVar(x.nData);
+}
+
+void ReadEntityDelta(CBitReader& r, SNetEntity& x) {
+  auto add = [](int32_t a, int32_t d) {
+    return (int32_t)((uint32_t)a + (uint32_t)d);
+  };
+
+  const uint32_t mask = r.Read(6);
+  if (mask & FIELD_X) x.nX = add(x.nX, r.ReadSigned());
+  if (mask & FIELD_Y) x.nY = add(x.nY, r.ReadSigned());
+  if (mask & FIELD_VX) x.nVX = add(x.nVX, r.ReadSigned());
+  if (mask & FIELD_VY) x.nVY = add(x.nVY, r.ReadSigned());
+  if (mask & FIELD_FLAGS) x.nFlags = (uint8_t)r.Read(8);
+  if (mask & FIELD_DATA) x.nData = (uint16_t)r.ReadVar();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CInterestGrid
+
+void CInterestGrid::Reset(float cell, int w, int h) {
+  m_fCell = std::max(cell, 1.0f);
+  m_nW = std::max(w, 1);
+  m_nH = std::max(h, 1);
+}
+
+/// Counting sort of the entities by cell: count each cell, turn the counts
+/// into start indices, and place each entity at its cell's next index.
+/// \param entities Entities
+
+void CInterestGrid::Build(const std::vector<SNetEntity>& entities) {
+  const size_t cells = (size_t)m_nW * m_nH;
+  m_vStart.assign(cells + 1, 0);
+  m_vCell.resize(entities.size());
+  m_vIndex.resize(entities.size());
+
+  for (size_t i = 0; i < entities.size(); ++i) {
+    const int x = (int)std::floor(entities[i].GetX() / m_fCell);
+    const int y = (int)std::floor(entities[i].GetY() / m_fCell);
+    const uint32_t c = std::max(0, std::min(m_nH - 1, y)) * m_nW +
+                       std::max(0, std::min(m_nW - 1, x));
+    m_vCell[i] = c;
+    m_vStart[c + 1]++;
+  }
+
+  for (size_t c = 1; c <= cells; ++c) m_vStart[c] += m_vStart[c - 1];
+
+  for (size_t i = 0; i < entities.size(); ++i)
+    m_vIndex[m_vStart[m_vCell[i]]++] = (uint32_t)i;
+
+  for (size_t c = cells; c > 0; --c) m_vStart[c] = m_vStart[c - 1];
+  m_vStart[0] = 0;
+}
+
+void CInterestGrid::Query(float x, float y, int radius,
+                          std::vector<uint32_t>& out) const {
+  if (m_vStart.empty()) return;
+
+  const int cx = std::max(0, std::min(m_nW - 1, (int)std::floor(x / m_fCell)));
+  const int cy = std::max(0, std::min(m_nH - 1, (int)std::floor(y / m_fCell)));
+  const int x0 = std::max(0, cx - radius), x1 = std::min(m_nW - 1, cx + radius);
+  const int y0 = std::max(0, cy - radius), y1 = std::min(m_nH - 1, cy + radius);
+
+  for (int j = y0; j <= y1; ++j)
+    for (int i = x0; i <= x1; ++i) {
+      const size_t c = (size_t)j * m_nW + i;
+      out.insert(out.end(), m_vIndex.begin() + m_vStart[c],
+                 m_vIndex.begin() + m_vStart[c + 1]);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CNetIdMap
+
+uint32_t CNetIdMap::Get(const void* p, eNetEntity type) {
+  const uintptr_t key = (uintptr_t)p | (uintptr_t)type;
+  auto it = m_map.find(key);
+  if (it == m_map.end()) it = m_map.insert({key, {m_nNext++, m_nSweep}}).first;
+  it->second.nSeen = m_nSweep;
+  return it->second.nId;
+}
+
+void CNetIdMap::Sweep() {
+  for (auto it = m_map.begin(); it != m_map.end();)
+    if (it->second.nSeen != m_nSweep) it = m_map.erase(it);
+    else ++it;
+
+  ++m_nSweep;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CNetServer
+
+bool CNetServer::Open(uint16_t port, size_t clients, bool loopback) {
+  m_vClients.assign(clients, SClient());
+  return m_socket.Open(port, loopback);
+}
+
+void CNetServer::Close() {
+  const uint8_t bye = (uint8_t)eNetPacket::Disconnect;
+  for (size_t i = 0; i < m_vClients.size(); ++i)
+    if (m_vClients[i].bActive) {
+      m_socket.Send(m_vClients[i].addr, &bye, 1);
+      Drop(i);
+    }
+
+  m_socket.Close();
+}
+
+void CNetServer::SetInterest(float cell, int w, int h, int radius) {
+  m_grid.Reset(cell, w, h);
+  m_nRadius = std::max(radius, 0);
+}
+
+void CNetServer::SetBudget(size_t bytes) {
+  m_nBudget = std::max<size_t>(64, std::min(bytes, g_nNetMaxPacket));
+}
+
+size_t CNetServer::GetClientCount() const {
+  size_t n = 0;
+  for (const SClient& c : m_vClients) n += c.bActive;
+  return n;
+}
+
+int CNetServer::FindClient(const SNetAddress& addr) const {
+  for (size_t i = 0; i < m_vClients.size(); ++i)
+    if (m_vClients[i].bActive && m_vClients[i].addr == addr) return (int)i;
+  return -1;
+}
+
+/// Free a slot. Its snapshot arrays are kept for the next client.
+/// \param slot Slot
+
+void CNetServer::Drop(size_t slot) {
+  SClient& c = m_vClients[slot];
+  c.bActive = false;
+  for (SSent& s : c.vSent) s.nTick = 0;
+}
+
+/// A Connect from a new address takes a free slot, or is answered with Full.
+/// A Connect from a client already in a slot is answered with Welcome
+/// again, since the first one may have been lost. Inputs update the
+/// client's latest snapshot received, its held buttons and its presses.
+/// \param now Time in ms
+
+void CNetServer::Poll(double now) {
+  m_vJoined.clear();
+  m_vLeft.clear();
+  if (!m_socket.IsOpen()) return;
+
+  const uint8_t held = SPlayerInput{0xff}.Held().nButtons;
+  uint8_t buffer[g_nNetMaxPacket];
+  SNetAddress from;
+  size_t n;
+
+  while ((n = m_socket.Receive(buffer, sizeof(buffer), from)) > 0) {
+    CBitReader r(buffer, n);
+    const eNetPacket kind = (eNetPacket)r.Read(8);
+    int slot = FindClient(from);
+
+    if (kind == eNetPacket::Connect) {
+      if (r.Read(32) != g_nNetProtocol || r.HasError()) continue;
+
+      if (slot < 0) {
+        for (size_t i = 0; i < m_vClients.size() && slot < 0; ++i)
+          if (!m_vClients[i].bActive) slot = (int)i;
+
+        if (slot < 0) {
+          const uint8_t full = (uint8_t)eNetPacket::Full;
+          m_socket.Send(from, &full, 1);
+          continue;
+        }
+
+        SClient& c = m_vClients[slot];
+        c.bActive = true;
+        c.addr = from;
+        c.nPlayerId = c.nAck = c.nInputFrame = 0;
+        c.input = SPlayerInput();
+        c.vSent.resize(m_nHistory);
+        c.stats = SNetClientStats();
+        m_vJoined.push_back(slot);
+      }
+
+      CBitWriter w(m_vPacket);
+      w.Write((uint32_t)eNetPacket::Welcome, 8);
+      w.Write((uint32_t)slot, 32);
+      m_socket.Send(from, m_vPacket.data(), w.GetBytes());
+    }
+
+    if (slot < 0) continue;
+    SClient& c = m_vClients[slot];
+    c.fLastHeard = now;
+
+    if (kind == eNetPacket::Input) {
+      const uint32_t ack = r.Read(32);
+      const uint32_t frame = r.Read(32);
+      const uint8_t buttons = (uint8_t)r.Read(8);
+      if (r.HasError()) continue;
+
+      c.nAck = std::max(c.nAck, ack);
+      if (frame >= c.nInputFrame) {  // newer, its held buttons win
+        c.input.nButtons = (c.input.nButtons & ~held) | buttons;
+        c.nInputFrame = frame;
+      } else c.input.nButtons |= buttons & ~held;  // late, keep its presses
+    }
+
+    else if (kind == eNetPacket::Disconnect) {
+      Drop(slot);
+      m_vLeft.push_back(slot);
+    }
+  }
+
+  for (size_t i = 0; i < m_vClients.size(); ++i)
+    if (m_vClients[i].bActive && now - m_vClients[i].fLastHeard > m_fTimeout) {
+      Drop(i);
+      m_vLeft.push_back(i);
+    }
+}
+
+SPlayerInput CNetServer::TakeInput(size_t slot) {
+  SClient& c = m_vClients[slot];
+  const SPlayerInput x = c.input;
+  c.input = x.Held();
+  return x;
+}
+
+/// Bucket the entities by chunk and send each client its snapshot.
+/// \param tick Tick number, from 1
+/// \param world Every entity, in any order
+
+void CNetServer::Replicate(uint32_t tick, const std::vector<SNetEntity>& world) {
+  const auto t0 = std::chrono::high_resolution_clock::now();
+
+  m_grid.Build(world);
+  m_vById.resize(world.size());
+  for (size_t i = 0; i < world.size(); ++i)
+    m_vById[i] = {world[i].nId, (uint32_t)i};
+  std::sort(m_vById.begin(), m_vById.end());
+
+  for (size_t i = 0; i < m_vClients.size(); ++i)
+    if (m_vClients[i].bActive) Send(i, tick, world);
+
+  m_fTickTime = std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - t0)
+                    .count();
+}
+
+/// Find the entities in the chunks around the client's player and write
+/// them as a delta from the last snapshot it acknowledged, if that is still
+/// held, or else from nothing. Both lists are sorted by id, so one pass
+/// over the two finds the entities that are new, changed, unchanged and
+/// gone. Ids are written as the gap from the last id written.
+///
+/// What the client will know after this snapshot is recorded as it is
+/// written. An entry that does not fit in the budget is not written, and
+/// the client keeps its baseline value, so that is what is recorded.
+/// \param slot Client slot
+/// \param tick Tick number
+/// \param world Every entity
+
+void CNetServer::Send(size_t slot, uint32_t tick,
+                      const std::vector<SNetEntity>& world) {
+  SClient& c = m_vClients[slot];
+
+  float x = 0.0f, y = 0.0f;  // center of interest
+  auto it = std::lower_bound(m_vById.begin(), m_vById.end(),
+                             std::make_pair(c.nPlayerId, 0u));
+  if (it != m_vById.end() && it->first == c.nPlayerId) {
+    x = world[it->second].GetX();
+    y = world[it->second].GetY();
+  }
+
+  m_vQuery.clear();
+  m_grid.Query(x, y, m_nRadius, m_vQuery);
+  m_vTarget.clear();
+  for (uint32_t i : m_vQuery) m_vTarget.push_back(world[i]);
+  std::sort(m_vTarget.begin(), m_vTarget.end(),
+            [](const SNetEntity& a, const SNetEntity& b) {
+              return a.nId < b.nId;
+            });
+
+  static const std::vector<SNetEntity> none;
+  const SSent& base = c.vSent[c.nAck % m_nHistory];
+  const bool hasBase = c.nAck > 0 && tick > c.nAck &&
+                       tick - c.nAck < m_nHistory && base.nTick == c.nAck;
+  const std::vector<SNetEntity>& from = hasBase ? base.vView : none;
+
+  SSent& sent = c.vSent[tick % m_nHistory];
+  sent.nTick = tick;
+  sent.vView.clear();
+
+  CBitWriter w(m_vPacket);
+  w.Write((uint32_t)eNetPacket::Snapshot, 8);
+  w.Write(tick, 32);
+  w.Write(hasBase ? c.nAck : 0, 32);
+  w.WriteVar(c.nPlayerId);
+
+  uint32_t lastId = 0;  // ids are never 0
+  bool full = false;
+  c.stats.nWritten = c.stats.nDeferred = 0;
+
+  auto entry = [&](eNetOp op, const SNetEntity& b, const SNetEntity& e) {
+    if (full) return false;
+    const size_t mark = w.GetBits();
+    w.Write((uint32_t)op, 2);
+    w.WriteVar(e.nId - lastId - 1);
+    if (op == eNetOp::New) w.Write(e.nType, 3);
+    if (op != eNetOp::Remove) WriteEntityDelta(w, b, e);
+
+    if (w.GetBytes() + 1 > m_nBudget) {  // room for the end
+      w.Truncate(mark);
+      full = true;
+      return false;
+    }
+
+    lastId = e.nId;
+    c.stats.nWritten++;
+    return true;
+  };
+
+  size_t i = 0, j = 0;  // from, target
+  while (i < from.size() || j < m_vTarget.size()) {
+    const SNetEntity* b = i < from.size() ? &from[i] : nullptr;
+    const SNetEntity* e = j < m_vTarget.size() ? &m_vTarget[j] : nullptr;
+
+    if (b && e && b->nId == e->nId) {  // in both
+      if (*b == *e) sent.vView.push_back(*b);
+      else if (entry(eNetOp::Delta, *b, *e)) sent.vView.push_back(*e);
+      else sent.vView.push_back(*b), c.stats.nDeferred++;
+      ++i, ++j;
+    }
+
+    else if (e && (!b || e->nId < b->nId)) {  // new to the client
+      SNetEntity zero;
+      zero.nId = e->nId;
+      zero.nType = e->nType;
+      if (entry(eNetOp::New, zero, *e)) sent.vView.push_back(*e);
+      else c.stats.nDeferred++;
+      ++j;
+    }
+
+    else {  // gone, or out of interest
+      if (!entry(eNetOp::Remove, *b, *b))
+        sent.vView.push_back(*b), c.stats.nDeferred++;
+      ++i;
+    }
+  }
+
+  w.Write((uint32_t)eNetOp::End, 2);
+  m_socket.Send(c.addr, m_vPacket.data(), w.GetBytes());
+
+  c.stats.nBytes += w.GetBytes() + g_nUdpHeader;
+  c.stats.nPackets++;
+  c.stats.nVisible = (uint32_t)m_vTarget.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CNetClient
+
+bool CNetClient::Connect(const SNetAddress& server, double now) {
+  Close();
+  m_server = server;
+  m_vRing.assign(m_nHistory, SReceived());
+  m_nLatest = m_nPlayerId = 0;
+  m_nBytes = 0;
+  m_nDropped = 0;
+  m_bRefused = false;
+  m_fLastConnect = now - 1e9;
+  return m_socket.Open(0);
+}
+
+void CNetClient::Close() {
+  if (m_nSlot >= 0) {
+    const uint8_t bye = (uint8_t)eNetPacket::Disconnect;
+    m_socket.Send(m_server, &bye, 1);
+  }
+
+  m_socket.Close();
+  m_nSlot = -1;
+}
+
+bool CNetClient::Poll(double now) {
+  if (!m_socket.IsOpen()) return false;
+
+  if (m_nSlot < 0 && !m_bRefused && now - m_fLastConnect >= 500.0) {
+    CBitWriter w(m_vPacket);  // again every half second until welcomed
+    w.Write((uint32_t)eNetPacket::Connect, 8);
+    w.Write(g_nNetProtocol, 32);
+    m_socket.Send(m_server, m_vPacket.data(), w.GetBytes());
+    m_fLastConnect = now;
+  }
+
+  bool fresh = false;
+  uint8_t buffer[g_nNetMaxPacket];
+  SNetAddress from;
+  size_t n;
+
+  while ((n = m_socket.Receive(buffer, sizeof(buffer), from)) > 0) {
+    if (from != m_server) continue;
+    m_nBytes += n + g_nUdpHeader;
+
+    CBitReader r(buffer, n);
+    switch ((eNetPacket)r.Read(8)) {
+      case eNetPacket::Welcome: {
+        const uint32_t slot = r.Read(32);
+        if (!r.HasError()) m_nSlot = (int)slot;
+      } break;
+
+      case eNetPacket::Full: m_bRefused = true; break;
+      case eNetPacket::Disconnect: m_nSlot = -1; break;
+      case eNetPacket::Snapshot: fresh |= Decode(buffer, n); break;
+      default: break;
+    }
+  }
+
+  return fresh;
+}
+
+void CNetClient::SendInput(uint32_t frame, const SPlayerInput& input) {
+  if (m_nSlot < 0) return;
+
+  CBitWriter w(m_vPacket);
+  w.Write((uint32_t)eNetPacket::Input, 8);
+  w.Write(m_nLatest, 32);
+  w.Write(frame, 32);
+  w.Write(input.nButtons, 8);
+  m_socket.Send(m_server, m_vPacket.data(), w.GetBytes());
+}
+
+/// Apply a snapshot to the baseline it names, giving the entities as the
+/// server recorded them. A snapshot older than the latest is ignored, as is
+/// one whose baseline is no longer held or that does not decode.
+/// \param data Packet
+/// \param size Packet size in bytes
+/// \return True if it was the newest snapshot and it decoded
+
+bool CNetClient::Decode(const uint8_t* data, size_t size) {
+  CBitReader r(data, size);
+  r.Read(8);
+  const uint32_t tick = r.Read(32);
+  const uint32_t baseTick = r.Read(32);
+  const uint32_t player = r.ReadVar();
+  if (r.HasError() || tick <= m_nLatest || baseTick >= tick) return false;
+
+  static const std::vector<SNetEntity> none;
+  const SReceived& base = m_vRing[baseTick % m_nHistory];
+  if (baseTick > 0 && (base.nTick != baseTick || tick - baseTick >= m_nHistory)) {
+    m_nDropped++;
+    return false;
+  }
+
+  const std::vector<SNetEntity>& from = baseTick > 0 ? base.vView : none;
+  SReceived& out = m_vRing[tick % m_nHistory];
+  out.nTick = 0;
+  out.vView.clear();
+
+  uint32_t lastId = 0;
+  size_t i = 0;
+  bool ok = true;
+
+  for (;;) {
+    const eNetOp op = (eNetOp)r.Read(2);
+    if (r.HasError() || op == eNetOp::End) break;
+    const uint32_t id = lastId + 1 + r.ReadVar();
+    lastId = id;
+
+    while (i < from.size() && from[i].nId < id) out.vView.push_back(from[i++]);
+    const bool has = i < from.size() && from[i].nId == id;
+
+    if (op == eNetOp::Delta) {
+      if (!has) {
+        ok = false;
+        break;
+      }
+      SNetEntity e = from[i++];
+      ReadEntityDelta(r, e);
+      out.vView.push_back(e);
+    }
+
+    else if (op == eNetOp::New) {
+      if (has) ++i;
+      SNetEntity e;
+      e.nId = id;
+      e.nType = (uint8_t)r.Read(3);
+      ReadEntityDelta(r, e);
+      out.vView.push_back(e);
+    }
+
+    else if (has) ++i;  // removed
+  }
+
+  if (!ok || r.HasError()) {
+    m_nDropped++;
+    return false;
+  }
+
+  out.vView.insert(out.vView.end(), from.begin() + i, from.end());
+  out.nTick = m_nLatest = tick;
+  m_nPlayerId = player;
+  return true;
+}
+
+const std::vector<SNetEntity>& CNetClient::GetView() const {
+  static const std::vector<SNetEntity> none;
+  return m_nLatest > 0 ? m_vRing[m_nLatest % m_nHistory].vView : none;
+}
@@ -0,0 +1,400 @@
+/// \file Replication.h
+/// \brief Interface for state replication, CNetServer and CNetClient.
+
+#ifndef __L4RC_GAME_REPLICATION_H__
+#define __L4RC_GAME_REPLICATION_H__
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "NetSocket.h"
+#include "Rollback.h"
+
+/// \brief The kind of a replicated entity.
+enum class eNetEntity : uint8_t {
+  Player, ///< A player, nFlags has eNetFlag bits and nData the health.
+  Bullet, ///< A bullet.
+  Drop,   ///< An item in the world, nData is its sprite.
+  Count   ///< Number of kinds.
+};
+
+/// \brief A bit in a player's SNetEntity::nFlags.
+enum class eNetFlag : uint8_t {
+  FacingLeft = 1, ///< Faces left, else right.
+  Attacking = 2   ///< Attack in progress.
+};
+
+const float g_fNetPosScale = 8.0f; ///< Quantized position units per pixel.
+const float g_fNetVelScale = 4.0f; ///< Quantized velocity units per pixel/s.
+
+/// \brief Quantize a position or velocity to the nearest unit.
+inline int32_t NetQuantize(float x, float scale) {
+  return (int32_t)(x * scale + (x < 0.0f ? -0.5f : 0.5f));
+}
+
+/// \brief The state of one entity as the server sends it.
+///
+/// Positions are quantized to an eighth of a pixel and velocities to a
+/// quarter of a pixel per second, which no one can see and which makes a
+/// field that has not moved exactly equal to its baseline, so it costs
+/// nothing to send. There are no padding bytes, so entities compare with
+/// `memcmp()`.
+struct SNetEntity {
+  uint32_t nId = 0;    ///< Unique while the entity lives, never 0.
+  uint8_t nType = 0;   ///< eNetEntity.
+  uint8_t nFlags = 0;  ///< Bits whose meaning depends on the type.
+  uint16_t nData = 0;  ///< Value whose meaning depends on the type.
+  int32_t nX = 0;      ///< Position x, in units of 1 / g_fNetPosScale pixels.
+  int32_t nY = 0;      ///< Position y.
+  int32_t nVX = 0;     ///< Velocity x, in 1 / g_fNetVelScale pixels per second.
+  int32_t nVY = 0;     ///< Velocity y.
+
+  /// \brief Set the position in pixels.
+  void SetPos(float x, float y) {
+    nX = NetQuantize(x, g_fNetPosScale);
+    nY = NetQuantize(y, g_fNetPosScale);
+  }
+
+  /// \brief Set the velocity in pixels per second.
+  void SetVel(float x, float y) {
+    nVX = NetQuantize(x, g_fNetVelScale);
+    nVY = NetQuantize(y, g_fNetVelScale);
+  }
+
+  float GetX() const { return nX / g_fNetPosScale; } ///< Position x, pixels.
+  float GetY() const { return nY / g_fNetPosScale; } ///< Position y, pixels.
+  float GetVX() const { return nVX / g_fNetVelScale; } ///< Velocity x.
+  float GetVY() const { return nVY / g_fNetVelScale; } ///< Velocity y.
+
+  bool operator==(const SNetEntity& x) const {
+    return memcmp(this, &x, sizeof(SNetEntity)) == 0;
+  } ///< Same state.
+  bool operator!=(const SNetEntity& x) const { return !(*this == x); }
+};
+
+/// \brief A packet's kind, its first byte.
+enum class eNetPacket : uint8_t {
+  Connect,    ///< Client asks to join.
+  Welcome,    ///< Server accepts, with the client's slot.
+  Input,      ///< Client's input and the last snapshot it received.
+  Snapshot,   ///< Server's entities, as a delta from an acknowledged one.
+  Disconnect, ///< Either side leaves.
+  Full        ///< Server has no free slot.
+};
+
+const uint32_t g_nNetProtocol = 0x4c34524e; ///< Sent in Connect, "L4RN".
+const size_t g_nNetMaxPacket = 1400; ///< Largest packet, below the MTU.
+
+/// \brief Write values of any number of bits into a byte array.
+class CBitWriter {
+ private:
+  std::vector<uint8_t>& m_vBytes; ///< Output, grows as needed.
+  size_t m_nBits = 0;             ///< Bits written.
+
+ public:
+  /// \brief Write into an array, which is emptied first.
+  explicit CBitWriter(std::vector<uint8_t>& bytes) : m_vBytes(bytes) {
+    m_vBytes.clear();
+  }
+
+  /// \brief Write the low bits of a value, least significant first.
+  void Write(uint32_t value, uint32_t bits);
+
+  /// \brief Write an unsigned value in 4, 8, 16 or 32 bits, after a 2 bit
+  /// size, so that small values are small.
+  void WriteVar(uint32_t value);
+
+  /// \brief Write a signed value so that small magnitudes are small.
+  void WriteSigned(int32_t value) {
+    WriteVar((uint32_t)value << 1 ^ (uint32_t)(value >> 31));
+  }
+
+  /// \brief Drop the bits written after a point, to undo a write.
+  void Truncate(size_t bits);
+
+  size_t GetBits() const { return m_nBits; } ///< Bits written.
+  size_t GetBytes() const { return (m_nBits + 7) / 8; } ///< Bytes written.
+};
+
+/// \brief Read what a CBitWriter wrote.
+///
+/// Reading past the end gives zeros and sets an error flag, so a short or
+/// damaged packet is found once at the end rather than at every read.
+class CBitReader {
+ private:
+  const uint8_t* m_pBytes; ///< Input.
+  size_t m_nSize;          ///< Input size in bits.
+  size_t m_nBits = 0;      ///< Bits read.
+  bool m_bError = false;   ///< Read past the end.
+
+ public:
+  /// \brief Read from a buffer.
+  CBitReader(const void* data, size_t bytes)
+      : m_pBytes((const uint8_t*)data), m_nSize(bytes * 8) {}
+
+  uint32_t Read(uint32_t bits); ///< Read a value written by Write().
+  uint32_t ReadVar(); ///< Read a value written by WriteVar().
+
+  /// \brief Read a value written by WriteSigned().
+  int32_t ReadSigned() {
+    const uint32_t u = ReadVar();
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+  }
+
+  bool HasError() const { return m_bError; } ///< Read past the end.
+};
+
+/// \brief Encode an entity as a delta from a baseline.
+/// \param w Writer
+/// \param base Baseline, a zero entity for a new one
+/// \param x Entity
+void WriteEntityDelta(CBitWriter& w, const SNetEntity& base,
+                      const SNetEntity& x);
+
+/// \brief Decode an entity written by WriteEntityDelta().
+/// \param r Reader
+/// \param x [in, out] Baseline in, entity out
+void ReadEntityDelta(CBitReader& r, SNetEntity& x);
+
+/// \brief Entities bucketed by cell for interest queries.
+///
+/// The cells are the tile map's chunks, so a client is sent what is in the
+/// chunks around its player, the same chunks the renderer culls by. The
+/// grid is rebuilt from scratch every tick with a counting sort, which is
+/// linear and touches no hash table.
+class CInterestGrid {
+ private:
+  float m_fCell = 512.0f;        ///< Cell width and height in pixels.
+  int m_nW = 1;                  ///< Cells wide.
+  int m_nH = 1;                  ///< Cells high.
+  std::vector<uint32_t> m_vStart; ///< First index of each cell, and an end.
+  std::vector<uint32_t> m_vIndex; ///< Entity indices, by cell.
+  std::vector<uint32_t> m_vCell;  ///< Cell of each entity.
+
+ public:
+  /// \brief Set the grid size. Entities outside are put in the edge cells.
+  /// \param cell Cell size in pixels
+  /// \param w Cells wide
+  /// \param h Cells high
+  void Reset(float cell, int w, int h);
+
+  /// \brief Bucket the entities.
+  void Build(const std::vector<SNetEntity>& entities);
+
+  /// \brief Get the entities in the cells within a radius of a point.
+  /// \param x Point x in pixels
+  /// \param y Point y in pixels
+  /// \param radius Cells around the point's cell, 0 for that cell only
+  /// \param out [out] Entity indices, appended, in no particular order
+  void Query(float x, float y, int radius, std::vector<uint32_t>& out) const;
+};
+
+/// \brief Stable entity ids for objects that have none of their own.
+///
+/// Bullets and drops are known to the game by pointer. Each pointer seen is
+/// given an id that it keeps until a `Sweep()` finds it was not seen since
+/// the last sweep, so deleted objects free their entries. The kind goes in
+/// the key, in the low bits that an allocation leaves zero, so a drop
+/// allocated where a bullet was between two sweeps is not taken for it.
+class CNetIdMap {
+ private:
+  /// \brief An object's id and when it was last seen.
+  struct SEntry {
+    uint32_t nId;   ///< Id.
+    uint32_t nSeen; ///< Sweep it was last seen in.
+  };
+
+  std::unordered_map<uintptr_t, SEntry> m_map; ///< By object and kind.
+  uint32_t m_nNext = 1;  ///< Next id.
+  uint32_t m_nSweep = 0; ///< Sweeps so far.
+
+ public:
+  /// \brief Start ids from a value, so that ids below it can be reserved.
+  explicit CNetIdMap(uint32_t first = 1) : m_nNext(first) {}
+
+  uint32_t Get(const void* p, eNetEntity type); ///< Get an object's id.
+  void Sweep(); ///< Forget objects not seen since the last sweep.
+};
+
+/// \brief One client's traffic.
+struct SNetClientStats {
+  uint64_t nBytes = 0;    ///< Bytes sent to it, with UDP and IP headers.
+  uint32_t nPackets = 0;  ///< Snapshots sent to it.
+  uint32_t nVisible = 0;  ///< Entities of interest in the last snapshot.
+  uint32_t nWritten = 0;  ///< Entities written in the last snapshot.
+  uint32_t nDeferred = 0; ///< Left for later by the packet size limit.
+};
+
+/// \brief The authoritative end of state replication.
+///
+/// Every tick the game hands over every entity and `Replicate()` sends each
+/// client a snapshot of those near its player. A snapshot is a delta from
+/// the last snapshot the client acknowledged, which both sides still hold,
+/// so an entity that has not changed is not sent at all and one that has
+/// sends only its fields that changed, as differences of the quantized
+/// values. Lost packets need no resending: the next snapshot is a delta
+/// from an older baseline, which carries whatever was lost.
+///
+/// A snapshot is kept under the MTU. If the changes do not fit, those left
+/// over stay as they were in the baseline, as far as the client knows, and
+/// go in a later snapshot. The server records what each client was sent,
+/// not what the world was, so the baselines on both sides stay the same.
+class CNetServer {
+ private:
+  /// \brief What a client knows after a snapshot, by entity id.
+  struct SSent {
+    uint32_t nTick = 0;              ///< Tick, 0 if unused.
+    std::vector<SNetEntity> vView;   ///< Entities, sorted by id.
+  };
+
+  /// \brief A connected client.
+  struct SClient {
+    bool bActive = false;     ///< Slot in use.
+    SNetAddress addr;         ///< Where it sends from.
+    uint32_t nPlayerId = 0;   ///< Entity it watches, 0 if none.
+    uint32_t nAck = 0;        ///< Latest snapshot it has received.
+    double fLastHeard = 0.0;  ///< Time of its last packet, ms.
+    SPlayerInput input;       ///< Latest input, with presses since taken.
+    uint32_t nInputFrame = 0; ///< Client frame of the latest input.
+    std::vector<SSent> vSent; ///< Snapshots sent, by tick.
+    SNetClientStats stats;    ///< Traffic.
+  };
+
+  CUdpSocket m_socket;               ///< Socket.
+  std::vector<SClient> m_vClients;   ///< Client slots.
+  std::vector<size_t> m_vJoined;     ///< Slots that joined in the last poll.
+  std::vector<size_t> m_vLeft;       ///< Slots that left in the last poll.
+  CInterestGrid m_grid;              ///< Entities by chunk.
+  int m_nRadius = 1;                 ///< Chunks around a player to send.
+  size_t m_nBudget = 1200;           ///< Most bytes in a snapshot.
+  double m_fTimeout = 5000.0;        ///< Drop silent clients after this, ms.
+  double m_fTickTime = 0.0;          ///< Time of the last Replicate(), ms.
+
+  std::vector<uint8_t> m_vPacket;    ///< Packet being written.
+  std::vector<uint32_t> m_vQuery;    ///< Interest query result.
+  std::vector<SNetEntity> m_vTarget; ///< Entities of interest, by id.
+  std::vector<std::pair<uint32_t, uint32_t>> m_vById; ///< Id, index.
+
+  static const size_t m_nHistory = 32; ///< Snapshots kept per client.
+
+  int FindClient(const SNetAddress& addr) const; ///< Slot, -1 if none.
+  void Drop(size_t slot); ///< Free a slot.
+  void Send(size_t slot, uint32_t tick, const std::vector<SNetEntity>& world);
+
+ public:
+  /// \brief Open the socket.
+  /// \param port Port
+  /// \param clients Most clients
+  /// \param loopback Accept clients on this machine only
+  /// \return False if the socket could not be opened
+  bool Open(uint16_t port, size_t clients, bool loopback = false);
+
+  void Close(); ///< Tell the clients and close the socket.
+  bool IsOpen() const { return m_socket.IsOpen(); } ///< Open check.
+  uint16_t GetPort() const { return m_socket.GetPort(); } ///< Port.
+
+  /// \brief Set the interest grid, which is the tile map's chunk grid.
+  /// \param cell Chunk size in pixels
+  /// \param w Chunks wide
+  /// \param h Chunks high
+  /// \param radius Chunks around a player to send
+  void SetInterest(float cell, int w, int h, int radius);
+
+  /// \brief Set the most bytes in a snapshot, below the MTU.
+  void SetBudget(size_t bytes);
+
+  /// \brief Read every packet that has arrived: joins, inputs and
+  /// acknowledgements, and drop clients that have gone quiet.
+  /// \param now Time in ms
+  void Poll(double now);
+
+  const std::vector<size_t>& GetJoined() const { return m_vJoined; } ///< New.
+  const std::vector<size_t>& GetLeft() const { return m_vLeft; } ///< Gone.
+  size_t GetMaxClients() const { return m_vClients.size(); } ///< Slots.
+  size_t GetClientCount() const; ///< Clients connected.
+  bool IsConnected(size_t slot) const { return m_vClients[slot].bActive; }
+
+  /// \brief Set the entity a client watches, the center of its interest.
+  void SetPlayer(size_t slot, uint32_t id) { m_vClients[slot].nPlayerId = id; }
+
+  /// \brief Get a client's input for a tick: the buttons held in its latest
+  /// input, and every press since the last call, so that a press between
+  /// two ticks is not lost.
+  SPlayerInput TakeInput(size_t slot);
+
+  /// \brief Send every client a snapshot.
+  /// \param tick Tick number, from 1
+  /// \param world Every entity, in any order
+  void Replicate(uint32_t tick, const std::vector<SNetEntity>& world);
+
+  /// \brief Get a client's traffic.
+  const SNetClientStats& GetStats(size_t slot) const {
+    return m_vClients[slot].stats;
+  }
+
+  double GetTickTime() const { return m_fTickTime; } ///< Last Replicate(), ms.
+};
+
+/// \brief The replicating end of a connection to a CNetServer.
+///
+/// The client keeps the snapshots it has received, so it can decode a delta
+/// from any it acknowledged, and acknowledges the latest with every input
+/// it sends.
+class CNetClient {
+ private:
+  /// \brief A snapshot received.
+  struct SReceived {
+    uint32_t nTick = 0;            ///< Tick, 0 if unused.
+    std::vector<SNetEntity> vView; ///< Entities, sorted by id.
+  };
+
+  CUdpSocket m_socket;            ///< Socket.
+  SNetAddress m_server;           ///< Server address.
+  int m_nSlot = -1;               ///< Slot on the server, -1 until welcomed.
+  bool m_bRefused = false;        ///< Server was full.
+  double m_fLastConnect = -1e9;   ///< Time of the last Connect, ms.
+  uint32_t m_nLatest = 0;         ///< Latest tick received.
+  uint32_t m_nPlayerId = 0;       ///< Entity it watches.
+  std::vector<SReceived> m_vRing; ///< Snapshots received, by tick.
+  std::vector<uint8_t> m_vPacket; ///< Packet buffer.
+  uint64_t m_nBytes = 0;          ///< Bytes received, with headers.
+  uint32_t m_nDropped = 0;        ///< Snapshots that could not be decoded.
+
+  static const size_t m_nHistory = 64; ///< Snapshots kept, above the server's.
+
+  bool Decode(const uint8_t* data, size_t size); ///< Read a snapshot.
+
+ public:
+  /// \brief Open a socket on any port and ask a server to join.
+  /// \param server Server address
+  /// \param now Time in ms
+  /// \return False if the socket could not be opened
+  bool Connect(const SNetAddress& server, double now);
+
+  void Close(); ///< Tell the server and close the socket.
+
+  /// \brief Read every packet that has arrived, and ask to join again if
+  /// the server has not answered.
+  /// \param now Time in ms
+  /// \return True if a newer snapshot arrived
+  bool Poll(double now);
+
+  /// \brief Send an input, with the latest snapshot received.
+  /// \param frame Client frame number
+  /// \param input Input
+  void SendInput(uint32_t frame, const SPlayerInput& input);
+
+  bool IsConnected() const { return m_nSlot >= 0; } ///< Welcomed.
+  bool IsRefused() const { return m_bRefused; } ///< Server was full.
+  uint32_t GetTick() const { return m_nLatest; } ///< Latest tick.
+  uint32_t GetPlayerId() const { return m_nPlayerId; } ///< Entity watched.
+  uint64_t GetBytes() const { return m_nBytes; } ///< Bytes received.
+  uint32_t GetDropped() const { return m_nDropped; } ///< Undecodable.
+
+  /// \brief Get the entities in the latest snapshot, sorted by id.
+  const std::vector<SNetEntity>& GetView() const;
+};
+
+#endif  //__L4RC_GAME_REPLICATION_H__
@@ -0,0 +1,188 @@
+/// \file Rollback.cpp
+/// \brief Code for the rollback driver CRollback and CLoopbackPeer.
+
+#include "Rollback.h"
+
+#include <algorithm>
+#include <chrono>
+
+///////////////////////////////////////////////////////////////////////////////
+// CRollback
+
+CRollback::CRollback(size_t players, uint32_t depth) { Reset(players, depth); }
+
+/// Size the input ring to hold every frame that can still be rolled back to
+/// and every frame a peer can be ahead by, which is `depth` frames each way,
+/// and start again from frame 0 with no inputs.
+/// \param players Number of players
+/// \param depth Most frames to roll back
+
+void CRollback::Reset(size_t players, uint32_t depth) {
+  m_nPlayers = std::max<size_t>(players, 1);
+  m_nDepth = std::max<uint32_t>(depth, 1);
+  m_nFrame = m_nBarrier = 0;
+  m_nRollTo = UINT32_MAX;
+
+  const size_t n = 2 * (m_nDepth + 1) * m_nPlayers;
+  m_vInput.assign(n, SPlayerInput());
+  m_vSlotFrame.assign(n, UINT32_MAX);
+  m_vConfirmed.assign(n, 0);
+  m_vLatest.assign(m_nPlayers, SPlayerInput());
+  m_vLatestFrame.assign(m_nPlayers, 0);
+  m_vConfirmedTo.assign(m_nPlayers, 0);
+  m_vCurrent.assign(m_nPlayers, SPlayerInput());
+
+  m_vStats.assign(m_nDepth + 1, SRollbackStat());
+  m_nLastDepth = m_nLate = m_nPredicted = 0;
+  m_fLastTime = 0.0;
+}
+
+void CRollback::SetCallbacks(SaveFn save, LoadFn load, StepFn step) {
+  m_fnSave = save;
+  m_fnLoad = load;
+  m_fnStep = step;
+}
+
+size_t CRollback::Slot(uint32_t frame, size_t player) const {
+  return (frame % (2 * (m_nDepth + 1))) * m_nPlayers + player;
+}
+
+/// Get a player's input for a frame: the real one if it has arrived, or
+/// else the buttons held in the latest real one. The input is kept, so that a real input that
+/// arrives later can be checked against it.
+/// \param frame Frame
+/// \param player Player
+/// \return Input
+
+const SPlayerInput& CRollback::Predict(uint32_t frame, size_t player) {
+  const size_t slot = Slot(frame, player);
+
+  if (m_vSlotFrame[slot] != frame || !m_vConfirmed[slot]) {
+    m_vInput[slot] = m_vLatest[player].Held();
+    m_vSlotFrame[slot] = frame;
+    m_vConfirmed[slot] = 0;
+  }
+
+  return m_vInput[slot];
+}
+
+/// Keep the input. If its frame has already run with a different input,
+/// remember to roll back to it. An input from before the barrier, or too old
+/// or too far ahead to fit in the ring, is counted as late and dropped.
+/// \param player Player
+/// \param frame Frame the input is for
+/// \param input Input
+
+void CRollback::AddInput(size_t player, uint32_t frame,
+                         const SPlayerInput& input) {
+  if (player >= m_nPlayers) return;
+
+  if (frame < m_nBarrier || frame + m_nDepth < m_nFrame ||
+      frame > m_nFrame + m_nDepth) {
+    ++m_nLate;
+    return;
+  }
+
+  const size_t slot = Slot(frame, player);
+  if (m_vSlotFrame[slot] == frame && m_vConfirmed[slot]) return;  // a repeat
+
+  if (frame < m_nFrame &&
+      (m_vSlotFrame[slot] != frame || m_vInput[slot] != input))
+    m_nRollTo = std::min(m_nRollTo, frame);
+
+  m_vInput[slot] = input;
+  m_vSlotFrame[slot] = frame;
+  m_vConfirmed[slot] = 1;
+
+  if (frame >= m_vLatestFrame[player]) {
+    m_vLatest[player] = input;
+    m_vLatestFrame[player] = frame;
+  }
+
+  uint32_t& to = m_vConfirmedTo[player];
+  to = std::max(to, m_nBarrier);
+  for (size_t s = Slot(to, player);
+       m_vSlotFrame[s] == to && m_vConfirmed[s]; s = Slot(to, player))
+    ++to;
+}
+
+bool CRollback::CanAdvance() const {
+  for (size_t p = 0; p < m_nPlayers; ++p)
+    if (m_nFrame >= std::max(m_vConfirmedTo[p], m_nBarrier) + m_nDepth)
+      return false;
+
+  return true;
+}
+
+/// If a frame ran with the wrong input, load the state from before it and
+/// run it and every frame after it again, saving the state before each as
+/// it goes, since it has changed. Then save the state before this frame.
+/// \return One input per player
+
+const SPlayerInput* CRollback::BeginFrame() {
+  if (m_nRollTo < m_nFrame) {
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    const uint32_t from = m_nRollTo;
+    m_nRollTo = UINT32_MAX;
+
+    m_fnLoad(from);
+    for (uint32_t f = from; f < m_nFrame; ++f) {
+      if (f > from) m_fnSave(f);
+      for (size_t p = 0; p < m_nPlayers; ++p) m_vCurrent[p] = Predict(f, p);
+      m_fnStep(f, m_vCurrent.data());
+    }
+
+    m_nLastDepth = std::min(m_nFrame - from, m_nDepth);
+    m_fLastTime = std::chrono::duration<double, std::milli>(
+                      std::chrono::high_resolution_clock::now() - t0)
+                      .count();
+    m_vStats[m_nLastDepth].nCount++;
+    m_vStats[m_nLastDepth].fTime += m_fLastTime;
+  }
+
+  m_fnSave(m_nFrame);
+
+  for (size_t p = 0; p < m_nPlayers; ++p) {
+    const size_t slot = Slot(m_nFrame, p);
+    if (m_vSlotFrame[slot] != m_nFrame || !m_vConfirmed[slot]) ++m_nPredicted;
+    m_vCurrent[p] = Predict(m_nFrame, p);
+  }
+
+  return m_vCurrent.data();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CLoopbackPeer
+
+CLoopbackPeer::CLoopbackPeer(double delay, double jitter, uint32_t seed) {
+  Reset(delay, jitter, seed);
+}
+
+void CLoopbackPeer::Reset(double delay, double jitter, uint32_t seed) {
+  m_vFlights.clear();
+  m_fDelay = std::max(delay, 0.0);
+  m_fJitter = std::max(jitter, 0.0);
+  m_nSeq = 0;
+  m_rng.seed(seed);
+}
+
+/// Put the packet in flight, to arrive after the delay plus a jitter drawn
+/// evenly from 0 to the most jitter.
+/// \param packet Packet
+/// \param now Time in ms
+
+void CLoopbackPeer::Send(const SInputPacket& packet, double now) {
+  const double jitter =
+      std::uniform_real_distribution<double>(0.0, m_fJitter)(m_rng);
+  m_vFlights.push_back({now + m_fDelay + jitter, m_nSeq++, packet});
+  std::push_heap(m_vFlights.begin(), m_vFlights.end(), std::greater<SFlight>());
+}
+
+void CLoopbackPeer::Receive(double now, std::vector<SInputPacket>& packets) {
+  while (!m_vFlights.empty() && m_vFlights.front().fArrival <= now) {
+    std::pop_heap(m_vFlights.begin(), m_vFlights.end(),
+                  std::greater<SFlight>());
+    packets.push_back(m_vFlights.back().packet);
+    m_vFlights.pop_back();
+  }
+}
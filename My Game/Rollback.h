@@ -0,0 +1,202 @@
+/// \file Rollback.h
+/// \brief Interface for the rollback driver CRollback and CLoopbackPeer.
+
+#ifndef __L4RC_GAME_ROLLBACK_H__
+#define __L4RC_GAME_ROLLBACK_H__
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+/// \brief A button in SPlayerInput.
+enum class eInput : uint8_t {
+  Left = 1,    ///< Held, run left.
+  Right = 2,   ///< Held, run right.
+  Down = 4,    ///< Held, drop through platforms.
+  Jump = 8,    ///< Pressed this frame.
+  Attack = 16, ///< Pressed this frame.
+  Shoot = 32,  ///< Pressed this frame.
+  Menu = 64    ///< A menu has the keyboard, the player is not updated.
+};
+
+/// \brief One player's input for one frame.
+///
+/// This is all that CPlayer::Update() reads, so a frame can be simulated
+/// again from it without the keyboard. It is one byte, so that it is cheap
+/// to keep for every frame and to send to a peer.
+struct SPlayerInput {
+  uint8_t nButtons = 0; ///< eInput bits.
+
+  bool Has(eInput b) const { return (nButtons & (uint8_t)b) != 0; } ///< Test.
+  void Set(eInput b) { nButtons |= (uint8_t)b; } ///< Press.
+
+  /// \brief Get the buttons that are held, not pressed this frame.
+  SPlayerInput Held() const {
+    SPlayerInput x;
+    x.nButtons = nButtons & ((uint8_t)eInput::Left | (uint8_t)eInput::Right |
+                             (uint8_t)eInput::Down | (uint8_t)eInput::Menu);
+    return x;
+  }
+
+  bool operator==(const SPlayerInput& x) const {
+    return nButtons == x.nButtons;
+  } ///< Same buttons.
+  bool operator!=(const SPlayerInput& x) const { return !(*this == x); }
+};
+
+/// \brief One frame of one player's input, as sent to a peer.
+struct SInputPacket {
+  uint32_t nFrame = 0;  ///< Frame the input is for.
+  uint32_t nPlayer = 0; ///< Player it is from.
+  SPlayerInput input;   ///< Buttons.
+};
+
+/// \brief Rollbacks of one depth.
+struct SRollbackStat {
+  uint32_t nCount = 0; ///< Number of rollbacks.
+  double fTime = 0.0;  ///< Time spent simulating again, in ms.
+};
+
+/// \brief Rollback driver.
+///
+/// Instead of waiting for every player's input before running a frame, the
+/// frame runs at once with a prediction for the inputs that have not arrived,
+/// which is the buttons held in the last input that did arrive from that
+/// player. Buttons pressed once, to jump or shoot, are not repeated, since
+/// a press predicted wrongly shows a jump that never happened. When an input
+/// arrives for a frame that has already run, and it is not what was
+/// predicted, the driver loads the state from before that frame and runs
+/// every frame since again, with the real input and new predictions. So
+/// the game never waits for the network, and is only wrong for as long as a
+/// packet takes to arrive.
+///
+/// The driver owns the inputs. The state is the game's: the driver asks it to
+/// save its state before each frame and to load it again by frame number, so
+/// the game keeps a ring of depth + 1 snapshots with buffers that it reuses,
+/// and nothing is allocated while playing. The driver can roll back at most
+/// `depth` frames. It asks to stall rather than predict further ahead of a
+/// player than that, and counts an input older than that as late.
+class CRollback {
+ public:
+  typedef std::function<void(uint32_t)> SaveFn; ///< Save state before frame.
+  typedef std::function<void(uint32_t)> LoadFn; ///< Load state before frame.
+  typedef std::function<void(uint32_t, const SPlayerInput*)> StepFn; ///< Run.
+
+ private:
+  size_t m_nPlayers = 0;  ///< Number of players.
+  uint32_t m_nDepth = 0;  ///< Most frames to roll back.
+  uint32_t m_nFrame = 0;  ///< Next frame to run.
+  uint32_t m_nBarrier = 0; ///< Earliest frame that can be rolled back to.
+  uint32_t m_nRollTo = UINT32_MAX; ///< Earliest mispredicted frame.
+
+  std::vector<SPlayerInput> m_vInput; ///< Input used or confirmed, by slot.
+  std::vector<uint32_t> m_vSlotFrame; ///< Frame each slot holds.
+  std::vector<uint8_t> m_vConfirmed;  ///< Slot holds a real input.
+  std::vector<SPlayerInput> m_vLatest; ///< Latest real input by player.
+  std::vector<uint32_t> m_vLatestFrame; ///< Its frame, by player.
+  std::vector<uint32_t> m_vConfirmedTo; ///< First frame with no real input.
+  std::vector<SPlayerInput> m_vCurrent; ///< Inputs for the current frame.
+
+  SaveFn m_fnSave; ///< Save the state before a frame.
+  LoadFn m_fnLoad; ///< Load the state before a frame.
+  StepFn m_fnStep; ///< Run a frame, when simulating again.
+
+  std::vector<SRollbackStat> m_vStats; ///< Rollbacks by depth.
+  uint32_t m_nLastDepth = 0; ///< Depth of the last rollback.
+  double m_fLastTime = 0.0;  ///< Time of the last rollback in ms.
+  uint32_t m_nLate = 0;      ///< Inputs too old to roll back for.
+  uint32_t m_nPredicted = 0; ///< Inputs predicted, in every frame run.
+
+  size_t Slot(uint32_t frame, size_t player) const; ///< Input ring index.
+  const SPlayerInput& Predict(uint32_t frame, size_t player); ///< Input.
+
+ public:
+  CRollback(size_t players = 1, uint32_t depth = 8); ///< Constructor.
+
+  /// \brief Forget everything and start again from frame 0.
+  void Reset(size_t players, uint32_t depth);
+
+  /// \brief Set the game's callbacks.
+  /// \param save Save the state before a frame
+  /// \param load Load the state before a frame
+  /// \param step Run a frame with the given inputs, when simulating again
+  void SetCallbacks(SaveFn save, LoadFn load, StepFn step);
+
+  /// \brief Add a player's real input for a frame, local or from a peer.
+  void AddInput(size_t player, uint32_t frame, const SPlayerInput& input);
+
+  /// \brief Disallow rollbacks to frames before this one, after the game
+  /// changes state outside of frames, as loading a save does.
+  void Barrier() { m_nBarrier = m_nFrame; m_nRollTo = UINT32_MAX; }
+
+  /// \brief Check whether running the next frame keeps every player within
+  /// the rollback depth.
+  bool CanAdvance() const;
+
+  /// \brief Roll back and simulate again if need be, save the state before
+  /// this frame, and get the inputs to run it with.
+  /// \return One input per player
+  const SPlayerInput* BeginFrame();
+
+  /// \brief End the frame started by `BeginFrame()`.
+  void EndFrame() { ++m_nFrame; }
+
+  /// \brief Run a frame through the step callback.
+  void Advance() { m_fnStep(m_nFrame, BeginFrame()); EndFrame(); }
+
+  uint32_t GetFrame() const { return m_nFrame; } ///< Next frame to run.
+  uint32_t GetDepth() const { return m_nDepth; } ///< Most frames rolled back.
+  uint32_t GetLastDepth() const { return m_nLastDepth; } ///< Last rollback.
+  double GetLastTime() const { return m_fLastTime; } ///< Its time in ms.
+  uint32_t GetLate() const { return m_nLate; } ///< Inputs too late.
+  uint32_t GetPredicted() const { return m_nPredicted; } ///< Predictions.
+
+  /// \brief Get the rollbacks by depth, from 0 to the depth.
+  const std::vector<SRollbackStat>& GetStats() const { return m_vStats; }
+};
+
+/// \brief A network link to a peer that is really this machine.
+///
+/// Packets sent are received once a delay has passed, plus a random jitter,
+/// so they can arrive out of order, as they do over UDP. It tests rollback
+/// with any latency without a second machine.
+class CLoopbackPeer {
+ private:
+  /// \brief A packet in flight.
+  struct SFlight {
+    double fArrival;      ///< Time it arrives, in ms.
+    uint32_t nSeq;        ///< Order sent, to break ties.
+    SInputPacket packet;  ///< Packet.
+
+    bool operator>(const SFlight& x) const {
+      return fArrival > x.fArrival || (fArrival == x.fArrival && nSeq > x.nSeq);
+    } ///< Arrives later.
+  };
+
+  std::vector<SFlight> m_vFlights; ///< Heap, first to arrive at the front.
+  double m_fDelay = 0.0;   ///< Delay in ms.
+  double m_fJitter = 0.0;  ///< Most extra delay in ms.
+  uint32_t m_nSeq = 0;     ///< Packets sent.
+  std::mt19937 m_rng;      ///< Jitter.
+
+ public:
+  CLoopbackPeer(double delay = 0.0, double jitter = 0.0, uint32_t seed = 1);
+
+  /// \brief Set the delay and jitter and drop packets in flight.
+  void Reset(double delay, double jitter, uint32_t seed = 1);
+
+  /// \brief Send a packet.
+  /// \param packet Packet
+  /// \param now Time in ms
+  void Send(const SInputPacket& packet, double now);
+
+  /// \brief Receive the packets that have arrived, in order of arrival.
+  /// \param now Time in ms
+  /// \param packets [out] Packets, appended
+  void Receive(double now, std::vector<SInputPacket>& packets);
+
+  size_t GetInFlight() const { return m_vFlights.size(); } ///< Not arrived.
+};
+
+#endif  //__L4RC_GAME_ROLLBACK_H__
@@ -0,0 +1,273 @@
+/// \file SaveGame.cpp
+/// \brief Code for the binary save game format and CSaveWriter.
+
+#include "SaveGame.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "AssetPack.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/// Seek to an offset from the start of a file, past 2GB if need be.
+/// \param pFile File
+/// \param offset Offset in bytes
+/// \return True on success
+
+static bool Seek(FILE* pFile, uint64_t offset) {
+#ifdef _MSC_VER
+  return _fseeki64(pFile, (long long)offset, SEEK_SET) == 0;
+#else
+  return fseeko(pFile, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+/// Get the size of a file, leaving the position at the end.
+/// \param pFile File
+/// \return Size in bytes
+
+static uint64_t GetSize(FILE* pFile) {
+#ifdef _MSC_VER
+  if (_fseeki64(pFile, 0, SEEK_END)) return 0;
+  return (uint64_t)_ftelli64(pFile);
+#else
+  if (fseeko(pFile, 0, SEEK_END)) return 0;
+  return (uint64_t)ftello(pFile);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SSaveGame
+
+uint32_t SSaveGame::AddString(const std::string& s) {
+  const uint32_t offset = (uint32_t)strStrings.size();
+  strStrings.append(s.c_str(), s.size() + 1);  // with the null
+  return offset;
+}
+
+const char* SSaveGame::GetString(uint32_t offset) const {
+  return offset < strStrings.size() ? strStrings.c_str() + offset : "";
+}
+
+void SSaveGame::Clear() {
+  player = SSavePlayer();
+  inventory = SSaveInventory();
+  vSlots.clear();
+  vItems.clear();
+  vDrops.clear();
+  vBullets.clear();
+  strStrings.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Writing and reading
+
+/// \brief A section's data in memory.
+struct SSectionData {
+  eSaveSection eKind;  ///< Kind of data.
+  const void* pData;   ///< Records.
+  uint32_t nCount;     ///< Number of records.
+  size_t nSize;        ///< Size of a record.
+};
+
+/// Write the header, then each section's records straight from the
+/// snapshot's arrays, then the section table, and last the header again now
+/// that the table's offset is known.
+/// \param fileName File name
+/// \param save Snapshot
+/// \return True if every write succeeded
+
+bool WriteSaveGame(const char* fileName, const SSaveGame& save) {
+  const SSectionData data[] = {
+    {eSaveSection::Player, &save.player, 1, sizeof(SSavePlayer)},
+    {eSaveSection::Inventory, &save.inventory, 1, sizeof(SSaveInventory)},
+    {eSaveSection::Slots, save.vSlots.data(), (uint32_t)save.vSlots.size(),
+     sizeof(uint32_t)},
+    {eSaveSection::Items, save.vItems.data(), (uint32_t)save.vItems.size(),
+     sizeof(SSaveItem)},
+    {eSaveSection::Drops, save.vDrops.data(), (uint32_t)save.vDrops.size(),
+     sizeof(SSaveDrop)},
+    {eSaveSection::Bullets, save.vBullets.data(),
+     (uint32_t)save.vBullets.size(), sizeof(SSaveBullet)},
+    {eSaveSection::Strings, save.strStrings.data(),
+     (uint32_t)save.strStrings.size(), 1},
+  };
+  const uint32_t n = sizeof(data) / sizeof(data[0]);
+
+  FILE* pFile = fopen(fileName, "wb");
+  if (!pFile) return false;
+
+  SSaveHeader header = {};
+  memcpy(header.szMagic, "LSAV", 4);
+  header.nVersion = g_nSaveVersion;
+  header.nSections = n;
+
+  bool ok = fwrite(&header, sizeof(header), 1, pFile) == 1;
+  uint64_t offset = sizeof(header);
+  SSaveSection table[n];
+
+  for (uint32_t i = 0; i < n && ok; ++i) {
+    const SSectionData& d = data[i];
+    const size_t size = d.nCount * d.nSize;
+
+    table[i].eKind = d.eKind;
+    table[i].nCount = d.nCount;
+    table[i].nOffset = offset;
+    table[i].nSize = size;
+    table[i].nHash = PackHash(d.pData, size);
+
+    ok = size == 0 || fwrite(d.pData, size, 1, pFile) == 1;
+    offset += size;
+  }
+
+  header.nSectionOffset = offset;
+  ok = ok && fwrite(table, sizeof(table), 1, pFile) == 1 && Seek(pFile, 0) &&
+       fwrite(&header, sizeof(header), 1, pFile) == 1;
+
+  return fclose(pFile) == 0 && ok;
+}
+
+/// Read one section into an array, checking its size and hash.
+/// \param pFile File
+/// \param s Section
+/// \param v [out] Records
+/// \return True if the section was read and is intact
+
+template <class T>
+static bool ReadSection(FILE* pFile, const SSaveSection& s, T& v) {
+  typedef typename T::value_type Record;
+  if (s.nSize != (uint64_t)s.nCount * sizeof(Record)) return false;
+
+  v.resize(s.nCount);
+  if (s.nCount == 0) return true;
+
+  return Seek(pFile, s.nOffset) &&
+         fread(&v[0], (size_t)s.nSize, 1, pFile) == 1 &&
+         PackHash(&v[0], (size_t)s.nSize) == s.nHash;
+}
+
+/// Read the header and section table, checking that they describe a file of
+/// this version whose sections all lie inside it, then read each section
+/// whose kind is known straight into the snapshot's arrays.
+/// \param fileName File name
+/// \param save [out] Snapshot
+/// \return True if the file was read and is intact
+
+bool ReadSaveGame(const char* fileName, SSaveGame& save) {
+  save.Clear();
+
+  FILE* pFile = fopen(fileName, "rb");
+  if (!pFile) return false;
+
+  const uint64_t fileSize = GetSize(pFile);
+  SSaveHeader h;
+  bool ok = Seek(pFile, 0) && fread(&h, sizeof(h), 1, pFile) == 1 &&
+            !memcmp(h.szMagic, "LSAV", 4) && h.nVersion == g_nSaveVersion &&
+            h.nSectionOffset <= fileSize &&
+            h.nSections <= (fileSize - h.nSectionOffset) / sizeof(SSaveSection);
+
+  std::vector<SSaveSection> table(ok ? h.nSections : 0);
+  ok = ok && (table.empty() ||
+              (Seek(pFile, h.nSectionOffset) &&
+               fread(table.data(), sizeof(SSaveSection), table.size(),
+                     pFile) == table.size()));
+
+  std::vector<SSavePlayer> player;
+  std::vector<SSaveInventory> inventory;
+
+  for (const SSaveSection& s : table) {
+    if (!ok) break;
+    ok = s.nOffset <= fileSize && s.nSize <= fileSize - s.nOffset;
+    if (!ok) break;
+
+    switch (s.eKind) {
+      case eSaveSection::Player: ok = ReadSection(pFile, s, player); break;
+      case eSaveSection::Inventory:
+        ok = ReadSection(pFile, s, inventory);
+        break;
+      case eSaveSection::Slots: ok = ReadSection(pFile, s, save.vSlots); break;
+      case eSaveSection::Items: ok = ReadSection(pFile, s, save.vItems); break;
+      case eSaveSection::Drops: ok = ReadSection(pFile, s, save.vDrops); break;
+      case eSaveSection::Bullets:
+        ok = ReadSection(pFile, s, save.vBullets);
+        break;
+      case eSaveSection::Strings:
+        ok = ReadSection(pFile, s, save.strStrings);
+        break;
+      default: break;  // from a later build, skip it
+    }
+  }
+
+  fclose(pFile);
+
+  ok = ok && player.size() == 1 && inventory.size() == 1;
+  if (ok) {
+    save.player = player[0];
+    save.inventory = inventory[0];
+  } else save.Clear();
+
+  return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CSaveWriter
+
+CSaveWriter::~CSaveWriter() { Wait(); }
+
+/// Put a finished temporary file in place of the save in one step, so that a
+/// crash or power cut leaves either the old save or the new one, never
+/// neither. On Windows the move replaces the old file and is flushed to disk
+/// before it returns. On POSIX `rename()` already replaces atomically.
+/// \param temp Temporary file name
+/// \param fileName Save file name
+/// \return True on success
+
+static bool ReplaceSaveFile(const char* temp, const char* fileName) {
+#ifdef _WIN32
+  return MoveFileExA(temp, fileName,
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  return rename(temp, fileName) == 0;
+#endif
+}
+
+/// Take the snapshot and start the writer thread. The last thread, if it has
+/// finished, is joined first, which does not block.
+/// \param fileName File name
+/// \param save Snapshot, moved from
+/// \return True if the save was started, false if one is in progress
+
+bool CSaveWriter::Start(const char* fileName, SSaveGame&& save) {
+  if (m_bBusy) return false;
+  if (m_thread.joinable()) m_thread.join();
+
+  m_save = std::move(save);
+  m_strFile = fileName;
+  m_bBusy = true;
+
+  m_thread = std::thread([this]() {
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    const std::string temp = m_strFile + ".tmp";
+
+    m_bResult = WriteSaveGame(temp.c_str(), m_save) &&
+                ReplaceSaveFile(temp.c_str(), m_strFile.c_str());
+    if (!m_bResult) remove(temp.c_str());
+
+    m_save.Clear();
+    m_fTime = std::chrono::duration<float, std::milli>(
+                  std::chrono::high_resolution_clock::now() - t0)
+                  .count();
+    m_bBusy = false;
+  });
+
+  return true;
+}
+
+bool CSaveWriter::Wait() {
+  if (m_thread.joinable()) m_thread.join();
+  return m_bResult;
+}
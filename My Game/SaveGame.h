@@ -0,0 +1,173 @@
+/// \file SaveGame.h
+/// \brief Interface for the binary save game format and CSaveWriter.
+
+#ifndef __L4RC_GAME_SAVEGAME_H__
+#define __L4RC_GAME_SAVEGAME_H__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// \brief Kind of data in a save section.
+enum class eSaveSection : uint32_t {
+  Player,     ///< One SSavePlayer.
+  Inventory,  ///< One SSaveInventory.
+  Slots,      ///< Item index + 1 per inventory slot, 0 if empty.
+  Items,      ///< SSaveItem array.
+  Drops,      ///< SSaveDrop array.
+  Bullets,    ///< SSaveBullet array.
+  Strings,    ///< Null terminated item names and descriptions.
+};
+
+/// \brief Save file header, at offset 0.
+struct SSaveHeader {
+  char szMagic[4];          ///< Always "LSAV".
+  uint32_t nVersion;        ///< Format version.
+  uint32_t nSections;       ///< Number of sections.
+  uint32_t nPad;            ///< Unused, keeps what follows 8-byte aligned.
+  uint64_t nSectionOffset;  ///< Offset of the SSaveSection array.
+};
+
+/// \brief Where a section's records are in the file.
+///
+/// The section table is written last, after the data, so that the data can
+/// be streamed out without knowing its size first. A loader skips sections
+/// of kinds it does not know, so new kinds can be added without a version
+/// change. Changing a record's layout, or the order of `eSprite`, whose
+/// values items store, needs a new version.
+struct SSaveSection {
+  eSaveSection eKind;  ///< Kind of data.
+  uint32_t nCount;     ///< Number of records.
+  uint64_t nOffset;    ///< Offset of the first record.
+  uint64_t nSize;      ///< Size in bytes.
+  uint64_t nHash;      ///< Hash of the data, to catch a damaged file.
+};
+
+/// \brief Player state. Positions are in meters with y up, as in Box2D.
+struct SSavePlayer {
+  float fX;          ///< Body center x.
+  float fY;          ///< Body center y.
+  float fVX;         ///< Velocity x.
+  float fVY;         ///< Velocity y.
+  uint32_t nHealth;  ///< Health.
+  int32_t nFacing;   ///< 1 facing right, -1 facing left.
+};
+
+/// \brief Inventory selection.
+struct SSaveInventory {
+  int32_t nSelected;  ///< Selected slot.
+  int32_t nHotbar;    ///< Selected hotbar slot.
+};
+
+/// \brief An item, in a slot or in the world.
+struct SSaveItem {
+  int32_t nID;          ///< Item identifier.
+  uint32_t nSprite;     ///< Sprite, an eSprite value.
+  uint32_t nType;       ///< Category, an eItemType value.
+  int32_t nQuantity;    ///< Stack size.
+  int32_t nMaxStack;    ///< Largest stack.
+  uint32_t bStackable;  ///< 1 if it stacks.
+  uint32_t nName;       ///< Offset of the name in the strings.
+  uint32_t nDesc;       ///< Offset of the description in the strings.
+};
+
+/// \brief An item dropped in the world. Positions are in pixels.
+struct SSaveDrop {
+  uint32_t nItem;      ///< Item index.
+  float fX;            ///< Position x.
+  float fY;            ///< Position y.
+  float fTimer;        ///< Seconds since it was dropped.
+  float fPickupDelay;  ///< Seconds until it can be picked up.
+};
+
+/// \brief A bullet. Positions are in meters with y up, as in Box2D.
+struct SSaveBullet {
+  float fX;     ///< Position x.
+  float fY;     ///< Position y.
+  float fVX;    ///< Velocity x.
+  float fVY;    ///< Velocity y.
+  float fLife;  ///< Seconds left.
+};
+
+const uint32_t g_nSaveVersion = 1;  ///< Current save format version.
+
+/// \brief A snapshot of the game, in the records the file holds.
+///
+/// The game fills one of these on the main thread, which is a copy of a few
+/// fields per object and takes no locks. Writing and reading move whole
+/// arrays between the snapshot and the file, with no per-record encoding.
+struct SSaveGame {
+  SSavePlayer player = {};              ///< Player.
+  SSaveInventory inventory = {};        ///< Inventory selection.
+  std::vector<uint32_t> vSlots;         ///< Item index + 1 per slot.
+  std::vector<SSaveItem> vItems;        ///< Items.
+  std::vector<SSaveDrop> vDrops;        ///< World drops.
+  std::vector<SSaveBullet> vBullets;    ///< Bullets.
+  std::string strStrings;               ///< Null terminated strings.
+
+  /// \brief Add a string.
+  /// \param s String
+  /// \return Offset of the string
+  uint32_t AddString(const std::string& s);
+
+  /// \brief Get a string.
+  /// \param offset Offset of the string
+  /// \return The string, or an empty one if the offset is bad
+  const char* GetString(uint32_t offset) const;
+
+  /// \brief Empty every array.
+  void Clear();
+};
+
+/// \brief Write a save file.
+/// \param fileName File name
+/// \param save Snapshot
+/// \return True if the file was written
+bool WriteSaveGame(const char* fileName, const SSaveGame& save);
+
+/// \brief Read a save file.
+/// \param fileName File name
+/// \param save [out] Snapshot
+/// \return True if the file was read and is intact
+bool ReadSaveGame(const char* fileName, SSaveGame& save);
+
+/// \brief Writes save files on a thread of its own.
+///
+/// The snapshot is moved in, not copied, so starting a save costs the frame
+/// next to nothing. The file is written under a temporary name and renamed
+/// when it is complete, so a crash mid-save leaves the last good save. It
+/// has its own thread rather than a job system worker because a slow disk
+/// would hold up every frame graph that needed that worker.
+class CSaveWriter {
+ private:
+  std::thread m_thread;              ///< Writer thread.
+  std::atomic<bool> m_bBusy{false};  ///< A save is being written.
+  bool m_bResult = true;             ///< Whether the last save succeeded.
+  float m_fTime = 0.0f;              ///< Time the last save took, ms.
+  SSaveGame m_save;                  ///< Snapshot being written.
+  std::string m_strFile;             ///< File being written.
+
+ public:
+  ~CSaveWriter(); ///< Waits for the save in progress.
+
+  /// \brief Start writing a save, unless one is already being written.
+  /// \param fileName File name
+  /// \param save Snapshot, moved from
+  /// \return True if the save was started
+  bool Start(const char* fileName, SSaveGame&& save);
+
+  /// \brief Check whether a save is being written.
+  bool IsBusy() const { return m_bBusy; }
+
+  /// \brief Wait for the save in progress, if any.
+  /// \return True if the last save succeeded
+  bool Wait();
+
+  /// \brief Get the time the last save took on the writer thread.
+  /// \return Time in ms, valid once it is not busy
+  float GetLastTime() const { return m_fTime; }
+};
+
+#endif  //__L4RC_GAME_SAVEGAME_H__
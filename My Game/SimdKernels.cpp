@@ -0,0 +1,505 @@
+/// \file SimdKernels.cpp
+/// \brief Code for the batch float kernels.
+///
+/// Each kernel has a scalar version, which the vector versions also use for
+/// the elements left over after the last full vector. AVX2 code is compiled
+/// into every build and only run if the processor supports it, so GCC and
+/// Clang need it marked with a target attribute. MSVC does not.
+
+#include "SimdKernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+  #define SIMD_X64  ///< SSE2 is always there, AVX2 may be.
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+    #define AVX2_TARGET
+  #else
+    #define AVX2_TARGET __attribute__((target("avx2")))
+  #endif
+#endif
+
+/// \name Sine constants
+/// The argument is reduced to [-pi, pi] by subtracting a whole number of
+/// turns, found by rounding with the 1.5 * 2^23 trick and subtracted in two
+/// parts for precision, then folded into [-pi/2, pi/2], where a degree 11
+/// Taylor polynomial is good to about 1e-7.
+///@{
+static const float g_fInv2Pi = 0.159154943f;   ///< 1 / (2 pi).
+static const float g_fRound = 12582912.0f;     ///< 1.5 * 2^23.
+static const float g_f2PiHi = 6.28125f;        ///< 2 pi, high bits.
+static const float g_f2PiLo = 1.93530717e-3f;  ///< 2 pi, the rest.
+static const float g_fPi = 3.14159265f;        ///< pi.
+static const float g_fHalfPi = 1.57079633f;    ///< pi / 2.
+static const float g_fS3 = -1.66666667e-1f;    ///< -1 / 3!.
+static const float g_fS5 = 8.33333333e-3f;     ///< 1 / 5!.
+static const float g_fS7 = -1.98412698e-4f;    ///< -1 / 7!.
+static const float g_fS9 = 2.75573192e-6f;     ///< 1 / 9!.
+static const float g_fS11 = -2.50521084e-8f;   ///< -1 / 11!.
+///@}
+
+/// Sine by the steps above, one float at a time.
+/// \param x Angle in radians, less than 2^22 turns from zero
+/// \return Sine of x
+
+static inline float SinScalar(float x) {
+  const float k = (x * g_fInv2Pi + g_fRound) - g_fRound;
+  float r = (x - k * g_f2PiHi) - k * g_f2PiLo;
+  r = r > g_fHalfPi ? g_fPi - r : r;
+  r = r < -g_fHalfPi ? -g_fPi - r : r;
+
+  const float r2 = r * r;
+  float p = g_fS11;
+  p = p * r2 + g_fS9;
+  p = p * r2 + g_fS7;
+  p = p * r2 + g_fS5;
+  p = p * r2 + g_fS3;
+  p = p * r2 + 1.0f;
+  return r * p;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Scalar
+
+static void AddScalar(float* p, size_t n, float value) {
+  for (size_t i = 0; i < n; ++i) p[i] = p[i] + value;
+}
+
+static size_t ExpiredScalar(const float* p, size_t n, uint8_t* mask) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i) {
+    mask[i] = p[i] <= 0.0f ? 1 : 0;
+    count += mask[i];
+  }
+  return count;
+}
+
+static void IntegrateScalar(float* x, float* y, const float* vx, float* vy,
+                            size_t n, float gravity, float dt) {
+  const float dv = gravity * dt;
+  for (size_t i = 0; i < n; ++i) {
+    vy[i] = vy[i] + dv;
+    x[i] = x[i] + vx[i] * dt;
+    y[i] = y[i] + vy[i] * dt;
+  }
+}
+
+static size_t IntegrateAgeScalar(float* x, float* y, const float* vx,
+                                 float* vy, float* life, size_t n,
+                                 float gravity, float dt) {
+  const float dv = gravity * dt;
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i) {
+    vy[i] = vy[i] + dv;
+    x[i] = x[i] + vx[i] * dt;
+    y[i] = y[i] + vy[i] * dt;
+    life[i] = life[i] + -dt;
+    count += life[i] <= 0.0f ? 1 : 0;
+  }
+  return count;
+}
+
+static void BobScalar(const float* t, size_t n, float speed, float amplitude,
+                      float* out) {
+  for (size_t i = 0; i < n; ++i) out[i] = SinScalar(t[i] * speed) * amplitude;
+}
+
+static void AnimateScalar(float* phase, const float* rate, const float* length,
+                          const float* loop, const int32_t* start, size_t n,
+                          float dt, int32_t* frame) {
+  for (size_t i = 0; i < n; ++i) {
+    const float p = phase[i] + rate[i] * dt;
+    const float wrapped = p - (float)(int32_t)(p / length[i]) * length[i];
+    const float last = length[i] - 1.0f;
+    const float held = p < last ? p : last;
+    phase[i] = loop[i] > 0.0f ? wrapped : held;
+    frame[i] = start[i] + (int32_t)phase[i];
+  }
+}
+
+#ifdef SIMD_X64
+
+///////////////////////////////////////////////////////////////////////////////
+// SSE2
+
+/// Bits set in each 4 bit mask, to count expired elements.
+static const uint8_t g_pBitCount[16] = {0, 1, 1, 2, 1, 2, 2, 3,
+                                        1, 2, 2, 3, 2, 3, 3, 4};
+
+static void AddSSE2(float* p, size_t n, float value) {
+  const __m128 v = _mm_set1_ps(value);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(p + i, _mm_add_ps(_mm_loadu_ps(p + i), v));
+  AddScalar(p + i, n - i, value);
+}
+
+static size_t ExpiredSSE2(const float* p, size_t n, uint8_t* mask) {
+  const __m128 zero = _mm_setzero_ps();
+  size_t i = 0, count = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    const int bits = _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(p + i), zero));
+    for (int k = 0; k < 4; ++k) mask[i + k] = (bits >> k) & 1;
+    count += g_pBitCount[bits];
+  }
+
+  return count + ExpiredScalar(p + i, n - i, mask + i);
+}
+
+static void IntegrateSSE2(float* x, float* y, const float* vx, float* vy,
+                          size_t n, float gravity, float dt) {
+  const __m128 dv = _mm_set1_ps(gravity * dt);
+  const __m128 h = _mm_set1_ps(dt);
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    const __m128 v = _mm_add_ps(_mm_loadu_ps(vy + i), dv);
+    _mm_storeu_ps(vy + i, v);
+    _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i),
+                                    _mm_mul_ps(_mm_loadu_ps(vx + i), h)));
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(v, h)));
+  }
+
+  IntegrateScalar(x + i, y + i, vx + i, vy + i, n - i, gravity, dt);
+}
+
+static size_t IntegrateAgeSSE2(float* x, float* y, const float* vx,
+                               float* vy, float* life, size_t n, float gravity,
+                               float dt) {
+  const __m128 dv = _mm_set1_ps(gravity * dt);
+  const __m128 h = _mm_set1_ps(dt), nh = _mm_set1_ps(-dt);
+  const __m128 zero = _mm_setzero_ps();
+  size_t i = 0, count = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    const __m128 v = _mm_add_ps(_mm_loadu_ps(vy + i), dv);
+    _mm_storeu_ps(vy + i, v);
+    _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i),
+                                    _mm_mul_ps(_mm_loadu_ps(vx + i), h)));
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(v, h)));
+
+    const __m128 l = _mm_add_ps(_mm_loadu_ps(life + i), nh);
+    _mm_storeu_ps(life + i, l);
+    count += g_pBitCount[_mm_movemask_ps(_mm_cmple_ps(l, zero))];
+  }
+
+  return count + IntegrateAgeScalar(x + i, y + i, vx + i, vy + i, life + i,
+                                    n - i, gravity, dt);
+}
+
+/// Pick a where the mask is set and b elsewhere.
+static inline __m128 SelectSSE2(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static void BobSSE2(const float* t, size_t n, float speed, float amplitude,
+                    float* out) {
+  const __m128 s = _mm_set1_ps(speed), a = _mm_set1_ps(amplitude);
+  const __m128 inv = _mm_set1_ps(g_fInv2Pi), rnd = _mm_set1_ps(g_fRound);
+  const __m128 hi = _mm_set1_ps(g_f2PiHi), lo = _mm_set1_ps(g_f2PiLo);
+  const __m128 pi = _mm_set1_ps(g_fPi), npi = _mm_set1_ps(-g_fPi);
+  const __m128 hp = _mm_set1_ps(g_fHalfPi), nhp = _mm_set1_ps(-g_fHalfPi);
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    const __m128 x = _mm_mul_ps(_mm_loadu_ps(t + i), s);
+    const __m128 k = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(x, inv), rnd), rnd);
+    __m128 r = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(k, hi)), _mm_mul_ps(k, lo));
+    r = SelectSSE2(_mm_cmpgt_ps(r, hp), _mm_sub_ps(pi, r), r);
+    r = SelectSSE2(_mm_cmplt_ps(r, nhp), _mm_sub_ps(npi, r), r);
+
+    const __m128 r2 = _mm_mul_ps(r, r);
+    __m128 p = _mm_set1_ps(g_fS11);
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(g_fS9));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(g_fS7));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(g_fS5));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(g_fS3));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(1.0f));
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_mul_ps(r, p), a));
+  }
+
+  BobScalar(t + i, n - i, speed, amplitude, out + i);
+}
+
+static void AnimateSSE2(float* phase, const float* rate, const float* length,
+                        const float* loop, const int32_t* start, size_t n,
+                        float dt, int32_t* frame) {
+  const __m128 h = _mm_set1_ps(dt), one = _mm_set1_ps(1.0f);
+  const __m128 zero = _mm_setzero_ps();
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    const __m128 len = _mm_loadu_ps(length + i);
+    const __m128 p = _mm_add_ps(_mm_loadu_ps(phase + i),
+                                _mm_mul_ps(_mm_loadu_ps(rate + i), h));
+    const __m128 turns = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(p, len)));
+    const __m128 wrapped = _mm_sub_ps(p, _mm_mul_ps(turns, len));
+    const __m128 held = _mm_min_ps(p, _mm_sub_ps(len, one));
+    const __m128 q = SelectSSE2(_mm_cmpgt_ps(_mm_loadu_ps(loop + i), zero),
+                                wrapped, held);
+    _mm_storeu_ps(phase + i, q);
+
+    const __m128i s = _mm_loadu_si128((const __m128i*)(start + i));
+    _mm_storeu_si128((__m128i*)(frame + i),
+                     _mm_add_epi32(s, _mm_cvttps_epi32(q)));
+  }
+
+  AnimateScalar(phase + i, rate + i, length + i, loop + i, start + i, n - i, dt,
+                frame + i);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2
+
+AVX2_TARGET static void AddAVX2(float* p, size_t n, float value) {
+  const __m256 v = _mm256_set1_ps(value);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(p + i, _mm256_add_ps(_mm256_loadu_ps(p + i), v));
+  AddScalar(p + i, n - i, value);
+}
+
+AVX2_TARGET static size_t ExpiredAVX2(const float* p, size_t n,
+                                      uint8_t* mask) {
+  const __m256 zero = _mm256_setzero_ps();
+  size_t i = 0, count = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    const int bits = _mm256_movemask_ps(
+        _mm256_cmp_ps(_mm256_loadu_ps(p + i), zero, _CMP_LE_OQ));
+    for (int k = 0; k < 8; ++k) mask[i + k] = (bits >> k) & 1;
+    count += g_pBitCount[bits & 15] + g_pBitCount[bits >> 4];
+  }
+
+  return count + ExpiredScalar(p + i, n - i, mask + i);
+}
+
+AVX2_TARGET static void IntegrateAVX2(float* x, float* y, const float* vx,
+                                      float* vy, size_t n, float gravity,
+                                      float dt) {
+  const __m256 dv = _mm256_set1_ps(gravity * dt);
+  const __m256 h = _mm256_set1_ps(dt);
+  size_t i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    const __m256 v = _mm256_add_ps(_mm256_loadu_ps(vy + i), dv);
+    _mm256_storeu_ps(vy + i, v);
+    _mm256_storeu_ps(x + i,
+                     _mm256_add_ps(_mm256_loadu_ps(x + i),
+                                   _mm256_mul_ps(_mm256_loadu_ps(vx + i), h)));
+    _mm256_storeu_ps(
+        y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(v, h)));
+  }
+
+  IntegrateScalar(x + i, y + i, vx + i, vy + i, n - i, gravity, dt);
+}
+
+AVX2_TARGET static size_t IntegrateAgeAVX2(float* x, float* y,
+                                           const float* vx, float* vy,
+                                           float* life, size_t n,
+                                           float gravity, float dt) {
+  const __m256 dv = _mm256_set1_ps(gravity * dt);
+  const __m256 h = _mm256_set1_ps(dt), nh = _mm256_set1_ps(-dt);
+  const __m256 zero = _mm256_setzero_ps();
+  size_t i = 0, count = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    const __m256 v = _mm256_add_ps(_mm256_loadu_ps(vy + i), dv);
+    _mm256_storeu_ps(vy + i, v);
+    _mm256_storeu_ps(x + i,
+                     _mm256_add_ps(_mm256_loadu_ps(x + i),
+                                   _mm256_mul_ps(_mm256_loadu_ps(vx + i), h)));
+    _mm256_storeu_ps(
+        y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(v, h)));
+
+    const __m256 l = _mm256_add_ps(_mm256_loadu_ps(life + i), nh);
+    _mm256_storeu_ps(life + i, l);
+    const int bits = _mm256_movemask_ps(_mm256_cmp_ps(l, zero, _CMP_LE_OQ));
+    count += g_pBitCount[bits & 15] + g_pBitCount[bits >> 4];
+  }
+
+  _mm256_zeroupper();  // GCC leaves the upper halves dirty here
+  return count + IntegrateAgeScalar(x + i, y + i, vx + i, vy + i, life + i,
+                                    n - i, gravity, dt);
+}
+
+AVX2_TARGET static void BobAVX2(const float* t, size_t n, float speed,
+                                float amplitude, float* out) {
+  const __m256 s = _mm256_set1_ps(speed), a = _mm256_set1_ps(amplitude);
+  const __m256 inv = _mm256_set1_ps(g_fInv2Pi);
+  const __m256 rnd = _mm256_set1_ps(g_fRound);
+  const __m256 hi = _mm256_set1_ps(g_f2PiHi), lo = _mm256_set1_ps(g_f2PiLo);
+  const __m256 pi = _mm256_set1_ps(g_fPi), npi = _mm256_set1_ps(-g_fPi);
+  const __m256 hp = _mm256_set1_ps(g_fHalfPi);
+  const __m256 nhp = _mm256_set1_ps(-g_fHalfPi);
+  size_t i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    const __m256 x = _mm256_mul_ps(_mm256_loadu_ps(t + i), s);
+    const __m256 k =
+        _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(x, inv), rnd), rnd);
+    __m256 r = _mm256_sub_ps(_mm256_sub_ps(x, _mm256_mul_ps(k, hi)),
+                             _mm256_mul_ps(k, lo));
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(pi, r),
+                         _mm256_cmp_ps(r, hp, _CMP_GT_OQ));
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(npi, r),
+                         _mm256_cmp_ps(r, nhp, _CMP_LT_OQ));
+
+    const __m256 r2 = _mm256_mul_ps(r, r);
+    __m256 p = _mm256_set1_ps(g_fS11);
+    p = _mm256_add_ps(_mm256_mul_ps(p, r2), _mm256_set1_ps(g_fS9));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r2), _mm256_set1_ps(g_fS7));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r2), _mm256_set1_ps(g_fS5));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r2), _mm256_set1_ps(g_fS3));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r2), _mm256_set1_ps(1.0f));
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_mul_ps(r, p), a));
+  }
+
+  BobScalar(t + i, n - i, speed, amplitude, out + i);
+}
+
+AVX2_TARGET static void AnimateAVX2(float* phase, const float* rate,
+                                    const float* length, const float* loop,
+                                    const int32_t* start, size_t n, float dt,
+                                    int32_t* frame) {
+  const __m256 h = _mm256_set1_ps(dt), one = _mm256_set1_ps(1.0f);
+  const __m256 zero = _mm256_setzero_ps();
+  size_t i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    const __m256 len = _mm256_loadu_ps(length + i);
+    const __m256 p = _mm256_add_ps(_mm256_loadu_ps(phase + i),
+                                   _mm256_mul_ps(_mm256_loadu_ps(rate + i), h));
+    const __m256 turns =
+        _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_div_ps(p, len)));
+    const __m256 wrapped = _mm256_sub_ps(p, _mm256_mul_ps(turns, len));
+    const __m256 held = _mm256_min_ps(p, _mm256_sub_ps(len, one));
+    const __m256 q = _mm256_blendv_ps(
+        held, wrapped,
+        _mm256_cmp_ps(_mm256_loadu_ps(loop + i), zero, _CMP_GT_OQ));
+    _mm256_storeu_ps(phase + i, q);
+
+    const __m256i s = _mm256_loadu_si256((const __m256i*)(start + i));
+    _mm256_storeu_si256((__m256i*)(frame + i),
+                        _mm256_add_epi32(s, _mm256_cvttps_epi32(q)));
+  }
+
+  _mm256_zeroupper();  // likewise
+  AnimateScalar(phase + i, rate + i, length + i, loop + i, start + i, n - i, dt,
+                frame + i);
+}
+
+#endif  // SIMD_X64
+
+///////////////////////////////////////////////////////////////////////////////
+// Dispatch
+
+/// \brief One path's kernels.
+struct SKernels {
+  void (*pAdd)(float*, size_t, float);                   ///< SimdAdd().
+  size_t (*pExpired)(const float*, size_t, uint8_t*);    ///< SimdExpired().
+  void (*pIntegrate)(float*, float*, const float*, float*, size_t, float,
+                     float);                             ///< SimdIntegrate().
+  size_t (*pIntegrateAge)(float*, float*, const float*, float*, float*,
+                          size_t, float, float); ///< SimdIntegrateAge().
+  void (*pBob)(const float*, size_t, float, float, float*); ///< SimdBob().
+  void (*pAnimate)(float*, const float*, const float*, const float*,
+                   const int32_t*, size_t, float, int32_t*); ///< SimdAnimate().
+};
+
+/// Kernels by path. Paths the build cannot do fall back to scalar.
+static const SKernels g_pKernels[] = {
+  {AddScalar, ExpiredScalar, IntegrateScalar, IntegrateAgeScalar, BobScalar,
+   AnimateScalar},
+#ifdef SIMD_X64
+  {AddSSE2, ExpiredSSE2, IntegrateSSE2, IntegrateAgeSSE2, BobSSE2,
+   AnimateSSE2},
+  {AddAVX2, ExpiredAVX2, IntegrateAVX2, IntegrateAgeAVX2, BobAVX2,
+   AnimateAVX2},
+#else
+  {AddScalar, ExpiredScalar, IntegrateScalar, IntegrateAgeScalar, BobScalar,
+   AnimateScalar},
+  {AddScalar, ExpiredScalar, IntegrateScalar, IntegrateAgeScalar, BobScalar,
+   AnimateScalar},
+#endif
+};
+
+/// Ask the processor, and for AVX2 the operating system too, since the
+/// upper halves of the registers are only saved on a task switch if the
+/// operating system knows about them.
+/// \return Best path this machine supports
+
+eSimdPath GetBestSimdPath() {
+#if defined(SIMD_X64) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) return eSimdPath::SSE2;
+
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  __cpuidex(info, 7, 0);
+  const bool avx2 = (info[1] & (1 << 5)) != 0;
+
+  if (osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6) return eSimdPath::AVX2;
+  return eSimdPath::SSE2;
+#elif defined(SIMD_X64)
+  __builtin_cpu_init();  // checks operating system support as well
+  return __builtin_cpu_supports("avx2") ? eSimdPath::AVX2 : eSimdPath::SSE2;
+#else
+  return eSimdPath::Scalar;
+#endif
+}
+
+static eSimdPath g_ePath = GetBestSimdPath(); ///< Path the kernels use.
+
+eSimdPath GetSimdPath() { return g_ePath; }
+
+/// Make the kernels use a path, or the best supported one if that is lower.
+/// Not thread safe: call it while no kernels are running.
+/// \param path Path to use
+
+void SetSimdPath(eSimdPath path) {
+  const eSimdPath best = GetBestSimdPath();
+  g_ePath = (int)path < (int)best ? path : best;
+}
+
+const char* GetSimdPathName(eSimdPath path) {
+  switch (path) {
+    case eSimdPath::SSE2: return "sse2";
+    case eSimdPath::AVX2: return "avx2";
+    default: return "scalar";
+  }
+}
+
+void SimdAdd(float* p, size_t n, float value) {
+  g_pKernels[(int)g_ePath].pAdd(p, n, value);
+}
+
+size_t SimdExpired(const float* p, size_t n, uint8_t* mask) {
+  return g_pKernels[(int)g_ePath].pExpired(p, n, mask);
+}
+
+void SimdIntegrate(float* x, float* y, const float* vx, float* vy, size_t n,
+                   float gravity, float dt) {
+  g_pKernels[(int)g_ePath].pIntegrate(x, y, vx, vy, n, gravity, dt);
+}
+
+size_t SimdIntegrateAge(float* x, float* y, const float* vx, float* vy,
+                        float* life, size_t n, float gravity, float dt) {
+  return g_pKernels[(int)g_ePath].pIntegrateAge(x, y, vx, vy, life, n, gravity,
+                                                dt);
+}
+
+void SimdBob(const float* t, size_t n, float speed, float amplitude,
+             float* out) {
+  g_pKernels[(int)g_ePath].pBob(t, n, speed, amplitude, out);
+}
+
+void SimdAnimate(float* phase, const float* rate, const float* length,
+                 const float* loop, const int32_t* start, size_t n, float dt,
+                 int32_t* frame) {
+  g_pKernels[(int)g_ePath].pAnimate(phase, rate, length, loop, start, n, dt,
+                                    frame);
+}
@@ -0,0 +1,108 @@
+/// \file SimdKernels.h
+/// \brief Interface for the batch float kernels.
+///
+/// Each kernel updates a structure-of-arrays field in one call, with SSE2
+/// or AVX2 where the processor has them and plain C++ where it does not.
+/// The path is picked at runtime, once, from what the processor and the
+/// operating system support, and can be forced lower for testing.
+///
+/// Every path does the same float operations in the same order, with no
+/// fused multiply-add, so all paths give bit-for-bit the same results. The
+/// sine used for bobbing is a polynomial for that reason, rather than
+/// `std::sin()`, which is not vectorized and may differ between libraries.
+
+#ifndef __L4RC_GAME_SIMDKERNELS_H__
+#define __L4RC_GAME_SIMDKERNELS_H__
+
+#include <cstddef>
+#include <cstdint>
+
+/// \brief Instruction set used by the kernels.
+enum class eSimdPath {
+  Scalar,  ///< Plain C++.
+  SSE2,    ///< 4 floats at a time.
+  AVX2     ///< 8 floats at a time.
+};
+
+/// \brief Get the best path this machine supports.
+eSimdPath GetBestSimdPath();
+
+/// \brief Get the path the kernels use.
+eSimdPath GetSimdPath();
+
+/// \brief Make the kernels use a path, or the best supported one below it.
+/// \param path Path to use
+void SetSimdPath(eSimdPath path);
+
+/// \brief Get a path's name.
+const char* GetSimdPathName(eSimdPath path);
+
+/// \brief Add a value to every element, such as -dt to a lifetime.
+/// \param p Array
+/// \param n Number of elements
+/// \param value Value to add
+void SimdAdd(float* p, size_t n, float value);
+
+/// \brief Mark the elements that are zero or less.
+/// \param p Array, such as lifetimes
+/// \param n Number of elements
+/// \param mask [out] 1 for each element that is zero or less, else 0
+/// \return Number of elements marked
+size_t SimdExpired(const float* p, size_t n, uint8_t* mask);
+
+/// \brief Integrate positions with gravity, semi-implicit Euler.
+///
+/// vy += gravity * dt, then x += vx * dt and y += vy * dt.
+/// \param x Positions x
+/// \param y Positions y
+/// \param vx Velocities x
+/// \param vy Velocities y
+/// \param n Number of elements
+/// \param gravity Acceleration along y
+/// \param dt Time step
+void SimdIntegrate(float* x, float* y, const float* vx, float* vy, size_t n,
+                   float gravity, float dt);
+
+/// \brief Integrate positions with gravity and count down lifetimes.
+///
+/// SimdIntegrate() and then SimdAdd() of -dt to the lifetimes, in one pass
+/// over the arrays instead of two.
+/// \param x Positions x
+/// \param y Positions y
+/// \param vx Velocities x
+/// \param vy Velocities y
+/// \param life Lifetimes
+/// \param n Number of elements
+/// \param gravity Acceleration along y
+/// \param dt Time step
+/// \return Number of lifetimes that are now zero or less
+size_t SimdIntegrateAge(float* x, float* y, const float* vx, float* vy,
+                        float* life, size_t n, float gravity, float dt);
+
+/// \brief Bob offsets, amplitude * sin(speed * t).
+/// \param t Timers
+/// \param n Number of elements
+/// \param speed Angular speed in radians per unit of t
+/// \param amplitude Peak offset
+/// \param out [out] Offsets
+void SimdBob(const float* t, size_t n, float speed, float amplitude,
+             float* out);
+
+/// \brief Advance animation phases and find each one's frame.
+///
+/// phase += rate * dt. A looping phase then wraps into [0, length) and any
+/// other stops at length - 1, its last frame. The frame is start plus the
+/// whole part of the phase.
+/// \param phase Phases, in frames
+/// \param rate Frames per second, not negative
+/// \param length Frames in the clip, whole numbers of at least 1
+/// \param loop Greater than zero for a looping clip
+/// \param start First frame of the clip
+/// \param n Number of elements
+/// \param dt Time step
+/// \param frame [out] Frames
+void SimdAnimate(float* phase, const float* rate, const float* length,
+                 const float* loop, const int32_t* start, size_t n, float dt,
+                 int32_t* frame);
+
+#endif  //__L4RC_GAME_SIMDKERNELS_H__
@@ -0,0 +1,62 @@
+/// \file Snapshot.h
+/// \brief Interface for the snapshots of the game state used by rollback.
+
+#ifndef __L4RC_GAME_SNAPSHOT_H__
+#define __L4RC_GAME_SNAPSHOT_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "DropManager.h"
+#include "GridController.h"
+#include "InventoryManager.h"
+#include "SimpleMath.h"
+#include "box2d/box2d.h"
+
+/// \brief What a frame of CPlayer::Update() changes, for rollback.
+///
+/// The sensor contact counts are left out. Box2D keeps its contacts when
+/// bodies are moved back, and the counts follow its begin and end events,
+/// so they stay right as they are.
+struct SPlayerState {
+  b2Vec2 vBodyPos;          ///< Body position in meters.
+  b2Vec2 vBodyVel;          ///< Body velocity in meters per second.
+  bool bAwake = true;       ///< Body is awake.
+  Vector2 vPos;             ///< Position in pixels.
+  float fCoyote = 0.0f;     ///< Coyote timer.
+  float fAttackTimer = 0.0f; ///< Attack cooldown.
+  bool bAttacking = false;  ///< Attacking.
+  bool bWantsToShoot = false; ///< Shot asked for, not yet fired.
+  UINT nHealth = 0;         ///< Health.
+  int nFacing = 1;          ///< Facing, 1 right or -1 left.
+  float fGridX = 0.0f;      ///< Grid controller feet x.
+  float fGridY = 0.0f;      ///< Grid controller feet y.
+  float fGridVX = 0.0f;     ///< Grid controller velocity x.
+  float fGridVY = 0.0f;     ///< Grid controller velocity y.
+  SGridContacts contacts;   ///< Grid controller contacts.
+};
+
+/// \brief A bullet's motion and lifetime, for rollback.
+struct SBulletState {
+  b2Vec2 vPos;          ///< Position in meters.
+  b2Vec2 vVel;          ///< Velocity in meters per second.
+  float fLife = 0.0f;   ///< Seconds left.
+};
+
+/// \brief The state of the game before one frame, for rollback.
+///
+/// The game keeps a ring of these, one per frame that can be rolled back
+/// to, and saves into the same ones over and over, so their arrays stop
+/// growing after the first few frames and saving does not allocate. Only
+/// what a frame changes from its inputs is here. The tiles, the navigation
+/// graph and the crowd are left out, since nothing in them feeds back into
+/// the players or the items.
+struct SGameSnapshot {
+  uint32_t nFrame = 0;                ///< Frame this is the state before.
+  std::vector<SPlayerState> vPlayers; ///< Players, in order.
+  std::vector<SBulletState> vBullets; ///< Bullets, in order.
+  std::vector<SInventorySnapshot> vInventories; ///< Slots, one per player.
+  SDropSnapshot drops;                ///< World drops.
+};
+
+#endif  //__L4RC_GAME_SNAPSHOT_H__
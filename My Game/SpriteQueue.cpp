@@ -0,0 +1,111 @@
+/// \file SpriteQueue.cpp
+/// \brief Code for the sprite sorting and batching queue CSpriteQueue.
+
+#include "SpriteQueue.h"
+
+#include <algorithm>
+
+/// Empty the queue. Vectors keep their capacity so that steady state frames
+/// do not allocate.
+
+void CSpriteQueue::Clear() {
+  m_vSprites.clear();
+  m_vKeys.clear();
+  m_vOrder.clear();
+  m_nUnsortedBreaks = 0;
+  m_nSortedBreaks = 0;
+  m_bSorted = true;
+}
+
+/// Add a sprite. The key puts the layer in bits 24 to 31 and the low 16 bits
+/// of the sprite index in bits 0 to 15, leaving bits 16 to 23 for the atlas
+/// page, which `Sort()` fills in.
+/// \param desc Sprite descriptor
+/// \param layer Layer to draw it in
+
+void CSpriteQueue::Add(const LSpriteDesc2D& desc, eSpriteLayer layer) {
+  if (m_vSprites.empty() ||
+      m_vSprites.back().m_nSpriteIndex != desc.m_nSpriteIndex)
+    m_nUnsortedBreaks++;
+
+  m_vSprites.push_back(desc);
+  m_vKeys.push_back(((UINT)layer << 24) | (desc.m_nSpriteIndex & 0xFFFF));
+  m_bSorted = false;
+}
+
+/// Add a run of sprites that share a sprite index, such as the copies of a
+/// background layer. They share one key, so they are appended in one copy
+/// each and never break a batch among themselves.
+/// \param pDesc Sprite descriptors, all with the same sprite index
+/// \param n Number of descriptors
+/// \param layer Layer to draw them in
+
+void CSpriteQueue::Add(const LSpriteDesc2D* pDesc, size_t n,
+                       eSpriteLayer layer) {
+  if (n == 0) return;
+
+  const UINT sprite = pDesc[0].m_nSpriteIndex;
+  if (m_vSprites.empty() || m_vSprites.back().m_nSpriteIndex != sprite)
+    m_nUnsortedBreaks++;
+
+  m_vSprites.insert(m_vSprites.end(), pDesc, pDesc + n);
+  m_vKeys.insert(m_vKeys.end(), n, ((UINT)layer << 24) | (sprite & 0xFFFF));
+  m_bSorted = false;
+}
+
+/// Sort the sprites into draw order with a least significant digit radix sort
+/// over the 32-bit keys, one byte per pass. Each pass is stable, so sprites
+/// with equal keys keep their submission order. A pass where every key has
+/// the same byte would not move anything and is skipped.
+///
+/// With a texture table, the sprites of each atlas page are put together
+/// within a layer, pages in order and sprites with a texture of their own
+/// after them. The sprite index stays in the key below the page, so sprites
+/// that share a page but not a texture do not interleave. Batch breaks are
+/// counted where the sprite index changes, since the renderer binds each
+/// sprite's own texture, not the atlas page.
+/// \param pTextures Texture for each sprite index, or nullptr
+
+void CSpriteQueue::Sort(const std::vector<UINT>* pTextures) {
+  const UINT n = (UINT)m_vSprites.size();
+
+  if (pTextures)
+    for (UINT& key : m_vKeys) {
+      const UINT sprite = key & 0xFFFF;
+      const UINT page = sprite < pTextures->size()
+                            ? std::min((*pTextures)[sprite], 0xFFu)
+                            : 0xFFu;  // standalone textures are 0x100 up
+      key = (key & 0xFF00FFFF) | (page << 16);
+    }
+
+  m_vOrder.resize(n);
+  m_vScratch.resize(n);
+  for (UINT i = 0; i < n; i++) m_vOrder[i] = i;
+
+  for (UINT shift = 0; shift < 32; shift += 8) {
+    UINT count[256] = {0};
+    for (UINT i = 0; i < n; i++) count[(m_vKeys[i] >> shift) & 0xFF]++;
+
+    if (n == 0 || count[(m_vKeys[0] >> shift) & 0xFF] == n) continue;
+
+    UINT sum = 0;
+    for (UINT& c : count) {
+      const UINT t = c;
+      c = sum;
+      sum += t;
+    }
+
+    for (UINT i : m_vOrder)
+      m_vScratch[count[(m_vKeys[i] >> shift) & 0xFF]++] = i;
+
+    m_vOrder.swap(m_vScratch);
+  }
+
+  m_nSortedBreaks = 0;
+  for (UINT i = 0; i < n; i++)
+    if (i == 0 || m_vSprites[m_vOrder[i]].m_nSpriteIndex !=
+                      m_vSprites[m_vOrder[i - 1]].m_nSpriteIndex)
+      m_nSortedBreaks++;
+
+  m_bSorted = true;
+}
@@ -0,0 +1,92 @@
+/// \file SpriteQueue.h
+/// \brief Interface for the sprite sorting and batching queue CSpriteQueue.
+
+#ifndef __L4RC_GAME_SPRITEQUEUE_H__
+#define __L4RC_GAME_SPRITEQUEUE_H__
+
+#include <vector>
+
+#include "SpriteDesc.h"
+
+/// \brief Sprite layer enumerated type.
+///
+/// Layers are drawn in this order, back to front. Within a layer sprites are
+/// grouped by texture, so anything that has to be drawn over something else
+/// needs a later layer. `Size` must be last.
+enum class eSpriteLayer : UINT {
+  BackgroundFar,   ///< Chapel.
+  BackgroundNear,  ///< Sky.
+  Tiles,           ///< Ground tiles.
+  Drops,           ///< Items dropped in the world.
+  Actors,          ///< Player and other characters.
+  Projectiles,     ///< Bullets.
+  Particles,       ///< Sparks and puffs.
+  Debug,           ///< Debug boxes.
+  Panel,           ///< Inventory background panel.
+  Slots,           ///< Inventory and hotbar slots.
+  Icons,           ///< Item icons drawn over slots.
+  Size             // MUST BE LAST
+};
+
+/// \brief The sprite queue.
+///
+/// Collects sprite descriptors with a layer, sorts them by layer and then by
+/// texture with a stable radix sort, and flushes them to a renderer so that
+/// sprites sharing a texture go out back to back. A texture table (see
+/// CTextureAtlas) also groups the sprites on each atlas page together. Every
+/// time the bound texture, which is the sprite index's, changes between two
+/// consecutive draws counts as a batch break. The queue counts breaks for submission order and
+/// for sorted order so that the saving can be read off directly.
+class CSpriteQueue {
+ private:
+  std::vector<LSpriteDesc2D> m_vSprites;  ///< Sprites in submission order.
+  std::vector<UINT> m_vKeys;              ///< Sort key for each sprite.
+  std::vector<UINT> m_vOrder;             ///< Sprite indices in draw order.
+  std::vector<UINT> m_vScratch;           ///< Radix sort scratch space.
+
+  UINT m_nUnsortedBreaks = 0;  ///< Batch breaks in submission order.
+  UINT m_nSortedBreaks = 0;    ///< Batch breaks in sorted order.
+  bool m_bSorted = true;       ///< Whether m_vOrder is up to date.
+
+ public:
+  /// \brief Empty the queue, keeping its capacity.
+  void Clear();
+
+  /// \brief Add a sprite, copying the descriptor.
+  /// \param desc Sprite descriptor
+  /// \param layer Layer to draw it in
+  void Add(const LSpriteDesc2D& desc, eSpriteLayer layer);
+
+  /// \brief Add copies of one sprite in one go, copying the descriptors.
+  /// \param pDesc Sprite descriptors, all with the same sprite index
+  /// \param n Number of descriptors
+  /// \param layer Layer to draw them in
+  void Add(const LSpriteDesc2D* pDesc, size_t n, eSpriteLayer layer);
+
+  /// \brief Sort into draw order and count batch breaks.
+  /// \param pTextures Texture for each sprite index, or nullptr
+  void Sort(const std::vector<UINT>* pTextures = nullptr);
+
+  /// \brief Draw every sprite in sorted order.
+  ///
+  /// The renderer can be anything with a `Draw(const LSpriteDesc2D*)`
+  /// function, so a counting stub can stand in for LSpriteRenderer.
+  /// \param pRenderer Pointer to renderer
+  /// \param pTextures Texture for each sprite index, or nullptr
+  template <class R>
+  void Flush(R* pRenderer, const std::vector<UINT>* pTextures = nullptr) {
+    if (!m_bSorted) Sort(pTextures);
+    for (UINT i : m_vOrder) pRenderer->Draw(&m_vSprites[i]);
+  }
+
+  /// \brief Get the number of sprites in the queue.
+  size_t GetSize() const { return m_vSprites.size(); }
+
+  /// \brief Get the batch breaks in submission order.
+  UINT GetUnsortedBatchBreaks() const { return m_nUnsortedBreaks; }
+
+  /// \brief Get the batch breaks in sorted order, valid after Sort().
+  UINT GetBatchBreaks() const { return m_nSortedBreaks; }
+};
+
+#endif  //__L4RC_GAME_SPRITEQUEUE_H__
@@ -0,0 +1,49 @@
+/// \file TextureAtlas.cpp
+/// \brief Code for the texture atlas manifest CTextureAtlas.
+
+#include "TextureAtlas.h"
+
+#include <set>
+
+#include "GameDefines.h"
+
+/// Texture numbers from here up are sprites with a texture of their own, so
+/// that they can never collide with a page number.
+static const UINT g_nStandaloneBase = 0x100;
+
+/// Fill in a region and a texture for every sprite from the sprite table.
+/// If the atlas builder has not been run, every sprite is standalone.
+
+void CTextureAtlas::Load() {
+  m_nPages = g_nAtlasPages;
+  m_fEfficiency = g_fAtlasEfficiency;
+  m_vRegions.resize((size_t)eSprite::Size);
+  m_vTextures.resize((size_t)eSprite::Size);
+
+  for (const SSpriteInfo& s : g_pSpriteTable) {
+    const UINT i = (UINT)s.eIndex;
+    SAtlasRegion& r = m_vRegions[i];
+    r.nPage = s.nPage < 0 ? 0 : (UINT)s.nPage;
+    r.vSize = Vector2((float)s.nWidth, (float)s.nHeight);
+    r.vUV0 = Vector2(s.fU0, s.fV0);
+    r.vUV1 = Vector2(s.fU1, s.fV1);
+    m_vTextures[i] = s.nPage < 0 ? g_nStandaloneBase + i : (UINT)s.nPage;
+  }
+}
+
+/// Get the atlas region for a sprite.
+/// \param index Sprite index
+/// \return Pointer to region, or nullptr if the sprite is standalone
+
+const SAtlasRegion* CTextureAtlas::GetRegion(UINT index) const {
+  return index < m_vRegions.size() && g_pSpriteTable[index].nPage >= 0
+             ? &m_vRegions[index]
+             : nullptr;
+}
+
+/// Count the distinct textures in the texture table.
+/// \return Texture count
+
+UINT CTextureAtlas::GetTextureCount() const {
+  return (UINT)std::set<UINT>(m_vTextures.begin(), m_vTextures.end()).size();
+}
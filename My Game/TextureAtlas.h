@@ -0,0 +1,53 @@
+/// \file TextureAtlas.h
+/// \brief Interface for the texture atlas manifest CTextureAtlas.
+
+#ifndef __L4RC_GAME_TEXTUREATLAS_H__
+#define __L4RC_GAME_TEXTUREATLAS_H__
+
+#include <vector>
+
+#include "Defines.h"
+
+/// \brief Where a sprite lives in the atlas.
+struct SAtlasRegion {
+  UINT nPage = 0;                ///< Atlas page.
+  Vector2 vSize;                 ///< Size in pixels.
+  Vector2 vUV0;                  ///< Top-left texture coordinate.
+  Vector2 vUV1;                  ///< Bottom-right texture coordinate.
+};
+
+/// \brief The texture atlas manifest.
+///
+/// Maps `eSprite` indices to the atlas regions in the manifest written by
+/// the AtlasBuilder tool, which TableGen bakes into the sprite table at build
+/// time, so that nothing is read or looked up by name at startup. Its main
+/// product is the texture table, which gives for each sprite index the
+/// texture it would be drawn from: its atlas page, or a texture of its own
+/// for sprites that were left out of the atlas. CSpriteQueue groups each
+/// page's sprites together by this table.
+class CTextureAtlas {
+ private:
+  std::vector<SAtlasRegion> m_vRegions; ///< Region for each sprite index.
+  std::vector<UINT> m_vTextures;  ///< Texture for each sprite index.
+  UINT m_nPages = 0;              ///< Number of atlas pages.
+  float m_fEfficiency = 0.0f;     ///< Packing efficiency from the manifest.
+
+ public:
+  /// \brief Fill in the regions and texture table from the sprite table.
+  void Load();
+
+  /// \brief Get the region for a sprite index.
+  /// \return Pointer to region, or nullptr if the sprite is standalone
+  const SAtlasRegion* GetRegion(UINT index) const;
+
+  /// \brief Get the texture table, indexed by sprite index.
+  const std::vector<UINT>& GetTextureTable() const { return m_vTextures; }
+
+  /// \brief Get the number of distinct textures the sprites use.
+  UINT GetTextureCount() const;
+
+  UINT GetPageCount() const { return m_nPages; }  ///< Atlas page count.
+  float GetEfficiency() const { return m_fEfficiency; }  ///< Packing efficiency.
+};
+
+#endif  //__L4RC_GAME_TEXTUREATLAS_H__
@@ -1,26 +1,40 @@
 #include "TileManager.h"
+#include "Tiles.h"
 #include "Sprite.h"
 #include "SpriteRenderer.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
 CTileManager::CTileManager(LSpriteRenderer *renderer, float tileSize)
     : m_pRenderer(renderer), m_fTileSize(tileSize) {}
 
-CTileManager::~CTileManager() {
+CTileManager::~CTileManager() { FreeMap(); }
+
+/// Delete the map rows.
+
+void CTileManager::FreeMap() {
   if (m_chMap != nullptr) {
     for (size_t i = 0; i < m_nHeight; i++)
       delete[] m_chMap[i];
     delete[] m_chMap;
   }
+  m_chMap = nullptr;
 }
 
-void CTileManager::LoadMap(const char *filename) {
+/// Read a text map, one line per row, into one string of tiles. Short rows
+/// are padded with empty tiles to the width of the first row.
+/// \param filename Map file name
+/// \param tiles [out] One character per tile, row major
+/// \param w [out] Width in tiles
+/// \param h [out] Height in tiles
+/// \return True if the file was read and is not empty
+
+static bool ReadMapFile(const char *filename, std::string &tiles, size_t &w,
+                        size_t &h) {
   std::ifstream file(filename);
-  if (!file.is_open()) {
-    std::cerr << "Could not open map file: " << filename << std::endl;
-    return;
-  }
+  if (!file.is_open())
+    return false;
 
   std::vector<std::string> lines;
   std::string line;
@@ -28,35 +42,205 @@ void CTileManager::LoadMap(const char *filename) {
     if (!line.empty())
       lines.push_back(line);
   }
+  if (lines.empty())
+    return false;
 
-  m_nHeight = lines.size();
-  m_nWidth = lines[0].size();
+  w = lines[0].size();
+  h = lines.size();
+  tiles.clear();
+  for (std::string &l : lines) {
+    l.resize(w, '0');  // short rows are padded with empty tiles
+    tiles += l;
+  }
+
+  return true;
+}
+
+void CTileManager::LoadMap(const char *filename) {
+  std::string tiles;
+  size_t w = 0, h = 0;
+
+  if (!ReadMapFile(filename, tiles, w, h)) {
+    std::cerr << "Could not open map file: " << filename << std::endl;
+    return;
+  }
+
+  LoadMap(tiles.data(), w, h);
+}
+
+/// Load a map that is already in memory, such as one from the cooked asset
+/// pack.
+/// \param tiles One character per tile, row major, top row first
+/// \param w Width in tiles
+/// \param h Height in tiles
+
+void CTileManager::LoadMap(const char *tiles, size_t w, size_t h) {
+  FreeMap();
+  m_nHeight = h;
+  m_nWidth = w;
 
   // Allocate and copy the map
   m_chMap = new char *[m_nHeight];
   for (size_t i = 0; i < m_nHeight; i++) {
     m_chMap[i] = new char[m_nWidth];
     for (size_t j = 0; j < m_nWidth; j++) {
-      m_chMap[i][j] = lines[i][j];
+      m_chMap[i][j] = tiles[i * m_nWidth + j];
+    }
+  }
+
+  BuildChunks();
+  std::cout << "Loaded map: " << m_nWidth << "x" << m_nHeight << std::endl;
+}
+
+/// Read the map file again and update only the chunks whose tiles changed.
+/// If the map changed size every chunk counts as changed.
+/// \param filename Map file name
+/// \param changed [out] Indices of the chunks that were rebuilt
+/// \return False if the file could not be read, leaving the map as it was
+
+bool CTileManager::ReloadMap(const char *filename, std::vector<int> &changed) {
+  changed.clear();
+
+  std::string tiles;
+  size_t w = 0, h = 0;
+  if (!ReadMapFile(filename, tiles, w, h))
+    return false;
+
+  if (w != m_nWidth || h != m_nHeight) {
+    LoadMap(tiles.data(), w, h);
+    for (int i = 0; i < (int)m_vChunks.size(); ++i)
+      changed.push_back(i);
+    return true;
+  }
+
+  for (int y = 0; y < (int)h; ++y)
+    for (int x = 0; x < (int)w; ++x)
+      SetTile(x, y, tiles[y * w + x]);
+
+  RebuildDirty(changed);
+  return true;
+}
+
+/// Get the tile at a map position.
+/// \param x Column
+/// \param y Row, 0 at the top
+/// \return Tile, or '0' (empty) if the position is off the map
+
+char CTileManager::GetTile(int x, int y) const {
+  if (x < 0 || y < 0 || x >= (int)m_nWidth || y >= (int)m_nHeight)
+    return '0';
+  return m_chMap[y][x];
+}
+
+/// Change a tile. Only the map is written here. The chunk holding the tile is
+/// queued, and its sprites, solid rectangles and outline are rebuilt by the
+/// next call to `RebuildDirty()`, so a burst of edits in one chunk costs one
+/// rebuild. An outline looks one tile past its chunk, so the chunks beside
+/// a tile on a chunk border are queued too.
+/// \param x Column
+/// \param y Row, 0 at the top
+/// \param id New tile, '0' for empty and anything else solid
+/// \return True if the tile changed
+
+bool CTileManager::SetTile(int x, int y, char id) {
+  if (x < 0 || y < 0 || x >= (int)m_nWidth || y >= (int)m_nHeight)
+    return false;
+  if (m_chMap[y][x] == id)
+    return false;
+
+  m_chMap[y][x] = id;
+
+  const int top = std::max(y - 1, 0);
+  const int bottom = std::min(y + 1, (int)m_nHeight - 1);
+  const int left = std::max(x - 1, 0);
+  const int right = std::min(x + 1, (int)m_nWidth - 1);
+
+  for (int yy = top; yy <= bottom; ++yy)
+    for (int xx = left; xx <= right; ++xx) {
+      const int index = (yy / m_nChunkSize) * m_nChunksW + xx / m_nChunkSize;
+      if (!m_vChunks[index].bDirty) {
+        m_vChunks[index].bDirty = true;
+        m_vDirty.push_back(index);
+      }
     }
+
+  return true;
+}
+
+/// Rebuild the chunks edited by `SetTile()` since the last call. Because
+/// merged rectangles and outline edges never cross a chunk boundary, the
+/// rebuild reruns over one 16x16 block per edited chunk, however large the
+/// map.
+/// \param changed [out] Indices of the chunks that were rebuilt
+
+void CTileManager::RebuildDirty(std::vector<int> &changed) {
+  changed.clear();
+  changed.swap(m_vDirty);
+
+  for (int i : changed) {
+    BuildChunk(i);
+    m_vChunks[i].bDirty = false;
   }
+}
+
+/// Sort the solid tiles into square chunks so that culling can reject a whole
+/// chunk with one rectangle test instead of visiting every tile.
+
+void CTileManager::BuildChunks() {
+  m_vChunks.clear();
+  m_vDirty.clear();
+
+  m_nChunksW = ((int)m_nWidth + m_nChunkSize - 1) / m_nChunkSize;
+  const int chunksH = ((int)m_nHeight + m_nChunkSize - 1) / m_nChunkSize;
+  m_vChunks.resize(m_nChunksW * chunksH);
+
+  for (int i = 0; i < (int)m_vChunks.size(); ++i)
+    BuildChunk(i);
+}
 
-  m_solidRects.clear();
-  std::vector<std::vector<bool>> used(m_nHeight,std::vector<bool>(m_nWidth, false));
+/// Rebuild one chunk's bounds, tile list, solid rectangles and outline.
+/// Solid tiles are merged greedily into rectangles, each grown as wide as it
+/// can go and then as tall, without leaving the chunk. Keeping rectangles
+/// inside their chunk is what lets a change to the map rebuild just the
+/// chunks it touches.
+/// \param index Chunk index
 
-  for (int y = 0; y < m_nHeight; ++y)
-    for (int x = 0; x < m_nWidth; ++x) {
-      if (m_chMap[y][x] != '1' || used[y][x]) continue;
+void CTileManager::BuildChunk(int index) {
+  STileChunk &c = m_vChunks[index];
+  const int x0 = (index % m_nChunksW) * m_nChunkSize;
+  const int y0 = (index / m_nChunksW) * m_nChunkSize;
+  const int x1 = std::min(x0 + m_nChunkSize, (int)m_nWidth);
+  const int y1 = std::min(y0 + m_nChunkSize, (int)m_nHeight);
+
+  // map row 0 is the top of the world, so y flips here
+  c.vMin = Vector2(x0 * m_fTileSize, (m_nHeight - y1) * m_fTileSize);
+  c.vMax = Vector2(x1 * m_fTileSize, (m_nHeight - y0) * m_fTileSize);
+
+  c.vTiles.clear();
+  for (int y = y0; y < y1; ++y)
+    for (int x = x0; x < x1; ++x)
+      if (IsSolidTile(m_chMap[y][x]))
+        c.vTiles.push_back(Vector2((x + 0.5f) * m_fTileSize,
+                                   (m_nHeight - y - 0.5f) * m_fTileSize));
+
+  c.vRects.clear();
+  bool used[m_nChunkSize][m_nChunkSize] = {};
+
+  for (int y = y0; y < y1; ++y)
+    for (int x = x0; x < x1; ++x) {
+      if (!IsSolidTile(m_chMap[y][x]) || used[y - y0][x - x0]) continue;
 
       int w = 0;
-      while (x + w < m_nWidth && m_chMap[y][x + w] == '1' && !used[y][x + w])
+      while (x + w < x1 && IsSolidTile(m_chMap[y][x + w]) &&
+             !used[y - y0][x + w - x0])
         w++;
 
       int h = 1;
       bool done = false;
-      while (y + h < m_nHeight && !done) {
+      while (y + h < y1 && !done) {
         for (int i = 0; i < w; ++i)
-          if (m_chMap[y + h][x + i] != '1' || used[y + h][x + i]) {
+          if (!IsSolidTile(m_chMap[y + h][x + i]) ||
+              used[y + h - y0][x + i - x0]) {
             done = true;
             break;
           }
@@ -64,42 +248,127 @@ void CTileManager::LoadMap(const char *filename) {
       }
 
       for (int yy = y; yy < y + h; ++yy)
-        for (int xx = x; xx < x + w; ++xx) used[yy][xx] = true;
+        for (int xx = x; xx < x + w; ++xx) used[yy - y0][xx - x0] = true;
 
-      m_solidRects.push_back({x, y, w, h});
+      c.vRects.push_back({x, y, w, h});
     }
 
-  //m_solidTiles.clear();
-  //// Identify solid tiles (represented by '#')
-  //for (size_t i = 0; i < m_nHeight; i++) {
-  //  for (size_t j = 0; j < m_nWidth; j++) {
-  //    if (m_chMap[i][j] == '1') {
-  //      float x = (j * 0.5f) * m_fTileSize;
-  //      float y = (m_nHeight - 1 - i * 0.5f) * m_fTileSize;
-  //      m_solidTiles.push_back(Vector2(x, y));
-  //    } else {
-  //      continue;
-  //    }
-  //  }
-  //}
-  //m_vWorldSize = Vector2((float)m_nWidth, (float)m_nHeight) * m_fTileSize;
-  std::cout << "Loaded map: " << m_nWidth << "x" << m_nHeight << std::endl;
+  BuildEdges(c, x0, y0, x1, y1);
+  m_bRectsDirty = true;
 }
 
-void CTileManager::Draw() {
-  if (!m_chMap) return;
+/// Trace the outline of a chunk's solid tiles as one-sided edges. Every face
+/// of a solid tile that borders an empty one, on or off the map, is on the
+/// outline, and runs of faces in a line are joined into one edge as far as
+/// the chunk border. Each edge's ghost corners come from the tiles just past
+/// its ends, which may be in the next chunk. Box2D then sees the outline
+/// carry on across a seam, whether chunk border or corner, and a body
+/// sliding along a floor does not catch on the end of an edge the way it
+/// does on the corner of a box.
+/// \param c Chunk
+/// \param x0 Left column
+/// \param y0 Top row
+/// \param x1 Column past the right
+/// \param y1 Row past the bottom
 
-LSpriteDesc2D d;
-  d.m_nSpriteIndex = (UINT)eSprite::Dirt;
+void CTileManager::BuildEdges(STileChunk &c, int x0, int y0, int x1, int y1) {
+  static const int normals[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+  auto solid = [this](int x, int y) { return IsSolidTile(GetTile(x, y)); };
+
+  c.vEdges.clear();
+
+  for (const auto &n : normals) {
+    const int nx = n[0], ny = n[1];  // toward the empty side
+    const int tx = ny, ty = -nx;     // along the edge
+
+    auto face = [&](int x, int y) {
+      return x >= x0 && x < x1 && y >= y0 && y < y1 && solid(x, y) &&
+             !solid(x + nx, y + ny);
+    };
 
-  for (int y = 0; y < m_nHeight; ++y) {
-    for (int x = 0; x < m_nWidth; ++x) {
-      if (m_chMap[y][x] != '1') continue;
+    for (int y = y0; y < y1; ++y)
+      for (int x = x0; x < x1; ++x) {
+        if (!face(x, y) || face(x - tx, y - ty)) continue;  // not a run start
 
-      d.m_vPos.x = (x + 0.5f) * m_fTileSize;
-      d.m_vPos.y = (m_nHeight - y - 0.5f) * m_fTileSize;
+        int len = 1;
+        while (face(x + len * tx, y + len * ty)) len++;
 
-      m_pRenderer->Draw(&d);
+        TileEdge e;
+        e.x1 = x + (1 + nx - tx) / 2;
+        e.y1 = y + (1 + ny - ty) / 2;
+        e.x2 = e.x1 + len * tx;
+        e.y2 = e.y1 + len * ty;
+
+        const int px = x - tx, py = y - ty;  // tile before the run
+        if (solid(px + nx, py + ny)) {  // inside corner
+          e.x0 = e.x1 + nx;
+          e.y0 = e.y1 + ny;
+        } else if (solid(px, py)) {  // straight on, in the next chunk
+          e.x0 = e.x1 - tx;
+          e.y0 = e.y1 - ty;
+        } else {  // outside corner
+          e.x0 = e.x1 - nx;
+          e.y0 = e.y1 - ny;
+        }
+
+        const int qx = x + len * tx, qy = y + len * ty;  // tile after it
+        if (solid(qx + nx, qy + ny)) {
+          e.x3 = e.x2 + nx;
+          e.y3 = e.y2 + ny;
+        } else if (solid(qx, qy)) {
+          e.x3 = e.x2 + tx;
+          e.y3 = e.y2 + ty;
+        } else {
+          e.x3 = e.x2 - nx;
+          e.y3 = e.y2 - ny;
+        }
+
+        c.vEdges.push_back(e);
+      }
+  }
+
+  std::sort(c.vEdges.begin(), c.vEdges.end());
+}
+
+/// Get every solid rectangle in the map, gathered from the chunks.
+/// \return Solid rectangles in tile coordinates, row 0 at the top
+
+const std::vector<TileRect> &CTileManager::GetSolidRects() {
+  if (m_bRectsDirty) {
+    m_solidRects.clear();
+    for (const STileChunk &c : m_vChunks)
+      m_solidRects.insert(m_solidRects.end(), c.vRects.begin(), c.vRects.end());
+    m_bRectsDirty = false;
+  }
+
+  return m_solidRects;
+}
+
+/// Rebuild the list of tile sprites that overlap a view rectangle. This does
+/// not touch the renderer, so it is safe to run on a worker thread.
+/// \param view View rectangle in pixels
+
+void CTileManager::Cull(const SViewRect &view) {
+  m_vVisible.clear();
+
+  LSpriteDesc2D d;
+  d.m_nSpriteIndex = (UINT)eSprite::Dirt;
+
+  for (const STileChunk &c : m_vChunks) {
+    if (!view.Overlaps(c.vMin.x, c.vMin.y, c.vMax.x, c.vMax.y)) continue;
+
+    for (const Vector2 &p : c.vTiles) {
+      d.m_vPos = p;
+      m_vVisible.push_back(d);
     }
   }
 }
+
+/// Draw the tiles that survived the last call to `Cull()`.
+/// \param pPacket Frame packet to record into
+
+void CTileManager::Draw(CFramePacket *pPacket) {
+  pPacket->SetLayer(eSpriteLayer::Tiles);
+  for (const LSpriteDesc2D &d : m_vVisible) pPacket->Draw(&d);
+}
@@ -7,6 +7,9 @@
 #include "Sprite.h"
 #include "SpriteRenderer.h"
 #include "GameDefines.h"
+#include "Camera.h"
+#include "FramePacket.h"
+#include <tuple>
 #include <vector>
 
 /// \brief The tile manager.
@@ -15,6 +18,24 @@ struct TileRect {
   int x, y, w, h;
 };
 
+/// \brief A one-sided edge along a run of tile faces that border empty
+/// tiles, in tile corners with row 0 at the top. It runs from (x1, y1) to
+/// (x2, y2) with the empty side on its right once y points up, as Box2D
+/// wants. (x0, y0) and (x3, y3) are the ghost corners, where the outline
+/// goes before and after it, possibly in another chunk.
+struct TileEdge {
+  int x0, y0, x1, y1, x2, y2, x3, y3;
+
+  bool operator<(const TileEdge &e) const {
+    return std::tie(x1, y1, x2, y2, x0, y0, x3, y3) <
+           std::tie(e.x1, e.y1, e.x2, e.y2, e.x0, e.y0, e.x3, e.y3);
+  } ///< Order by position
+
+  bool operator==(const TileEdge &e) const {
+    return !(*this < e) && !(e < *this);
+  } ///< Same corners and ghosts
+};
+
 class CTileManager {
 private:
   size_t m_nWidth = 0;       ///< Number of tiles wide.
@@ -27,19 +48,58 @@ private:
 
   std::vector<Vector2> m_solidTiles; // positions of solid tiles for collision
 
+  /// \brief A square block of tiles, the unit of culling and rebuilding.
+  struct STileChunk {
+    Vector2 vMin;                ///< Bottom-left corner in pixels.
+    Vector2 vMax;                ///< Top-right corner in pixels.
+    std::vector<Vector2> vTiles; ///< Centers of solid tiles in pixels.
+    std::vector<TileRect> vRects; ///< Merged solid tiles, inside the chunk.
+    std::vector<TileEdge> vEdges; ///< Outline of its solid tiles, sorted.
+    bool bDirty = false;         ///< Edited since the last rebuild.
+  };
+
+  static const int m_nChunkSize = 16;      ///< Chunk width and height in tiles.
+  int m_nChunksW = 0;                      ///< Number of chunks wide.
+  std::vector<STileChunk> m_vChunks;       ///< Chunks, row major.
+  std::vector<LSpriteDesc2D> m_vVisible;   ///< Tile sprites that survived culling.
+  std::vector<TileRect> m_solidRects;      ///< All chunks' rectangles.
+  bool m_bRectsDirty = true;               ///< m_solidRects needs gathering.
+  std::vector<int> m_vDirty;               ///< Edited chunks, no duplicates.
+
+  void FreeMap();             ///< Delete the map rows.
+  void BuildChunks();         ///< Sort solid tiles into chunks.
+  void BuildChunk(int index); ///< Rebuild one chunk from the map.
+  void BuildEdges(STileChunk &c, int x0, int y0, int x1, int y1); ///< Outline
+
 public:
 
   CTileManager(LSpriteRenderer *renderer, float tileSize = 16.0f);
   ~CTileManager();
 
   void LoadMap(const char *filename); ///< Load a map from text file
-  void Draw();                        ///< Draw all tiles
+  void LoadMap(const char *tiles, size_t w, size_t h); ///< Load from memory
+  bool ReloadMap(const char *filename, std::vector<int> &changed); ///< Reload
+  char GetTile(int x, int y) const; ///< Get a tile, '0' if off the map
+  bool SetTile(int x, int y, char id); ///< Change a tile, rebuilt later
+  void RebuildDirty(std::vector<int> &changed); ///< Rebuild edited chunks
+  void Cull(const SViewRect &view); ///< Cull to view rect
+  void Draw(CFramePacket *pPacket);   ///< Draw tiles that survived culling
 
   const std::vector<Vector2> &GetSolidTiles() const { return m_solidTiles; }
   const float &GetTileSize() const { return m_fTileSize; }
   int GetMapHeight() const { return m_nHeight; }
-  std::vector<TileRect> m_solidRects;
-  const std::vector<TileRect> &GetSolidRects() { return m_solidRects; }
+  size_t GetVisibleCount() const { return m_vVisible.size(); } ///< Culled
+  int GetMapWidth() const { return m_nWidth; }
+  const std::vector<TileRect> &GetSolidRects(); ///< Every solid rectangle
+
+  size_t GetChunkCount() const { return m_vChunks.size(); } ///< Chunk count
+  int GetChunkSize() const { return m_nChunkSize; } ///< Chunk width in tiles
+  const std::vector<TileRect> &GetChunkRects(int index) const {
+    return m_vChunks[index].vRects;
+  } ///< Solid rectangles of one chunk
+  const std::vector<TileEdge> &GetChunkEdges(int index) const {
+    return m_vChunks[index].vEdges;
+  } ///< Outline of one chunk
 };
 
 
@@ -0,0 +1,18 @@
+/// \file Tiles.h
+/// \brief The tile solidity test shared by everything that reads the map.
+///
+/// A map is one character per tile. '0' is empty, and every other tile is
+/// drawn and is solid to the Box2D chunks, the navigation graph and the
+/// crowd, so that nothing can be seen that they walk through. Platforms
+/// ('2') and slopes ('3' and '4') are whole blocks to them. Only
+/// CGridController gives those tiles their own rules.
+
+#ifndef __L4RC_GAME_TILES_H__
+#define __L4RC_GAME_TILES_H__
+
+/// \brief Check whether a tile is solid, which is whether it is drawn.
+/// \param tile Tile from the map
+/// \return True unless the tile is empty
+inline bool IsSolidTile(char tile) { return tile != '0'; }
+
+#endif  //__L4RC_GAME_TILES_H__
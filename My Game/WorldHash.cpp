@@ -0,0 +1,116 @@
+/// \file WorldHash.cpp
+/// \brief Code for the per-frame simulation checksum CWorldHash.
+
+#include "WorldHash.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+/// Constructor. Every part starts stale, so that rarely changing parts are
+/// hashed on the first frame.
+
+CWorldHash::CWorldHash() { Reset(); }
+
+/// Combine the last frame's world hash with each part's hash, in part order,
+/// and record the frame if recording.
+/// \return The frame's hashes
+
+const SFrameHash& CWorldHash::EndFrame() {
+  SFrameHash& f = m_last;
+  f.nFrame = m_nFrame++;
+
+  uint64_t h = HashValue(m_nWorld);
+  for (int i = 0; i < (int)eHashPart::Count; ++i) {
+    f.nPart[i] = m_pPart[i];
+    h = HashValue(m_pPart[i], h);
+  }
+
+  f.nWorld = m_nWorld = h;
+  if (m_bRecord) m_vFrames.push_back(f);
+  return f;
+}
+
+void CWorldHash::Reset() {
+  std::fill(m_pPart, m_pPart + (int)eHashPart::Count, g_nHashSeed);
+  std::fill(m_pStale, m_pStale + (int)eHashPart::Count, true);
+  m_nWorld = g_nHashSeed;
+  m_nFrame = 0;
+  m_last = SFrameHash();
+  m_vFrames.clear();
+}
+
+/// Write each frame as its number, world hash and part hashes in hex, so
+/// that two logs can also be compared with a text diff.
+/// \param fileName File name
+/// \return True if the file was written
+
+bool CWorldHash::Write(const char* fileName) const {
+  FILE* pFile = fopen(fileName, "w");
+  if (!pFile) return false;
+
+  for (const SFrameHash& f : m_vFrames) {
+    fprintf(pFile, "%" PRIu32 " %016" PRIx64, f.nFrame, f.nWorld);
+    for (uint64_t h : f.nPart) fprintf(pFile, " %016" PRIx64, h);
+    fputc('\n', pFile);
+  }
+
+  return fclose(pFile) == 0;
+}
+
+bool ReadHashLog(const char* fileName, std::vector<SFrameHash>& frames) {
+  frames.clear();
+
+  FILE* pFile = fopen(fileName, "r");
+  if (!pFile) return false;
+
+  SFrameHash f;
+  while (fscanf(pFile, "%" SCNu32 " %" SCNx64, &f.nFrame, &f.nWorld) == 2) {
+    int i = 0;
+    while (i < (int)eHashPart::Count &&
+           fscanf(pFile, " %" SCNx64, &f.nPart[i]) == 1)
+      ++i;
+    if (i < (int)eHashPart::Count) break;
+    frames.push_back(f);
+  }
+
+  fclose(pFile);
+  return !frames.empty();
+}
+
+/// Compare two runs frame by frame. If one run is longer and the frames they
+/// share all match, the first frame past the end of the shorter one is
+/// reported with every bit set.
+/// \param a One run's frames
+/// \param b The other run's frames
+/// \param frame [out] Index of the first frame that differs
+/// \return Bit per part that differs there, 0 if the runs match
+
+uint32_t FindDivergence(const std::vector<SFrameHash>& a,
+                        const std::vector<SFrameHash>& b, size_t& frame) {
+  const size_t n = std::min(a.size(), b.size());
+
+  for (frame = 0; frame < n; ++frame) {
+    if (a[frame].nWorld == b[frame].nWorld) continue;
+
+    uint32_t parts = 0;
+    for (int i = 0; i < (int)eHashPart::Count; ++i)
+      if (a[frame].nPart[i] != b[frame].nPart[i]) parts |= 1u << i;
+    return parts;
+  }
+
+  return a.size() == b.size() ? 0 : (1u << (int)eHashPart::Count) - 1;
+}
+
+const char* GetHashPartName(eHashPart part) {
+  switch (part) {
+    case eHashPart::Bodies: return "bodies";
+    case eHashPart::Player: return "player";
+    case eHashPart::Bullets: return "bullets";
+    case eHashPart::Inventory: return "inventory";
+    case eHashPart::Drops: return "drops";
+    case eHashPart::Crowd: return "crowd";
+    case eHashPart::Tiles: return "tiles";
+    default: return "?";
+  }
+}
@@ -0,0 +1,162 @@
+/// \file WorldHash.h
+/// \brief Interface for the per-frame simulation checksum CWorldHash.
+
+#ifndef __L4RC_GAME_WORLDHASH_H__
+#define __L4RC_GAME_WORLDHASH_H__
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/// \brief A part of the simulation with a hash of its own.
+///
+/// When two runs diverge, the parts whose hashes differ at the first frame
+/// that differs say where to look.
+enum class eHashPart : uint32_t {
+  Bodies,     ///< Box2D bodies that can move.
+  Player,     ///< Player state and contact flags.
+  Bullets,    ///< Bullet lifetimes.
+  Inventory,  ///< Inventory slots and selection.
+  Drops,      ///< Items dropped in the world.
+  Crowd,      ///< Enemy crowd.
+  Tiles,      ///< Tile map, hashed only when it changes.
+  Count       ///< Number of parts.
+};
+
+const uint64_t g_nHashSeed = 0xcbf29ce484222325ULL;  ///< Empty hash.
+
+/// \brief Hash memory 8 bytes at a time.
+///
+/// Floats are hashed by their bits, so two states hash the same only if
+/// they are bit-for-bit the same, which is what determinism means here.
+/// This is not FNV, which goes a byte at a time and is several times slower
+/// on the crowd's arrays, but a multiply and shift per word that still lets
+/// every bit of the input reach every bit of the hash.
+/// \param p Pointer to data
+/// \param n Size of data in bytes
+/// \param h Hash to continue from
+/// \return Hash
+inline uint64_t HashWords(const void* p, size_t n, uint64_t h = g_nHashSeed) {
+  const unsigned char* b = (const unsigned char*)p;
+  uint64_t w;
+
+  for (; n >= 8; n -= 8, b += 8) {
+    memcpy(&w, b, 8);
+    h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 32;
+  }
+
+  if (n > 0) {
+    w = 0;
+    memcpy(&w, b, n);
+    h = (h ^ w ^ (uint64_t)n << 56) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 32;
+  }
+
+  return h;
+}
+
+/// \brief Hash the contents of an array.
+/// \param v Array
+/// \param h Hash to continue from
+/// \return Hash
+template <class T>
+inline uint64_t HashArray(const std::vector<T>& v, uint64_t h = g_nHashSeed) {
+  const uint64_t n = v.size();  // so that moving an element between arrays
+  h = HashWords(&n, sizeof(n), h);  // changes the hash
+  return v.empty() ? h : HashWords(v.data(), v.size() * sizeof(T), h);
+}
+
+/// \brief Hash a value.
+/// \param x Value, with no padding bytes
+/// \param h Hash to continue from
+/// \return Hash
+template <class T>
+inline uint64_t HashValue(const T& x, uint64_t h = g_nHashSeed) {
+  return HashWords(&x, sizeof(T), h);
+}
+
+/// \brief The hashes of one frame.
+struct SFrameHash {
+  uint32_t nFrame = 0;  ///< Frame number, from 0.
+  uint64_t nWorld = 0;  ///< Every part, and every frame before this one.
+  uint64_t nPart[(int)eHashPart::Count] = {}; ///< Each part's hash.
+};
+
+/// \brief A per-frame checksum of the simulation.
+///
+/// Each frame the game hashes the state of each part and hands it over with
+/// `Set()`. `EndFrame()` combines the parts with the last frame's world hash,
+/// so a run that diverged once never matches again, and records the frame.
+/// Comparing the records of two runs with the same input finds the first
+/// frame where they differ, and which parts differ there.
+///
+/// The cost is kept down by hashing each part's arrays directly a word at a
+/// time, and by leaving parts that change rarely, such as the tile map, to
+/// be hashed again only when they are marked stale. Their last hash goes
+/// into every frame until then.
+class CWorldHash {
+ private:
+  uint64_t m_pPart[(int)eHashPart::Count] = {}; ///< Current hash by part.
+  bool m_pStale[(int)eHashPart::Count] = {};    ///< Part needs hashing.
+  uint64_t m_nWorld = g_nHashSeed;              ///< Last frame's world hash.
+  uint32_t m_nFrame = 0;                        ///< Next frame number.
+  SFrameHash m_last;                            ///< Last frame.
+  bool m_bRecord = true;                        ///< Keep every frame.
+  std::vector<SFrameHash> m_vFrames;            ///< Recorded frames.
+
+ public:
+  CWorldHash(); ///< Constructor.
+
+  /// \brief Set a part's hash for this frame.
+  void Set(eHashPart part, uint64_t hash) {
+    m_pPart[(int)part] = hash;
+    m_pStale[(int)part] = false;
+  }
+
+  /// \brief Mark a rarely changing part as in need of hashing.
+  void Invalidate(eHashPart part) { m_pStale[(int)part] = true; }
+
+  /// \brief Check whether a part needs hashing.
+  bool IsStale(eHashPart part) const { return m_pStale[(int)part]; }
+
+  /// \brief Combine the parts into this frame's world hash and record it.
+  /// \return The frame's hashes
+  const SFrameHash& EndFrame();
+
+  /// \brief Set whether `EndFrame()` keeps every frame or only the last.
+  void SetRecording(bool record) { m_bRecord = record; }
+
+  /// \brief Forget every frame and start again from frame 0.
+  void Reset();
+
+  /// \brief Get the recorded frames.
+  const std::vector<SFrameHash>& GetFrames() const { return m_vFrames; }
+
+  /// \brief Get the last frame's hashes.
+  const SFrameHash& GetLast() const { return m_last; }
+
+  /// \brief Write the recorded frames as text, one frame per line.
+  /// \param fileName File name
+  /// \return True if the file was written
+  bool Write(const char* fileName) const;
+};
+
+/// \brief Read frames written by `CWorldHash::Write()`.
+/// \param fileName File name
+/// \param frames [out] Frames
+/// \return True if the file was read
+bool ReadHashLog(const char* fileName, std::vector<SFrameHash>& frames);
+
+/// \brief Find the first frame where two runs differ.
+/// \param a One run's frames
+/// \param b The other run's frames
+/// \param frame [out] Index of the first frame that differs
+/// \return Bit per part that differs there, 0 if the runs match
+uint32_t FindDivergence(const std::vector<SFrameHash>& a,
+                        const std::vector<SFrameHash>& b, size_t& frame);
+
+/// \brief Get a part's name.
+const char* GetHashPartName(eHashPart part);
+
+#endif  //__L4RC_GAME_WORLDHASH_H__
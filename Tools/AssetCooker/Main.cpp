@@ -0,0 +1,417 @@
+/// \file Main.cpp
+/// \brief Offline asset cooker.
+///
+/// Reads `gamesettings.xml` and everything it names, and writes a single pack
+/// file that the game memory maps at startup. Images are decoded to BGRA,
+/// sounds are stripped to raw PCM, the sprite font is stored as is, the map
+/// loses its line breaks. Data is stored once per content hash, so identical
+/// files share their bytes.
+/// Run it from the solution directory:
+///
+///     AssetCooker [-out file] [-map file] [-force]
+///
+/// The pack records the time stamp and hash of every source file. If no time
+/// stamp has changed the cooker does nothing. Otherwise sources whose hash is
+/// unchanged have their cooked data copied from the old pack, and only the
+/// rest are decoded again.
+
+#define NOMINMAX
+#include <windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "AssetPack.h"
+#include "tinyxml2.h"
+
+using Microsoft::WRL::ComPtr;
+
+static const char* g_szSettings = "Media\\XML\\gamesettings.xml";  ///< Input.
+
+/// \brief An entry on its way into the pack.
+struct SCooked {
+  SPackEntry entry = {};     ///< Entry, offset filled in when written.
+  std::vector<char> vData;   ///< Cooked data.
+};
+
+/// \brief What the cooker knows about a source file.
+struct SSource {
+  SPackSource record = {};   ///< Record as it goes in the pack.
+  std::vector<char> vBytes;  ///< File contents.
+};
+
+/// Read a whole file.
+/// \param fileName File name
+/// \param bytes [out] File contents
+/// \return True if it worked
+
+static bool LoadFile(const std::string& fileName, std::vector<char>& bytes) {
+  FILE* input = nullptr;
+  if (fopen_s(&input, fileName.c_str(), "rb") || !input) return false;
+
+  fseek(input, 0, SEEK_END);
+  bytes.resize((size_t)ftell(input));
+  fseek(input, 0, SEEK_SET);
+  const size_t n = fread(bytes.data(), 1, bytes.size(), input);
+  fclose(input);
+
+  return n == bytes.size();
+}
+
+/// Get a file's last write time.
+/// \param fileName File name
+/// \return Time stamp, or 0 if the file is missing
+
+static uint64_t FileTime(const std::string& fileName) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExA(fileName.c_str(), GetFileExInfoStandard, &data))
+    return 0;
+  return ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) |
+         data.ftLastWriteTime.dwLowDateTime;
+}
+
+/// Decode an image to BGRA with WIC.
+/// \param pFactory WIC factory
+/// \param fileName File name
+/// \param cooked [out] Cooked entry
+/// \return True if it worked
+
+static bool CookImage(IWICImagingFactory* pFactory, const std::string& fileName,
+                      SCooked& cooked) {
+  ComPtr<IWICBitmapDecoder> decoder;
+  ComPtr<IWICBitmapFrameDecode> frame;
+  ComPtr<IWICFormatConverter> converter;
+
+  const std::wstring wide(fileName.begin(), fileName.end());
+  if (FAILED(pFactory->CreateDecoderFromFilename(
+          wide.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand,
+          &decoder)))
+    return false;
+  if (FAILED(decoder->GetFrame(0, &frame))) return false;
+  if (FAILED(pFactory->CreateFormatConverter(&converter))) return false;
+  if (FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppBGRA,
+                                   WICBitmapDitherTypeNone, nullptr, 0.0,
+                                   WICBitmapPaletteTypeCustom)))
+    return false;
+
+  UINT w = 0, h = 0;
+  converter->GetSize(&w, &h);
+  cooked.vData.resize((size_t)w * h * 4);
+  cooked.entry.eKind = ePackKind::Image;
+  cooked.entry.nParam[0] = w;
+  cooked.entry.nParam[1] = h;
+
+  return SUCCEEDED(converter->CopyPixels(nullptr, w * 4,
+                                         (UINT)cooked.vData.size(),
+                                         (BYTE*)cooked.vData.data()));
+}
+
+/// Strip a WAV file down to its PCM samples by walking the RIFF chunks.
+/// \param bytes WAV file contents
+/// \param cooked [out] Cooked entry
+/// \return True if it worked
+
+static bool CookSound(const std::vector<char>& bytes, SCooked& cooked) {
+  if (bytes.size() < 12 || memcmp(bytes.data(), "RIFF", 4) ||
+      memcmp(bytes.data() + 8, "WAVE", 4))
+    return false;
+
+  cooked.entry.eKind = ePackKind::Sound;
+  bool format = false;
+
+  for (size_t i = 12; i + 8 <= bytes.size();) {
+    const char* chunk = bytes.data() + i;
+    uint32_t size = 0;
+    memcpy(&size, chunk + 4, 4);
+    if (i + 8 + size > bytes.size()) return false;
+
+    if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+      uint16_t channels = 0, bits = 0;
+      uint32_t rate = 0;
+      memcpy(&channels, chunk + 10, 2);
+      memcpy(&rate, chunk + 12, 4);
+      memcpy(&bits, chunk + 22, 2);
+      cooked.entry.nParam[0] = rate;
+      cooked.entry.nParam[1] = channels;
+      cooked.entry.nParam[2] = bits;
+      format = true;
+    } else if (!memcmp(chunk, "data", 4)) {
+      cooked.vData.assign(chunk + 8, chunk + 8 + size);
+      return format;
+    }
+
+    i += 8 + size + (size & 1);  // chunks are word aligned
+  }
+
+  return false;
+}
+
+/// Drop the line breaks from a text map. Every row must be the same width.
+/// \param bytes Map file contents
+/// \param cooked [out] Cooked entry
+/// \return True if it worked
+
+static bool CookMap(const std::vector<char>& bytes, SCooked& cooked) {
+  cooked.entry.eKind = ePackKind::Map;
+  uint32_t w = 0, h = 0;
+  std::string line;
+
+  for (size_t i = 0; i <= bytes.size(); i++) {
+    const char c = i < bytes.size() ? bytes[i] : '\n';
+    if (c == '\r') continue;
+
+    if (c != '\n') {
+      line += c;
+    } else if (!line.empty()) {
+      if (h > 0 && line.size() != w) return false;
+      w = (uint32_t)line.size();
+      cooked.vData.insert(cooked.vData.end(), line.begin(), line.end());
+      line.clear();
+      h++;
+    }
+  }
+
+  cooked.entry.nParam[0] = w;
+  cooked.entry.nParam[1] = h;
+  return h > 0;
+}
+
+/// Read an existing pack into memory.
+/// \param fileName Pack file name
+/// \param bytes [out] Pack contents
+/// \return Pointer to the header, or nullptr if there is no usable pack
+
+static const SPackHeader* ReadPack(const std::string& fileName,
+                                   std::vector<char>& bytes) {
+  if (!LoadFile(fileName, bytes) || bytes.size() < sizeof(SPackHeader))
+    return nullptr;
+
+  const SPackHeader* pHeader = (const SPackHeader*)bytes.data();
+  if (memcmp(pHeader->szMagic, "LPAK", 4) ||
+      pHeader->nVersion != g_nPackVersion)
+    return nullptr;
+
+  return pHeader;
+}
+
+/// Write the pack: header, data blobs aligned to 16 bytes with one copy per
+/// content hash, then the entries, hash slots and source records.
+/// \param fileName Pack file name
+/// \param cooked Cooked entries
+/// \param sources Source files
+/// \return True if it worked
+
+static bool WritePack(const std::string& fileName,
+                      std::vector<SCooked>& cooked,
+                      const std::vector<SSource>& sources) {
+  FILE* output = nullptr;
+  if (fopen_s(&output, fileName.c_str(), "wb") || !output) return false;
+
+  SPackHeader header = {};
+  memcpy(header.szMagic, "LPAK", 4);
+  header.nVersion = g_nPackVersion;
+  header.nEntries = (uint32_t)cooked.size();
+  header.nSources = (uint32_t)sources.size();
+  header.nSlots = 1;
+  while (header.nSlots < 2 * header.nEntries) header.nSlots <<= 1;
+
+  fwrite(&header, sizeof(header), 1, output);
+
+  const char zeros[16] = {};
+  std::map<uint64_t, uint64_t> written;  // content hash to offset
+
+  for (SCooked& c : cooked) {
+    c.entry.nHash = PackHash(c.vData.data(), c.vData.size());
+    c.entry.nSize = c.vData.size();
+
+    auto it = written.find(c.entry.nHash);
+    if (it != written.end()) {
+      c.entry.nOffset = it->second;
+      continue;
+    }
+
+    const long pos = ftell(output);
+    fwrite(zeros, 1, (16 - pos % 16) % 16, output);
+    c.entry.nOffset = (uint64_t)ftell(output);
+    fwrite(c.vData.data(), 1, c.vData.size(), output);
+    written[c.entry.nHash] = c.entry.nOffset;
+  }
+
+  std::vector<uint32_t> slots(header.nSlots, 0);
+  for (uint32_t i = 0; i < header.nEntries; i++) {
+    uint32_t j = (uint32_t)cooked[i].entry.nKey & (header.nSlots - 1);
+    while (slots[j]) j = (j + 1) & (header.nSlots - 1);
+    slots[j] = i + 1;
+  }
+
+  const long pos = ftell(output);
+  fwrite(zeros, 1, (16 - pos % 16) % 16, output);
+  header.nEntryOffset = (uint64_t)ftell(output);
+  for (const SCooked& c : cooked)
+    fwrite(&c.entry, sizeof(SPackEntry), 1, output);
+
+  header.nSlotOffset = (uint64_t)ftell(output);
+  fwrite(slots.data(), sizeof(uint32_t), slots.size(), output);
+
+  header.nSourceOffset = (uint64_t)ftell(output);
+  for (const SSource& s : sources)
+    fwrite(&s.record, sizeof(SPackSource), 1, output);
+
+  fseek(output, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, output);
+  fclose(output);
+  return true;
+}
+
+/// Read arguments, check whether the pack is up to date, and cook.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 on success
+
+int main(int argc, char* argv[]) {
+  std::string outFile = "Media\\Cooked\\assets.pak";
+  std::string mapFile = "Media\\Maps\\testmap.txt";
+  bool force = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-force")) force = true;
+    else if (!strcmp(argv[i], "-out") && i + 1 < argc) outFile = argv[++i];
+    else if (!strcmp(argv[i], "-map") && i + 1 < argc) mapFile = argv[++i];
+  }
+
+  tinyxml2::XMLDocument doc;
+  if (doc.LoadFile(g_szSettings) != tinyxml2::XML_SUCCESS) {
+    printf("Cannot read %s\n", g_szSettings);
+    return 1;
+  }
+  tinyxml2::XMLElement* pSettings = doc.FirstChildElement("settings");
+
+  // every source file, with the name of the entry it becomes
+
+  std::vector<std::pair<std::string, std::string>> inputs;  // name, file
+  inputs.push_back({"map", mapFile});
+
+  if (tinyxml2::XMLElement* p = pSettings->FirstChildElement("font"))
+    if (p->Attribute("file")) inputs.push_back({"font", p->Attribute("file")});
+
+  const char* lists[][2] = {{"sprites", "sprite"}, {"sounds", "sound"}};
+  for (const auto& list : lists) {
+    tinyxml2::XMLElement* pList = pSettings->FirstChildElement(list[0]);
+    if (!pList) continue;
+    const std::string path = pList->Attribute("path");
+
+    for (tinyxml2::XMLElement* p = pList->FirstChildElement(list[1]); p;
+         p = p->NextSiblingElement(list[1]))
+      if (p->Attribute("name") && p->Attribute("file"))
+        inputs.push_back({std::string(list[1]) + "." + p->Attribute("name"),
+                          path + "\\" + p->Attribute("file")});
+  }
+
+  // compare time stamps with the old pack
+
+  std::vector<char> oldBytes;
+  const SPackHeader* pOld = ReadPack(outFile, oldBytes);
+  std::map<std::string, SPackSource> oldSources;
+  std::map<std::string, const SPackEntry*> oldEntries;
+
+  if (pOld) {
+    const SPackSource* s =
+        (const SPackSource*)(oldBytes.data() + pOld->nSourceOffset);
+    for (uint32_t i = 0; i < pOld->nSources; i++)
+      oldSources[s[i].szPath] = s[i];
+
+    const SPackEntry* e =
+        (const SPackEntry*)(oldBytes.data() + pOld->nEntryOffset);
+    for (uint32_t i = 0; i < pOld->nEntries; i++)
+      oldEntries[e[i].szName] = &e[i];
+  }
+
+  bool stale = force || !pOld || oldSources.size() != inputs.size();
+  for (const auto& input : inputs) {
+    auto it = oldSources.find(input.second);
+    if (it == oldSources.end() || it->second.nTime != FileTime(input.second))
+      stale = true;
+  }
+
+  if (!stale) {
+    printf("%s is up to date\n", outFile.c_str());
+    return 0;
+  }
+
+  // cook whatever changed, copy the rest
+
+  CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+  ComPtr<IWICImagingFactory> factory;
+  CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+                   IID_PPV_ARGS(&factory));
+
+  std::vector<SSource> sources;
+  std::vector<SCooked> cooked;
+  size_t reused = 0;
+
+  for (const auto& input : inputs) {
+    SSource source;
+    if (!LoadFile(input.second, source.vBytes)) {
+      printf("Cannot read %s, skipped\n", input.second.c_str());
+      continue;
+    }
+
+    source.record.nTime = FileTime(input.second);
+    source.record.nHash = PackHash(source.vBytes.data(), source.vBytes.size());
+    strncpy_s(source.record.szPath, input.second.c_str(), _TRUNCATE);
+
+    SCooked c;
+    auto it = oldEntries.find(input.first);
+
+    if (!force && it != oldEntries.end() &&
+        it->second->nSourceHash == source.record.nHash) {
+      const char* p = oldBytes.data() + it->second->nOffset;
+      c.entry = *it->second;
+      c.vData.assign(p, p + it->second->nSize);
+      reused++;
+    } else {
+      bool ok = true;
+      const std::string& name = input.first;
+
+      if (name == "map") ok = CookMap(source.vBytes, c);
+      else if (name == "font") {
+        c.entry.eKind = ePackKind::Font;
+        c.vData = source.vBytes;
+      } else if (name.compare(0, 7, "sprite.") == 0)
+        ok = CookImage(factory.Get(), input.second, c);
+      else ok = CookSound(source.vBytes, c);
+
+      if (!ok) {
+        printf("Cannot cook %s, skipped\n", input.second.c_str());
+        continue;
+      }
+    }
+
+    c.entry.nSourceHash = source.record.nHash;
+    c.entry.nKey = PackHash(input.first.data(), input.first.size());
+    strncpy_s(c.entry.szName, input.first.c_str(), _TRUNCATE);
+    cooked.push_back(std::move(c));
+    sources.push_back(std::move(source));
+  }
+
+  CoUninitialize();
+
+  CreateDirectoryA("Media\\Cooked", nullptr);
+  if (!WritePack(outFile, cooked, sources)) {
+    printf("Cannot write %s\n", outFile.c_str());
+    return 1;
+  }
+
+  size_t total = 0;
+  for (const SCooked& c : cooked) total += c.vData.size();
+
+  printf("%zu entries, %zu cooked, %zu reused, %zu KB\n", cooked.size(),
+         cooked.size() - reused, reused, total / 1024);
+  return 0;
+}
@@ -0,0 +1,171 @@
+/// \file AtlasPacker.cpp
+/// \brief Code for the skyline rectangle packer CSkylinePacker.
+
+#include "AtlasPacker.h"
+
+#include <algorithm>
+
+/// Round up to a power of two.
+/// \param n A positive number
+/// \return Smallest power of two not less than n
+
+static int NextPowerOfTwo(int n) {
+  int p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+/// Empty the bin. The skyline starts as one segment along the top.
+/// \param w Bin width
+/// \param h Bin height
+
+void CSkylinePacker::Reset(int w, int h) {
+  m_nWidth = w;
+  m_nHeight = h;
+  m_nUsedWidth = 0;
+  m_nUsedHeight = 0;
+  m_vSkyline.clear();
+  m_vSkyline.push_back({0, 0, w});
+}
+
+/// A rectangle placed with its left edge at a segment rests on the highest
+/// segment underneath it.
+/// \param index Index of the segment for the left edge
+/// \param w Rectangle width
+/// \param h Rectangle height
+/// \return Top y of the rectangle, or -1 if it goes off the bin
+
+int CSkylinePacker::Fit(size_t index, int w, int h) const {
+  const int x = m_vSkyline[index].nX;
+  if (x + w > m_nWidth) return -1;
+
+  int y = 0;
+  int remaining = w;
+
+  for (size_t i = index; remaining > 0; i++) {
+    y = std::max(y, m_vSkyline[i].nY);
+    if (y + h > m_nHeight) return -1;
+    remaining -= m_vSkyline[i].nWidth;
+  }
+
+  return y;
+}
+
+/// Place a rectangle at the segment where its bottom edge is lowest, breaking
+/// ties in favor of the narrower segment, then raise the skyline under it.
+/// \param w Width
+/// \param h Height
+/// \param x [out] Left edge
+/// \param y [out] Top edge
+/// \return True if it fit
+
+bool CSkylinePacker::Insert(int w, int h, int& x, int& y) {
+  int bestIndex = -1;
+  int bestBottom = m_nHeight + 1;
+  int bestWidth = m_nWidth + 1;
+
+  for (size_t i = 0; i < m_vSkyline.size(); i++) {
+    const int top = Fit(i, w, h);
+    if (top < 0) continue;
+
+    const int bottom = top + h;
+    if (bottom < bestBottom ||
+        (bottom == bestBottom && m_vSkyline[i].nWidth < bestWidth)) {
+      bestIndex = (int)i;
+      bestBottom = bottom;
+      bestWidth = m_vSkyline[i].nWidth;
+    }
+  }
+
+  if (bestIndex < 0) return false;
+
+  x = m_vSkyline[bestIndex].nX;
+  y = bestBottom - h;
+
+  // new segment on top of the rectangle
+  m_vSkyline.insert(m_vSkyline.begin() + bestIndex, {x, bestBottom, w});
+
+  // trim or remove the segments it now covers
+  for (size_t i = bestIndex + 1; i < m_vSkyline.size();) {
+    SNode& node = m_vSkyline[i];
+    const int overlap = x + w - node.nX;
+    if (overlap <= 0) break;
+
+    if (overlap >= node.nWidth) {
+      m_vSkyline.erase(m_vSkyline.begin() + i);
+    } else {
+      node.nX += overlap;
+      node.nWidth -= overlap;
+      break;
+    }
+  }
+
+  // merge neighbors at the same height
+  for (size_t i = 0; i + 1 < m_vSkyline.size();) {
+    if (m_vSkyline[i].nY == m_vSkyline[i + 1].nY) {
+      m_vSkyline[i].nWidth += m_vSkyline[i + 1].nWidth;
+      m_vSkyline.erase(m_vSkyline.begin() + i + 1);
+    } else {
+      i++;
+    }
+  }
+
+  m_nUsedWidth = std::max(m_nUsedWidth, x + w);
+  m_nUsedHeight = std::max(m_nUsedHeight, bestBottom);
+  return true;
+}
+
+/// Pack tallest first. Fill a maximum size page with everything that fits,
+/// shrink it to the smallest power of two that holds what went in, and start
+/// another page for whatever is left.
+/// \param rects Rectangles, page and position are filled in
+/// \param padding Empty pixels around each image
+/// \param maxPage Maximum page width and height
+/// \param pages [out] Page sizes
+/// \return False if some rectangle is bigger than a page
+
+bool PackAtlas(std::vector<SPackRect>& rects, int padding, int maxPage,
+               std::vector<SPackPage>& pages) {
+  pages.clear();
+
+  std::vector<SPackRect*> todo;
+  for (SPackRect& r : rects) {
+    r.nPage = -1;
+    if (r.nWidth + 2 * padding > maxPage || r.nHeight + 2 * padding > maxPage)
+      return false;
+    todo.push_back(&r);
+  }
+
+  std::stable_sort(todo.begin(), todo.end(),
+                   [](const SPackRect* a, const SPackRect* b) {
+                     if (a->nHeight != b->nHeight)
+                       return a->nHeight > b->nHeight;
+                     return a->nWidth > b->nWidth;
+                   });
+
+  CSkylinePacker packer;
+
+  while (!todo.empty()) {
+    packer.Reset(maxPage, maxPage);
+    const int page = (int)pages.size();
+    std::vector<SPackRect*> next;
+
+    for (SPackRect* r : todo) {
+      int x = 0, y = 0;
+      if (packer.Insert(r->nWidth + 2 * padding, r->nHeight + 2 * padding, x,
+                        y)) {
+        r->nPage = page;
+        r->nX = x + padding;
+        r->nY = y + padding;
+      } else {
+        next.push_back(r);
+      }
+    }
+
+    pages.push_back({NextPowerOfTwo(packer.GetUsedWidth()),
+                     NextPowerOfTwo(packer.GetUsedHeight())});
+    todo.swap(next);
+  }
+
+  return true;
+}
@@ -0,0 +1,79 @@
+/// \file AtlasPacker.h
+/// \brief Interface for the skyline rectangle packer CSkylinePacker.
+
+#ifndef __L4RC_ATLAS_ATLASPACKER_H__
+#define __L4RC_ATLAS_ATLASPACKER_H__
+
+#include <string>
+#include <vector>
+
+/// \brief A rectangle to be packed.
+///
+/// The caller fills in the name and size, the packer fills in the page and
+/// position. The position is that of the image itself, inside its padding.
+struct SPackRect {
+  std::string strName;  ///< Sprite name from gamesettings.xml.
+  int nWidth = 0;       ///< Image width in pixels.
+  int nHeight = 0;      ///< Image height in pixels.
+  int nPage = -1;       ///< Atlas page, or -1 if not packed.
+  int nX = 0;           ///< Left edge of image on its page.
+  int nY = 0;           ///< Top edge of image on its page.
+};
+
+/// \brief An atlas page.
+struct SPackPage {
+  int nWidth = 0;   ///< Page width, a power of two.
+  int nHeight = 0;  ///< Page height, a power of two.
+};
+
+/// \brief The skyline packer.
+///
+/// Keeps the top edge of the packed area as a list of horizontal segments
+/// (the skyline) and places each rectangle on the segment where its top edge
+/// ends up lowest, the bottom-left rule. This wastes the space under
+/// overhangs but is fast and does well on sprites sorted tallest first.
+class CSkylinePacker {
+ private:
+  /// \brief A horizontal segment of the skyline.
+  struct SNode {
+    int nX;      ///< Left edge.
+    int nY;      ///< Height of the packed area below this segment.
+    int nWidth;  ///< Segment width.
+  };
+
+  std::vector<SNode> m_vSkyline;  ///< Segments, left to right.
+  int m_nWidth = 0;               ///< Bin width.
+  int m_nHeight = 0;              ///< Bin height.
+  int m_nUsedWidth = 0;           ///< Right edge of the packed area.
+  int m_nUsedHeight = 0;          ///< Bottom edge of the packed area.
+
+  /// \brief Find where a rectangle would sit if placed at a segment.
+  /// \return Top y of the rectangle, or -1 if it does not fit there
+  int Fit(size_t index, int w, int h) const;
+
+ public:
+  /// \brief Empty the bin and set its size.
+  void Reset(int w, int h);
+
+  /// \brief Place a rectangle.
+  /// \param w Width
+  /// \param h Height
+  /// \param x [out] Left edge
+  /// \param y [out] Top edge
+  /// \return True if it fit
+  bool Insert(int w, int h, int& x, int& y);
+
+  int GetUsedWidth() const { return m_nUsedWidth; }    ///< Packed width.
+  int GetUsedHeight() const { return m_nUsedHeight; }  ///< Packed height.
+};
+
+/// \brief Pack rectangles onto as few power-of-two pages as possible.
+/// \param rects Rectangles, page and position are filled in
+/// \param padding Empty pixels to leave around each image
+/// \param maxPage Maximum page width and height
+/// \param pages [out] Page sizes
+/// \return False if some rectangle is bigger than a page
+bool PackAtlas(std::vector<SPackRect>& rects, int padding, int maxPage,
+               std::vector<SPackPage>& pages);
+
+#endif  //__L4RC_ATLAS_ATLASPACKER_H__
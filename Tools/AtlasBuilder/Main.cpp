@@ -0,0 +1,274 @@
+/// \file Main.cpp
+/// \brief Offline texture atlas builder.
+///
+/// Reads the sprite list from `gamesettings.xml`, packs the images onto
+/// power-of-two atlas pages with CSkylinePacker, writes the pages as PNG files
+/// and writes a manifest giving each sprite's page, pixel rectangle and UVs.
+/// Images bigger than the size limit, such as full-screen backgrounds, stay
+/// as standalone textures. Run it from the solution directory:
+///
+///     AtlasBuilder [-padding n] [-page n] [-limit n]
+///
+/// Padding pixels are filled by extending each image's edge pixels outward,
+/// so that bilinear filtering at a sprite's border never picks up its
+/// neighbor.
+///
+/// The game does not read the manifest. TableGen bakes its regions into the
+/// sprite table at the game's next build.
+
+#define NOMINMAX
+#include <windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "AtlasPacker.h"
+#include "tinyxml2.h"
+
+using Microsoft::WRL::ComPtr;
+
+static const char* g_szSettings = "Media\\XML\\gamesettings.xml";  ///< Input.
+static const char* g_szManifest = "Media\\XML\\atlas.xml";  ///< Output manifest.
+static const char* g_szPagePrefix = "atlas_";  ///< Page file name prefix.
+
+/// \brief A decoded image, 32-bit BGRA.
+struct SImage {
+  UINT nWidth = 0;                 ///< Width in pixels.
+  UINT nHeight = 0;                ///< Height in pixels.
+  std::vector<uint32_t> vPixels;   ///< Pixels, row major.
+};
+
+/// Convert a narrow string to a wide one for WIC.
+/// \param s Narrow string
+/// \return Wide string
+
+static std::wstring Widen(const std::string& s) {
+  return std::wstring(s.begin(), s.end());
+}
+
+/// Decode an image file to BGRA.
+/// \param pFactory WIC factory
+/// \param fileName File name
+/// \param image [out] Decoded image
+/// \return True if it worked
+
+static bool LoadImageFile(IWICImagingFactory* pFactory,
+                          const std::string& fileName, SImage& image) {
+  ComPtr<IWICBitmapDecoder> decoder;
+  ComPtr<IWICBitmapFrameDecode> frame;
+  ComPtr<IWICFormatConverter> converter;
+
+  if (FAILED(pFactory->CreateDecoderFromFilename(
+          Widen(fileName).c_str(), nullptr, GENERIC_READ,
+          WICDecodeMetadataCacheOnDemand, &decoder)))
+    return false;
+  if (FAILED(decoder->GetFrame(0, &frame))) return false;
+  if (FAILED(pFactory->CreateFormatConverter(&converter))) return false;
+  if (FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppBGRA,
+                                   WICBitmapDitherTypeNone, nullptr, 0.0,
+                                   WICBitmapPaletteTypeCustom)))
+    return false;
+
+  converter->GetSize(&image.nWidth, &image.nHeight);
+  image.vPixels.resize((size_t)image.nWidth * image.nHeight);
+
+  return SUCCEEDED(converter->CopyPixels(
+      nullptr, image.nWidth * 4, (UINT)image.vPixels.size() * 4,
+      (BYTE*)image.vPixels.data()));
+}
+
+/// Encode a BGRA image as PNG.
+/// \param pFactory WIC factory
+/// \param fileName File name
+/// \param image The image
+/// \return True if it worked
+
+static bool SavePng(IWICImagingFactory* pFactory, const std::string& fileName,
+                    const SImage& image) {
+  ComPtr<IWICStream> stream;
+  ComPtr<IWICBitmapEncoder> encoder;
+  ComPtr<IWICBitmapFrameEncode> frame;
+
+  if (FAILED(pFactory->CreateStream(&stream))) return false;
+  if (FAILED(stream->InitializeFromFilename(Widen(fileName).c_str(),
+                                            GENERIC_WRITE)))
+    return false;
+  if (FAILED(pFactory->CreateEncoder(GUID_ContainerFormatPng, nullptr,
+                                     &encoder)))
+    return false;
+  if (FAILED(encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache)))
+    return false;
+  if (FAILED(encoder->CreateNewFrame(&frame, nullptr))) return false;
+  if (FAILED(frame->Initialize(nullptr))) return false;
+
+  WICPixelFormatGUID format = GUID_WICPixelFormat32bppBGRA;
+  frame->SetSize(image.nWidth, image.nHeight);
+  frame->SetPixelFormat(&format);
+
+  if (FAILED(frame->WritePixels(image.nHeight, image.nWidth * 4,
+                                (UINT)image.vPixels.size() * 4,
+                                (BYTE*)image.vPixels.data())))
+    return false;
+
+  return SUCCEEDED(frame->Commit()) && SUCCEEDED(encoder->Commit());
+}
+
+/// Copy an image onto a page and extend its edge pixels into the padding.
+/// \param page Atlas page
+/// \param image Sprite image
+/// \param x0 Left edge of image on page
+/// \param y0 Top edge of image on page
+/// \param padding Padding width
+
+static void Blit(SImage& page, const SImage& image, int x0, int y0,
+                 int padding) {
+  for (int y = -padding; y < (int)image.nHeight + padding; y++)
+    for (int x = -padding; x < (int)image.nWidth + padding; x++) {
+      const int sx = std::min(std::max(x, 0), (int)image.nWidth - 1);
+      const int sy = std::min(std::max(y, 0), (int)image.nHeight - 1);
+      page.vPixels[(size_t)(y0 + y) * page.nWidth + x0 + x] =
+          image.vPixels[(size_t)sy * image.nWidth + sx];
+    }
+}
+
+/// Read arguments, load the sprites, pack, and write the pages and manifest.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 on success
+
+int main(int argc, char* argv[]) {
+  int padding = 2;
+  int maxPage = 2048;
+  int limit = 512;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-padding")) padding = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-page")) maxPage = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-limit")) limit = atoi(argv[i + 1]);
+  }
+
+  tinyxml2::XMLDocument doc;
+  if (doc.LoadFile(g_szSettings) != tinyxml2::XML_SUCCESS) {
+    printf("Cannot read %s\n", g_szSettings);
+    return 1;
+  }
+
+  tinyxml2::XMLElement* pSprites =
+      doc.FirstChildElement("settings")->FirstChildElement("sprites");
+  const std::string path = pSprites->Attribute("path");
+
+  CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+  ComPtr<IWICImagingFactory> factory;
+  CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+                   IID_PPV_ARGS(&factory));
+
+  std::vector<SPackRect> rects;
+  std::vector<SImage> images;
+  size_t standalone = 0;
+
+  for (tinyxml2::XMLElement* p = pSprites->FirstChildElement("sprite"); p;
+       p = p->NextSiblingElement("sprite")) {
+    const char* name = p->Attribute("name");
+    const char* file = p->Attribute("file");
+    if (!name || !file) continue;
+
+    SImage image;
+    if (!LoadImageFile(factory.Get(), path + "\\" + file, image)) {
+      printf("Cannot load %s\\%s\n", path.c_str(), file);
+      continue;
+    }
+
+    if ((int)image.nWidth > limit || (int)image.nHeight > limit) {
+      printf("%-24s %4ux%-4u standalone\n", name, image.nWidth, image.nHeight);
+      standalone++;
+      continue;
+    }
+
+    SPackRect r;
+    r.strName = name;
+    r.nWidth = (int)image.nWidth;
+    r.nHeight = (int)image.nHeight;
+    rects.push_back(r);
+    images.push_back(std::move(image));
+  }
+
+  std::vector<SPackPage> pages;
+  if (!PackAtlas(rects, padding, maxPage, pages)) {
+    printf("A sprite is bigger than the %d pixel page size\n", maxPage);
+    return 1;
+  }
+
+  std::vector<SImage> pageImages(pages.size());
+  for (size_t i = 0; i < pages.size(); i++) {
+    pageImages[i].nWidth = pages[i].nWidth;
+    pageImages[i].nHeight = pages[i].nHeight;
+    pageImages[i].vPixels.assign((size_t)pages[i].nWidth * pages[i].nHeight, 0);
+  }
+
+  double spriteArea = 0.0;
+  for (size_t i = 0; i < rects.size(); i++) {
+    Blit(pageImages[rects[i].nPage], images[i], rects[i].nX, rects[i].nY,
+         padding);
+    spriteArea += (double)rects[i].nWidth * rects[i].nHeight;
+  }
+
+  double pageArea = 0.0;
+  for (size_t i = 0; i < pages.size(); i++) {
+    const std::string file = path + "\\" + g_szPagePrefix +
+                             std::to_string(i) + ".png";
+    SavePng(factory.Get(), file, pageImages[i]);
+    pageArea += (double)pages[i].nWidth * pages[i].nHeight;
+  }
+
+  const double efficiency = pageArea > 0.0 ? spriteArea / pageArea : 0.0;
+
+  FILE* output = nullptr;
+  if (fopen_s(&output, g_szManifest, "wt") || !output) {
+    printf("Cannot write %s\n", g_szManifest);
+    return 1;
+  }
+
+  fprintf(output, "<?xml version=\"1.0\"?>\n");
+  fprintf(output, "<!-- Generated by AtlasBuilder, do not edit -->\n\n");
+  fprintf(output, "<atlas padding=\"%d\" efficiency=\"%.3f\">\n", padding,
+          efficiency);
+
+  for (size_t i = 0; i < pages.size(); i++)
+    fprintf(output,
+            "  <page index=\"%zu\" name=\"%s%zu\" file=\"%s%zu.png\" "
+            "width=\"%d\" height=\"%d\"/>\n",
+            i, g_szPagePrefix, i, g_szPagePrefix, i, pages[i].nWidth,
+            pages[i].nHeight);
+
+  for (const SPackRect& r : rects) {
+    const SPackPage& page = pages[r.nPage];
+    fprintf(output,
+            "  <region name=\"%s\" page=\"%d\" x=\"%d\" y=\"%d\" w=\"%d\" "
+            "h=\"%d\" u0=\"%f\" v0=\"%f\" u1=\"%f\" v1=\"%f\"/>\n",
+            r.strName.c_str(), r.nPage, r.nX, r.nY, r.nWidth, r.nHeight,
+            (float)r.nX / page.nWidth, (float)r.nY / page.nHeight,
+            (float)(r.nX + r.nWidth) / page.nWidth,
+            (float)(r.nY + r.nHeight) / page.nHeight);
+  }
+
+  fprintf(output, "</atlas>\n");
+  fclose(output);
+
+  // Sprites on the same page can share a batch, so the most texture switches
+  // a frame can need drops from one per sprite to one per page.
+  printf("\n%zu sprites on %zu pages, %zu standalone\n", rects.size(),
+         pages.size(), standalone);
+  printf("Packing efficiency %.1f%%\n", efficiency * 100.0);
+  printf("Textures %zu -> %zu, up to %zu batch breaks saved per frame\n",
+         rects.size() + standalone, pages.size() + standalone,
+         rects.size() - pages.size());
+
+  CoUninitialize();
+  return 0;
+}
@@ -0,0 +1,186 @@
+/// \file AnimBench.cpp
+/// \brief Animation benchmark.
+///
+/// A large number of entities, 100k by default, play random clips from a
+/// generated set, with a few of them switching clip every frame. They are
+/// advanced two ways: with CAnimator, whose state is one array per field
+/// updated in one pass by SimdAnimate(), on every SIMD path the machine has,
+/// and with an object per entity that keeps its own timer and clip pointer
+/// and branches on the loop flag, which is how it is usually first written.
+/// The CAnimator paths must agree bit for bit on every frame of every
+/// entity. The objects time their clips in seconds rather than frames, so
+/// their checksum is printed but not expected to match.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Animation.h"
+#include "Benchmarks.h"
+#include "SimdKernels.h"
+
+static const float g_fDt = 1.0f / 60.0f; ///< Frame time.
+
+/// \brief An entity animated the usual way, for comparison.
+struct SNaiveAnim {
+  const SAnimClip* pClip = nullptr; ///< Clip playing.
+  float fTime = 0.0f;               ///< Seconds into the clip.
+  int nFrame = 0;                   ///< Current frame in the table.
+
+  /// Advance the timer and find the frame.
+  void Update(float dt) {
+    fTime += dt;
+    int k = (int)(fTime * pClip->fRate);
+    if (pClip->bLoop) k %= (int)pClip->nCount;
+    else if (k >= (int)pClip->nCount) k = (int)pClip->nCount - 1;
+    nFrame = (int)pClip->nFirst + k;
+  }
+};
+
+/// Make random clips.
+/// \param clips [out] Clips
+/// \param n Number of clips
+
+static void MakeClips(CAnimClips& clips, int n) {
+  std::mt19937 rng(1);
+  clips.Clear();
+
+  for (int i = 0; i < n; ++i) {
+    const int count = 1 + (int)(rng() % 16);
+    const std::string frames = "0-" + std::to_string(count - 1);
+    const float rate = 4.0f + (float)(rng() % 21);
+    clips.Add(("clip" + std::to_string(i)).c_str(), rng() % 8, frames.c_str(),
+              rate, rng() % 4 != 0);
+  }
+}
+
+/// Run CAnimator on the current path.
+/// \param clips Clips
+/// \param entities Number of entities
+/// \param frames Frames to run
+/// \param switches Entities switching clip per frame
+/// \param sum [out] Sum of every frame of every entity, over all frames
+/// \param last [out] Frames after the last update
+/// \return Time per frame in ms
+
+static double RunSoA(const CAnimClips& clips, int entities, int frames,
+                     int switches, uint64_t& sum, std::vector<int32_t>& last) {
+  std::mt19937 rng(2);
+  const uint32_t n = (uint32_t)clips.GetClipCount();
+
+  CAnimator anim;
+  anim.SetClips(&clips);
+  anim.Resize(entities, 0);
+  for (int i = 0; i < entities; ++i) anim.Play(i, rng() % n);
+
+  sum = 0;
+  double t = 0.0;
+
+  for (int f = 0; f < frames; ++f) {
+    CStopwatch sw;
+    for (int k = 0; k < switches; ++k) anim.Play(rng() % entities, rng() % n);
+    anim.Update(g_fDt);
+    t += sw.GetTime();
+
+    const int32_t* p = anim.GetFrames();
+    for (int i = 0; i < entities; ++i) sum += (uint32_t)p[i];
+  }
+
+  last.assign(anim.GetFrames(), anim.GetFrames() + entities);
+  return t / frames;
+}
+
+/// Run an object per entity and print its row.
+/// \param clips Clips
+/// \param entities Number of entities
+/// \param frames Frames to run
+/// \param switches Entities switching clip per frame
+
+static void RunNaive(const CAnimClips& clips, int entities, int frames,
+                     int switches) {
+  std::mt19937 rng(2);
+  const uint32_t n = (uint32_t)clips.GetClipCount();
+
+  std::vector<SNaiveAnim*> anim(entities);  // one allocation each
+  for (SNaiveAnim*& a : anim) {
+    a = new SNaiveAnim;
+    a->pClip = &clips.GetClip(rng() % n);
+  }
+
+  double t = 0.0;
+  uint64_t sum = 0;
+
+  for (int f = 0; f < frames; ++f) {
+    CStopwatch sw;
+    for (int k = 0; k < switches; ++k) {
+      SNaiveAnim* a = anim[rng() % entities];
+      const SAnimClip* c = &clips.GetClip(rng() % n);
+      if (a->pClip != c) *a = {c, 0.0f, (int)c->nFirst};
+    }
+    for (SNaiveAnim* a : anim) a->Update(g_fDt);
+    t += sw.GetTime();
+
+    for (const SNaiveAnim* a : anim) sum += (uint32_t)a->nFrame;
+  }
+
+  for (SNaiveAnim* a : anim) delete a;
+  printf("object   %8.3f  %8.2f  %016llx\n", t / frames,
+         1e6 * t / frames / entities, (unsigned long long)sum);
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if every path gives the same frames, else 1
+
+int AnimBench(int argc, char* argv[]) {
+  int entities = 100000, frames = 600, clips = 32, switches = 1000;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-entities")) entities = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-clips")) clips = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-switch")) switches = atoi(argv[i + 1]);
+  }
+
+  entities = std::max(entities, 1);
+  frames = std::max(frames, 1);
+
+  CAnimClips table;
+  MakeClips(table, std::max(clips, 1));
+  printf("%d entities, %zu clips in %zu frames, %d switches per frame, "
+         "%d frames\n", entities, table.GetClipCount(), table.GetFrameCount(),
+         switches, frames);
+  printf("update   ms/frame  ns/entity  checksum\n");
+
+  const eSimdPath best = GetBestSimdPath();
+  uint64_t first = 0;
+  std::vector<int32_t> firstLast;
+  bool ok = true;
+
+  for (int p = 0; p <= (int)best; ++p) {
+    SetSimdPath((eSimdPath)p);
+    uint64_t sum;
+    std::vector<int32_t> last;
+    const double t = RunSoA(table, entities, frames, switches, sum, last);
+
+    if (p == 0) {
+      first = sum;
+      firstLast = last;
+    }
+    const bool same = sum == first && last == firstLast;
+    ok = ok && same;
+
+    printf("%-7s  %8.3f  %8.2f  %016llx%s\n", GetSimdPathName((eSimdPath)p), t,
+           1e6 * t / entities, (unsigned long long)sum,
+           same ? "" : "  DIFFERS");
+  }
+
+  SetSimdPath(best);
+  RunNaive(table, entities, frames, switches);
+  return ok ? 0 : 1;
+}  // AnimBench
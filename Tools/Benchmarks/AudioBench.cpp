@@ -0,0 +1,217 @@
+/// \file AudioBench.cpp
+/// \brief Audio mixer benchmark.
+///
+/// The mixer is run headless, into a null device, for a number of 60 Hz
+/// frames. Every frame a burst of sounds is asked for: half of them bullet
+/// hits around a few walls, which the mixer should merge, and the rest at
+/// random points in a world larger than a sound's radius, around a listener
+/// that moves through it. A looping piece of music is streamed from a wav
+/// file written for the purpose. The same frames are mixed with a few real
+/// voices and with every voice real, to show what virtual voices save. The
+/// run fails if the device was not given exactly a frame's worth of samples
+/// every frame, if the stream was never read, or if the mix reached full
+/// scale, where the device would clip it.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "AudioMixer.h"
+#include "Benchmarks.h"
+
+static const char* g_szFile = "audiobench.wav"; ///< Scratch stream file.
+static const float g_fDt = 1.0f / 60.0f;         ///< Frame time.
+static const float g_fArea = 8192.0f;            ///< Width of the world.
+static const uint32_t g_nRate = 44100;           ///< Device frame rate.
+
+/// Make a tone that dies away, as a stand-in for a sound effect.
+/// \param rate Frames per second
+/// \param channels 1 or 2
+/// \param seconds Length
+/// \param freq Frequency in Hz
+/// \return Clip
+
+static SAudioClip MakeClip(uint32_t rate, uint32_t channels, float seconds,
+                           float freq) {
+  SAudioClip clip;
+  clip.nRate = rate;
+  clip.nChannels = channels;
+  clip.nFrames = (uint32_t)(seconds * rate);
+  clip.vSamples.resize((size_t)clip.nFrames * channels);
+
+  for (uint32_t i = 0; i < clip.nFrames; ++i) {
+    const float t = (float)i / rate;
+    const float s = std::sin(6.2831853f * freq * t) *
+                    std::exp(-3.0f * t / seconds) * 16000.0f;
+    for (uint32_t c = 0; c < channels; ++c)
+      clip.vSamples[(size_t)i * channels + c] = (int16_t)s;
+  }
+
+  return clip;
+}  // MakeClip
+
+/// Write a clip to a 16 bit PCM wav file.
+/// \param file File name
+/// \param clip Samples
+/// \return False if it could not be written
+
+static bool WriteWav(const char* file, const SAudioClip& clip) {
+  FILE* pFile = fopen(file, "wb");
+  if (pFile == nullptr) return false;
+
+  const uint32_t bytes = (uint32_t)(clip.vSamples.size() * 2);
+  unsigned char h[44];
+  auto put = [&](size_t at, uint32_t v, size_t n) {
+    for (size_t i = 0; i < n; ++i) h[at + i] = (unsigned char)(v >> (8 * i));
+  };
+
+  memcpy(h, "RIFF", 4);
+  put(4, 36 + bytes, 4);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  put(16, 16, 4);
+  put(20, 1, 2);  // PCM
+  put(22, clip.nChannels, 2);
+  put(24, clip.nRate, 4);
+  put(28, clip.nRate * clip.nChannels * 2, 4);
+  put(32, clip.nChannels * 2, 2);
+  put(34, 16, 2);
+  memcpy(h + 36, "data", 4);
+  put(40, bytes, 4);
+
+  const bool ok = fwrite(h, 1, sizeof(h), pFile) == sizeof(h) &&
+                  fwrite(clip.vSamples.data(), 2, clip.vSamples.size(),
+                         pFile) == clip.vSamples.size();
+  fclose(pFile);
+  return ok;
+}  // WriteWav
+
+/// Mix the frames with a number of real voices and print its row.
+/// \param voices Real voices
+/// \param frames Frames to run
+/// \param requests Sounds asked for per frame
+/// \return True if the device got every frame, the stream was read and the
+/// mix stayed under full scale
+
+static bool Run(size_t voices, int frames, int requests) {
+  CNullAudioDevice device(g_nRate);
+  CAudioMixer mixer;
+  mixer.SetDevice(&device);
+  mixer.SetVoices(voices);
+
+  SSoundDef def;
+  def.strName = "clang";
+  def.nInstances = 64;
+  const int clang = mixer.Add(def, MakeClip(22050, 1, 0.3f, 880.0f));
+
+  def.strName = "grunt";
+  def.fPriority = 2.0f;
+  def.nInstances = 16;
+  const int grunt = mixer.Add(def, MakeClip(44100, 1, 0.6f, 220.0f));
+
+  def.strName = "engine";
+  def.fPriority = 0.5f;
+  def.fRadius = 2048.0f;
+  def.nInstances = 32;
+  def.bLoop = true;
+  const int engine = mixer.Add(def, MakeClip(44100, 2, 1.0f, 110.0f));
+
+  def.strName = "music";
+  def.strFile = g_szFile;
+  def.fPriority = 10.0f;
+  def.fVolume = 0.5f;
+  def.fRadius = 1e6f;
+  def.nInstances = 1;
+  def.bStream = true;
+  const int music = mixer.Add(def);
+  if (clang < 0 || grunt < 0 || engine < 0 || music < 0) return false;
+
+  const int sounds[] = {clang, grunt, engine};
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> pos(0.0f, g_fArea);
+  std::uniform_real_distribution<float> jitter(-24.0f, 24.0f);
+  std::uniform_real_distribution<float> volume(0.5f, 1.0f);
+
+  double total = 0.0, worst = 0.0;
+  size_t real = 0, all = 0;
+
+  for (int f = 0; f < frames; ++f) {
+    const float lx = g_fArea / 2 + std::sin(f * 0.01f) * g_fArea / 4;
+    const float ly = g_fArea / 2 + std::cos(f * 0.013f) * g_fArea / 4;
+    if (f == 0) mixer.Play((uint32_t)music, lx, ly);
+
+    for (int r = 0; r < requests; ++r) {
+      if (r % 2 == 0) {  // hits on one of eight walls near the listener
+        const float wx = lx + 256.0f * (r / 2 % 8) - 1024.0f;
+        mixer.Play((uint32_t)clang, wx + jitter(rng), ly + jitter(rng),
+                   volume(rng));
+      } else {
+        const float x = pos(rng), y = pos(rng);
+        mixer.Play((uint32_t)sounds[rng() % 3], x, y, volume(rng));
+      }
+    }
+
+    mixer.Update(lx, ly, g_fDt);
+    total += mixer.GetMixTime();
+    worst = std::max(worst, (double)mixer.GetMixTime());
+    real += mixer.GetRealCount();
+    all += mixer.GetVoiceCount();
+  }  // for
+
+  const double ms = total / frames;
+  printf("%6zu  %8.3f  %6.3f  %8.1f  %5.1f  %7.1f  %7llu  %7llu  %9llu  "
+         "%6llu  %5.2f\n",
+         voices, ms, worst, 1000.0 * g_fDt / ms, (double)real / frames,
+         (double)(all - real) / frames,
+         (unsigned long long)mixer.GetSteals(),
+         (unsigned long long)mixer.GetDropped(),
+         (unsigned long long)mixer.GetCoalesced(),
+         (unsigned long long)mixer.GetChunks(), device.GetPeak());
+
+  double expected = 0.0;  // frames the mixer should have submitted
+  for (int f = 0; f < frames; ++f) expected += (double)g_fDt * g_nRate;
+  const double got = (double)device.GetFrames();
+  return std::fabs(got - expected) <= 1.0 && mixer.GetChunks() > 0 &&
+         std::isfinite(device.GetPeak()) && device.GetPeak() < 1.0f;
+}  // Run
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if every run kept up with the device, else 1
+
+int AudioBench(int argc, char* argv[]) {
+  int frames = 600, requests = 200, voices = 32, seconds = 30;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-requests")) requests = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-voices")) voices = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-music")) seconds = atoi(argv[i + 1]);
+  }
+
+  frames = std::max(frames, 1);
+  requests = std::max(requests, 0);
+  voices = std::max(voices, 1);
+  seconds = std::max(seconds, 1);
+
+  if (!WriteWav(g_szFile, MakeClip(g_nRate, 2, (float)seconds, 55.0f))) {
+    printf("cannot write %s\n", g_szFile);
+    return 1;
+  }
+
+  printf("%d frames, %d requests per frame, %d s of streamed music\n",
+         frames, requests, seconds);
+  printf("voices  ms/frame  max ms  realtime  real  virtual   stolen  "
+         "dropped  coalesced  chunks   peak\n");
+
+  bool ok = Run((size_t)voices, frames, requests);
+  ok = Run(1u << 16, frames, requests) && ok;  // every voice real
+
+  remove(g_szFile);
+  printf(ok ? "ok\n" : "FAILED: frames submitted, stream reads or clipping\n");
+  return ok ? 0 : 1;
+}  // AudioBench
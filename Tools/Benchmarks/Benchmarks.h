@@ -0,0 +1,58 @@
+/// \file Benchmarks.h
+/// \brief Interface shared by the benchmarks.
+
+#ifndef __L4RC_BENCHMARKS_BENCHMARKS_H__
+#define __L4RC_BENCHMARKS_BENCHMARKS_H__
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/// \brief Wall clock stopwatch.
+class CStopwatch {
+ private:
+  std::chrono::high_resolution_clock::time_point m_tStart; ///< Start time.
+
+ public:
+  CStopwatch() { Restart(); } ///< Start timing.
+
+  /// \brief Start timing again.
+  void Restart() { m_tStart = std::chrono::high_resolution_clock::now(); }
+
+  /// \brief Get the time since the last restart.
+  /// \return Elapsed time in ms
+  double GetTime() const {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::high_resolution_clock::now() - m_tStart)
+        .count();
+  }
+};
+
+/// \brief Generate a platformer tile map in bands 32 tiles high, each with
+/// random-walk ground, the odd high wall and pit, and stairs of floating
+/// platforms above it.
+/// \param w Width in tiles
+/// \param h Height in tiles
+/// \param seed Random seed
+/// \return One character per tile, row major, '1' is solid
+std::string GenerateMap(int w, int h, uint32_t seed);
+
+int PathBench(int argc, char* argv[]); ///< Path finding benchmark.
+int CrowdBench(int argc, char* argv[]); ///< Crowd benchmark.
+int ControllerBench(int argc, char* argv[]); ///< Controller benchmark.
+int SimdBench(int argc, char* argv[]); ///< Batch kernel benchmark.
+int SaveBench(int argc, char* argv[]); ///< Save game benchmark.
+int DeterminismBench(int argc, char* argv[]); ///< Determinism check.
+int RollbackBench(int argc, char* argv[]); ///< Rollback benchmark.
+int NetBench(int argc, char* argv[]); ///< Dedicated server benchmark.
+int PlayersBench(int argc, char* argv[]); ///< Many players benchmark.
+int ParallaxBench(int argc, char* argv[]); ///< Parallax span check.
+int AnimBench(int argc, char* argv[]); ///< Animation benchmark.
+int ParticleBench(int argc, char* argv[]); ///< Particle benchmark.
+int AudioBench(int argc, char* argv[]); ///< Audio mixer benchmark.
+int CameraBench(int argc, char* argv[]); ///< Camera and culling check.
+int CollisionBench(int argc, char* argv[]); ///< Collision layer benchmark.
+int SpriteBench(int argc, char* argv[]); ///< Sprite queue check.
+int FrameBench(int argc, char* argv[]); ///< Frame graph scaling.
+
+#endif  //__L4RC_BENCHMARKS_BENCHMARKS_H__
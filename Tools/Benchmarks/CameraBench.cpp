@@ -0,0 +1,249 @@
+/// \file CameraBench.cpp
+/// \brief Camera check and culling benchmark.
+///
+/// Checks, over many random cameras, that the camera's view is what the
+/// renderer shows, that the draw paths culling against the cull rectangle
+/// agree on what is in view, and that following behaves: the target never
+/// leaves the dead zone without smoothing, smoothing settles the same at
+/// any frame rate, and a teleport is jumped to. The renderer draws the view
+/// centered on the camera position it is given, one pixel per unit, so a
+/// world point `p` is at `p - camera + size / 2` on screen. Then a world
+/// full of sprites is culled to time the cull and show how many are left
+/// to draw.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Camera.h"
+#include "Parallax.h"
+
+/// \brief A tally of checks.
+struct SChecks {
+  int nRun = 0;     ///< Checks made.
+  int nFailed = 0;  ///< Checks that failed.
+
+  /// \brief Count a check.
+  /// \param ok Whether it passed
+  void Check(bool ok) {
+    ++nRun;
+    if (!ok) ++nFailed;
+  }
+};
+
+/// Check the view against where the renderer puts points on screen. The
+/// view's corners must land on the screen's corners, and a point inside the
+/// view must land on screen, except within a rounding error of an edge.
+/// \param cameras Random cameras to try
+/// \param rng Random numbers
+/// \return Tally
+
+static SChecks CheckView(int cameras, std::mt19937& rng) {
+  static const float sizes[][2] = {{800, 600}, {1024, 768}, {1920, 1080}};
+  std::uniform_real_distribution<float> world(-1e5f, 1e5f);
+  SChecks c;
+
+  for (int i = 0; i < cameras; ++i) {
+    const float w = sizes[i % 3][0], h = sizes[i % 3][1];
+    CCamera camera;
+    camera.SetViewSize(w, h);
+    camera.Snap(world(rng), world(rng));
+    const float cx = camera.GetX(), cy = camera.GetY();
+    const SViewRect v = camera.GetView();
+    const float eps = 1e-6f * (std::fabs(cx) + std::fabs(cy) + w + h);
+
+    c.Check(std::fabs(v.fLeft - cx + w / 2) <= eps &&
+            std::fabs(v.fBottom - cy + h / 2) <= eps &&
+            std::fabs(v.fRight - cx - w / 2) <= eps &&
+            std::fabs(v.fTop - cy - h / 2) <= eps);
+
+    std::uniform_real_distribution<float> near(-w, w);
+    for (int k = 0; k < 64; ++k) {
+      const float x = cx + near(rng), y = cy + near(rng);
+      const float sx = x - cx + w / 2, sy = y - cy + h / 2;
+      if (std::fabs(sx) < eps || std::fabs(sx - w) < eps ||
+          std::fabs(sy) < eps || std::fabs(sy - h) < eps)
+        continue;  // on an edge, either answer is right
+      const bool onScreen = sx >= 0 && sx <= w && sy >= 0 && sy <= h;
+      c.Check(v.Contains(x, y) == onScreen);
+    }
+  }
+
+  return c;
+}  // CheckView
+
+/// Check that culling is the same wherever it is done. A sprite no bigger
+/// than twice the padding that shows on screen must have its center in the
+/// cull rectangle, which is how bullets, drops and particles are culled. A
+/// tile chunk that shows must overlap it, which is how tiles are culled. A
+/// point is in it exactly when a box of no size there overlaps it. Every
+/// copy of a background layer that shows must be in the layer's span.
+/// \param cameras Random cameras to try
+/// \param rng Random numbers
+/// \return Tally
+
+static SChecks CheckCull(int cameras, std::mt19937& rng) {
+  std::uniform_real_distribution<float> world(-1e4f, 1e4f);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  SChecks c;
+
+  for (int i = 0; i < cameras; ++i) {
+    SCameraSettings s;
+    s.fPadding = 8.0f + 56.0f * unit(rng);
+
+    CCamera camera;
+    camera.SetSettings(s);
+    camera.SetViewSize(1024.0f, 768.0f);
+    camera.Snap(world(rng), world(rng));
+    const SViewRect v = camera.GetView();
+    const SViewRect r = camera.GetCullRect();
+
+    std::uniform_real_distribution<float> nx(v.fLeft - 256, v.fRight + 256);
+    std::uniform_real_distribution<float> ny(v.fBottom - 256, v.fTop + 256);
+
+    for (int k = 0; k < 64; ++k) {
+      const float x = nx(rng), y = ny(rng);
+      const float half = s.fPadding * unit(rng);  // sprite half size
+      if (v.Overlaps(x - half, y - half, x + half, y + half))
+        c.Check(r.Contains(x, y));
+
+      c.Check(r.Contains(x, y) == r.Overlaps(x, y, x, y));
+
+      const float cw = 64.0f + 512.0f * unit(rng);  // chunk size
+      if (v.Overlaps(x, y, x + cw, y + cw))
+        c.Check(r.Overlaps(x, y, x + cw, y + cw));
+    }
+
+    SParallaxLayer layer;
+    layer.fWidth = 256.0f + 1024.0f * unit(rng);
+    layer.fXScale = 0.5f + unit(rng);
+    layer.fXScroll = unit(rng);
+    layer.fXOffset = world(rng);
+
+    const SParallaxSpan span =
+        GetParallaxSpan(layer, r.GetCenterX(), r.GetWidth() / 2);
+    for (int k = span.nFirst - 4; k < span.nFirst + span.nCount + 4; ++k) {
+      const float x = span.GetX(k);
+      if (x + span.fStep / 2 > v.fLeft && x - span.fStep / 2 < v.fRight)
+        c.Check(k >= span.nFirst && k < span.nFirst + span.nCount);
+    }
+  }  // for
+
+  return c;
+}  // CheckCull
+
+/// Check following. Snapping, the target wanders and never leaves the dead
+/// zone. Smoothed, a target that stops settles as the half-life says, to
+/// the same place at 30, 60 and 144 frames per second. A target moved
+/// further than a view is jumped to.
+/// \param frames Frames of wandering
+/// \param rng Random numbers
+/// \return Tally
+
+static SChecks CheckFollow(int frames, std::mt19937& rng) {
+  std::uniform_real_distribution<float> step(-40.0f, 40.0f);
+  SChecks c;
+
+  SCameraSettings s;
+  s.fDeadWidth = 96.0f;
+  s.fDeadHeight = 64.0f;
+
+  CCamera camera;
+  camera.SetSettings(s);
+  camera.Snap(0.0f, 0.0f);
+  float x = 0.0f, y = 0.0f;
+
+  for (int f = 0; f < frames; ++f) {
+    x += step(rng);
+    y += step(rng);
+    camera.Follow(x, y, 1.0f / 60.0f);
+    c.Check(std::fabs(x + s.fOffsetX - camera.GetX()) <= 48.001f &&
+            std::fabs(y + s.fOffsetY - camera.GetY()) <= 32.001f);
+  }
+
+  s.fHalfLife = 0.1f;
+  const float jump = 300.0f;
+  const float gap = jump - s.fDeadWidth / 2;  // to the dead zone's edge
+  const float want = gap * (1.0f - std::exp2(-0.5f / s.fHalfLife));
+  const int rates[] = {30, 60, 144};
+
+  for (int rate : rates) {
+    camera.SetSettings(s);
+    camera.Snap(0.0f, 0.0f);
+    const float x0 = camera.GetX();
+    for (int f = 0; f < rate / 2; ++f)  // half a second
+      camera.Follow(jump, 0.0f, 1.0f / rate);
+    c.Check(std::fabs(camera.GetX() - x0 - want) < 0.01f);
+  }
+
+  camera.Snap(0.0f, 0.0f);
+  camera.Follow(1e5f, 0.0f, 1.0f / 60.0f);
+  c.Check(camera.GetX() == 1e5f + s.fOffsetX);
+  return c;
+}  // CheckFollow
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if every check passed, else 1
+
+int CameraBench(int argc, char* argv[]) {
+  int cameras = 10000, sprites = 1000000, frames = 100000;
+  float area = 16384.0f;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-cameras")) cameras = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-sprites")) sprites = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-area")) area = (float)atof(argv[i + 1]);
+  }
+
+  cameras = std::max(cameras, 1);
+  sprites = std::max(sprites, 1);
+  frames = std::max(frames, 1);
+  area = std::max(area, 1.0f);
+
+  std::mt19937 rng(1);
+  const SChecks view = CheckView(cameras, rng);
+  const SChecks cull = CheckCull(cameras, rng);
+  const SChecks follow = CheckFollow(frames, rng);
+
+  printf("check    run       failed\n");
+  printf("view     %8d  %6d\n", view.nRun, view.nFailed);
+  printf("cull     %8d  %6d\n", cull.nRun, cull.nFailed);
+  printf("follow   %8d  %6d\n", follow.nRun, follow.nFailed);
+
+  std::uniform_real_distribution<float> pos(0.0f, area);
+  std::vector<float> x(sprites), y(sprites);
+  for (int i = 0; i < sprites; ++i) {
+    x[i] = pos(rng);
+    y[i] = pos(rng);
+  }
+
+  SCameraSettings s;
+  CCamera camera;
+  camera.SetSettings(s);
+  camera.SetViewSize(1920.0f, 1080.0f);
+
+  const int reps = 20;
+  size_t kept = 0;
+  CStopwatch sw;
+  for (int k = 0; k < reps; ++k) {
+    camera.Snap(pos(rng), pos(rng));
+    const SViewRect r = camera.GetCullRect();
+    for (int i = 0; i < sprites; ++i) kept += r.Contains(x[i], y[i]);
+  }
+  const double t = sw.GetTime();
+
+  printf("%d sprites over %.0f px square, %.0f in a 1920x1080 view "
+         "+%.0f px, culled in %.2f ns/sprite\n",
+         sprites, area, (double)kept / reps, s.fPadding,
+         1e6 * t / reps / sprites);
+
+  return view.nFailed + cull.nFailed + follow.nFailed ? 1 : 0;
+}  // CameraBench
@@ -0,0 +1,285 @@
+/// \file CollisionBench.cpp
+/// \brief Collision layer benchmark.
+///
+/// A row of players stands on a floor of tile chunks and every player fires
+/// bullets both ways at a given rate. Bullets start inside the shooter, as
+/// in the game, fly into the players on either side and fall to the floor
+/// for two seconds. The players have the game's body and four sensors. The
+/// same frames are run twice, first with Box2D's default filters on every
+/// fixture, which is how the game made them before it had collision layers,
+/// and then with the filters from the default CCollisionMatrix. Each run
+/// prints the contacts alive per frame, the contacts begun per frame, which
+/// all go through the contact listener, and the step time. The run fails if
+/// the layers cost more contacts than the default filters, or if they stop
+/// a player's foot sensor feeling the floor or a bullet hitting it.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "CollisionLayers.h"
+#include "box2d/box2d.h"
+
+static const float g_fDt = 1.0f / 60.0f;    ///< Frame time.
+static const float g_fHalfWidth = 0.4375f;  ///< Player half width, as CPlayer.
+static const float g_fHalfHeight = 0.75f;   ///< Player half height.
+static const float g_fSpacing = 4.0f;       ///< Meters between players.
+static const float g_fBulletLife = 2.0f;    ///< Seconds a bullet lasts.
+
+/// \brief Counts what the contact listener is given.
+class CCounter : public b2ContactListener {
+ public:
+  size_t m_nBegun = 0;   ///< Contacts begun.
+  size_t m_nImpacts = 0; ///< Bullets hitting something solid.
+  std::vector<int> m_vGround; ///< Solid fixtures under each player's foot.
+
+  /// \brief Count a foot sensor touching something solid.
+  /// \param sensor Fixture that may be a foot sensor
+  /// \param other The fixture it touches
+  /// \param n 1 when the contact begins, -1 when it ends
+  void CountFoot(b2Fixture* sensor, b2Fixture* other, int n) {
+    const uintptr_t player = sensor->GetUserData().pointer;
+    if (sensor->IsSensor() && !other->IsSensor() && player > 0)
+      m_vGround[player - 1] += n;
+  }
+
+  /// \brief Count a contact beginning, as the game's listener sees it.
+  /// \param contact Contact
+  void BeginContact(b2Contact* contact) override {
+    b2Fixture* a = contact->GetFixtureA();
+    b2Fixture* b = contact->GetFixtureB();
+    m_nBegun++;
+    CountFoot(a, b, 1);
+    CountFoot(b, a, 1);
+    if (!a->IsSensor() && !b->IsSensor() &&
+        a->GetBody()->IsBullet() != b->GetBody()->IsBullet())
+      m_nImpacts++;
+  }
+
+  /// \brief Count a contact ending.
+  /// \param contact Contact
+  void EndContact(b2Contact* contact) override {
+    CountFoot(contact->GetFixtureA(), contact->GetFixtureB(), -1);
+    CountFoot(contact->GetFixtureB(), contact->GetFixtureA(), -1);
+  }
+};  // CCounter
+
+/// \brief What a run measured.
+struct SResult {
+  double fContacts = 0.0; ///< Contacts alive per frame.
+  double fBegun = 0.0;    ///< Contacts begun per frame.
+  double fImpacts = 0.0;  ///< Bullet hits per frame.
+  double fBullets = 0.0;  ///< Bullets alive per frame.
+  double fStep = 0.0;     ///< Mean step time in ms.
+  double fWorst = 0.0;    ///< Slowest step in ms.
+  size_t nGrounded = 0;   ///< Players on the floor at the end.
+};
+
+/// Get a fixture's filter, or the default if layers are off.
+/// \param pMatrix Collision matrix, or nullptr for the default filter
+/// \param layer Layer
+/// \return Filter
+
+static b2Filter GetFilter(const CCollisionMatrix* pMatrix,
+                          eCollisionLayer layer) {
+  return pMatrix ? pMatrix->GetFilter(layer) : b2Filter();
+}
+
+/// Add a player with the game's body and sensors, the foot sensor tagged
+/// with the player's number.
+/// \param world World
+/// \param x Position x in meters
+/// \param index Player number
+/// \param pMatrix Collision matrix, or nullptr for default filters
+/// \return Body
+
+static b2Body* AddPlayer(b2World& world, float x, size_t index,
+                         const CCollisionMatrix* pMatrix) {
+  b2BodyDef def;
+  def.type = b2_dynamicBody;
+  def.position.Set(x, 0.5f + g_fHalfHeight);
+  def.fixedRotation = true;
+  b2Body* pBody = world.CreateBody(&def);
+
+  b2PolygonShape box;
+  box.SetAsBox(g_fHalfWidth, g_fHalfHeight);
+  b2FixtureDef fix;
+  fix.shape = &box;
+  fix.density = 1.0f;
+  fix.friction = 0.0f;
+  fix.filter = GetFilter(pMatrix, eCollisionLayer::Player);
+  pBody->CreateFixture(&fix);
+
+  const float w = g_fHalfWidth, h = g_fHalfHeight, t = 0.02f;
+  const float sensors[4][4] = {  // half width, half height, x, y
+      {w * 0.9f, t, 0.0f, -h - t},
+      {w * 0.9f, t, 0.0f, h + t},
+      {t, h * 0.8f, -w - t, 0.0f},
+      {t, h * 0.8f, w + t, 0.0f}};
+
+  for (int i = 0; i < 4; ++i) {
+    b2PolygonShape shape;
+    shape.SetAsBox(sensors[i][0], sensors[i][1],
+                   b2Vec2(sensors[i][2], sensors[i][3]), 0.0f);
+    b2FixtureDef sensor;
+    sensor.shape = &shape;
+    sensor.isSensor = true;
+    sensor.userData.pointer = i == 0 ? index + 1 : 0;
+    sensor.filter = GetFilter(pMatrix, eCollisionLayer::PlayerSensor);
+    pBody->CreateFixture(&sensor);
+  }
+
+  return pBody;
+}  // AddPlayer
+
+/// Run the frames.
+/// \param players Number of players
+/// \param rate Shots per second per player
+/// \param frames Frames to run
+/// \param pMatrix Collision matrix, or nullptr for default filters
+/// \return What was measured
+
+static SResult Run(size_t players, float rate, int frames,
+                   const CCollisionMatrix* pMatrix) {
+  b2World world(b2Vec2(0.0f, -9.8f));
+  CCounter counter;
+  counter.m_vGround.assign(players, 0);
+  world.SetContactListener(&counter);
+
+  const float length = g_fSpacing * (players + 1);
+  b2BodyDef groundDef;
+  b2Body* pGround = world.CreateBody(&groundDef);
+  for (float x = 0.0f; x < length; x += 8.0f) {  // tile chunks
+    b2PolygonShape box;
+    box.SetAsBox(4.0f, 0.5f, b2Vec2(x + 4.0f, 0.0f), 0.0f);
+    b2FixtureDef fd;
+    fd.shape = &box;
+    fd.friction = 2.5f;
+    fd.filter = GetFilter(pMatrix, eCollisionLayer::World);
+    pGround->CreateFixture(&fd);
+  }
+
+  std::vector<b2Body*> vPlayers;
+  for (size_t i = 0; i < players; ++i)
+    vPlayers.push_back(AddPlayer(world, g_fSpacing * (i + 1), i, pMatrix));
+
+  std::vector<b2Body*> vBullets;
+  std::vector<float> vLife;
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  const float chance = rate * g_fDt;  // shots per player per frame
+
+  b2CircleShape shape;
+  shape.m_radius = 0.1f;
+  b2FixtureDef bullet;
+  bullet.shape = &shape;
+  bullet.density = 1.0f;
+  bullet.friction = 0.0f;
+  bullet.filter = GetFilter(pMatrix, eCollisionLayer::Projectile);
+
+  SResult r;
+  for (int f = 0; f < frames; ++f) {
+    for (size_t i = 0; i < players; ++i) {
+      if (unit(rng) >= chance) continue;
+      b2BodyDef def;
+      def.type = b2_dynamicBody;
+      def.bullet = true;
+      def.position = vPlayers[i]->GetPosition();
+      def.linearVelocity.Set(unit(rng) < 0.5f ? -15.0f : 15.0f,
+                             4.0f * unit(rng));
+      vBullets.push_back(world.CreateBody(&def));
+      vBullets.back()->CreateFixture(&bullet);
+      vLife.push_back(g_fBulletLife);
+    }
+
+    CStopwatch sw;
+    world.Step(g_fDt, 8, 3);
+    const double t = sw.GetTime();
+    r.fStep += t;
+    r.fWorst = std::max(r.fWorst, t);
+    r.fContacts += world.GetContactCount();
+    r.fBullets += vBullets.size();
+
+    size_t n = 0;
+    for (size_t i = 0; i < vBullets.size(); ++i) {
+      vLife[i] -= g_fDt;
+      if (vLife[i] <= 0.0f) world.DestroyBody(vBullets[i]);
+      else {
+        vBullets[n] = vBullets[i];
+        vLife[n++] = vLife[i];
+      }
+    }
+    vBullets.resize(n);
+    vLife.resize(n);
+  }  // for
+
+  r.fContacts /= frames;
+  r.fBullets /= frames;
+  r.fStep /= frames;
+  r.fBegun = (double)counter.m_nBegun / frames;
+  r.fImpacts = (double)counter.m_nImpacts / frames;
+  for (int g : counter.m_vGround) r.nGrounded += g > 0;
+
+  world.SetContactListener(nullptr);
+  return r;
+}  // Run
+
+/// Print a run's row.
+/// \param name Row name
+/// \param r What was measured
+/// \param players Number of players
+
+static void Print(const char* name, const SResult& r, size_t players) {
+  printf("%-8s  %7.1f  %8.1f  %8.1f  %7.1f  %7.3f  %6.3f  %4zu/%zu\n", name,
+         r.fBullets, r.fContacts, r.fBegun, r.fImpacts, r.fStep, r.fWorst,
+         r.nGrounded, players);
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if the layers cut contacts and kept what the game needs, else 1
+
+int CollisionBench(int argc, char* argv[]) {
+  int players = 64, frames = 600;
+  float rate = 10.0f;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-players")) players = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-rate")) rate = (float)atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+  }
+
+  players = std::max(players, 1);
+  rate = std::max(rate, 0.0f);
+  frames = std::max(frames, 1);
+
+  printf("%d players firing %.1f shots/s each, %d frames\n", players, rate,
+         frames);
+  printf("filters   bullets  contacts     begun  impacts  step ms  max ms  "
+         "grounded\n");
+
+  const SResult before = Run((size_t)players, rate, frames, nullptr);
+  Print("default", before, (size_t)players);
+
+  const CCollisionMatrix matrix;
+  const SResult after = Run((size_t)players, rate, frames, &matrix);
+  Print("layers", after, (size_t)players);
+
+  printf("contacts x%.2f, begun x%.2f, step x%.2f\n",
+         after.fContacts / std::max(before.fContacts, 1e-9),
+         after.fBegun / std::max(before.fBegun, 1e-9),
+         after.fStep / std::max(before.fStep, 1e-9));
+
+  const bool ok = after.fContacts <= before.fContacts &&
+                  after.fBegun <= before.fBegun &&
+                  after.nGrounded == (size_t)players &&
+                  (rate == 0.0f || after.fImpacts > 0.0);
+  printf(ok ? "ok\n" : "FAILED: more contacts, a player off the floor or "
+                       "no bullet hits\n");
+  return ok ? 0 : 1;
+}  // CollisionBench
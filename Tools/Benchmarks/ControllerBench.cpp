@@ -0,0 +1,304 @@
+/// \file ControllerBench.cpp
+/// \brief Player controller benchmark.
+///
+/// Compares the player's two controllers: a Box2D dynamic body with foot,
+/// head and wall sensors, set up as in CPlayer, and CGridController. Both get the same
+/// scripted input on the same generated map, and the time per update is
+/// the Box2D world step or the grid move, plus the player logic around it.
+///
+/// The second test drops each controller onto a flat floor from a range of
+/// heights and counts the updates from the first one that starts with the
+/// fall stopped by the floor to the first one that would accept a jump.
+/// Box2D only updates contacts at the start of a step, from where the bodies
+/// were before it, so the foot sensor lags the landing. The grid controller
+/// finds its contacts where its move ends.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "Benchmarks.h"
+#include "GridController.h"
+#include "Tiles.h"
+#include "box2d/box2d.h"
+
+static const float g_fHalfWidth = 0.4375f; ///< Player half width, as CPlayer.
+static const float g_fHeight = 1.5f;       ///< Player height, as CPlayer.
+static const float g_fDt = 1.0f / 60.0f;   ///< Update time step.
+
+/// \brief Scripted input for one update.
+struct SInput {
+  float fTarget = 0.0f;  ///< Desired horizontal speed.
+  bool bJump = false;    ///< Jump if on the ground.
+};
+
+/// \brief The player as a Box2D body, built the way CPlayer builds it.
+class CBox2DPlayer : public b2ContactListener {
+ private:
+  b2World m_world{b2Vec2(0.0f, -9.8f)};  ///< World with tiles and player.
+  b2Body* m_pBody = nullptr;             ///< Player body.
+  int m_pContacts[4] = {};               ///< Foot, head, left, right.
+  float m_fMapHeight = 0.0f;             ///< Map height in tiles.
+
+  /// Count a sensor touching something solid, sorted by where the sensor
+  /// is on the body, the way the game's contact listener does it.
+  void Count(b2Fixture* sensor, b2Fixture* other, int n) {
+    if (!sensor->IsSensor() || other->IsSensor()) return;
+    if (sensor->GetUserData().pointer != 1) return;
+
+    const b2Vec2 c = sensor->GetAABB(0).GetCenter();
+    const b2Vec2& body = m_pBody->GetPosition();
+
+    if (c.y < body.y) m_pContacts[0] += n;
+    else if (c.y > body.y) m_pContacts[1] += n;
+    else if (c.x < body.x) m_pContacts[2] += n;
+    else m_pContacts[3] += n;
+  }
+
+ public:
+  /// Build the tiles, one fixture for each horizontal run of solid tiles,
+  /// and the player standing at a point.
+  CBox2DPlayer(const std::string& tiles, int w, int h, float x, float y)
+      : m_fMapHeight((float)h) {
+    m_world.SetContactListener(this);
+
+    b2BodyDef ground;
+    b2Body* pGround = m_world.CreateBody(&ground);
+
+    for (int r = 0; r < h; ++r)
+      for (int c = 0; c < w;) {
+        if (!IsSolidTile(tiles[(size_t)r * w + c])) {
+          ++c;
+          continue;
+        }
+
+        int len = 1;
+        while (c + len < w && IsSolidTile(tiles[(size_t)r * w + c + len]))
+          ++len;
+
+        b2PolygonShape box;
+        box.SetAsBox(len * 0.5f, 0.5f, b2Vec2(c + len * 0.5f, h - r - 0.5f),
+                     0.0f);
+        b2FixtureDef fd;
+        fd.shape = &box;
+        fd.friction = 1.0f;
+        pGround->CreateFixture(&fd);
+        c += len;
+      }
+
+    b2BodyDef def;
+    def.type = b2_dynamicBody;
+    def.fixedRotation = true;
+    m_pBody = m_world.CreateBody(&def);
+
+    b2PolygonShape box;
+    box.SetAsBox(g_fHalfWidth, g_fHeight * 0.5f);
+    b2FixtureDef fix;
+    fix.shape = &box;
+    fix.density = 1.0f;
+    fix.friction = 0.0f;
+    m_pBody->CreateFixture(&fix);
+
+    const float hw = g_fHalfWidth, hh = g_fHeight * 0.5f, t = 0.02f;
+    const float sensors[4][4] = {  // half width, half height, x, y
+        {hw * 0.9f, t, 0.0f, -hh - t},
+        {hw * 0.9f, t, 0.0f, hh + t},
+        {t, hh * 0.8f, -hw - t, 0.0f},
+        {t, hh * 0.8f, hw + t, 0.0f}};
+
+    for (int i = 0; i < 4; ++i) {
+      b2PolygonShape shape;
+      shape.SetAsBox(sensors[i][0], sensors[i][1],
+                     b2Vec2(sensors[i][2], sensors[i][3]), 0.0f);
+      b2FixtureDef sensor;
+      sensor.shape = &shape;
+      sensor.isSensor = true;
+      sensor.userData.pointer = 1;
+      m_pBody->CreateFixture(&sensor);
+    }
+
+    Place(x, y);
+  }
+
+  /// Count a contact beginning on any of the sensors.
+  void BeginContact(b2Contact* c) override {
+    Count(c->GetFixtureA(), c->GetFixtureB(), 1);
+    Count(c->GetFixtureB(), c->GetFixtureA(), 1);
+  }
+
+  /// Count a contact ending on any of the sensors.
+  void EndContact(b2Contact* c) override {
+    Count(c->GetFixtureA(), c->GetFixtureB(), -1);
+    Count(c->GetFixtureB(), c->GetFixtureA(), -1);
+  }
+
+  /// Put the feet at a point in map space, at rest.
+  void Place(float x, float y) {
+    m_pBody->SetTransform(b2Vec2(x, m_fMapHeight - y + g_fHeight * 0.5f),
+                          0.0f);
+    m_pBody->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
+    m_pBody->SetAwake(true);
+  }
+
+  /// One update: CPlayer's velocity logic, then the world step.
+  void Update(const SInput& in) {
+    b2Vec2 v = m_pBody->GetLinearVelocity();
+    v.x += (in.fTarget - v.x) * 15.0f * g_fDt;
+    if (in.bJump && IsGrounded()) v.y = 7.0f;
+    m_pBody->SetLinearVelocity(v);
+    m_world.Step(g_fDt, 8, 3);
+  }
+
+  bool IsGrounded() const { return m_pContacts[0] > 0; } ///< Jump ready.
+
+  /// Downward speed.
+  float GetFallSpeed() const { return -m_pBody->GetLinearVelocity().y; }
+
+  float GetX() const { return m_pBody->GetPosition().x; } ///< Feet x.
+};
+
+/// \brief The player as a grid controller, moved the way CPlayer moves it.
+class CGridPlayer {
+ private:
+  CGridController m_grid{g_fHalfWidth, g_fHeight}; ///< Controller.
+
+ public:
+  /// Set the tiles and put the player at a point.
+  CGridPlayer(const std::string& tiles, int w, int h, float x, float y) {
+    m_grid.SetMap(tiles.data(), w, h);
+    Place(x, y);
+  }
+
+  /// Put the feet at a point in map space, at rest.
+  void Place(float x, float y) {
+    m_grid.SetPos(x, y);
+    m_grid.SetVel(0.0f, 0.0f);
+    m_grid.Move(0.0f);  // refresh the contacts
+  }
+
+  /// One update: CPlayer's velocity logic, then the move.
+  void Update(const SInput& in) {
+    float vx = m_grid.GetVelX();
+    float vy = m_grid.GetVelY();
+    vx += (in.fTarget - vx) * 15.0f * g_fDt;
+    if (in.bJump && IsGrounded()) vy = -7.0f;
+    m_grid.SetVel(vx, vy + 9.8f * g_fDt);
+    m_grid.Move(g_fDt);
+  }
+
+  bool IsGrounded() const { return m_grid.GetContacts().bGround; } ///< Ready.
+  float GetFallSpeed() const { return m_grid.GetVelY(); } ///< Down speed.
+  float GetX() const { return m_grid.GetX(); }    ///< Feet x.
+};
+
+/// Run a controller through the scripted course and print the time per
+/// update. The player runs one way, turning when it has not got anywhere
+/// for a second, and jumps every half second.
+/// \param label Row label
+/// \param player Controller
+/// \param updates Number of updates
+
+template <class T>
+static void RunCourse(const char* label, T& player, int updates) {
+  SInput in;
+  float dir = 1.0f, lastX = player.GetX();
+  double total = 0.0;
+
+  for (int f = 0; f < updates; ++f) {
+    if (f % 60 == 0) {
+      if (std::fabs(player.GetX() - lastX) < 1.0f) dir = -dir;
+      lastX = player.GetX();
+    }
+
+    in.fTarget = 5.0f * dir;
+    in.bJump = f % 30 == 0;
+
+    CStopwatch sw;
+    player.Update(in);
+    total += sw.GetTime();
+  }
+
+  printf("%-6s %8.2f us/update\n", label, 1000.0 * total / updates);
+}
+
+/// Drop a controller onto a floor from a range of heights and print the
+/// updates from touching down to being ready to jump.
+/// \param label Row label
+/// \param player Controller
+/// \param floor Floor row
+/// \param drops Number of drops
+
+template <class T>
+static void RunLanding(const char* label, T& player, int floor, int drops) {
+  std::mt19937 rng(3);
+  int total = 0, worst = 0;
+
+  for (int d = 0; d < drops; ++d) {
+    const float height = 0.5f + (rng() % 1000) * 0.004f;  // 0.5 to 4.5 tiles
+    player.Place(8.0f, floor - height);
+
+    int down = -1;
+    bool falling = false;
+    for (int f = 0; f < 600; ++f) {
+      const float v = player.GetFallSpeed();
+      falling = falling || v > 1.0f;
+      if (falling && v < 0.5f && down < 0) down = f;  // stopped by the floor
+      if (down >= 0 && player.IsGrounded()) {
+        total += f - down;
+        worst = std::max(worst, f - down);
+        break;
+      }
+      player.Update(SInput());
+    }
+  }
+
+  printf("%-6s %8.2f updates mean %d worst from touchdown to jump-ready "
+         "(%.1f ms at 60 Hz)\n",
+         label, (double)total / drops, worst, 1000.0 * total / drops / 60.0);
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 on success
+
+int ControllerBench(int argc, char* argv[]) {
+  int w = 512, h = 64, updates = 20000, drops = 200;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-w")) w = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-h")) h = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-updates")) updates = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-drops")) drops = atoi(argv[i + 1]);
+  }
+
+  const std::string tiles = GenerateMap(w, h, 1);
+  int floor = 1;  // top of the ground under column 8
+  while (floor < h && tiles[(size_t)floor * w + 8] != '1') ++floor;
+
+  printf("%d updates on %dx%d tiles\n", updates, w, h);
+  {
+    CBox2DPlayer box2d(tiles, w, h, 8.5f, (float)floor);
+    RunCourse("box2d", box2d, updates);
+    CGridPlayer grid(tiles, w, h, 8.5f, (float)floor);
+    RunCourse("grid", grid, updates);
+  }
+
+  const int fw = 16, fh = 16, ff = 12;  // flat floor at row 12
+  std::string flat((size_t)fw * fh, '0');
+  std::fill(flat.begin() + (size_t)ff * fw, flat.end(), '1');
+
+  printf("%d drops onto a flat floor\n", drops);
+  {
+    CBox2DPlayer box2d(flat, fw, fh, 8.0f, (float)ff);
+    RunLanding("box2d", box2d, ff, drops);
+    CGridPlayer grid(flat, fw, fh, 8.0f, (float)ff);
+    RunLanding("grid", grid, ff, drops);
+  }
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+/// \file CrowdBench.cpp
+/// \brief Crowd simulation benchmark.
+///
+/// Scatters agents over a large generated map, all chasing a target that
+/// runs across the map with the view centered on it, and times the crowd
+/// update at 60 Hz on the calling thread alone. It runs twice, once with
+/// levels of detail and once with every agent ticking every frame, and
+/// prints the mean and worst frame against the 16.7 ms frame budget.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Crowd.h"
+
+/// Time one run of the crowd and print a row.
+/// \param label Row label
+/// \param params Movement limits
+/// \param tiles Tile map
+/// \param w Map width in tiles
+/// \param h Map height in tiles
+/// \param spawn Agent positions, x then y
+/// \param frames Frames to run
+
+static void Run(const char* label, const SCrowdParams& params,
+                const std::string& tiles, int w, int h,
+                const std::vector<float>& spawn, int frames) {
+  CCrowd crowd(params);
+  crowd.SetMap(tiles.data(), w, h);
+  for (size_t i = 0; i + 1 < spawn.size(); i += 2)
+    crowd.Add(spawn[i], spawn[i + 1]);
+
+  const float dt = 1.0f / 60.0f;
+  const float viewW = 32.0f, viewH = 24.0f;  // 1024x768 in 32 pixel tiles
+  double total = 0.0, worst = 0.0;
+  size_t ticked = 0;
+
+  for (int f = 0; f < frames; ++f) {
+    const float tx = 8.0f + std::fmod(f * 0.2f, w - 16.0f);  // 12 tiles/s
+    const float ty = h * 0.5f;
+
+    CStopwatch sw;
+    crowd.SetView(tx - viewW / 2, ty - viewH / 2, tx + viewW / 2,
+                  ty + viewH / 2);
+    crowd.SetGoal(tx, ty);
+    crowd.Update(dt);
+    const double ms = sw.GetTime();
+
+    total += ms;
+    worst = std::max(worst, ms);
+    ticked += crowd.GetTicked();
+  }
+
+  size_t n[(int)eCrowdLOD::Count];
+  for (int k = 0; k < (int)eCrowdLOD::Count; ++k) {
+    size_t begin, end;
+    crowd.GetRange((eCrowdLOD)k, begin, end);
+    n[k] = end - begin;
+  }
+
+  printf("%-6s %7.3f ms mean %7.3f ms worst %4.0f%% budget %8zu ticks/frame"
+         "  near %zu mid %zu far %zu\n",
+         label, total / frames, worst, 100.0 * total / frames / (1000.0 / 60),
+         ticked / frames, n[0], n[1], n[2]);
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 on success
+
+int CrowdBench(int argc, char* argv[]) {
+  int w = 2048, h = 256, agents = 50000, frames = 600;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-w")) w = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-h")) h = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-agents")) agents = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+  }
+
+  const std::string tiles = GenerateMap(w, h, 1);
+  std::mt19937 rng(2);
+  std::vector<float> spawn;
+
+  while ((int)spawn.size() < 2 * agents) {  // on top of a random solid tile
+    const int x = 1 + (int)(rng() % (w - 2));
+    const int y = 2 + (int)(rng() % (h - 2));
+    if (tiles[(size_t)y * w + x] == '1' && tiles[(size_t)(y - 1) * w + x] != '1'
+        && tiles[(size_t)(y - 2) * w + x] != '1') {
+      spawn.push_back(x + 0.5f);
+      spawn.push_back((float)y);
+    }
+  }
+
+  printf("%d agents on %dx%d tiles, %d frames at 60 Hz, one thread\n",
+         agents, w, h, frames);
+
+  SCrowdParams params;
+  Run("lod", params, tiles, w, h, spawn, frames);
+
+  params.fNearPad = (float)(w + h);  // everything is on screen
+  Run("full", params, tiles, w, h, spawn, frames);
+
+  return 0;
+}
@@ -0,0 +1,371 @@
+/// \file DeterminismBench.cpp
+/// \brief Determinism check.
+///
+/// Runs a simulation built from the game's own parts several times with the
+/// same scripted input and compares their per-frame world hashes. There is
+/// a Box2D world with the tiles, a player body and bullets, a grid
+/// controller player, world drops with bobbing, and a crowd steered by the
+/// path service, on a job system of a given size. The parts that do not
+/// touch Box2D run alongside the world step in a task graph each frame, as
+/// in the game. The second run repeats the first exactly, and the third
+/// uses a different number of threads. For each, it prints whether the run
+/// matches the first, or the first frame where it does not and which parts
+/// differ there. The repeat can be given a tiny push at some frame to show
+/// that the check catches it.
+///
+/// Given two hash logs written by the game, it compares those instead.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Crowd.h"
+#include "GridController.h"
+#include "JobSystem.h"
+#include "NavGraph.h"
+#include "PathService.h"
+#include "SimdKernels.h"
+#include "WorldHash.h"
+#include "box2d/box2d.h"
+
+static const float g_fDt = 1.0f / 60.0f;   ///< Frame time.
+static const float g_fHalfWidth = 0.4375f; ///< Player half width, as CPlayer.
+static const float g_fHeight = 1.5f;       ///< Player height, as CPlayer.
+
+/// \brief The simulation.
+class CSim {
+ private:
+  const std::string& m_strTiles;  ///< Tile map.
+  int m_nWidth;                   ///< Map width in tiles.
+  int m_nHeight;                  ///< Map height in tiles.
+
+  CJobSystem m_jobs;              ///< Worker pool.
+  CTaskGraph m_frame;             ///< Jobs for the current frame.
+  CNavGraph m_nav;                ///< Navigation graph.
+  CPathService m_paths{&m_nav};   ///< Path finder.
+  CCrowd m_crowd;                 ///< Crowd.
+  std::vector<std::pair<uint32_t, int>> m_vTickets; ///< Agent, ticket.
+
+  b2World m_world{b2Vec2(0.0f, -9.8f)}; ///< Tiles, player and bullets.
+  b2Body* m_pPlayer = nullptr;          ///< Player body.
+  std::vector<b2Body*> m_vBullets;      ///< Bullet bodies.
+  std::vector<float> m_vLife;           ///< Bullet lifetimes.
+  std::vector<uint8_t> m_vDead;         ///< Bullet expiry mask.
+
+  CGridController m_grid{g_fHalfWidth, g_fHeight}; ///< Second player.
+
+  std::vector<float> m_vDropX;     ///< Drop positions x.
+  std::vector<float> m_vDropY;     ///< Drop positions y.
+  std::vector<float> m_vDropTime;  ///< Drop bob timers.
+  std::vector<float> m_vDropBob;   ///< Drop bob offsets.
+
+ public:
+  /// Build the tiles as one fixture per horizontal run of solid tiles, put
+  /// both players on the ground near the left and scatter the crowd.
+  CSim(const std::string& tiles, int w, int h, unsigned threads, int agents)
+      : m_strTiles(tiles), m_nWidth(w), m_nHeight(h), m_jobs(threads) {
+    b2BodyDef ground;
+    b2Body* pGround = m_world.CreateBody(&ground);
+
+    for (int r = 0; r < h; ++r)
+      for (int c = 0; c < w;) {
+        if (tiles[(size_t)r * w + c] != '1') {
+          ++c;
+          continue;
+        }
+
+        int len = 1;
+        while (c + len < w && tiles[(size_t)r * w + c + len] == '1') ++len;
+
+        b2PolygonShape box;
+        box.SetAsBox(len * 0.5f, 0.5f, b2Vec2(c + len * 0.5f, h - r - 0.5f),
+                     0.0f);
+        b2FixtureDef fd;
+        fd.shape = &box;
+        fd.friction = 1.0f;
+        pGround->CreateFixture(&fd);
+        c += len;
+      }
+
+    int floor = 1;  // top of the ground under column 8
+    while (floor < h && tiles[(size_t)floor * w + 8] != '1') ++floor;
+
+    b2BodyDef def;
+    def.type = b2_dynamicBody;
+    def.fixedRotation = true;
+    def.position.Set(8.5f, h - floor + g_fHeight * 0.5f);
+    m_pPlayer = m_world.CreateBody(&def);
+
+    b2PolygonShape box;
+    box.SetAsBox(g_fHalfWidth, g_fHeight * 0.5f);
+    b2FixtureDef fix;
+    fix.shape = &box;
+    fix.density = 1.0f;
+    m_pPlayer->CreateFixture(&fix);
+
+    m_grid.SetMap(tiles.data(), w, h);
+    m_grid.SetPos(8.5f, (float)floor);
+
+    m_nav.Build(tiles.data(), w, h);
+    m_crowd.SetMap(tiles.data(), w, h);
+    std::mt19937 rng(1);
+    for (int i = 0; i < agents && m_nav.GetNodeCount() > 0; ++i) {
+      const int n = rng() % m_nav.GetNodeCount();
+      m_crowd.Add(m_nav.GetNodeX(n) + 0.5f, m_nav.GetNodeY(n) + 1.0f);
+    }
+  }
+
+  /// Run one frame with the scripted input: run one way and then the
+  /// other, jump every 45 frames, shoot every 10 and drop an item every 30.
+  /// \param f Frame number
+  void Step(int f) {
+    const float dir = (f / 240) % 2 ? -1.0f : 1.0f;
+    const b2Vec2 p = m_pPlayer->GetPosition();
+    const float feetY = m_nHeight - (p.y - g_fHeight * 0.5f);  // map space
+
+    // paths asked for last frame steer the crowd, as in CGame::SteerCrowd()
+    m_paths.Collect(&m_jobs);
+    for (const std::pair<uint32_t, int>& t : m_vTickets) {
+      const SPathResult& result = m_paths.GetResult(t.second);
+      if (!result.bFound || result.vSteps.size() < 2) continue;
+      const int n = result.vSteps[1].nNode;
+      m_crowd.SetGoal(t.first, m_nav.GetNodeX(n) + 0.5f,
+                      m_nav.GetNodeY(n) + 1.0f);
+    }
+    m_vTickets.clear();
+    m_crowd.SetView(p.x - 16.0f, feetY - 12.0f, p.x + 16.0f, feetY + 12.0f);
+    m_crowd.SetGoal(p.x, feetY);
+
+    // the Box2D player, as CPlayer moves it
+    b2Vec2 v = m_pPlayer->GetLinearVelocity();
+    v.x += (5.0f * dir - v.x) * 15.0f * g_fDt;
+    if (f % 45 == 0 && std::fabs(v.y) < 0.01f) v.y = 7.0f;
+    m_pPlayer->SetLinearVelocity(v);
+
+    if (f % 10 == 0) {
+      b2BodyDef def;
+      def.type = b2_dynamicBody;
+      def.bullet = true;
+      def.position = p;
+      b2Body* pBullet = m_world.CreateBody(&def);
+      b2CircleShape shape;
+      shape.m_radius = 0.1f;
+      b2FixtureDef fd;
+      fd.shape = &shape;
+      fd.density = 1.0f;
+      pBullet->CreateFixture(&fd);
+      pBullet->SetLinearVelocity(b2Vec2(15.0f * dir, 0.0f));
+      m_vBullets.push_back(pBullet);
+      m_vLife.push_back(2.0f);
+    }
+
+    if (f % 30 == 0) {
+      m_vDropX.push_back(p.x * 32.0f);
+      m_vDropY.push_back(p.y * 32.0f);
+      m_vDropTime.push_back(0.0f);
+    }
+
+    // the grid player, as CPlayer::UpdateGrid() moves it
+    float gvx = m_grid.GetVelX(), gvy = m_grid.GetVelY();
+    gvx += (5.0f * dir - gvx) * 15.0f * g_fDt;
+    if (f % 45 == 0 && m_grid.GetContacts().bGround) gvy = -7.0f;
+    m_grid.SetVel(gvx, gvy + 9.8f * g_fDt);
+    m_grid.Move(g_fDt);
+
+    // the frame graph, as in CGame::RunFrameGraph()
+    m_frame.Clear();
+    m_frame.Add([&]() { m_world.Step(g_fDt, 8, 3); });
+    m_frame.Add([&]() {
+      m_vDead.resize(m_vLife.size());
+      SimdAdd(m_vLife.data(), m_vLife.size(), -g_fDt);
+      SimdExpired(m_vLife.data(), m_vLife.size(), m_vDead.data());
+    });
+    m_frame.Add([&]() {
+      SimdAdd(m_vDropTime.data(), m_vDropTime.size(), g_fDt);
+      m_vDropBob.resize(m_vDropTime.size());
+      SimdBob(m_vDropTime.data(), m_vDropTime.size(), 2.5f, 6.0f,
+              m_vDropBob.data());
+    });
+    m_frame.Add([&]() { m_crowd.Update(g_fDt); });
+    m_frame.Run(&m_jobs);
+
+    size_t live = 0;  // bodies are destroyed outside of Step
+    for (size_t i = 0; i < m_vBullets.size(); ++i) {
+      if (m_vDead[i]) m_world.DestroyBody(m_vBullets[i]);
+      else {
+        m_vBullets[live] = m_vBullets[i];
+        m_vLife[live++] = m_vLife[i];
+      }
+    }
+    m_vBullets.resize(live);
+    m_vLife.resize(live);
+
+    // paths for the agents on screen, searched while the next frame starts
+    const int goal = m_nav.FindNode((int)std::floor(p.x),
+                                    (int)std::floor(feetY - 0.5f));
+    size_t begin, end;
+    m_crowd.GetRange(eCrowdLOD::Near, begin, end);
+    end = std::min(end, begin + 256);
+    for (size_t i = begin; i < end && goal >= 0; ++i) {
+      const int start = m_nav.FindNode((int)std::floor(m_crowd.GetX(i)),
+                                       (int)std::floor(m_crowd.GetY(i) - 0.5f));
+      if (start >= 0)
+        m_vTickets.push_back({m_crowd.GetId(i), m_paths.Request(start, goal)});
+    }
+    m_paths.Dispatch(&m_jobs);
+  }
+
+  /// Hash each part as CGame::HashWorld() does.
+  /// \param hash World hash to add the frame to
+  void Hash(CWorldHash& hash) {
+    uint64_t h = g_nHashSeed;
+    for (b2Body* b = m_world.GetBodyList(); b; b = b->GetNext()) {
+      if (b->GetType() == b2_staticBody) continue;
+      const b2Vec2& p = b->GetPosition();
+      const b2Vec2& v = b->GetLinearVelocity();
+      const float state[] = {p.x, p.y, b->GetAngle(), v.x, v.y,
+                             b->GetAngularVelocity(),
+                             b->IsAwake() ? 1.0f : 0.0f};
+      h = HashValue(state, h);
+    }
+    hash.Set(eHashPart::Bodies, h);
+
+    const float grid[] = {m_grid.GetX(), m_grid.GetY(), m_grid.GetVelX(),
+                          m_grid.GetVelY()};
+    hash.Set(eHashPart::Player, HashValue(grid));
+    hash.Set(eHashPart::Bullets, HashArray(m_vLife));
+    hash.Set(eHashPart::Drops,
+             HashArray(m_vDropBob, HashArray(m_vDropTime)));
+    hash.Set(eHashPart::Crowd, m_crowd.Hash(g_nHashSeed));
+
+    if (hash.IsStale(eHashPart::Tiles))
+      hash.Set(eHashPart::Tiles, HashWords(m_strTiles.data(),
+                                           m_strTiles.size()));
+    hash.EndFrame();
+  }
+
+  /// Nudge a drop's timer by a hair, to show that a divergence is caught.
+  /// The players would not do, since walls and floors snap them back.
+  void Perturb() {
+    if (!m_vDropTime.empty()) m_vDropTime[0] += 1.0f / 1024.0f;
+  }
+};
+
+/// Run the simulation and hash every frame.
+/// \param tiles Tile map
+/// \param w Map width in tiles
+/// \param h Map height in tiles
+/// \param threads Job system threads
+/// \param agents Crowd size
+/// \param frames Frames to run
+/// \param inject Frame to perturb a drop at, or -1
+/// \param hash [out] World hash
+/// \return Time spent hashing per frame in ms
+
+static double Run(const std::string& tiles, int w, int h, unsigned threads,
+                  int agents, int frames, int inject, CWorldHash& hash) {
+  CSim sim(tiles, w, h, threads, agents);
+  double time = 0.0;
+
+  for (int f = 0; f < frames; ++f) {
+    if (f == inject) sim.Perturb();
+    sim.Step(f);
+
+    CStopwatch sw;
+    sim.Hash(hash);
+    time += sw.GetTime();
+  }
+
+  return time / frames;
+}
+
+/// Print whether a run matches the reference run.
+/// \param label Row label
+/// \param ref Reference run
+/// \param run Run to check
+/// \return True if it matches
+
+static bool Report(const char* label, const CWorldHash& ref,
+                   const CWorldHash& run) {
+  size_t frame;
+  const uint32_t parts = FindDivergence(ref.GetFrames(), run.GetFrames(),
+                                        frame);
+  if (parts == 0) {
+    printf("%-10s matches, world %016llx\n", label,
+           (unsigned long long)run.GetLast().nWorld);
+    return true;
+  }
+
+  printf("%-10s diverges at frame %zu in", label, frame);
+  for (int i = 0; i < (int)eHashPart::Count; ++i)
+    if (parts & (1u << i)) printf(" %s", GetHashPartName((eHashPart)i));
+  printf("\n");
+  return false;
+}
+
+/// Run the check.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if every run matches, except a repeat perturbed on purpose,
+///   1 otherwise
+
+int DeterminismBench(int argc, char* argv[]) {
+  int w = 256, h = 64, agents = 2000, frames = 600, inject = -1;
+  unsigned threads = 4;
+  const char* logA = nullptr;
+  const char* logB = nullptr;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-w")) w = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-h")) h = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-agents")) agents = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-threads")) threads = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-inject")) inject = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-a")) logA = argv[i + 1];
+    else if (!strcmp(argv[i], "-b")) logB = argv[i + 1];
+  }
+
+  if (logA && logB) {  // compare two logs from the game
+    std::vector<SFrameHash> a, b;
+    if (!ReadHashLog(logA, a) || !ReadHashLog(logB, b)) {
+      printf("cannot read %s or %s\n", logA, logB);
+      return 1;
+    }
+
+    size_t frame;
+    const uint32_t parts = FindDivergence(a, b, frame);
+    printf("%zu and %zu frames: ", a.size(), b.size());
+    if (parts == 0) printf("match\n");
+    else {
+      printf("diverge at frame %zu in", frame);
+      for (int i = 0; i < (int)eHashPart::Count; ++i)
+        if (parts & (1u << i)) printf(" %s", GetHashPartName((eHashPart)i));
+      printf("\n");
+    }
+    return parts ? 1 : 0;
+  }
+
+  const std::string tiles = GenerateMap(w, h, 1);
+  printf("%d agents on %dx%d tiles, %d frames\n", agents, w, h, frames);
+
+  CWorldHash ref, again, other;
+  const double ms = Run(tiles, w, h, 1, agents, frames, -1, ref);
+  Run(tiles, w, h, 1, agents, frames, inject, again);
+  Run(tiles, w, h, threads, agents, frames, -1, other);
+
+  char label[32];
+  snprintf(label, sizeof(label), "%u thread%s", threads,
+           threads == 1 ? "" : "s");
+  printf("1 thread %.2f us/frame to hash\n", 1000.0 * ms);
+  bool ok = Report("repeat", ref, again) != (inject >= 0 && inject < frames);
+  ok = Report(label, ref, other) && ok;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,428 @@
+/// \file FrameBench.cpp
+/// \brief Frame graph scaling benchmark.
+///
+/// Builds the task graph CGame::RunFrameGraph builds, with the same jobs and
+/// the same dependencies, over headless stand-ins for what the game's jobs
+/// touch, and runs it on CJobSystem with 1, 2, and so on up to N threads.
+/// The physics step, which is Box2D's and runs on one thread, is stood in
+/// for by moving every body's grid controller. Bullet lifetimes, drops, tile
+/// culling, the crowd, player animation, particles and the sprite lists are
+/// the game's own code or the same loops over the same amount of data.
+///
+/// Each thread count runs the same frames from the same start. The one
+/// thread run also times every job, which gives the total work and the
+/// critical path, the longest chain of jobs that must run one after the
+/// other. No number of threads can beat the critical path, so the best
+/// speedup is the work over the critical path, which is printed with the
+/// speedup actually reached.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Animation.h"
+#include "Benchmarks.h"
+#include "Camera.h"
+#include "Crowd.h"
+#include "GridController.h"
+#include "JobSystem.h"
+#include "Particles.h"
+#include "Tiles.h"
+
+static const float g_fDt = 1.0f / 60.0f; ///< Frame time.
+static const float g_fTile = 32.0f;      ///< Tile size in pixels.
+
+/// \brief Sizes of the world.
+struct SFrameSizes {
+  int nWidth = 1024;        ///< Map width in tiles.
+  int nHeight = 128;        ///< Map height in tiles.
+  int nBodies = 2000;       ///< Players and bullets moved by the step.
+  int nAgents = 20000;      ///< Crowd agents.
+  int nDrops = 20000;       ///< Items lying in the world.
+  int nParticles = 200000;  ///< Particle pool size.
+};
+
+/// \brief Everything the frame's jobs read and write.
+class CFrameWorld {
+ public:
+  std::string m_strTiles;                ///< Tile map.
+  std::vector<CGridController> m_vBodies; ///< Stand-ins for Box2D bodies.
+  std::vector<float> m_vBulletLife;      ///< Seconds left per body.
+  std::vector<bool> m_vBulletDead;       ///< Expired this frame.
+  std::vector<float> m_vDropX, m_vDropY; ///< Drop positions in pixels.
+  std::vector<float> m_vDropTimer;       ///< Drop bob timers.
+  std::vector<float> m_vPlayerX, m_vPlayerY; ///< Player positions in pixels.
+  std::vector<float> m_vTileX, m_vTileY; ///< Solid tile centers in pixels.
+  CCrowd m_crowd;                        ///< Crowd.
+  CAnimClips m_clips;                    ///< Player clips.
+  CAnimator m_anim;                      ///< One entity per body.
+  CParticles m_particles;                ///< Particle pool.
+  SViewRect m_view;                      ///< Cull rectangle.
+
+  std::vector<float> m_vBulletSprites;   ///< Culled bullets, x then y.
+  std::vector<float> m_vDropSprites;     ///< Culled drops.
+  std::vector<float> m_vTileSprites;     ///< Culled tiles.
+  std::vector<float> m_vCrowdSprites;    ///< Agents on screen.
+  size_t m_nCollected = 0;               ///< Drops in reach of a body.
+
+  /// \brief Build the world.
+  /// \param s Sizes
+  explicit CFrameWorld(const SFrameSizes& s);
+
+  void UpdatePlayers();   ///< Copy the player positions.
+  void Step();            ///< Move the bodies.
+  void AgeBullets();      ///< Count down bullet lifetimes.
+  void UpdateDrops();     ///< Bob the drops and collect those in reach.
+  void CullTiles();       ///< Cull the tiles.
+  void CullBullets();     ///< Cull the bullets.
+  void UpdateCrowd();     ///< Update the crowd.
+  void CullDrops();       ///< Cull the drops.
+  void Animate();         ///< Advance the clips.
+  void UpdateParticles(); ///< Emit hits and pickups, move the particles.
+  void ListAgents();      ///< List the agents on screen.
+};  // CFrameWorld
+
+/// Generate the map and scatter everything over it, with the view in the
+/// middle.
+/// \param s Sizes
+
+CFrameWorld::CFrameWorld(const SFrameSizes& s)
+    : m_strTiles(GenerateMap(s.nWidth, s.nHeight, 1)) {
+  const int w = s.nWidth, h = s.nHeight;
+  std::mt19937 rng(4);
+  std::uniform_real_distribution<float> fx(1.0f, w - 1.0f);
+  std::uniform_real_distribution<float> fy(1.0f, h - 1.0f);
+
+  for (int i = 0; i < s.nBodies; ++i) {
+    m_vBodies.emplace_back(0.4375f, 1.5f);
+    m_vBodies.back().SetMap(m_strTiles.data(), w, h);
+    m_vBodies.back().SetPos(fx(rng), fy(rng));
+    m_vBodies.back().SetVel(rng() % 2 ? 6.0f : -6.0f, 0.0f);
+  }
+  m_vBulletLife.assign(s.nBodies, 2.0f);
+  m_vBulletDead.assign(s.nBodies, false);
+
+  for (int i = 0; i < s.nDrops; ++i) {
+    m_vDropX.push_back(fx(rng) * g_fTile);
+    m_vDropY.push_back(fy(rng) * g_fTile);
+    m_vDropTimer.push_back(0.0f);
+  }
+
+  for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x)
+      if (IsSolidTile(m_strTiles[(size_t)y * w + x])) {
+        m_vTileX.push_back((x + 0.5f) * g_fTile);
+        m_vTileY.push_back((h - y - 0.5f) * g_fTile);
+      }
+
+  m_crowd.SetMap(m_strTiles.data(), w, h);
+  while ((int)m_crowd.GetCount() < s.nAgents)
+    m_crowd.Add(fx(rng), fy(rng));
+  const float cx = w * 0.5f, cy = h * 0.5f;
+  m_crowd.SetView(cx - 16.0f, cy - 12.0f, cx + 16.0f, cy + 12.0f);
+  m_crowd.SetGoal(cx, cy);
+
+  m_clips.Add("walk", 0, "0-7", 12.0f, true);
+  m_clips.Add("jump", 0, "8-11", 8.0f, false);
+  m_anim.SetClips(&m_clips);
+  m_anim.Resize(s.nBodies, 0);
+
+  std::vector<SParticleEmitter> emitters(2);
+  emitters[0].strName = "hit";
+  emitters[0].nMax = (uint32_t)s.nParticles / 2;
+  emitters[1].strName = "pickup";
+  emitters[1].nMax = (uint32_t)s.nParticles - emitters[0].nMax;
+  m_particles.SetEmitters(emitters);
+
+  m_view.fLeft = (cx - 16.0f) * g_fTile;  // 1024x768 around the middle
+  m_view.fRight = (cx + 16.0f) * g_fTile;
+  m_view.fBottom = (h - cy - 12.0f) * g_fTile;
+  m_view.fTop = (h - cy + 12.0f) * g_fTile;
+}  // constructor
+
+/// Copy the first few bodies' positions, on the main thread before the
+/// graph runs, as CPlayer keeps its own position for the drops to read while
+/// Box2D steps.
+
+void CFrameWorld::UpdatePlayers() {
+  const size_t players = std::min<size_t>(m_vBodies.size(), 8);
+  m_vPlayerX.resize(players);
+  m_vPlayerY.resize(players);
+  for (size_t p = 0; p < players; ++p) {
+    m_vPlayerX[p] = m_vBodies[p].GetX() * g_fTile;
+    m_vPlayerY[p] = m_vBodies[p].GetY() * g_fTile;
+  }
+}
+
+/// Move every body a frame under gravity, turning at walls.
+
+void CFrameWorld::Step() {
+  for (CGridController& b : m_vBodies) {
+    float vx = b.GetVelX();
+    const SGridContacts& c = b.GetContacts();
+    if (c.bWallLeft || c.bWallRight) vx = -vx;
+    b.SetVel(vx, b.GetVelY() + 9.8f * g_fDt);
+    b.Move(g_fDt);
+  }
+}
+
+/// Count down every bullet's life, restarting it when it runs out.
+
+void CFrameWorld::AgeBullets() {
+  for (size_t i = 0; i < m_vBulletLife.size(); ++i) {
+    m_vBulletLife[i] -= g_fDt;
+    m_vBulletDead[i] = m_vBulletLife[i] <= 0.0f;
+    if (m_vBulletDead[i]) m_vBulletLife[i] += 2.0f;
+  }
+}
+
+/// Bob every drop and count those near a player.
+
+void CFrameWorld::UpdateDrops() {
+  for (float& t : m_vDropTimer) t += g_fDt;
+
+  m_nCollected = 0;
+  for (size_t p = 0; p < m_vPlayerX.size(); ++p) {
+    const float px = m_vPlayerX[p], py = m_vPlayerY[p];
+    for (size_t i = 0; i < m_vDropX.size(); ++i) {
+      const float dx = m_vDropX[i] - px, dy = m_vDropY[i] - py;
+      m_nCollected += dx * dx + dy * dy < 32.0f * 32.0f;
+    }
+  }
+}
+
+/// Keep the tiles whose centers are in view.
+
+void CFrameWorld::CullTiles() {
+  m_vTileSprites.clear();
+  for (size_t i = 0; i < m_vTileX.size(); ++i)
+    if (m_view.Contains(m_vTileX[i], m_vTileY[i])) {
+      m_vTileSprites.push_back(m_vTileX[i]);
+      m_vTileSprites.push_back(m_vTileY[i]);
+    }
+}
+
+/// Keep the live bullets in view.
+
+void CFrameWorld::CullBullets() {
+  m_vBulletSprites.clear();
+  for (size_t i = 0; i < m_vBodies.size(); ++i) {
+    if (m_vBulletDead[i]) continue;
+    const float x = m_vBodies[i].GetX() * g_fTile;
+    const float y = m_vBodies[i].GetY() * g_fTile;
+    if (m_view.Contains(x, y)) {
+      m_vBulletSprites.push_back(x);
+      m_vBulletSprites.push_back(y);
+    }
+  }
+}
+
+/// Update the crowd.
+
+void CFrameWorld::UpdateCrowd() { m_crowd.Update(g_fDt); }
+
+/// Keep the drops in view, with their bob.
+
+void CFrameWorld::CullDrops() {
+  m_vDropSprites.clear();
+  for (size_t i = 0; i < m_vDropX.size(); ++i)
+    if (m_view.Contains(m_vDropX[i], m_vDropY[i])) {
+      m_vDropSprites.push_back(m_vDropX[i]);
+      m_vDropSprites.push_back(m_vDropY[i] + 4.0f * m_vDropTimer[i]);
+    }
+}
+
+/// Play the jump clip for bodies in the air, walk for the rest.
+
+void CFrameWorld::Animate() {
+  for (size_t i = 0; i < m_vBodies.size(); ++i) {
+    const uint32_t clip = m_vBodies[i].GetContacts().bGround ? 0 : 1;
+    if (m_anim.GetClip(i) != clip) m_anim.Play(i, clip);
+  }
+  m_anim.Update(g_fDt);
+}
+
+/// Emit a burst where each body hit a wall in the step, as the game does at
+/// the listener's impacts, and at a few drops, then move the particles.
+
+void CFrameWorld::UpdateParticles() {
+  for (size_t i = 0; i < m_vBodies.size(); ++i) {
+    const SGridContacts& c = m_vBodies[i].GetContacts();
+    if (c.bWallLeft || c.bWallRight)
+      m_particles.Emit(0, m_vBodies[i].GetX() * g_fTile,
+                       m_vBodies[i].GetY() * g_fTile);
+  }
+  for (size_t i = 0; i < m_nCollected && i < m_vDropX.size(); ++i)
+    m_particles.Emit(1, m_vDropX[i], m_vDropY[i]);
+  m_particles.Update(g_fDt);
+}
+
+/// List the agents the crowd put in its near range.
+
+void CFrameWorld::ListAgents() {
+  size_t begin, end;
+  m_crowd.GetRange(eCrowdLOD::Near, begin, end);
+  m_vCrowdSprites.clear();
+  for (size_t i = begin; i < end; ++i) {
+    m_vCrowdSprites.push_back(m_crowd.GetX(i) * g_fTile);
+    m_vCrowdSprites.push_back(m_crowd.GetY(i) * g_fTile);
+  }
+}
+
+/// \brief The frame graph, with a timer on every job.
+class CFrameGraph {
+ private:
+  CTaskGraph m_graph;                    ///< Task graph.
+  std::vector<std::vector<int>> m_vDeps; ///< Dependencies of each job.
+  std::vector<double> m_vTime;           ///< Time of each job this frame.
+
+  /// Add a job that times itself.
+  /// \param task The work to do
+  /// \param deps Handles of jobs that must finish first
+  /// \return Handle of the new job
+  JobHandle Add(const std::function<void()>& task,
+                std::initializer_list<JobHandle> deps = {}) {
+    const size_t i = m_vDeps.size();
+    m_vDeps.emplace_back(deps);
+    m_vTime.push_back(0.0);
+    return m_graph.Add([this, task, i]() {
+      CStopwatch sw;
+      task();
+      m_vTime[i] = sw.GetTime();
+    }, deps);
+  }
+
+ public:
+  /// Build the graph RunFrameGraph builds, job for job.
+  /// \param w World
+  explicit CFrameGraph(CFrameWorld& w) {
+    const JobHandle step = Add([&w]() { w.Step(); });
+    const JobHandle bullets = Add([&w]() { w.AgeBullets(); });
+    const JobHandle drops = Add([&w]() { w.UpdateDrops(); });
+    Add([&w]() { w.CullTiles(); });
+    Add([&w]() { w.CullBullets(); }, {step, bullets});
+    const JobHandle crowd = Add([&w]() { w.UpdateCrowd(); });
+    Add([&w]() { w.CullDrops(); }, {drops});
+    Add([&w]() { w.Animate(); }, {step});
+    Add([&w]() { w.UpdateParticles(); }, {step, drops});
+    Add([&w]() { w.ListAgents(); }, {crowd});
+  }
+
+  /// Run a frame, the graph and what the main thread does before it.
+  /// \param w World
+  /// \param pJobs Job system
+  /// \return Graph time in ms
+  double Run(CFrameWorld& w, CJobSystem* pJobs) {
+    w.UpdatePlayers();
+    m_graph.Run(pJobs);
+    return m_graph.GetLastRunTime();
+  }
+
+  /// Add up the time of every job in the last run.
+  /// \return Work in ms
+  double GetWork() const {
+    double t = 0.0;
+    for (double x : m_vTime) t += x;
+    return t;
+  }
+
+  /// Find the longest chain of dependent jobs in the last run. Jobs only
+  /// depend on jobs added before them, so one pass in order does it.
+  /// \return Critical path in ms
+  double GetCriticalPath() const {
+    std::vector<double> finish(m_vTime.size());
+    double longest = 0.0;
+    for (size_t i = 0; i < m_vTime.size(); ++i) {
+      double start = 0.0;
+      for (int d : m_vDeps[i]) start = std::max(start, finish[d]);
+      finish[i] = start + m_vTime[i];
+      longest = std::max(longest, finish[i]);
+    }
+    return longest;
+  }
+};  // CFrameGraph
+
+/// \brief What a thread count measured.
+struct SResult {
+  double fMean = 0.0;      ///< Mean frame graph time in ms.
+  double fWorst = 0.0;     ///< Slowest frame graph in ms.
+  double fWork = 0.0;      ///< Mean total job time in ms.
+  double fCritical = 0.0;  ///< Mean critical path in ms.
+};
+
+/// Run the frames on a number of threads, from a fresh world.
+/// \param s Sizes
+/// \param threads Threads including the calling one
+/// \param frames Frames to run
+/// \return What was measured
+
+static SResult Run(const SFrameSizes& s, unsigned threads, int frames) {
+  CFrameWorld world(s);
+  CFrameGraph graph(world);
+  CJobSystem jobs(threads);
+  SResult r;
+
+  for (int f = 0; f < frames; ++f) {
+    const double t = graph.Run(world, &jobs);
+    r.fMean += t;
+    r.fWorst = std::max(r.fWorst, t);
+    r.fWork += graph.GetWork();
+    r.fCritical += graph.GetCriticalPath();
+  }
+
+  r.fMean /= frames;
+  r.fWork /= frames;
+  r.fCritical /= frames;
+  return r;
+}  // Run
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 on success
+
+int FrameBench(int argc, char* argv[]) {
+  SFrameSizes s;
+  int frames = 300;
+  int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-threads")) threads = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-agents")) s.nAgents = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-bodies")) s.nBodies = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-drops")) s.nDrops = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-particles"))
+      s.nParticles = atoi(argv[i + 1]);
+  }
+
+  threads = std::max(threads, 1);
+  frames = std::max(frames, 1);
+  s.nAgents = std::max(s.nAgents, 0);
+  s.nBodies = std::max(s.nBodies, 1);
+  s.nDrops = std::max(s.nDrops, 0);
+  s.nParticles = std::max(s.nParticles, 2);
+
+  printf("%d bodies, %d agents, %d drops, %d particles, %d frames\n",
+         s.nBodies, s.nAgents, s.nDrops, s.nParticles, frames);
+
+  const SResult one = Run(s, 1, frames);
+  printf("work %.3f ms, critical path %.3f ms, best speedup x%.2f\n",
+         one.fWork, one.fCritical, one.fWork / std::max(one.fCritical, 1e-9));
+  printf("threads   mean ms  worst ms  speedup  efficiency\n");
+
+  for (int t = 1; t <= threads; ++t) {
+    const SResult r = t == 1 ? one : Run(s, (unsigned)t, frames);
+    const double speedup = one.fMean / std::max(r.fMean, 1e-9);
+    printf("%7d  %8.3f  %8.3f  %7.2f  %9.0f%%\n", t, r.fMean, r.fWorst,
+           speedup, 100.0 * speedup / t);
+  }
+
+  return 0;
+}  // FrameBench
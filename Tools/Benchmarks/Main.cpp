@@ -0,0 +1,155 @@
+/// \file Main.cpp
+/// \brief Benchmarks for the game's engine-independent systems.
+///
+/// Each benchmark runs the same code the game does on generated data, large
+/// enough to show how a system scales, and prints its timings. Build the
+/// Release configuration and run it from the solution directory:
+///
+///     Benchmarks <name> [options]
+///
+/// Run it with no arguments for the list of benchmarks.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Benchmarks.h"
+
+/// \brief A benchmark's name and entry point.
+struct SBenchmark {
+  const char* szName;                   ///< Name on the command line.
+  int (*pFunc)(int argc, char* argv[]); ///< Entry point.
+  const char* szHelp;                   ///< One line description.
+};
+
+/// Every benchmark.
+static const SBenchmark g_pBenchmarks[] = {
+  {"path", PathBench,
+   "path finding on a generated map [-w n] [-h n] [-agents n] [-targets n] "
+   "[-frames n]"},
+  {"crowd", CrowdBench,
+   "crowd of agents on a generated map [-w n] [-h n] [-agents n] [-frames n]"},
+  {"controller", ControllerBench,
+   "box2d and grid player controllers [-w n] [-h n] [-updates n] [-drops n]"},
+  {"simd", SimdBench,
+   "batch float kernels on every supported path [-n n] [-reps n]"},
+  {"save", SaveBench,
+   "save game write and read [-drops n] [-bullets n] [-reps n]"},
+  {"determinism", DeterminismBench,
+   "same input twice and threaded [-agents n] [-frames n] [-threads n] "
+   "[-inject n] [-a log -b log]"},
+  {"rollback", RollbackBench,
+   "rollback with a delayed loopback peer [-frames n] [-depth n] [-drops n] "
+   "[-jitter ms]"},
+  {"net", NetBench,
+   "dedicated server with local clients [-players n] [-ticks n] [-send n] "
+   "[-radius n] [-drops n]"},
+  {"players", PlayersBench,
+   "scripted players picking up drops [-players n] [-drops n] [-frames n] "
+   "[-w n] [-h n]"},
+  {"parallax", ParallaxBench,
+   "background layer spans over many cameras [-cameras n] [-range px] "
+   "[-view px]"},
+  {"anim", AnimBench,
+   "animated entities on every SIMD path [-entities n] [-frames n] "
+   "[-clips n] [-switch n]"},
+  {"particles", ParticleBench,
+   "particle pool kept full on every SIMD path [-particles n] [-frames n] "
+   "[-emitters n]"},
+  {"audio", AudioBench,
+   "headless mixer with a null device [-frames n] [-requests n] [-voices n] "
+   "[-music s]"},
+  {"camera", CameraBench,
+   "camera view, culling and following checks [-cameras n] [-sprites n] "
+   "[-frames n] [-area px]"},
+  {"collision", CollisionBench,
+   "heavy fire with and without collision layers [-players n] [-rate n] "
+   "[-frames n]"},
+  {"sprites", SpriteBench,
+   "sprite queue sorting into a mock renderer [-sprites n] [-textures n] "
+   "[-frames n]"},
+  {"frame", FrameBench,
+   "frame graph on 1 to n threads [-threads n] [-frames n] [-agents n] "
+   "[-bodies n] [-drops n] [-particles n]"},
+};
+
+/// Generate a map in horizontal bands 32 tiles high, one above the other.
+/// Each band's ground is a random walk in height, in steps of up to two
+/// tiles, as high as a player can jump, with the odd wall too high to jump
+/// and the odd pit down into the band below. Above the ground are stairs of
+/// floating platforms, each two rows above the last, which an agent can
+/// climb only by jumping from one to the next.
+/// \param w Width in tiles
+/// \param h Height in tiles
+/// \param seed Random seed
+/// \return One character per tile, row major, '1' is solid
+
+std::string GenerateMap(int w, int h, uint32_t seed) {
+  std::string tiles((size_t)w * h, '0');
+  std::mt19937 rng(seed);
+  auto set = [&](int x, int y) {
+    if (x > 0 && x < w - 1 && y > 0 && y < h) tiles[(size_t)y * w + x] = '1';
+  };
+
+  for (int y = 0; y < h; ++y) {
+    tiles[(size_t)y * w] = '1';
+    tiles[(size_t)y * w + w - 1] = '1';
+  }
+
+  const int band = 32;
+  std::vector<int> ground(w);
+
+  for (int y0 = 0; y0 + band <= h; y0 += band) {
+    const int y1 = y0 + band - 1;  // bottom row of the band
+    int top = y1 - 4;              // row of the ground surface
+
+    for (int x = 0; x < w;) {
+      const int len = 3 + (int)(rng() % 8);
+      const int kind = rng() % 32;
+      top += (int)(rng() % 5) - 2;
+      top = std::max(y0 + band / 2, std::min(y1 - 1, top));
+
+      for (int i = 0; i < len && x < w; ++i, ++x) {
+        ground[x] = top;
+        if (kind == 0 && i > 0 && i < 3) continue;  // pit
+        for (int y = top; y <= y1; ++y) set(x, y);
+        if (kind == 1 && i == 0)  // wall too high to jump
+          for (int y = top - 4; y < top; ++y) set(x, y);
+      }
+    }
+
+    for (int i = 0; i < w / 12; ++i) {
+      int x = 1 + (int)(rng() % (w - 2));
+      int y = ground[x] - 2;
+      const int dir = rng() % 2 ? 1 : -1;
+      const int steps = 1 + (int)(rng() % 6);
+
+      for (int k = 0; k < steps && y > y0 + 2; ++k, y -= 2) {
+        const int len = 3 + (int)(rng() % 5);
+        for (int j = 0; j < len; ++j) set(x + j, y);
+        x += dir * (len + 1 + (int)(rng() % 3));
+      }
+    }
+  }
+
+  return tiles;
+}
+
+/// Run the benchmark named on the command line.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 on success
+
+int main(int argc, char* argv[]) {
+  if (argc > 1)
+    for (const SBenchmark& b : g_pBenchmarks)
+      if (!strcmp(argv[1], b.szName)) return b.pFunc(argc - 1, argv + 1);
+
+  printf("Benchmarks <name> [options]\n");
+  for (const SBenchmark& b : g_pBenchmarks)
+    printf("  %-10s %s\n", b.szName, b.szHelp);
+
+  return 1;
+}
@@ -0,0 +1,464 @@
+/// \file NetBench.cpp
+/// \brief Dedicated server benchmark.
+///
+/// A headless server runs players on a generated map with CGridController,
+/// as the game's grid controller does, with bullets and items dropped in
+/// the world, and replicates them with CNetServer over UDP on this machine
+/// to one CNetClient per player, all in this process. Each client sends its
+/// scripted input every tick and acknowledges the snapshots it receives.
+///
+/// For each player count it reports the server's time per tick, split into
+/// reading packets, simulating and replicating, and the bandwidth sent to
+/// each client. For comparison it reports what client 0's snapshots would
+/// cost without deltas and without interest management. Every client's own
+/// player must arrive exactly as the server quantized it, and so must every
+/// entity near it when none were left out for the packet size limit.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "GridController.h"
+#include "Replication.h"
+#include "WorldHash.h"
+
+static const float g_fDt = 1.0f / 60.0f;   ///< Tick time.
+static const float g_fTile = 32.0f;        ///< Tile size in pixels.
+static const int g_nChunk = 16;            ///< Chunk size in tiles.
+static const float g_fHalfWidth = 0.4375f; ///< Player half width, as CPlayer.
+static const float g_fHeight = 1.5f;       ///< Player height, as CPlayer.
+
+/// \brief The server's world.
+class CServerSim {
+ private:
+  const std::string& m_strTiles; ///< Tile map.
+  int m_nWidth;                  ///< Map width in tiles.
+  int m_nHeight;                 ///< Map height in tiles.
+  uint32_t m_nNextId;            ///< Next bullet or drop id.
+
+  std::vector<CGridController> m_vPlayers; ///< Players, id is index + 1.
+  std::vector<float> m_vCoyote;  ///< Coyote timers.
+  std::vector<float> m_vFacing;  ///< Facing, 1 right or -1 left.
+
+  std::vector<uint32_t> m_vBulletId; ///< Bullet ids.
+  std::vector<float> m_vBulletX;     ///< Bullet positions x.
+  std::vector<float> m_vBulletY;     ///< Bullet positions y.
+  std::vector<float> m_vBulletVX;    ///< Bullet velocities x.
+  std::vector<float> m_vBulletLife;  ///< Bullet lifetimes.
+
+  std::vector<uint32_t> m_vDropId;   ///< Drop ids.
+  std::vector<float> m_vDropX;       ///< Drop positions x.
+  std::vector<float> m_vDropY;       ///< Drop positions y.
+  std::vector<float> m_vDropLife;    ///< Seconds left, forever if negative.
+  std::vector<uint16_t> m_vDropItem; ///< Item sprite.
+
+  /// Whether a tile stops bullets.
+  bool Solid(float x, float y) const {
+    const int c = (int)std::floor(x), r = (int)std::floor(y);
+    return c < 0 || c >= m_nWidth || r < 0 || r >= m_nHeight ||
+           m_strTiles[(size_t)r * m_nWidth + c] == '1';
+  }
+
+  /// Add a drop.
+  void Drop(float x, float y, float life, uint16_t item) {
+    m_vDropId.push_back(m_nNextId++);
+    m_vDropX.push_back(x);
+    m_vDropY.push_back(y);
+    m_vDropLife.push_back(life);
+    m_vDropItem.push_back(item);
+  }
+
+ public:
+  /// Put the players on the ground at random and scatter the drops, which
+  /// stay until the end.
+  CServerSim(const std::string& tiles, int w, int h, size_t players,
+             int drops)
+      : m_strTiles(tiles), m_nWidth(w), m_nHeight(h),
+        m_nNextId((uint32_t)players + 1),
+        m_vPlayers(players, CGridController(g_fHalfWidth, g_fHeight)),
+        m_vCoyote(players, 0.0f), m_vFacing(players, 1.0f) {
+    std::mt19937 rng(1);
+
+    for (CGridController& g : m_vPlayers) {
+      const int x = 2 + (int)(rng() % (w - 4));
+      int y = 1 + (int)(rng() % (h / 32)) * 32;  // top of a band
+      while (y < h - 1 && tiles[(size_t)(y + 1) * w + x] != '1') ++y;
+      g.SetMap(tiles.data(), w, h);
+      g.SetPos(x + 0.5f, (float)y + 1.0f);
+    }
+
+    for (int i = 0; i < drops; ++i)
+      Drop((float)(rng() % w) + 0.5f, (float)(rng() % h) + 0.5f, -1.0f,
+           (uint16_t)(9 + rng() % 6));
+  }
+
+  /// Run a tick: move the players as CPlayer::UpdateGrid() does, then fire,
+  /// drop items that vanish after a while, and move the bullets.
+  /// \param inputs One input per player
+  void Step(const std::vector<SPlayerInput>& inputs) {
+    for (size_t p = 0; p < m_vPlayers.size(); ++p) {
+      const SPlayerInput& in = inputs[p];
+      CGridController& g = m_vPlayers[p];
+
+      float target = 0.0f;
+      if (in.Has(eInput::Left)) target = -5.0f;
+      if (in.Has(eInput::Right)) target = 5.0f;
+      if (target != 0.0f) m_vFacing[p] = target > 0.0f ? 1.0f : -1.0f;
+
+      float vx = g.GetVelX(), vy = g.GetVelY();
+      vx += (target - vx) * 15.0f * g_fDt;
+      if (g.GetContacts().bGround) m_vCoyote[p] = 0.1f;
+      else m_vCoyote[p] -= g_fDt;
+      if (m_vCoyote[p] > 0.0f && in.Has(eInput::Jump)) {
+        m_vCoyote[p] = 0.0f;
+        vy = -7.0f;
+      }
+      g.SetVel(vx, vy + 9.8f * g_fDt);
+      g.Move(g_fDt, in.Has(eInput::Down));
+
+      if (in.Has(eInput::Shoot)) {
+        m_vBulletId.push_back(m_nNextId++);
+        m_vBulletX.push_back(g.GetX());
+        m_vBulletY.push_back(g.GetY() - 0.75f);
+        m_vBulletVX.push_back(15.0f * m_vFacing[p]);
+        m_vBulletLife.push_back(2.0f);
+      }
+
+      if (in.Has(eInput::Attack))
+        Drop(g.GetX() + 2.0f * m_vFacing[p], g.GetY() - 0.5f, 5.0f, 9);
+    }
+
+    size_t live = 0;
+    for (size_t i = 0; i < m_vBulletX.size(); ++i) {
+      const float x = m_vBulletX[i] + m_vBulletVX[i] * g_fDt;
+      const float life = m_vBulletLife[i] - g_fDt;
+      if (life <= 0.0f || Solid(x, m_vBulletY[i])) continue;
+      m_vBulletId[live] = m_vBulletId[i];
+      m_vBulletX[live] = x;
+      m_vBulletY[live] = m_vBulletY[i];
+      m_vBulletVX[live] = m_vBulletVX[i];
+      m_vBulletLife[live++] = life;
+    }
+    m_vBulletId.resize(live);
+    m_vBulletX.resize(live);
+    m_vBulletY.resize(live);
+    m_vBulletVX.resize(live);
+    m_vBulletLife.resize(live);
+
+    live = 0;
+    for (size_t i = 0; i < m_vDropX.size(); ++i) {
+      const float life = m_vDropLife[i] - g_fDt;
+      if (m_vDropLife[i] >= 0.0f && life < 0.0f) continue;
+      m_vDropId[live] = m_vDropId[i];
+      m_vDropX[live] = m_vDropX[i];
+      m_vDropY[live] = m_vDropY[i];
+      m_vDropItem[live] = m_vDropItem[i];
+      m_vDropLife[live++] = m_vDropLife[i] < 0.0f ? -1.0f : life;
+    }
+    m_vDropId.resize(live);
+    m_vDropX.resize(live);
+    m_vDropY.resize(live);
+    m_vDropItem.resize(live);
+    m_vDropLife.resize(live);
+  }
+
+  /// Get every entity in pixels, y up, as the game sees them.
+  /// \param out [out] Entities
+  void Gather(std::vector<SNetEntity>& out) const {
+    auto px = [&](float x, float y, SNetEntity& e) {
+      e.SetPos(x * g_fTile, (m_nHeight - y) * g_fTile);
+    };
+
+    out.clear();
+    SNetEntity e;
+
+    e.nType = (uint8_t)eNetEntity::Player;
+    e.nData = 100;
+    for (size_t p = 0; p < m_vPlayers.size(); ++p) {
+      const CGridController& g = m_vPlayers[p];
+      e.nId = (uint32_t)p + 1;
+      e.nFlags = m_vFacing[p] < 0.0f ? (uint8_t)eNetFlag::FacingLeft : 0;
+      px(g.GetX(), g.GetY(), e);
+      e.SetVel(g.GetVelX() * g_fTile, -g.GetVelY() * g_fTile);
+      out.push_back(e);
+    }
+
+    e = SNetEntity();
+    e.nType = (uint8_t)eNetEntity::Bullet;
+    for (size_t i = 0; i < m_vBulletX.size(); ++i) {
+      e.nId = m_vBulletId[i];
+      px(m_vBulletX[i], m_vBulletY[i], e);
+      e.SetVel(m_vBulletVX[i] * g_fTile, 0.0f);
+      out.push_back(e);
+    }
+
+    e = SNetEntity();
+    e.nType = (uint8_t)eNetEntity::Drop;
+    for (size_t i = 0; i < m_vDropX.size(); ++i) {
+      e.nId = m_vDropId[i];
+      e.nData = m_vDropItem[i];
+      px(m_vDropX[i], m_vDropY[i], e);
+      out.push_back(e);
+    }
+  }
+
+  /// Get a player's position in pixels, unquantized.
+  void GetPlayer(size_t p, float& x, float& y) const {
+    x = m_vPlayers[p].GetX() * g_fTile;
+    y = (m_nHeight - m_vPlayers[p].GetY()) * g_fTile;
+  }
+};
+
+/// Scripted input: each player runs one way for a while and then the other,
+/// and now and then jumps, shoots, drops an item or drops through a
+/// platform, at times that look random but are the same on every run.
+/// \param player Player
+/// \param frame Frame
+/// \return Input
+
+static SPlayerInput Script(uint32_t player, uint32_t frame) {
+  auto roll = [&](uint32_t salt) {
+    return (uint32_t)(HashValue(frame * 1024 + player, salt) >> 40) % 1000;
+  };
+
+  SPlayerInput in;
+  const uint64_t leg = HashValue((frame / 150) * 1024 + player);
+  in.Set(leg & 1 ? eInput::Left : eInput::Right);
+  if (roll(1) < 25) in.Set(eInput::Jump);
+  if (roll(2) < 30) in.Set(eInput::Shoot);
+  if (roll(3) < 5) in.Set(eInput::Attack);
+  if (roll(4) < 5) in.Set(eInput::Down);
+  return in;
+}
+
+/// \brief Size of a snapshot with every entity new.
+/// \param entities Entities
+/// \return Bytes, with UDP and IP headers
+static size_t FullSize(const std::vector<SNetEntity>& entities) {
+  std::vector<uint8_t> bytes;
+  CBitWriter w(bytes);
+  w.Write(0, 8 + 32 + 32 + 6);  // header and player id
+  for (const SNetEntity& e : entities) {
+    SNetEntity zero;
+    zero.nId = e.nId;
+    zero.nType = e.nType;
+    w.Write(1, 2);
+    w.WriteVar(1);
+    w.Write(e.nType, 3);
+    WriteEntityDelta(w, zero, e);
+  }
+  return w.GetBytes() + 28;
+}
+
+/// Run a server with one client per player for a number of ticks.
+/// \param tiles Tile map
+/// \param w Map width in tiles
+/// \param h Map height in tiles
+/// \param players Players
+/// \param ticks Ticks to run
+/// \param send Ticks per snapshot
+/// \param radius Chunks around a player to replicate
+/// \param drops Drops that stay
+/// \return True if every client saw its own player as the server sent it
+
+static bool Run(const std::string& tiles, int w, int h, size_t players,
+                uint32_t ticks, uint32_t send, int radius, int drops) {
+  CServerSim sim(tiles, w, h, players, drops);
+  CNetServer server;
+  if (!server.Open(0, players, true)) {
+    printf("cannot open the server socket\n");
+    return false;
+  }
+
+  const float chunk = g_nChunk * g_fTile;
+  server.SetInterest(chunk, (w + g_nChunk - 1) / g_nChunk,
+                     (h + g_nChunk - 1) / g_nChunk, radius);
+
+  SNetAddress addr;
+  addr.Set("127.0.0.1", server.GetPort());
+  std::vector<CNetClient> clients(players);
+  for (CNetClient& c : clients)
+    if (!c.Connect(addr, 0.0)) {
+      printf("cannot open a client socket\n");
+      return false;
+    }
+
+  double now = 0.0;
+  for (int tries = 0; tries < 100 && server.GetClientCount() < players;
+       ++tries, now += 1.0) {
+    for (CNetClient& c : clients) c.Poll(now);
+    server.Poll(now);
+    for (size_t slot : server.GetJoined())
+      server.SetPlayer(slot, (uint32_t)slot + 1);
+  }
+
+  for (CNetClient& c : clients) c.Poll(now);
+  if (server.GetClientCount() < players) {
+    printf("%zu of %zu clients joined\n", server.GetClientCount(), players);
+    return false;
+  }
+
+  std::vector<SPlayerInput> inputs(players);
+  std::vector<SNetEntity> world, query;
+  std::vector<uint32_t> indices;
+  CInterestGrid grid;
+  grid.Reset(chunk, (w + g_nChunk - 1) / g_nChunk,
+             (h + g_nChunk - 1) / g_nChunk);
+
+  double tPoll = 0.0, tSim = 0.0, tSend = 0.0, tWorst = 0.0;
+  uint64_t full = 0, all = 0, visible = 0, deferred = 0;
+  uint32_t snapshots = 0, mismatches = 0, fresh = 0;
+  float error = 0.0f;
+  CStopwatch sw;
+
+  for (uint32_t tick = 1; tick <= ticks; ++tick) {
+    now += 1000.0 * g_fDt;
+    for (size_t k = 0; k < players; ++k)
+      clients[k].SendInput(tick, Script((uint32_t)k, tick));
+
+    double t = 0.0;
+    sw.Restart();
+    server.Poll(now);
+    for (size_t p = 0; p < players; ++p) inputs[p] = server.TakeInput(p);
+    tPoll += sw.GetTime();
+    t += sw.GetTime();
+
+    sw.Restart();
+    sim.Step(inputs);
+    tSim += sw.GetTime();
+    t += sw.GetTime();
+
+    if (tick % send != 0) {
+      tWorst = std::max(tWorst, t);
+      continue;
+    }
+
+    sw.Restart();
+    sim.Gather(world);
+    server.Replicate(tick, world);
+    tSend += sw.GetTime();
+    t += sw.GetTime();
+    tWorst = std::max(tWorst, t);
+    ++snapshots;
+
+    for (size_t slot = 0; slot < players; ++slot)
+      deferred += server.GetStats(slot).nDeferred;
+
+    {  // what client 0's snapshot costs without deltas, and without interest
+      float x, y;
+      sim.GetPlayer(0, x, y);
+      grid.Build(world);
+      indices.clear();
+      grid.Query(x, y, radius, indices);
+      query.clear();
+      for (uint32_t i : indices) query.push_back(world[i]);
+      full += FullSize(query);
+      all += FullSize(world);
+      visible += query.size();
+    }
+
+    for (size_t k = 0; k < players; ++k) {
+      CNetClient& c = clients[k];
+      if (!c.Poll(now)) continue;
+      ++fresh;
+
+      const std::vector<SNetEntity>& view = c.GetView();
+      const uint32_t id = c.GetPlayerId();
+      auto it = std::lower_bound(
+          view.begin(), view.end(), id,
+          [](const SNetEntity& e, uint32_t n) { return e.nId < n; });
+      if (c.GetTick() != tick || it == view.end() || it->nId != id ||
+          *it != world[id - 1]) {
+        ++mismatches;
+        continue;
+      }
+
+      float x, y;
+      sim.GetPlayer(id - 1, x, y);
+      if (server.GetStats(id - 1).nDeferred == 0) {  // all of it, then
+        grid.Build(world);
+        indices.clear();
+        grid.Query(it->GetX(), it->GetY(), radius, indices);
+        query.clear();
+        for (uint32_t i : indices) query.push_back(world[i]);
+        std::sort(query.begin(), query.end(),
+                  [](const SNetEntity& a, const SNetEntity& b) {
+                    return a.nId < b.nId;
+                  });
+        if (query != view) ++mismatches;
+      }
+
+      error = std::max(error, std::max(std::fabs(it->GetX() - x),
+                                       std::fabs(it->GetY() - y)));
+    }
+  }
+
+  const double seconds = ticks * g_fDt;
+  uint64_t bytes = 0, most = 0;
+  for (size_t slot = 0; slot < players; ++slot) {
+    const uint64_t b = server.GetStats(slot).nBytes;
+    bytes += b;
+    most = std::max(most, b);
+  }
+
+  const double kbps = bytes / (double)players / seconds / 1024.0;
+  const double tick = (tPoll + tSim + tSend) / ticks;
+  printf("%7zu  %8zu  %7.1f  %8.2f  %8.2f  %7.3f  %6.3f  %7.3f  %7.3f\n",
+         players, world.size(), visible / (double)snapshots, kbps,
+         most / seconds / 1024.0, tPoll / ticks, tSim / ticks,
+         tSend / snapshots, tick);
+  printf("         client 0: delta %.2f kB/s, no delta %.2f kB/s, no "
+         "interest %.2f kB/s; worst tick %.3f ms\n",
+         server.GetStats(0).nBytes / seconds / 1024.0,
+         full / seconds / 1024.0, all / seconds / 1024.0, tWorst);
+  printf("         %u of %zu snapshots received, %llu entities deferred, "
+         "%u mismatched, most error %.4f px\n",
+         fresh, (size_t)snapshots * players, (unsigned long long)deferred,
+         mismatches, error);
+
+  for (CNetClient& c : clients) c.Close();
+  server.Close();
+  return mismatches == 0 && fresh == snapshots * players;
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if every client saw its own player as sent, else 1
+
+int NetBench(int argc, char* argv[]) {
+  int w = 512, h = 128, drops = 4000, radius = 1;
+  uint32_t ticks = 1200, send = 3;
+  size_t players = 0;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-w")) w = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-h")) h = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-players")) players = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-ticks")) ticks = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-send")) send = std::max(1, atoi(argv[i + 1]));
+    else if (!strcmp(argv[i], "-radius")) radius = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-drops")) drops = atoi(argv[i + 1]);
+  }
+
+  const std::string tiles = GenerateMap(w, h, 1);
+  printf("%dx%d map, %d drops, %u ticks at 60 Hz, snapshots at %.0f Hz, "
+         "radius %d chunks\n", w, h, drops, ticks, 60.0 / send, radius);
+  printf("players  entities  visible  kB/s avg  kB/s max  poll ms  sim ms  "
+         "send ms  tick ms\n");
+
+  bool ok = true;
+  for (size_t n : {(size_t)64, (size_t)256})
+    if (players == 0 || players == n)
+      ok = Run(tiles, w, h, n, ticks, send, radius, drops) && ok;
+  if (players != 0 && players != 64 && players != 256)
+    ok = Run(tiles, w, h, players, ticks, send, radius, drops);
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/// \file ParallaxBench.cpp
+/// \brief Parallax span benchmark.
+///
+/// Works out the copies of a background layer in view for a great many
+/// camera positions, far from the origin as well as near it, with the layers
+/// from gamesettings.xml and some awkward ones: fixed to the screen, fixed in
+/// the world, narrower than a tile and wider than the view. For every
+/// position it checks that the copies cover the view, that the first and
+/// last are actually in view, and that each copy meets the next with no
+/// seam. It times GetParallaxSpan() against the loop the game used to step
+/// across the view, which started a whole copy off screen on either side.
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Parallax.h"
+
+static volatile float g_fSink = 0.0f; ///< Keeps the timed loops' results.
+
+/// \brief A layer to test and what to call it.
+struct SCase {
+  const char* szName;    ///< Name in the table.
+  SParallaxLayer layer;  ///< Layer.
+};
+
+/// Make a layer.
+/// \param width Image width
+/// \param scale Horizontal scale
+/// \param scroll Scroll factor
+/// \param offset Horizontal offset
+/// \return Layer
+
+static SParallaxLayer Layer(float width, float scale, float scroll,
+                            float offset) {
+  SParallaxLayer layer;
+  layer.fWidth = width;
+  layer.fXScale = scale;
+  layer.fXScroll = scroll;
+  layer.fXOffset = offset;
+  return layer;
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if every span covers the view with no seams, else 1
+
+int ParallaxBench(int argc, char* argv[]) {
+  int cameras = 1000000;
+  float range = 1000000.0f, view = 1024.0f;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-cameras")) cameras = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-range")) range = (float)atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "-view")) view = (float)atof(argv[i + 1]);
+  }
+
+  cameras = std::max(cameras, 1);
+  const float halfView = view / 2.0f;
+
+  const SCase cases[] = {
+    {"chapel", Layer(1024.0f, 1.39f, 0.1f, -210.0f)},
+    {"sky", Layer(1024.0f, 1.39f, 0.25f, -210.0f)},
+    {"screen", Layer(1024.0f, 1.0f, 0.0f, 0.0f)},
+    {"world", Layer(1024.0f, 1.0f, 1.0f, 0.0f)},
+    {"narrow", Layer(37.0f, 0.9f, 0.5f, 13.0f)},
+    {"wide", Layer(4096.0f, 1.0f, 0.7f, -1000.0f)},
+  };
+
+  printf("%d cameras within %.0f px, view %.0f px\n", cameras, range, view);
+  printf("layer    copies  stepped  span ns  loop ns  max seam  result\n");
+
+  bool ok = true;
+  for (const SCase& c : cases) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> u(-range, range);
+    std::vector<float> cams(cameras);
+    for (float& x : cams) x = u(rng);
+    cams[0] = 0.0f;
+
+    size_t copies = 0, stepped = 0;
+    float seam = 0.0f;
+    bool good = true;
+
+    // check every span
+    for (float cam : cams) {
+      const SParallaxSpan s = GetParallaxSpan(c.layer, cam, halfView);
+      const float half = s.fStep / 2.0f;
+      const float tol = 8.0f * FLT_EPSILON *
+                        (std::fabs(s.fOrigin) + std::fabs(cam) + halfView +
+                         s.fStep);
+      const float left = cam - halfView, right = cam + halfView;
+      const int last = s.nFirst + s.nCount - 1;
+      copies += s.nCount;
+
+      good = good && s.nCount > 0 &&
+             s.GetX(s.nFirst) - half <= left + tol &&  // covers the view
+             s.GetX(last) + half >= right - tol &&
+             s.GetX(s.nFirst) + half >= left - tol &&  // and no more
+             s.GetX(last) - half <= right + tol;
+
+      for (int k = s.nFirst; k < last; ++k) {
+        const float gap = std::fabs((s.GetX(k + 1) - half) -
+                                    (s.GetX(k) + half));
+        seam = std::max(seam, gap);
+        good = good && gap <= tol;
+      }
+    }
+
+    // time the span against the old loop
+    float sum = 0.0f;
+    CStopwatch sw;
+    for (float cam : cams) {
+      const SParallaxSpan s = GetParallaxSpan(c.layer, cam, halfView);
+      for (int k = s.nFirst; k < s.nFirst + s.nCount; ++k) sum += s.GetX(k);
+    }
+    const double span = sw.GetTime();
+
+    sw.Restart();
+    const float step = c.layer.fWidth * c.layer.fXScale;
+    for (float cam : cams) {
+      const float start = cam - halfView - step;
+      for (float x = start; x < cam + halfView + step; x += step) {
+        sum += x + step / 2.0f;
+        ++stepped;
+      }
+    }
+    const double loop = sw.GetTime();
+    g_fSink = sum;
+
+    ok = ok && good;
+    printf("%-7s  %6.2f  %7.2f  %7.1f  %7.1f  %8.4f  %s\n", c.szName,
+           (double)copies / cameras, (double)stepped / cameras,
+           1e6 * span / cameras, 1e6 * loop / cameras, seam,
+           good ? "ok" : "FAILED");
+  }
+
+  return ok ? 0 : 1;
+}  // ParallaxBench
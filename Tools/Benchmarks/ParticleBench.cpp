@@ -0,0 +1,213 @@
+/// \file ParticleBench.cpp
+/// \brief Particle benchmark.
+///
+/// A pool of particles, a million by default, is kept full for a number of
+/// frames: every frame each particle is moved under its emitter's gravity
+/// and aged, the dead ones are removed, and new bursts are emitted at random
+/// points until every emitter's slab is full again. It is run with
+/// CParticles on every SIMD path the machine has, and with a vector of
+/// particle structs removed with `std::remove_if()`, which is how it is
+/// usually first written. The CParticles paths must end with the same
+/// particles. Their order in a slab does not matter, so the checksum adds
+/// up the bits of every position and is the same in any order.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Particles.h"
+#include "SimdKernels.h"
+
+static const float g_fDt = 1.0f / 60.0f; ///< Frame time.
+static const float g_fArea = 4096.0f;    ///< Width and height of the world.
+
+/// \brief A particle, the usual way, for comparison.
+struct SNaiveParticle {
+  float fX, fY;       ///< Position.
+  float fVX, fVY;     ///< Velocity.
+  float fLife;        ///< Seconds left.
+  uint32_t nEmitter;  ///< Emitter, for its gravity.
+};
+
+/// Make emitters that share the pool equally.
+/// \param n Number of emitters
+/// \param particles Pool size
+/// \return Emitters
+
+static std::vector<SParticleEmitter> MakeEmitters(int n, int particles) {
+  std::vector<SParticleEmitter> emitters(n);
+  for (int e = 0; e < n; ++e) {
+    SParticleEmitter& em = emitters[e];
+    em.strName = "emitter" + std::to_string(e);
+    em.nMax = (uint32_t)(particles / n + (e < particles % n ? 1 : 0));
+    em.nCount = 64;
+    em.fLifeMin = 0.25f + 0.25f * e;
+    em.fLifeMax = em.fLifeMin * 4.0f;
+    em.fGravity = -200.0f * e;
+  }
+  return emitters;
+}
+
+/// Add up the bits of every position of the live particles.
+/// \param p Particle pool
+/// \return Checksum
+
+static uint64_t Checksum(const CParticles& p) {
+  uint64_t sum = 0;
+  for (uint32_t e = 0; e < (uint32_t)p.GetEmitterCount(); ++e)
+    for (uint32_t i = p.GetBase(e); i < p.GetBase(e) + p.GetCount(e); ++i) {
+      uint32_t x, y;
+      memcpy(&x, p.GetX() + i, sizeof(x));
+      memcpy(&y, p.GetY() + i, sizeof(y));
+      sum += x + (uint64_t)y;
+    }
+  return sum;
+}
+
+/// Run CParticles on the current path.
+/// \param emitters Emitters
+/// \param frames Frames to run
+/// \param sum [out] Checksum of the particles after the last frame
+/// \param emitted [out] Particles emitted per frame, on average
+/// \return Time per frame in ms
+
+static double RunSoA(const std::vector<SParticleEmitter>& emitters, int frames,
+                     uint64_t& sum, double& emitted) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> pos(0.0f, g_fArea);
+
+  CParticles p;
+  p.SetEmitters(emitters);
+  size_t total = 0;
+  double t = 0.0;
+
+  for (int f = 0; f <= frames; ++f) {
+    CStopwatch sw;
+    if (f > 0) p.Update(g_fDt);  // frame 0 only fills the pool
+
+    for (uint32_t e = 0; e < (uint32_t)emitters.size(); ++e)
+      while (p.GetCount(e) < emitters[e].nMax) {
+        const float x = pos(rng), y = pos(rng);
+        const uint32_t n = p.Emit(e, x, y);
+        if (f > 0) total += n;
+      }
+
+    if (f > 0) t += sw.GetTime();
+  }
+
+  sum = Checksum(p);
+  emitted = (double)total / frames;
+  return t / frames;
+}  // RunSoA
+
+/// Run a vector of particle structs and print its row. Bursts are the same
+/// as CParticles's, but the particles come from a generator of their own.
+/// \param emitters Emitters
+/// \param frames Frames to run
+/// \param particles Pool size
+
+static void RunNaive(const std::vector<SParticleEmitter>& emitters,
+                     int frames, int particles) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> pos(0.0f, g_fArea);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  std::vector<SNaiveParticle> v;
+  v.reserve(particles);
+  std::vector<uint32_t> count(emitters.size());
+  double t = 0.0;
+
+  for (int f = 0; f <= frames; ++f) {
+    CStopwatch sw;
+    if (f > 0) {
+      for (SNaiveParticle& q : v) {
+        q.fVY += emitters[q.nEmitter].fGravity * g_fDt;
+        q.fX += q.fVX * g_fDt;
+        q.fY += q.fVY * g_fDt;
+        q.fLife -= g_fDt;
+      }
+
+      v.erase(std::remove_if(v.begin(), v.end(),
+                             [&](const SNaiveParticle& q) {
+                               if (q.fLife > 0.0f) return false;
+                               --count[q.nEmitter];
+                               return true;
+                             }),
+              v.end());
+    }
+
+    for (uint32_t e = 0; e < (uint32_t)emitters.size(); ++e) {
+      const SParticleEmitter& em = emitters[e];
+      while (count[e] < em.nMax) {
+        const float x = pos(rng), y = pos(rng);
+        const uint32_t n = std::min(em.nCount, em.nMax - count[e]);
+        for (uint32_t k = 0; k < n; ++k) {
+          const float a = em.fAngle + (unit(rng) - 0.5f) * em.fSpread;
+          const float s =
+              em.fSpeedMin + unit(rng) * (em.fSpeedMax - em.fSpeedMin);
+          const float life =
+              em.fLifeMin + unit(rng) * (em.fLifeMax - em.fLifeMin);
+          v.push_back({x, y, std::cos(a) * s, std::sin(a) * s, life, e});
+        }
+        count[e] += n;
+      }
+    }
+
+    if (f > 0) t += sw.GetTime();
+  }
+
+  printf("struct   %8.3f  %8.2f\n", t / frames, 1e6 * t / frames / v.size());
+}  // RunNaive
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if every path ends with the same particles, else 1
+
+int ParticleBench(int argc, char* argv[]) {
+  int particles = 1000000, frames = 300, emitters = 4;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-particles")) particles = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-emitters")) emitters = atoi(argv[i + 1]);
+  }
+
+  emitters = std::max(emitters, 1);
+  particles = std::max(particles, emitters);
+  frames = std::max(frames, 1);
+
+  const std::vector<SParticleEmitter> table = MakeEmitters(emitters, particles);
+  printf("%d particles in %d emitters, %d frames\n", particles, emitters,
+         frames);
+  printf("update   ms/frame  ns/particle  emitted/frame  checksum\n");
+
+  const eSimdPath best = GetBestSimdPath();
+  uint64_t first = 0;
+  bool ok = true;
+
+  for (int p = 0; p <= (int)best; ++p) {
+    SetSimdPath((eSimdPath)p);
+    uint64_t sum;
+    double emitted;
+    const double t = RunSoA(table, frames, sum, emitted);
+
+    if (p == 0) first = sum;
+    const bool same = sum == first;
+    ok = ok && same;
+
+    printf("%-7s  %8.3f  %11.2f  %13.0f  %016llx%s\n",
+           GetSimdPathName((eSimdPath)p), t, 1e6 * t / particles, emitted,
+           (unsigned long long)sum, same ? "" : "  DIFFERS");
+  }
+
+  SetSimdPath(best);
+  RunNaive(table, frames, particles);
+  return ok ? 0 : 1;
+}  // ParticleBench
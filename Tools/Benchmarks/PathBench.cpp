@@ -0,0 +1,162 @@
+/// \file PathBench.cpp
+/// \brief Path finding benchmark.
+///
+/// Builds the navigation graph of a large generated map and times three
+/// loads on the path service: random requests with nothing cached, a crowd
+/// of agents chasing a few targets over many frames, and the same crowd with
+/// the cache flushed every frame to show what the cache saves. Most random
+/// pairs on a generated map are not connected, since walls, pits and drops
+/// are one way, so that row mostly measures how fast the region graph
+/// rejects them. Agents in the crowd always start where they can reach
+/// their target.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "JobSystem.h"
+#include "NavGraph.h"
+#include "PathService.h"
+
+/// Print the service's counters since a snapshot.
+/// \param label Row label
+/// \param paths Path service
+/// \param queries Query count at the snapshot
+/// \param hits Cache hit count at the snapshot
+/// \param searches Search count at the snapshot
+/// \param expanded Expansion count at the snapshot
+/// \param ms Wall time in ms
+
+static void Report(const char* label, const CPathService& paths,
+                   uint64_t queries, uint64_t hits, uint64_t searches,
+                   uint64_t expanded, double ms) {
+  const uint64_t q = paths.GetQueryCount() - queries;
+  const uint64_t s = paths.GetSearchCount() - searches;
+  const uint64_t e = paths.GetExpandedCount() - expanded;
+
+  printf("%-8s %9llu req %9.1f ms %10.0f req/s %5.1f%% cached "
+         "%5.0f exp/search\n",
+         label, (unsigned long long)q, ms, q * 1000.0 / ms,
+         100.0 * (paths.GetCacheHits() - hits) / (q ? q : 1),
+         s ? (double)e / s : 0.0);
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 on success
+
+int PathBench(int argc, char* argv[]) {
+  int w = 2048, h = 256, agents = 10000, targets = 16, frames = 60;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-w")) w = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-h")) h = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-agents")) agents = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-targets")) targets = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+  }
+
+  const std::string tiles = GenerateMap(w, h, 1234);
+
+  CNavGraph graph;
+  CStopwatch timer;
+  graph.Build(tiles.data(), w, h);
+  printf("graph    %dx%d tiles, %d nodes, %d edges, %d regions, %.1f ms\n", w,
+         h, graph.GetNodeCount(), graph.GetEdgeCount(),
+         graph.GetRegionCount(), timer.GetTime());
+
+  const int nodes = graph.GetNodeCount();
+  if (nodes == 0) return 1;
+
+  CJobSystem jobs;
+  CPathService paths(&graph);
+  std::mt19937 rng(42);
+  printf("threads  %u\n", jobs.GetThreadCount());
+
+  auto snapshot = [&](uint64_t* p) {
+    p[0] = paths.GetQueryCount();
+    p[1] = paths.GetCacheHits();
+    p[2] = paths.GetSearchCount();
+    p[3] = paths.GetExpandedCount();
+  };
+
+  uint64_t s[4];
+
+  // random requests, nothing cached
+
+  snapshot(s);
+  for (int i = 0; i < agents; ++i) paths.Request(rng() % nodes, rng() % nodes);
+  timer.Restart();
+  paths.Dispatch(&jobs);
+  paths.Collect(&jobs);
+  Report("random", paths, s[0], s[1], s[2], s[3], timer.GetTime());
+
+  int found = 0;
+  for (int i = 0; i < agents; ++i) found += paths.GetResult(i).bFound;
+  printf("         %.1f%% of random pairs are connected\n",
+         100.0 * found / agents);
+
+  // agents start where they can reach their target, found by searching
+  // backward from each target
+
+  std::vector<std::vector<int>> back(nodes);
+  for (int n = 0; n < nodes; ++n)
+    for (const SNavEdge* e = graph.EdgesBegin(n); e != graph.EdgesEnd(n); ++e)
+      back[e->nTo].push_back(n);
+
+  auto spawn = [&](std::vector<int>& pos, std::vector<int>& goal) {
+    for (int t = 0; t < targets; ++t) {
+      goal[t] = rng() % nodes;
+      std::vector<int> reach(1, goal[t]);
+      std::vector<char> seen(nodes, 0);
+      seen[goal[t]] = 1;
+      for (size_t i = 0; i < reach.size(); ++i)
+        for (int n : back[reach[i]])
+          if (!seen[n]) {
+            seen[n] = 1;
+            reach.push_back(n);
+          }
+      for (int i = t; i < agents; i += targets)
+        pos[i] = reach[rng() % reach.size()];
+    }
+  };
+
+  // a crowd chasing targets that wander, with and without the cache
+
+  for (int pass = 0; pass < 2; ++pass) {
+    const bool cached = pass == 0;
+    std::vector<int> pos(agents), goal(targets);
+    spawn(pos, goal);
+
+    paths.Invalidate();
+    snapshot(s);
+    timer.Restart();
+
+    for (int f = 0; f < frames; ++f) {
+      if (!cached) paths.Invalidate();
+
+      for (int i = 0; i < agents; ++i) paths.Request(pos[i], goal[i % targets]);
+      paths.Dispatch(&jobs);
+      paths.Collect(&jobs);
+
+      for (int i = 0; i < agents; ++i) {  // everyone takes a step
+        const SPathResult& r = paths.GetResult(i);
+        if (r.bFound && r.vSteps.size() > 1) pos[i] = r.vSteps[1].nNode;
+      }
+
+      if (f % 10 == 9)  // targets move every few frames
+        for (int& g : goal)
+          if (graph.EdgesBegin(g) != graph.EdgesEnd(g))
+            g = graph.EdgesBegin(g)->nTo;
+    }
+
+    Report(cached ? "chase" : "uncached", paths, s[0], s[1], s[2], s[3],
+           timer.GetTime());
+  }
+
+  return 0;
+}
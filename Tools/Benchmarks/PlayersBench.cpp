@@ -0,0 +1,211 @@
+/// \file PlayersBench.cpp
+/// \brief Many players benchmark.
+///
+/// Scripted players, 256 by default, run on one generated map with
+/// CGridController among a field of drops, with the input that CGame gives
+/// the players nobody plays. Every frame each player picks up the drops in
+/// reach, as CDropManager::Collect() does, and each drop picked up is put
+/// back somewhere else at random, so that the field stays the same size.
+///
+/// The pickups are found two ways on the same state every frame: with
+/// CPickupGrid, rebuilt whenever a drop moved, and with a loop over every
+/// drop for every player, which is what one player's pickup loop becomes
+/// with many players. Both must give the same drops to the same players in
+/// the same order. It reports the time per frame to move the players and to
+/// find the pickups each way, for a growing number of players.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "GridController.h"
+#include "PickupGrid.h"
+#include "Rollback.h"
+
+static const float g_fDt = 1.0f / 60.0f;   ///< Frame time.
+static const float g_fHalfWidth = 0.4375f; ///< Player half width, as CPlayer.
+static const float g_fHeight = 1.5f;       ///< Player height, as CPlayer.
+static const float g_fReach = 1.5f; ///< Player radius and pickup radius.
+
+/// Scripted input, as CPlayer::ScriptInput().
+/// \param seed Player
+/// \param frame Frame
+/// \return Input
+
+static SPlayerInput Script(uint32_t seed, uint32_t frame) {
+  const uint32_t h = (seed + 1) * 2654435761u;
+  const uint32_t period = 120 + h % 120;
+  const uint32_t t = frame + (h >> 8) % period;
+
+  SPlayerInput input;
+  input.Set(t / period % 2 ? eInput::Left : eInput::Right);
+  if (t % 45 == (h >> 16) % 45) input.Set(eInput::Jump);
+  if (t % 90 == (h >> 20) % 90) input.Set(eInput::Shoot);
+  return input;
+}
+
+/// \brief The result of one run.
+struct SRun {
+  double fMove = 0.0;  ///< Time moving players in ms.
+  double fGrid = 0.0;  ///< Time finding pickups with the grid in ms.
+  double fLoop = 0.0;  ///< Time finding pickups with the loop in ms.
+  size_t nPickups = 0; ///< Drops picked up.
+  bool bSame = true;   ///< Both ways found the same pickups every frame.
+};
+
+/// Run the players for a number of frames.
+/// \param tiles Tile map
+/// \param w Map width in tiles
+/// \param h Map height in tiles
+/// \param players Number of players
+/// \param drops Number of drops
+/// \param frames Frames to run
+/// \return Result
+
+static SRun Run(const std::string& tiles, int w, int h, int players,
+                int drops, uint32_t frames) {
+  std::vector<CGridController> grid(players, {g_fHalfWidth, g_fHeight});
+  std::vector<float> coyote(players, 0.0f);
+  std::vector<float> px(players), py(players);  // pickup centers
+
+  for (int p = 0; p < players; ++p) {  // on the ground, spread out
+    const int x = 2 + (int)((int64_t)p * (w - 4) / players);
+    int floor = 1;
+    while (floor < h && tiles[(size_t)floor * w + x] != '1') ++floor;
+    grid[p].SetMap(tiles.data(), w, h);
+    grid[p].SetPos(x + 0.5f, (float)floor);
+  }
+
+  std::mt19937 rng(1);
+  std::vector<float> xy(2 * drops);
+  for (int i = 0; i < drops; ++i) {
+    xy[2 * i] = 1.0f + (float)(rng() % (1000 * (w - 2))) / 1000.0f;
+    xy[2 * i + 1] = (float)(rng() % (1000 * h)) / 1000.0f;
+  }
+
+  CPickupGrid pickups;
+  pickups.Reset(g_fReach, (int)std::ceil(w / g_fReach),
+                (int)std::ceil(h / g_fReach));
+  bool dirty = true;
+
+  std::vector<uint8_t> taken(drops, 0);
+  std::vector<uint32_t> reach;
+  std::vector<std::pair<int, uint32_t>> byGrid, byLoop;  // player, drop
+  SRun run;
+
+  for (uint32_t f = 0; f < frames; ++f) {
+    CStopwatch sw;
+    for (int p = 0; p < players; ++p) {  // as CPlayer::UpdateGrid()
+      const SPlayerInput in = Script(p, f);
+      CGridController& g = grid[p];
+
+      float target = 0.0f;
+      if (in.Has(eInput::Left)) target = -5.0f;
+      if (in.Has(eInput::Right)) target = 5.0f;
+
+      float vx = g.GetVelX(), vy = g.GetVelY();
+      vx += (target - vx) * 15.0f * g_fDt;
+      if (g.GetContacts().bGround) coyote[p] = 0.1f;
+      else coyote[p] -= g_fDt;
+      if (coyote[p] > 0.0f && in.Has(eInput::Jump)) {
+        coyote[p] = 0.0f;
+        vy = -7.0f;
+      }
+      g.SetVel(vx, vy + 9.8f * g_fDt);
+      g.Move(g_fDt, in.Has(eInput::Down));
+
+      px[p] = g.GetX();
+      py[p] = g.GetY() - g_fHeight * 0.5f;
+    }
+    run.fMove += sw.GetTime();
+
+    sw.Restart();  // as CDropManager::Collect()
+    if (dirty) pickups.Build(xy.data(), drops);
+    byGrid.clear();
+    for (int p = 0; p < players; ++p) {
+      reach.clear();
+      pickups.Query(px[p], py[p], g_fReach, reach);
+      std::sort(reach.begin(), reach.end());
+      for (uint32_t i : reach)
+        if (!taken[i]) {
+          taken[i] = 1;
+          byGrid.push_back({p, i});
+        }
+    }
+    run.fGrid += sw.GetTime();
+
+    for (const auto& t : byGrid) taken[t.second] = 0;
+
+    sw.Restart();  // every drop for every player
+    byLoop.clear();
+    const float r2 = g_fReach * g_fReach;
+    for (int p = 0; p < players; ++p)
+      for (int i = 0; i < drops; ++i) {
+        const float dx = xy[2 * i] - px[p], dy = xy[2 * i + 1] - py[p];
+        if (!taken[i] && dx * dx + dy * dy <= r2) {
+          taken[i] = 1;
+          byLoop.push_back({p, (uint32_t)i});
+        }
+      }
+    run.fLoop += sw.GetTime();
+
+    run.bSame = run.bSame && byGrid == byLoop;
+    run.nPickups += byGrid.size();
+
+    for (const auto& t : byLoop) {  // put them back somewhere else
+      taken[t.second] = 0;
+      xy[2 * t.second] = 1.0f + (float)(rng() % (1000 * (w - 2))) / 1000.0f;
+      xy[2 * t.second + 1] = (float)(rng() % (1000 * h)) / 1000.0f;
+    }
+    dirty = !byLoop.empty();
+  }
+
+  return run;
+}  // Run
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if the grid and the loop always agree, else 1
+
+int PlayersBench(int argc, char* argv[]) {
+  int w = 512, h = 128, players = 256, drops = 20000;
+  uint32_t frames = 600;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-w")) w = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-h")) h = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-players")) players = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-drops")) drops = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+  }
+
+  players = std::max(players, 1);
+  drops = std::max(drops, 0);
+  const std::string tiles = GenerateMap(w, h, 1);
+  printf("%dx%d map, %d drops, %u frames\n", w, h, drops, frames);
+  printf("players  move ms  grid us  loop us  speedup  pickups  result\n");
+
+  std::vector<int> counts;
+  for (int n = 1; n < players; n *= 4) counts.push_back(n);
+  counts.push_back(players);
+
+  bool ok = true;
+  for (int n : counts) {
+    const SRun r = Run(tiles, w, h, n, drops, frames);
+    ok = ok && r.bSame;
+    printf("%7d  %7.3f  %7.1f  %7.1f  %6.1fx  %7zu  %s\n", n,
+           r.fMove / frames, 1000.0 * r.fGrid / frames,
+           1000.0 * r.fLoop / frames, r.fLoop / std::max(r.fGrid, 1e-9),
+           r.nPickups, r.bSame ? "same" : "DIFFERS");
+  }
+
+  return ok ? 0 : 1;
+}
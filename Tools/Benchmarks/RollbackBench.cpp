@@ -0,0 +1,365 @@
+/// \file RollbackBench.cpp
+/// \brief Rollback benchmark.
+///
+/// Two players run on a generated map with CGridController, shooting
+/// bullets and dropping items that either of them can pick up, among a
+/// field of items already dropped. Player 0's input is local. Player 1's
+/// comes through CLoopbackPeer with a delay and jitter, so CRollback
+/// predicts it and rolls back when it arrives. Both inputs are scripted.
+///
+/// For each delay it reports how often the game rolled back, how far, and
+/// how often it had to stall because player 1 was more than the rollback
+/// depth behind. Once every input has arrived, the state must be the same
+/// as a run where both inputs were known at once. The time to simulate
+/// again is reported by rollback depth over every run, with the time to
+/// save and load a snapshot.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "GridController.h"
+#include "Rollback.h"
+#include "WorldHash.h"
+
+static const float g_fDt = 1.0f / 60.0f;   ///< Frame time.
+static const float g_fHalfWidth = 0.4375f; ///< Player half width, as CPlayer.
+static const float g_fHeight = 1.5f;       ///< Player height, as CPlayer.
+
+/// \brief Everything a frame changes. Copying it into a snapshot that has
+/// been used before reuses its arrays, so it does not allocate.
+struct SState {
+  CGridController player[2] = {{g_fHalfWidth, g_fHeight},
+                               {g_fHalfWidth, g_fHeight}}; ///< Players.
+  float fCoyote[2] = {};   ///< Coyote timers.
+  float fFacing[2] = {1.0f, 1.0f}; ///< Facing, 1 right or -1 left.
+  uint32_t nScore[2] = {}; ///< Items picked up.
+
+  std::vector<float> vBulletX;    ///< Bullet positions x.
+  std::vector<float> vBulletY;    ///< Bullet positions y.
+  std::vector<float> vBulletVX;   ///< Bullet velocities x.
+  std::vector<float> vBulletLife; ///< Bullet lifetimes.
+
+  std::vector<float> vDropX;     ///< Drop positions x.
+  std::vector<float> vDropY;     ///< Drop positions y.
+  std::vector<float> vDropTimer; ///< Seconds since dropped.
+};
+
+/// \brief The game, as CRollback sees it.
+class CRollbackSim {
+ private:
+  const std::string& m_strTiles; ///< Tile map.
+  int m_nWidth;                  ///< Map width in tiles.
+  SState m_state;                ///< Current state.
+  std::vector<SState> m_vRing;   ///< Snapshots by frame.
+
+  /// Whether a tile stops bullets.
+  bool Solid(float x, float y) const {
+    const int c = (int)std::floor(x), r = (int)std::floor(y);
+    const int h = (int)m_strTiles.size() / m_nWidth;
+    return c < 0 || c >= m_nWidth || r < 0 || r >= h ||
+           m_strTiles[(size_t)r * m_nWidth + c] == '1';
+  }
+
+ public:
+  /// Put both players on the ground near the left and scatter the drops.
+  CRollbackSim(const std::string& tiles, int w, int h, int drops,
+               uint32_t depth)
+      : m_strTiles(tiles), m_nWidth(w), m_vRing(depth + 1) {
+    for (int p = 0; p < 2; ++p) {
+      const int x = 8 + 4 * p;
+      int floor = 1;
+      while (floor < h && tiles[(size_t)floor * w + x] != '1') ++floor;
+      m_state.player[p].SetMap(tiles.data(), w, h);
+      m_state.player[p].SetPos(x + 0.5f, (float)floor);
+    }
+
+    std::mt19937 rng(1);
+    for (int i = 0; i < drops; ++i) {
+      m_state.vDropX.push_back((float)(rng() % w) + 0.5f);
+      m_state.vDropY.push_back((float)(rng() % h) + 0.5f);
+      m_state.vDropTimer.push_back(1.0f);
+    }
+  }
+
+  void Save(uint32_t frame) { m_vRing[frame % m_vRing.size()] = m_state; }
+  void Load(uint32_t frame) { m_state = m_vRing[frame % m_vRing.size()]; }
+
+  /// Run a frame: move the players as CPlayer::UpdateGrid() does, then
+  /// fire, drop, move the bullets and pick up drops. Attack drops an item.
+  /// \param inputs One input per player
+  void Step(const SPlayerInput* inputs) {
+    SState& s = m_state;
+
+    for (int p = 0; p < 2; ++p) {
+      const SPlayerInput& in = inputs[p];
+      CGridController& g = s.player[p];
+
+      float target = 0.0f;
+      if (in.Has(eInput::Left)) target = -5.0f;
+      if (in.Has(eInput::Right)) target = 5.0f;
+      if (target != 0.0f) s.fFacing[p] = target > 0.0f ? 1.0f : -1.0f;
+
+      float vx = g.GetVelX(), vy = g.GetVelY();
+      vx += (target - vx) * 15.0f * g_fDt;
+      if (g.GetContacts().bGround) s.fCoyote[p] = 0.1f;
+      else s.fCoyote[p] -= g_fDt;
+      if (s.fCoyote[p] > 0.0f && in.Has(eInput::Jump)) {
+        s.fCoyote[p] = 0.0f;
+        vy = -7.0f;
+      }
+      g.SetVel(vx, vy + 9.8f * g_fDt);
+      g.Move(g_fDt, in.Has(eInput::Down));
+
+      if (in.Has(eInput::Shoot)) {
+        s.vBulletX.push_back(g.GetX());
+        s.vBulletY.push_back(g.GetY() - 0.75f);
+        s.vBulletVX.push_back(15.0f * s.fFacing[p]);
+        s.vBulletLife.push_back(2.0f);
+      }
+
+      if (in.Has(eInput::Attack)) {
+        s.vDropX.push_back(g.GetX() + 2.0f * s.fFacing[p]);
+        s.vDropY.push_back(g.GetY() - 0.5f);
+        s.vDropTimer.push_back(0.0f);
+      }
+    }
+
+    size_t live = 0;
+    for (size_t i = 0; i < s.vBulletX.size(); ++i) {
+      const float x = s.vBulletX[i] + s.vBulletVX[i] * g_fDt;
+      const float life = s.vBulletLife[i] - g_fDt;
+      if (life <= 0.0f || Solid(x, s.vBulletY[i])) continue;
+      s.vBulletX[live] = x;
+      s.vBulletY[live] = s.vBulletY[i];
+      s.vBulletVX[live] = s.vBulletVX[i];
+      s.vBulletLife[live++] = life;
+    }
+    s.vBulletX.resize(live);
+    s.vBulletY.resize(live);
+    s.vBulletVX.resize(live);
+    s.vBulletLife.resize(live);
+
+    live = 0;
+    for (size_t i = 0; i < s.vDropX.size(); ++i) {
+      const float t = s.vDropTimer[i] + g_fDt;
+      bool taken = false;
+      for (int p = 0; p < 2 && !taken && t > 0.25f; ++p) {
+        const float dx = s.vDropX[i] - s.player[p].GetX();
+        const float dy = s.vDropY[i] - (s.player[p].GetY() - 0.75f);
+        if (dx * dx + dy * dy < 1.0f) {
+          ++s.nScore[p];
+          taken = true;
+        }
+      }
+      if (taken) continue;
+      s.vDropX[live] = s.vDropX[i];
+      s.vDropY[live] = s.vDropY[i];
+      s.vDropTimer[live++] = t;
+    }
+    s.vDropX.resize(live);
+    s.vDropY.resize(live);
+    s.vDropTimer.resize(live);
+  }
+
+  /// Hash the whole state.
+  uint64_t Hash() const {
+    const SState& s = m_state;
+    uint64_t h = g_nHashSeed;
+    for (int p = 0; p < 2; ++p) {
+      const float f[] = {s.player[p].GetX(), s.player[p].GetY(),
+                         s.player[p].GetVelX(), s.player[p].GetVelY(),
+                         s.fCoyote[p], s.fFacing[p]};
+      h = HashValue(f, h);
+      h = HashValue(s.nScore[p], h);
+    }
+    h = HashArray(s.vBulletX, h);
+    h = HashArray(s.vBulletY, h);
+    h = HashArray(s.vBulletLife, h);
+    h = HashArray(s.vDropX, h);
+    return HashArray(s.vDropTimer, h);
+  }
+
+  size_t GetDrops() const { return m_state.vDropX.size(); } ///< Drops left.
+};
+
+/// Scripted input: each player runs one way for a while and then the other,
+/// and now and then jumps, shoots, drops an item or drops through a
+/// platform, at times that look random but are the same on every run.
+/// \param player Player
+/// \param frame Frame
+/// \return Input
+
+static SPlayerInput Script(uint32_t player, uint32_t frame) {
+  auto roll = [&](uint32_t salt) {
+    return (uint32_t)(HashValue(frame * 4 + player, salt) >> 40) % 1000;
+  };
+
+  SPlayerInput in;
+  const uint64_t leg = HashValue((frame / 150) * 4 + player);
+  in.Set(leg & 1 ? eInput::Left : eInput::Right);
+  if (roll(1) < 25) in.Set(eInput::Jump);
+  if (roll(2) < 60) in.Set(eInput::Shoot);
+  if (roll(3) < 10) in.Set(eInput::Attack);
+  if (roll(4) < 5) in.Set(eInput::Down);
+  return in;
+}
+
+/// \brief The result of one run.
+struct SRun {
+  uint64_t nHash = 0;    ///< State hash with every input in.
+  uint32_t nStalls = 0;  ///< Frames waited for player 1.
+  uint32_t nLate = 0;    ///< Inputs too late to roll back for.
+  uint32_t nRollbacks = 0; ///< Rollbacks.
+  uint32_t nFrames = 0;  ///< Frames run again in them.
+  double fTime = 0.0;    ///< Time run again in ms.
+};
+
+/// Run the game for a number of frames with player 1's input arriving late,
+/// then let every packet in flight arrive and roll back for the last time.
+/// \param sim Game
+/// \param frames Frames to run
+/// \param depth Rollback depth
+/// \param delay Delay in ms
+/// \param jitter Most jitter in ms
+/// \param stats [in, out] Rollbacks by depth, added to
+/// \return Result
+
+static SRun Run(CRollbackSim& sim, uint32_t frames, uint32_t depth,
+                double delay, double jitter,
+                std::vector<SRollbackStat>& stats) {
+  CRollback rollback(2, depth);
+  CLoopbackPeer peer(delay, jitter);
+  std::vector<SInputPacket> packets;
+  SRun run;
+
+  rollback.SetCallbacks([&](uint32_t f) { sim.Save(f); },
+                        [&](uint32_t f) { sim.Load(f); },
+                        [&](uint32_t, const SPlayerInput* in) { sim.Step(in); });
+
+  uint32_t sent = 0;  // player 1 keeps to its own clock, and stalls too
+  for (uint32_t tick = 0; rollback.GetFrame() < frames; ++tick) {
+    const double now = tick * g_fDt * 1000.0;
+    for (; sent <= tick && sent < frames && sent < rollback.GetFrame() + depth;
+         ++sent) {
+      SInputPacket packet;
+      packet.nFrame = sent;
+      packet.nPlayer = 1;
+      packet.input = Script(1, sent);
+      peer.Send(packet, sent * g_fDt * 1000.0);
+    }
+
+    packets.clear();
+    peer.Receive(now, packets);
+    for (const SInputPacket& p : packets)
+      rollback.AddInput(p.nPlayer, p.nFrame, p.input);
+
+    if (!rollback.CanAdvance()) {
+      ++run.nStalls;
+      continue;
+    }
+
+    const uint32_t f = rollback.GetFrame();
+    rollback.AddInput(0, f, Script(0, f));
+    rollback.Advance();
+  }
+
+  packets.clear();
+  peer.Receive(1e300, packets);
+  for (const SInputPacket& p : packets)
+    rollback.AddInput(p.nPlayer, p.nFrame, p.input);
+  rollback.BeginFrame();  // the state before frame `frames`, all inputs in
+  run.nHash = sim.Hash();
+  run.nLate = rollback.GetLate();
+
+  const std::vector<SRollbackStat>& s = rollback.GetStats();
+  for (size_t d = 0; d < s.size(); ++d) {
+    run.nRollbacks += s[d].nCount;
+    run.nFrames += s[d].nCount * (uint32_t)d;
+    run.fTime += s[d].fTime;
+    if (d >= stats.size()) stats.resize(d + 1);
+    stats[d].nCount += s[d].nCount;
+    stats[d].fTime += s[d].fTime;
+  }
+
+  return run;
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if every run ends in the same state as with no delay, else 1
+
+int RollbackBench(int argc, char* argv[]) {
+  int w = 256, h = 64, drops = 1000;
+  uint32_t frames = 3600, depth = 8;
+  double jitter = 30.0;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-w")) w = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-h")) h = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-drops")) drops = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-depth")) depth = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-jitter")) jitter = atof(argv[i + 1]);
+  }
+
+  const std::string tiles = GenerateMap(w, h, 1);
+  printf("2 players, %u frames, %d drops, depth %u, jitter %.0f ms\n", frames,
+         drops, depth, jitter);
+
+  uint64_t reference;  // both inputs known at once
+  {
+    CRollbackSim sim(tiles, w, h, drops, depth);
+    SPlayerInput in[2];
+    for (uint32_t f = 0; f < frames; ++f) {
+      in[0] = Script(0, f);
+      in[1] = Script(1, f);
+      sim.Step(in);
+    }
+    reference = sim.Hash();
+  }
+
+  {  // snapshot costs, with the arrays already grown
+    CRollbackSim sim(tiles, w, h, drops, depth);
+    const int reps = 10000;
+    sim.Save(0);
+    CStopwatch sw;
+    for (int i = 0; i < reps; ++i) sim.Save(i);
+    const double save = sw.GetTime();
+    sw.Restart();
+    for (int i = 0; i < reps; ++i) sim.Load(i);
+    const double load = sw.GetTime();
+    printf("snapshot of %zu drops: save %.2f us, load %.2f us\n",
+           sim.GetDrops(), 1000.0 * save / reps, 1000.0 * load / reps);
+  }
+
+  printf("delay  rollbacks  frames  ms total  stalls  late  state\n");
+  std::vector<SRollbackStat> stats;
+  bool ok = true;
+
+  for (double delay : {0.0, 16.0, 50.0, 100.0, 150.0}) {
+    CRollbackSim sim(tiles, w, h, drops, depth);
+    const SRun r = Run(sim, frames, depth, delay, jitter, stats);
+    const bool same = r.nHash == reference;
+    ok = ok && same;
+    printf("%5.0f  %9u  %6u  %8.2f  %6u  %4u  %s\n", delay, r.nRollbacks,
+           r.nFrames, r.fTime, r.nStalls, r.nLate,
+           same ? "matches" : "DIFFERS");
+  }
+
+  printf("depth  rollbacks  us/rollback  us/frame\n");
+  for (size_t d = 1; d < stats.size(); ++d) {
+    if (stats[d].nCount == 0) continue;
+    const double us = 1000.0 * stats[d].fTime / stats[d].nCount;
+    printf("%5zu  %9u  %11.2f  %8.2f\n", d, stats[d].nCount, us, us / d);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+/// \file SaveBench.cpp
+/// \brief Save game benchmark.
+///
+/// Builds a snapshot with a large number of world drops, each with its own
+/// item record and strings as the inventory writes them, and times writing
+/// it, reading it back and starting a background save. Starting the save is
+/// the only part the frame pays for, the write itself is timed on the
+/// writer thread. The file read back is checked against the snapshot.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "Benchmarks.h"
+#include "SaveGame.h"
+
+static const char* g_szFile = "savebench.sav"; ///< Scratch save file.
+
+/// Make a snapshot like the game's, with a full inventory and the given
+/// number of drops and bullets.
+/// \param drops Number of world drops
+/// \param bullets Number of bullets
+/// \return Snapshot
+
+static SSaveGame MakeSave(size_t drops, size_t bullets) {
+  static const char* names[] = {"Health Potion", "Rusty Key", "Apple",
+                                "Wooden Shield"};
+  static const char* descs[] = {"Restores 50 HP", "Opens old doors",
+                                "Restores 10 HP", "Blocks some damage"};
+  std::mt19937 rng(1);
+  SSaveGame save;
+
+  save.player = {12.5f, 30.0f, 5.0f, -2.0f, 80, 1};
+  save.inventory = {3, 3};
+
+  auto add = [&]() {
+    const int k = rng() % 4;
+    SSaveItem r = {k + 1, 20u + k, (uint32_t)k, 1 + (int)(rng() % 20), 20,
+                   1, save.AddString(names[k]), save.AddString(descs[k])};
+    save.vItems.push_back(r);
+    return (uint32_t)save.vItems.size() - 1;
+  };
+
+  for (int i = 0; i < 24; ++i) save.vSlots.push_back(add() + 1);
+
+  for (size_t i = 0; i < drops; ++i) {
+    SSaveDrop d = {add(), (float)(rng() % 16384), (float)(rng() % 2048),
+                   (rng() % 1000) * 0.01f, 0.0f};
+    save.vDrops.push_back(d);
+  }
+
+  for (size_t i = 0; i < bullets; ++i)
+    save.vBullets.push_back({(float)i, 10.0f, 15.0f, 0.0f, 1.5f});
+
+  return save;
+}
+
+/// Whether two snapshots hold the same records.
+/// \param a Snapshot
+/// \param b Snapshot
+/// \return True if every record matches
+
+static bool Same(const SSaveGame& a, const SSaveGame& b) {
+  auto same = [](const void* p, const void* q, size_t n) {
+    return n == 0 || !memcmp(p, q, n);
+  };
+
+  return same(&a.player, &b.player, sizeof(a.player)) &&
+         same(&a.inventory, &b.inventory, sizeof(a.inventory)) &&
+         a.vSlots == b.vSlots && a.strStrings == b.strStrings &&
+         a.vItems.size() == b.vItems.size() &&
+         same(a.vItems.data(), b.vItems.data(),
+              a.vItems.size() * sizeof(SSaveItem)) &&
+         a.vDrops.size() == b.vDrops.size() &&
+         same(a.vDrops.data(), b.vDrops.data(),
+              a.vDrops.size() * sizeof(SSaveDrop)) &&
+         a.vBullets.size() == b.vBullets.size() &&
+         same(a.vBullets.data(), b.vBullets.data(),
+              a.vBullets.size() * sizeof(SSaveBullet));
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 on success, 1 if a save fails or does not read back the same
+
+int SaveBench(int argc, char* argv[]) {
+  size_t drops = 100000, bullets = 1000;
+  int reps = 10;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-drops")) drops = (size_t)atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-bullets")) bullets = (size_t)atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-reps")) reps = atoi(argv[i + 1]);
+  }
+
+  const SSaveGame save = MakeSave(drops, bullets);
+  SSaveGame loaded;
+  double write = 0.0, read = 0.0, start = 0.0, background = 0.0;
+  bool ok = true;
+
+  for (int r = 0; r < reps && ok; ++r) {
+    CStopwatch sw;
+    ok = WriteSaveGame(g_szFile, save);
+    write += sw.GetTime();
+
+    sw.Restart();
+    ok = ok && ReadSaveGame(g_szFile, loaded) && Same(save, loaded);
+    read += sw.GetTime();
+
+    CSaveWriter writer;
+    SSaveGame copy = save;  // the game builds a fresh snapshot each time
+    sw.Restart();
+    ok = ok && writer.Start(g_szFile, std::move(copy));
+    start += sw.GetTime();
+    ok = ok && writer.Wait();
+    background += writer.GetLastTime();
+  }
+
+  FILE* pFile = fopen(g_szFile, "rb");
+  long size = 0;
+  if (pFile) {
+    fseek(pFile, 0, SEEK_END);
+    size = ftell(pFile);
+    fclose(pFile);
+  }
+  remove(g_szFile);
+
+  printf("%zu drops, %zu bullets, %.1f MB file, %d reps\n", drops, bullets,
+         size / 1048576.0, reps);
+  printf("write       %8.2f ms\n", write / reps);
+  printf("read        %8.2f ms\n", read / reps);
+  printf("async start %8.3f ms on the frame, %.2f ms on the writer\n",
+         start / reps, background / reps);
+  printf("%s\n", ok ? "read back matches" : "SAVE OR READ BACK FAILED");
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+/// \file SimdBench.cpp
+/// \brief Batch float kernel benchmark.
+///
+/// Times each kernel in SimdKernels.h over a large array on every path the
+/// machine supports, and checks that each path's output is bit-for-bit the
+/// same as the scalar path's, on the large array and on every small size up
+/// to a few vectors, so that the leftover elements are checked as well. It
+/// also prints how far the polynomial bob is from `std::sin()`.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "SimdKernels.h"
+
+/// \brief Kernel inputs and outputs, one array per field.
+struct SArrays {
+  std::vector<float> vLife;  ///< Lifetimes.
+  std::vector<uint8_t> vDead; ///< Expiry mask.
+  std::vector<float> vX;      ///< Positions x.
+  std::vector<float> vY;      ///< Positions y.
+  std::vector<float> vVX;     ///< Velocities x.
+  std::vector<float> vVY;     ///< Velocities y.
+  std::vector<float> vTimer;  ///< Bob timers.
+  std::vector<float> vBob;    ///< Bob offsets.
+
+  /// Fill with random values, the same ones for the same seed.
+  SArrays(size_t n, uint32_t seed)
+      : vLife(n), vDead(n), vX(n), vY(n), vVX(n), vVY(n), vTimer(n), vBob(n) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+
+    for (size_t i = 0; i < n; ++i) {
+      vLife[i] = 1.0f + u(rng);  // some already expired after one update
+      vX[i] = 512.0f * u(rng);
+      vY[i] = 64.0f * u(rng);
+      vVX[i] = 15.0f * u(rng);
+      vVY[i] = 15.0f * u(rng);
+      vTimer[i] = 50.0f + 50.0f * u(rng);
+    }
+  }
+
+  /// Run every kernel once.
+  /// \return Number of expired elements
+  size_t Run(float dt) {
+    const size_t n = vLife.size();
+    SimdAdd(vLife.data(), n, -dt);
+    const size_t dead = SimdExpired(vLife.data(), n, vDead.data());
+    SimdIntegrate(vX.data(), vY.data(), vVX.data(), vVY.data(), n, -9.8f, dt);
+    SimdBob(vTimer.data(), n, 2.5f, 6.0f, vBob.data());
+    return dead;
+  }
+
+  /// Whether every array is bit-for-bit the same as another's.
+  bool operator==(const SArrays& a) const {
+    auto same = [](const std::vector<float>& p, const std::vector<float>& q) {
+      return p.size() == q.size() &&
+             (p.empty() || !memcmp(p.data(), q.data(), p.size() * 4));
+    };
+    return same(vLife, a.vLife) && vDead == a.vDead && same(vX, a.vX) &&
+           same(vY, a.vY) && same(vVY, a.vVY) && same(vBob, a.vBob);
+  }
+};
+
+/// Time each kernel on one path and print a row in ns per element.
+/// \param n Number of elements
+/// \param reps Number of repetitions
+
+static void Time(size_t n, int reps) {
+  SArrays a(n, 1);
+  const float dt = 1.0f / 60.0f;
+  double add = 0.0, expired = 0.0, integrate = 0.0, bob = 0.0;
+
+  for (int r = 0; r < reps; ++r) {
+    CStopwatch sw;
+    SimdAdd(a.vLife.data(), n, -dt);
+    add += sw.GetTime();
+
+    sw.Restart();
+    SimdExpired(a.vLife.data(), n, a.vDead.data());
+    expired += sw.GetTime();
+
+    sw.Restart();
+    SimdIntegrate(a.vX.data(), a.vY.data(), a.vVX.data(), a.vVY.data(), n,
+                  -9.8f, dt);
+    integrate += sw.GetTime();
+
+    sw.Restart();
+    SimdBob(a.vTimer.data(), n, 2.5f, 6.0f, a.vBob.data());
+    bob += sw.GetTime();
+  }
+
+  const double scale = 1e6 / ((double)n * reps);  // ms to ns per element
+  printf("%-6s %9.3f %9.3f %9.3f %9.3f\n", GetSimdPathName(GetSimdPath()),
+         add * scale, expired * scale, integrate * scale, bob * scale);
+}
+
+/// Check one path against the scalar path over a few updates.
+/// \param path Path to check
+/// \param n Number of elements
+/// \return True if the results are the same
+
+static bool Check(eSimdPath path, size_t n) {
+  SArrays scalar(n, 2), simd(n, 2);
+
+  for (int f = 0; f < 4; ++f) {
+    SetSimdPath(eSimdPath::Scalar);
+    const size_t expected = scalar.Run(1.0f / 60.0f);
+    SetSimdPath(path);
+    if (simd.Run(1.0f / 60.0f) != expected || !(simd == scalar)) return false;
+  }
+
+  return true;
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 on success, 1 if a path differs from the scalar path
+
+int SimdBench(int argc, char* argv[]) {
+  size_t n = 1000000;
+  int reps = 20;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-n")) n = (size_t)atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-reps")) reps = atoi(argv[i + 1]);
+  }
+
+  const eSimdPath best = GetBestSimdPath();
+  int failed = 0;
+
+  printf("%zu elements, %d reps, best path %s\n", n, reps,
+         GetSimdPathName(best));
+  printf("path   ns/add    ns/expire ns/integr ns/bob\n");
+
+  for (int p = 0; p <= (int)best; ++p) {
+    SetSimdPath((eSimdPath)p);
+    Time(n, reps);
+  }
+
+  for (int p = 1; p <= (int)best; ++p) {
+    bool ok = Check((eSimdPath)p, n);
+    for (size_t k = 0; k <= 33 && ok; ++k) ok = Check((eSimdPath)p, k);
+    printf("%-6s %s scalar\n", GetSimdPathName((eSimdPath)p),
+           ok ? "matches" : "DIFFERS FROM");
+    failed += !ok;
+  }
+
+  SetSimdPath(best);
+
+  SArrays a(n, 3);
+  a.Run(0.0f);
+  float worst = 0.0f;
+  for (size_t i = 0; i < n; ++i) {
+    const float exact = std::sin(a.vTimer[i] * 2.5f) * 6.0f;
+    worst = std::max(worst, std::fabs(a.vBob[i] - exact));
+  }
+  printf("bob max error against std::sin %g pixels\n", worst);
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,231 @@
+/// \file SpriteBench.cpp
+/// \brief Sprite queue check and benchmark.
+///
+/// Fills a CSpriteQueue each frame with sprites in random layers and random
+/// submission order, the way a busy frame mixes tiles, drops, players,
+/// bullets and particles, then flushes it to a mock renderer that counts a
+/// texture bind every time the sprite index changes, as LSpriteRenderer does.
+/// Each frame is checked: every sprite is drawn once, layers come out back
+/// to front, sprites with the same layer and sprite index keep their
+/// submission order, the queue's sorted batch break count is the number of
+/// binds the renderer made, and that is the least there can be, one per
+/// sprite index in each layer. With a texture table each layer's atlas
+/// pages must also come out in one run each. The frames are run without a
+/// texture table and with one, and the time to fill and sort is printed.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "SpriteQueue.h"
+
+static const UINT g_nLayers = (UINT)eSpriteLayer::Size;  ///< Layer count.
+
+/// \brief What was submitted, indexed by submission order.
+struct SSubmitted {
+  std::vector<UINT> vLayer;  ///< Layer of each sprite.
+  std::vector<UINT> vPage;   ///< Texture table entry of each sprite.
+};
+
+/// \brief A renderer that draws nothing and checks what it is given.
+///
+/// The queue puts each sprite's submission index in its frame number, so
+/// that the renderer can look up what it was submitted with.
+class CMockRenderer {
+ private:
+  const SSubmitted* m_pSubmitted = nullptr; ///< What was submitted.
+  UINT m_nBound = 0;         ///< Sprite index of the bound texture.
+  int m_nLast = -1;          ///< Submission index of the last draw.
+  std::set<UINT> m_setDone;  ///< Pages finished with in this layer.
+
+ public:
+  size_t m_nDraws = 0;  ///< Sprites drawn.
+  UINT m_nBinds = 0;    ///< Texture binds.
+  bool m_bOrdered = true;  ///< Layers in order, stable and pages in runs.
+  std::vector<bool> m_vDrawn; ///< Whether each sprite has been drawn.
+
+  /// \brief Start a frame.
+  /// \param submitted What was submitted
+  void Begin(const SSubmitted* submitted) {
+    m_pSubmitted = submitted;
+    m_nLast = -1;
+    m_setDone.clear();
+    m_nDraws = 0;
+    m_nBinds = 0;
+    m_bOrdered = true;
+    m_vDrawn.assign(submitted->vLayer.size(), false);
+  }
+
+  /// \brief Draw a sprite, binding its texture if it is not bound.
+  /// \param pDesc Sprite descriptor
+  void Draw(const LSpriteDesc2D* pDesc) {
+    const int i = (int)pDesc->m_nCurrentFrame;
+    const std::vector<UINT>& layer = m_pSubmitted->vLayer;
+    const std::vector<UINT>& page = m_pSubmitted->vPage;
+
+    if (m_nLast >= 0) {
+      const int j = m_nLast;
+      if (layer[i] < layer[j]) m_bOrdered = false;  // back to front
+      else if (layer[i] > layer[j]) m_setDone.clear();
+      else if (page[i] != page[j]) {
+        m_setDone.insert(page[j]);
+        if (m_setDone.count(page[i])) m_bOrdered = false;  // page split
+      } else if (pDesc->m_nSpriteIndex == m_nBound && i < j)
+        m_bOrdered = false;  // not stable
+    }
+
+    if (m_nDraws == 0 || pDesc->m_nSpriteIndex != m_nBound) {
+      m_nBound = pDesc->m_nSpriteIndex;
+      m_nBinds++;
+    }
+
+    if (m_vDrawn[i]) m_bOrdered = false;  // drawn twice
+    m_vDrawn[i] = true;
+    m_nLast = i;
+    m_nDraws++;
+  }
+};  // CMockRenderer
+
+/// \brief What a run measured.
+struct SResult {
+  double fUnsorted = 0.0;  ///< Batch breaks in submission order per frame.
+  double fSorted = 0.0;    ///< Batch breaks after sorting per frame.
+  double fTime = 0.0;      ///< Fill and sort time per frame in us.
+  int nFailed = 0;         ///< Frames that failed a check.
+};
+
+/// Run the frames.
+/// \param sprites Sprites per frame
+/// \param textures Number of sprite indices
+/// \param frames Frames to run
+/// \param pTextures Texture table, or nullptr
+/// \return What was measured
+
+static SResult Run(int sprites, int textures, int frames,
+                   const std::vector<UINT>* pTextures) {
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<int> sprite(0, textures - 1);
+  std::uniform_int_distribution<int> percent(0, 99);
+
+  CSpriteQueue queue;
+  CMockRenderer renderer;
+  SSubmitted submitted;
+  LSpriteDesc2D desc;
+  SResult r;
+
+  for (int f = 0; f < frames; ++f) {
+    submitted.vLayer.clear();
+    submitted.vPage.clear();
+
+    std::vector<std::pair<UINT, UINT>> sorted;  // layer and sprite index
+    std::vector<LSpriteDesc2D> vDesc;
+    std::vector<UINT> vLayer;
+    while ((int)vDesc.size() < sprites) {
+      const UINT s = (UINT)sprite(rng);
+      UINT layer = s * g_nLayers / textures;  // each sprite has a layer
+      if (percent(rng) < 5) layer = (UINT)eSpriteLayer::Debug;
+      const int n = percent(rng) < 2 ? 8 : 1;  // background copies
+
+      for (int k = 0; k < n; ++k) {
+        desc.m_nSpriteIndex = s;
+        desc.m_nCurrentFrame = (UINT)vDesc.size();
+        vDesc.push_back(desc);
+        vLayer.push_back(layer);
+        submitted.vLayer.push_back(layer);
+        submitted.vPage.push_back(pTextures ? (*pTextures)[s] : s);
+      }
+      sorted.push_back({layer, s});
+    }
+
+    CStopwatch sw;
+    queue.Clear();
+    for (size_t i = 0; i < vDesc.size();) {
+      size_t n = 1;
+      while (i + n < vDesc.size() && vLayer[i + n] == vLayer[i] &&
+             vDesc[i + n].m_nSpriteIndex == vDesc[i].m_nSpriteIndex)
+        ++n;
+      if (n == 1) queue.Add(vDesc[i], (eSpriteLayer)vLayer[i]);
+      else queue.Add(&vDesc[i], n, (eSpriteLayer)vLayer[i]);
+      i += n;
+    }
+    queue.Sort(pTextures);
+    r.fTime += sw.GetTime();
+
+    renderer.Begin(&submitted);
+    queue.Flush(&renderer, pTextures);
+
+    std::sort(sorted.begin(), sorted.end());
+    const size_t least =
+        std::unique(sorted.begin(), sorted.end()) - sorted.begin();
+
+    const bool ok = renderer.m_nDraws == vDesc.size() &&
+                    renderer.m_bOrdered &&
+                    renderer.m_nBinds == queue.GetBatchBreaks() &&
+                    queue.GetBatchBreaks() == least &&
+                    queue.GetUnsortedBatchBreaks() >= least;
+    if (!ok) r.nFailed++;
+
+    r.fUnsorted += queue.GetUnsortedBatchBreaks();
+    r.fSorted += queue.GetBatchBreaks();
+  }  // for
+
+  r.fUnsorted /= frames;
+  r.fSorted /= frames;
+  r.fTime = 1000.0 * r.fTime / frames;
+  return r;
+}  // Run
+
+/// Print a run's row.
+/// \param name Row name
+/// \param r What was measured
+/// \param frames Frames run
+
+static void Print(const char* name, const SResult& r, int frames) {
+  printf("%-6s  %9.1f  %7.1f  %8.1f  %4d/%d\n", name, r.fUnsorted,
+         r.fSorted, r.fTime, frames - r.nFailed, frames);
+}
+
+/// Run the benchmark.
+/// \param argc Argument count
+/// \param argv Arguments
+/// \return 0 if every frame passed its checks, else 1
+
+int SpriteBench(int argc, char* argv[]) {
+  int sprites = 20000, textures = 48, frames = 200;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-sprites")) sprites = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-textures")) textures = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "-frames")) frames = atoi(argv[i + 1]);
+  }
+
+  sprites = std::max(sprites, 1);
+  textures = std::min(std::max(textures, 1), 0xFFFF);
+  frames = std::max(frames, 1);
+
+  // two thirds of the sprites on three atlas pages, the rest standalone,
+  // numbered as CTextureAtlas numbers them
+  std::vector<UINT> atlas(textures);
+  for (int s = 0; s < textures; ++s)
+    atlas[s] = s < textures * 2 / 3 ? (UINT)s % 3 : 0x100 + (UINT)s;
+
+  printf("%d sprites of %d textures in %u layers, %d frames\n", sprites,
+         textures, g_nLayers, frames);
+  printf("table   unsorted   sorted   sort us  passed\n");
+
+  const SResult none = Run(sprites, textures, frames, nullptr);
+  Print("none", none, frames);
+  const SResult pages = Run(sprites, textures, frames, &atlas);
+  Print("atlas", pages, frames);
+
+  const bool ok = none.nFailed == 0 && pages.nFailed == 0;
+  printf(ok ? "ok\n" : "FAILED: a frame was drawn out of order, or its "
+                       "batch breaks were not the binds or not the least\n");
+  return ok ? 0 : 1;
+}  // SpriteBench
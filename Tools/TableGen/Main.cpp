@@ -0,0 +1,534 @@
+/// \file Main.cpp
+/// \brief Offline sprite and sound table generator.
+///
+/// Reads the sprite and sound lists from `gamesettings.xml` and writes
+/// `My Game\GameTables.h`, which holds `eSprite`, `eSound` and a `constexpr`
+/// table for each, in list order. A sprite's row has its tag name, its file,
+/// whether the first frame needs it, the image size read from the PNG header
+/// and, if the atlas builder has been run, its atlas page and texture
+/// coordinates. A sound's row has its tag name, its file and its mixer
+/// settings. The game is built with this run first, from the solution
+/// directory:
+///
+///     TableGen
+///
+/// so that the game never looks a sprite or sound up by name, and a sprite
+/// renamed or removed in the XML but still used by the code is a compile
+/// error. Anything that would make a bad table stops the build: a missing
+/// file, two tags with the same name or enum name, an enum name that is not
+/// an identifier, or a `sprite` attribute anywhere in the XML that names no
+/// sprite. The header is only written when it changes, so that an unchanged
+/// XML file does not rebuild the game.
+
+#include <cctype>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "tinyxml2.h"
+
+static const char* g_szSettings = "Media\\XML\\gamesettings.xml";  ///< Input.
+static const char* g_szManifest = "Media\\XML\\atlas.xml";  ///< Atlas input.
+static const char* g_szOutput = "My Game\\GameTables.h";    ///< Output.
+
+/// \brief A sprite tag and what is known about its image.
+struct SSprite {
+  std::string strName;   ///< Tag name.
+  std::string strId;     ///< Enum name.
+  std::string strFile;   ///< File, with the list's path.
+  bool bFirstFrame = false;  ///< Loaded before the first frame.
+  unsigned nWidth = 0;   ///< Width in pixels, 0 if unknown.
+  unsigned nHeight = 0;  ///< Height in pixels, 0 if unknown.
+  int nPage = -1;        ///< Atlas page, -1 if standalone.
+  float fU0 = 0.0f;      ///< Left texture coordinate.
+  float fV0 = 0.0f;      ///< Top texture coordinate.
+  float fU1 = 0.0f;      ///< Right texture coordinate.
+  float fV1 = 0.0f;      ///< Bottom texture coordinate.
+};
+
+/// \brief A sound tag.
+struct SSound {
+  std::string strName;     ///< Tag name.
+  std::string strId;       ///< Enum name.
+  std::string strFile;     ///< File, with the list's path.
+  float fVolume = 1.0f;    ///< Volume.
+  float fPriority = 1.0f;  ///< Priority.
+  float fRadius = 1024.0f; ///< Fade radius in pixels.
+  unsigned nInstances = 8; ///< Most voices at once.
+  bool bLoop = false;      ///< Repeats.
+  bool bStream = false;    ///< Streamed from disk.
+};
+
+static int g_nErrors = 0;  ///< Errors found, any of which stops the build.
+
+/// Print an error in the form Visual Studio lists in its error window.
+/// \param fmt Format string
+/// \param ... Arguments
+
+static void Error(const char* fmt, ...) {
+  printf("%s: error: ", g_szSettings);
+  va_list args;
+  va_start(args, fmt);
+  vprintf(fmt, args);
+  va_end(args);
+  printf("\n");
+  g_nErrors++;
+}
+
+/// Append formatted text to a string.
+/// \param s String
+/// \param fmt Format string
+/// \param ... Arguments
+
+static void Append(std::string& s, const char* fmt, ...) {
+  char buffer[512];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buffer, sizeof(buffer), fmt, args);
+  va_end(args);
+  s += buffer;
+}
+
+/// Write a float as a C++ literal, which needs a point or an exponent.
+/// \param f Value
+/// \return Literal
+
+static std::string Float(float f) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%g", f);
+  std::string s = buffer;
+  if (s.find_first_of(".e") == std::string::npos) s += ".0";
+  return s + "f";
+}
+
+/// Write a string as a C++ string literal.
+/// \param s String
+/// \return Literal
+
+static std::string Quote(const std::string& s) {
+  std::string q = "\"";
+  for (char c : s) {
+    if (c == '\\' || c == '"') q += '\\';
+    q += c;
+  }
+  return q + "\"";
+}
+
+/// Make the enum name for a tag name: each part between underscores with
+/// its first letter capitalized, so `inventory_slot` becomes `InventorySlot`.
+/// \param name Tag name
+/// \return Enum name
+
+static std::string PascalCase(const std::string& name) {
+  std::string id;
+  bool up = true;
+  for (char c : name) {
+    if (c == '_') up = true;
+    else {
+      id += up ? (char)toupper((unsigned char)c) : c;
+      up = false;
+    }
+  }
+  return id;
+}
+
+/// Check that an enum name is a C++ identifier and not `Size`, which ends
+/// every enum.
+/// \param id Enum name
+/// \return True if it can be used
+
+static bool IsIdentifier(const std::string& id) {
+  if (id.empty() || id == "Size" || isdigit((unsigned char)id[0]))
+    return false;
+  for (char c : id)
+    if (!isalnum((unsigned char)c) && c != '_') return false;
+  return true;
+}
+
+/// Read an image's size from its PNG header.
+/// \param file File name
+/// \param w [out] Width in pixels
+/// \param h [out] Height in pixels
+/// \return 0 if it was read, 1 if the file is not a PNG, -1 if it is missing
+
+static int ReadPngSize(const std::string& file, unsigned& w, unsigned& h) {
+  std::ifstream input(file, std::ios::binary);
+  if (!input) return -1;
+
+  static const unsigned char signature[] = {0x89, 'P', 'N', 'G',
+                                            '\r', '\n', 0x1a, '\n'};
+  unsigned char header[24];  // signature, IHDR length and type, w, h
+  if (!input.read((char*)header, sizeof(header)) ||
+      memcmp(header, signature, 8) || memcmp(header + 12, "IHDR", 4))
+    return 1;
+
+  auto be = [&](int at) {
+    return (unsigned)header[at] << 24 | (unsigned)header[at + 1] << 16 |
+           (unsigned)header[at + 2] << 8 | (unsigned)header[at + 3];
+  };
+  w = be(16);
+  h = be(20);
+  return 0;
+}
+
+/// Check a tag's name and enum name, and that no earlier tag of its list
+/// has either.
+/// \param kind "sprite" or "sound"
+/// \param name Tag name
+/// \param id Enum name
+/// \param names Names so far
+/// \param ids Enum names so far
+
+static void CheckNames(const char* kind, const std::string& name,
+                       const std::string& id, std::set<std::string>& names,
+                       std::set<std::string>& ids) {
+  if (!names.insert(name).second)
+    Error("two %ss are named %s", kind, name.c_str());
+  if (!IsIdentifier(id))
+    Error("%s %s has enum name '%s', which is not an identifier, add an id",
+          kind, name.c_str(), id.c_str());
+  else if (!ids.insert(id).second)
+    Error("two %ss have enum name %s, give one an id", kind, id.c_str());
+}
+
+/// Check that every `sprite` attribute under an element names a sprite.
+/// Parallax layers, animation clips and particle emitters name their sprite
+/// this way.
+/// \param p Element
+/// \param names Sprite names
+
+static void CheckSpriteRefs(const tinyxml2::XMLElement* p,
+                            const std::set<std::string>& names) {
+  for (; p; p = p->NextSiblingElement()) {
+    const char* sprite = p->Attribute("sprite");
+    if (sprite && !names.count(sprite))
+      Error("<%s sprite=\"%s\"> names no sprite", p->Name(), sprite);
+    CheckSpriteRefs(p->FirstChildElement(), names);
+  }
+}
+
+/// Read the sprite list.
+/// \param pSettings Settings root
+/// \param sprites [out] Sprites
+
+static void ReadSprites(tinyxml2::XMLElement* pSettings,
+                        std::vector<SSprite>& sprites) {
+  tinyxml2::XMLElement* pList = pSettings->FirstChildElement("sprites");
+  if (!pList) return;
+
+  const char* path = pList->Attribute("path");
+  std::set<std::string> names, ids;
+
+  for (tinyxml2::XMLElement* p = pList->FirstChildElement("sprite"); p;
+       p = p->NextSiblingElement("sprite")) {
+    const char* name = p->Attribute("name");
+    const char* file = p->Attribute("file");
+    if (!name || !file) {
+      Error("a sprite on line %d has no name or file", p->GetLineNum());
+      continue;
+    }
+
+    SSprite s;
+    s.strName = name;
+    s.strId = p->Attribute("id") ? p->Attribute("id") : PascalCase(name);
+    s.strFile = path ? std::string(path) + "\\" + file : std::string(file);
+    s.bFirstFrame = p->BoolAttribute("first", false);
+    CheckNames("sprite", s.strName, s.strId, names, ids);
+
+    const int read = ReadPngSize(s.strFile, s.nWidth, s.nHeight);
+    if (read < 0) Error("sprite %s: cannot open %s", name, s.strFile.c_str());
+    else if (read > 0)
+      printf("%s is not a PNG, its size is left out\n", s.strFile.c_str());
+
+    sprites.push_back(s);
+  }
+}
+
+/// Read the sound list.
+/// \param pSettings Settings root
+/// \param sounds [out] Sounds
+
+static void ReadSounds(tinyxml2::XMLElement* pSettings,
+                       std::vector<SSound>& sounds) {
+  tinyxml2::XMLElement* pList = pSettings->FirstChildElement("sounds");
+  if (!pList) return;
+
+  const char* path = pList->Attribute("path");
+  std::set<std::string> names, ids;
+
+  for (tinyxml2::XMLElement* p = pList->FirstChildElement("sound"); p;
+       p = p->NextSiblingElement("sound")) {
+    const char* name = p->Attribute("name");
+    const char* file = p->Attribute("file");
+    if (!name || !file) {
+      Error("a sound on line %d has no name or file", p->GetLineNum());
+      continue;
+    }
+
+    SSound s;
+    s.strName = name;
+    s.strId = p->Attribute("id") ? p->Attribute("id") : PascalCase(name);
+    s.strFile = path ? std::string(path) + "\\" + file : std::string(file);
+    s.fVolume = p->FloatAttribute("volume", 1.0f);
+    s.fPriority = p->FloatAttribute("priority", 1.0f);
+    s.fRadius = p->FloatAttribute("radius", 1024.0f);
+    s.nInstances = p->UnsignedAttribute("instances", 8);
+    s.bLoop = p->BoolAttribute("loop", false);
+    s.bStream = p->BoolAttribute("stream", false);
+    CheckNames("sound", s.strName, s.strId, names, ids);
+
+    if (!std::ifstream(s.strFile, std::ios::binary))
+      Error("sound %s: cannot open %s", name, s.strFile.c_str());
+
+    sounds.push_back(s);
+  }
+}
+
+/// Give the sprites their atlas regions from the atlas builder's manifest,
+/// if there is one.
+/// \param sprites Sprites
+/// \param pages [out] Atlas page count
+/// \param efficiency [out] Packing efficiency
+/// \return Number of sprites in the atlas
+
+static size_t ReadAtlas(std::vector<SSprite>& sprites, unsigned& pages,
+                        float& efficiency) {
+  pages = 0;
+  efficiency = 0.0f;
+
+  tinyxml2::XMLDocument doc;
+  if (doc.LoadFile(g_szManifest) != tinyxml2::XML_SUCCESS) return 0;
+  tinyxml2::XMLElement* pAtlas = doc.FirstChildElement("atlas");
+  if (!pAtlas) return 0;
+
+  efficiency = pAtlas->FloatAttribute("efficiency", 0.0f);
+  for (tinyxml2::XMLElement* p = pAtlas->FirstChildElement("page"); p;
+       p = p->NextSiblingElement("page"))
+    pages++;
+
+  std::map<std::string, SSprite*> byName;
+  for (SSprite& s : sprites) byName[s.strName] = &s;
+  size_t found = 0;
+
+  for (tinyxml2::XMLElement* p = pAtlas->FirstChildElement("region"); p;
+       p = p->NextSiblingElement("region")) {
+    const char* name = p->Attribute("name");
+    auto it = name ? byName.find(name) : byName.end();
+    if (it == byName.end()) {
+      printf("%s: region %s is no sprite, run AtlasBuilder again\n",
+             g_szManifest, name ? name : "");
+      continue;
+    }
+
+    SSprite& s = *it->second;
+    s.nPage = p->IntAttribute("page", 0);
+    s.fU0 = p->FloatAttribute("u0");
+    s.fV0 = p->FloatAttribute("v0");
+    s.fU1 = p->FloatAttribute("u1");
+    s.fV1 = p->FloatAttribute("v1");
+    found++;
+  }
+
+  return found;
+}
+
+/// Write the header.
+/// \param sprites Sprites
+/// \param sounds Sounds
+/// \param pages Atlas page count
+/// \param efficiency Packing efficiency
+/// \return Header text
+
+static std::string Generate(const std::vector<SSprite>& sprites,
+                            const std::vector<SSound>& sounds,
+                            unsigned pages, float efficiency) {
+  std::string h;
+
+  h += "/// \\file GameTables.h\n"
+       "/// \\brief Sprite and sound tables, generated from gamesettings.xml."
+       "\n///\n"
+       "/// Written by TableGen before every build of the game. Do not edit "
+       "it, edit\n"
+       "/// the sprite and sound lists in gamesettings.xml instead.\n\n"
+       "#ifndef __L4RC_GAME_GAMETABLES_H__\n"
+       "#define __L4RC_GAME_GAMETABLES_H__\n\n"
+       "#include <cstddef>\n\n"
+       "#include \"Defines.h\"\n\n";
+
+  h += "/// \\brief Sprite enumerated type.\n"
+       "///\n"
+       "/// An enumerated type for the sprites, which will be cast to an "
+       "unsigned\n"
+       "/// integer and used for the index of the corresponding texture in "
+       "graphics\n"
+       "/// memory. `Size` must be last.\n\n"
+       "enum class eSprite : UINT {\n";
+  for (const SSprite& s : sprites)
+    Append(h, "  %s,  ///< %s\n", s.strId.c_str(), s.strName.c_str());
+  h += "  Size  // MUST BE LAST\n};  // eSprite\n\n";
+
+  h += "/// \\brief Sound enumerated type.\n"
+       "///\n"
+       "/// An enumerated type for the sounds, which will be cast to an "
+       "unsigned\n"
+       "/// integer and used for the index of the corresponding sample. "
+       "`Size` must\n"
+       "/// be last.\n\n"
+       "enum class eSound : UINT {\n";
+  for (const SSound& s : sounds)
+    Append(h, "  %s,  ///< %s\n", s.strId.c_str(), s.strName.c_str());
+  h += "  Size  // MUST BE LAST\n};  // eSound\n\n";
+
+  h += "/// \\brief A sprite tag in gamesettings.xml and what is known about "
+       "its image.\n"
+       "struct SSpriteInfo {\n"
+       "  eSprite eIndex;      ///< Sprite index.\n"
+       "  const char* szName;  ///< Tag name in gamesettings.xml.\n"
+       "  const char* szFile;  ///< Image file.\n"
+       "  bool bFirstFrame;    ///< Loaded before the first frame.\n"
+       "  UINT nWidth;         ///< Width in pixels, 0 if unknown.\n"
+       "  UINT nHeight;        ///< Height in pixels, 0 if unknown.\n"
+       "  int nPage;           ///< Atlas page, or -1 if standalone.\n"
+       "  float fU0;           ///< Left texture coordinate on the page.\n"
+       "  float fV0;           ///< Top texture coordinate on the page.\n"
+       "  float fU1;           ///< Right texture coordinate on the page.\n"
+       "  float fV1;           ///< Bottom texture coordinate on the page.\n"
+       "};\n\n";
+
+  h += "/// \\brief A sound tag in gamesettings.xml.\n"
+       "struct SSoundInfo {\n"
+       "  eSound eIndex;       ///< Sound index.\n"
+       "  const char* szName;  ///< Tag name in gamesettings.xml.\n"
+       "  const char* szFile;  ///< Sound file.\n"
+       "  float fVolume;       ///< Volume, 0 to 1.\n"
+       "  float fPriority;     ///< Rank against other sounds.\n"
+       "  float fRadius;       ///< Fades out over this many pixels.\n"
+       "  UINT nInstances;     ///< Most voices of it at once.\n"
+       "  bool bLoop;          ///< Repeats.\n"
+       "  bool bStream;        ///< Read from disk while it plays.\n"
+       "};\n\n";
+
+  h += "/// Every sprite, in `eSprite` order.\n"
+       "static constexpr SSpriteInfo g_pSpriteTable[] = {\n";
+  for (const SSprite& s : sprites) {
+    Append(h, "    {eSprite::%s, %s,\n", s.strId.c_str(),
+           Quote(s.strName).c_str());
+    Append(h, "     %s,\n", Quote(s.strFile).c_str());
+    Append(h, "     %s, %u, %u, %d, %s, %s, %s, %s},\n",
+           s.bFirstFrame ? "true" : "false", s.nWidth, s.nHeight, s.nPage,
+           Float(s.fU0).c_str(), Float(s.fV0).c_str(), Float(s.fU1).c_str(),
+           Float(s.fV1).c_str());
+  }
+  h += "};\n\n";
+
+  h += "/// Every sound, in `eSound` order.\n"
+       "static constexpr SSoundInfo g_pSoundTable[] = {\n";
+  for (const SSound& s : sounds) {
+    Append(h, "    {eSound::%s, %s,\n", s.strId.c_str(),
+           Quote(s.strName).c_str());
+    Append(h, "     %s,\n", Quote(s.strFile).c_str());
+    Append(h, "     %s, %s, %s, %u, %s, %s},\n", Float(s.fVolume).c_str(),
+           Float(s.fPriority).c_str(), Float(s.fRadius).c_str(),
+           s.nInstances, s.bLoop ? "true" : "false",
+           s.bStream ? "true" : "false");
+  }
+  h += "};\n\n";
+
+  Append(h,
+         "static constexpr UINT g_nAtlasPages = %u;  ///< Atlas page count.\n"
+         "static constexpr float g_fAtlasEfficiency = %s;  ///< Packing."
+         "\n\n",
+         pages, Float(efficiency).c_str());
+
+  h += "/// \\brief Check that a table lists its enum in order, so that it "
+       "can be\n"
+       "/// indexed by it.\n"
+       "/// \\param table Table\n"
+       "/// \\return True if row `i` is for enum value `i`\n"
+       "template <class T, size_t n>\n"
+       "constexpr bool IsTableInOrder(const T (&table)[n]) {\n"
+       "  for (size_t i = 0; i < n; ++i)\n"
+       "    if ((size_t)table[i].eIndex != i) return false;\n"
+       "  return true;\n"
+       "}\n\n"
+       "static_assert(sizeof(g_pSpriteTable) / sizeof(g_pSpriteTable[0]) ==\n"
+       "                  (size_t)eSprite::Size,\n"
+       "              \"the sprite table has a row per sprite\");\n"
+       "static_assert(IsTableInOrder(g_pSpriteTable),\n"
+       "              \"the sprite table is in eSprite order\");\n"
+       "static_assert(sizeof(g_pSoundTable) / sizeof(g_pSoundTable[0]) ==\n"
+       "                  (size_t)eSound::Size,\n"
+       "              \"the sound table has a row per sound\");\n"
+       "static_assert(IsTableInOrder(g_pSoundTable),\n"
+       "              \"the sound table is in eSound order\");\n\n"
+       "#endif  //__L4RC_GAME_GAMETABLES_H__\n";
+
+  return h;
+}  // Generate
+
+/// Read the lists, check them, and write the header if it has changed.
+/// \return 0 on success, 1 to stop the build
+
+int main() {
+  tinyxml2::XMLDocument doc;
+  if (doc.LoadFile(g_szSettings) != tinyxml2::XML_SUCCESS) {
+    printf("%s: error: cannot read it\n", g_szSettings);
+    return 1;
+  }
+
+  tinyxml2::XMLElement* pSettings = doc.FirstChildElement("settings");
+  if (!pSettings) {
+    printf("%s: error: no settings tag\n", g_szSettings);
+    return 1;
+  }
+
+  std::vector<SSprite> sprites;
+  std::vector<SSound> sounds;
+  ReadSprites(pSettings, sprites);
+  ReadSounds(pSettings, sounds);
+
+  if (sprites.empty()) Error("there are no sprites");
+  if (sounds.empty()) Error("there are no sounds");
+
+  std::set<std::string> names;
+  for (const SSprite& s : sprites) names.insert(s.strName);
+  CheckSpriteRefs(pSettings->FirstChildElement(), names);
+
+  if (g_nErrors > 0) {
+    printf("%d errors, %s not written\n", g_nErrors, g_szOutput);
+    return 1;
+  }
+
+  unsigned pages = 0;
+  float efficiency = 0.0f;
+  const size_t atlas = ReadAtlas(sprites, pages, efficiency);
+  const std::string text = Generate(sprites, sounds, pages, efficiency);
+
+  std::ifstream old(g_szOutput, std::ios::binary);
+  const std::string oldText((std::istreambuf_iterator<char>(old)),
+                            std::istreambuf_iterator<char>());
+  old.close();
+
+  printf("%zu sprites, %zu in the atlas, %zu sounds\n", sprites.size(),
+         atlas, sounds.size());
+
+  if (text == oldText) {
+    printf("%s is up to date\n", g_szOutput);
+    return 0;
+  }
+
+  std::ofstream output(g_szOutput, std::ios::binary);
+  if (!output.write(text.data(), text.size())) {
+    printf("%s: error: cannot write it\n", g_szOutput);
+    return 1;
+  }
+
+  printf("%s written\n", g_szOutput);
+  return 0;
+}  // main